@@ -0,0 +1,152 @@
+"""
+Dekoder payloadu CBOR z tematu das_tower/measurements/cbor (src/logrec.c,
+logrec_format_cbor) do rekordów w formacie das_tower_data.json.
+
+Payload: {"v": wersja schematu, "r": [[seq, timestamp, ...], ...]}
+Wartości są liczbami całkowitymi: wartość = raw * 10^scale, None = brak odczytu.
+Pole tablicowe (temp_probes) to zagnieżdżona lista.
+"""
+from datetime import datetime, timezone
+
+# Schematy - kolejność i skale jak schema[] w src/logrec.c (LOGREC_VERSION)
+_SCHEMA_V1 = [
+    ("seq", 0),
+    ("timestamp", 0),
+    ("temperature_ds18", -2),
+    ("temperature_dht", -2),
+    ("humidity", -2),
+    ("ph", -2),
+    ("light", -2),
+    ("relay1_on_ms", 0),
+    ("relay1_off_ms", 0),
+    ("flags", 0),
+]
+SCHEMAS = {
+    1: _SCHEMA_V1,
+    2: _SCHEMA_V1 + [("temp_probes", -2)],
+}
+
+FLAG_RELAY1 = 0x01
+FLAG_RELAY2 = 0x02
+FLAG_RELAY1_CYCLE = 0x04
+FLAG_LEVEL = 0x10
+FLAG_LEVEL_VALID = 0x20
+FLAG_PH_FRESH = 0x40
+FLAG_PH_FRESH_VALID = 0x80
+
+
+class CBORError(ValueError):
+    pass
+
+
+def _loads(data, pos):
+    """Dekoduje jeden element CBOR (podzbiór z src/cborenc.c)."""
+    if pos >= len(data):
+        raise CBORError("truncated")
+    initial = data[pos]
+    major, info = initial >> 5, initial & 0x1F
+    pos += 1
+
+    if major == 7:
+        simple = {20: False, 21: True, 22: None}
+        if info not in simple:
+            raise CBORError(f"unsupported simple value {info}")
+        return simple[info], pos
+
+    if info < 24:
+        arg = info
+    elif info <= 27:
+        size = 1 << (info - 24)
+        if pos + size > len(data):
+            raise CBORError("truncated")
+        arg = int.from_bytes(data[pos:pos + size], "big")
+        pos += size
+    else:
+        raise CBORError("indefinite length not supported")
+
+    if major == 0:
+        return arg, pos
+    if major == 1:
+        return -1 - arg, pos
+    if major == 3:
+        if pos + arg > len(data):
+            raise CBORError("truncated")
+        return data[pos:pos + arg].decode("utf-8"), pos + arg
+    if major == 4:
+        items = []
+        for _ in range(arg):
+            item, pos = _loads(data, pos)
+            items.append(item)
+        return items, pos
+    if major == 5:
+        result = {}
+        for _ in range(arg):
+            key, pos = _loads(data, pos)
+            result[key], pos = _loads(data, pos)
+        return result, pos
+    raise CBORError(f"unsupported major type {major}")
+
+
+def loads(data):
+    value, pos = _loads(bytes(data), 0)
+    if pos != len(data):
+        raise CBORError("trailing bytes")
+    return value
+
+
+def _scaled(raw, scale):
+    if raw is None:
+        return None
+    if isinstance(raw, list):
+        return [_scaled(v, scale) for v in raw]
+    if scale >= 0:
+        return raw * 10 ** scale
+    return round(raw / 10 ** -scale, -scale)
+
+
+def to_viewer(raw, schema):
+    """Rekord surowy -> słownik jak linia NDJSON z logrec_format_ndjson()."""
+    values = dict(zip((name for name, _ in schema), raw))
+
+    rec = {}
+    if values.get("timestamp") is not None:
+        ts = datetime.fromtimestamp(values["timestamp"], tz=timezone.utc)
+        rec["timestamp"] = ts.strftime("%Y-%m-%d %H:%M:%S")
+    for name, scale in schema:
+        if name in ("timestamp", "flags") or name.startswith("relay"):
+            continue
+        rec[name] = _scaled(values.get(name), scale)
+
+    flags = values.get("flags")
+    if flags is not None:
+        if flags & FLAG_LEVEL_VALID:
+            rec["level"] = 1 if flags & FLAG_LEVEL else 0
+        if flags & FLAG_PH_FRESH_VALID:
+            rec["ph_fresh"] = bool(flags & FLAG_PH_FRESH)
+        relay_1 = {"active": bool(flags & FLAG_RELAY1)}
+        on_ms, off_ms = values.get("relay1_on_ms"), values.get("relay1_off_ms")
+        if flags & FLAG_RELAY1_CYCLE and on_ms and off_ms:
+            relay_1[str(on_ms)] = off_ms
+        rec["relay_1"] = relay_1
+        rec["relay_2"] = {"active": bool(flags & FLAG_RELAY2)}
+    return rec
+
+
+def decode(payload):
+    """Payload CBOR -> lista rekordów w formacie przeglądarki."""
+    msg = loads(payload)
+    if not isinstance(msg, dict) or "v" not in msg or "r" not in msg:
+        raise CBORError("not a measurement payload")
+    schema = SCHEMAS.get(msg["v"])
+    if schema is None:
+        raise CBORError(f"unknown schema version {msg['v']}")
+    return [to_viewer(raw, schema) for raw in msg["r"]]
+
+
+if __name__ == "__main__":
+    import json
+    import sys
+
+    # Test: python das_tower_cbor.py < payload.cbor
+    for record in decode(sys.stdin.buffer.read()):
+        print(json.dumps(record))
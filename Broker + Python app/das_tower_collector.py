@@ -0,0 +1,156 @@
+import argparse
+import json
+import sys
+from pathlib import Path
+
+import paho.mqtt.client as mqtt
+
+import das_tower_cbor
+
+# ================= CONFIG =================
+
+BROKER_HOST = "localhost"
+BROKER_PORT = 1883
+TOPIC = "das_tower/measurements"
+TOPIC_CBOR = "das_tower/measurements/cbor"
+DATA_FILE = Path(__file__).with_name("das_tower_data.json")
+# seq niższy od ostatniego o więcej niż tyle nie jest już ponowieniem z outboxa,
+# tylko nowym licznikiem (wymiana/formatowanie karty, odtworzenie bez plików dób)
+SEQ_RESTART_WINDOW = 1000
+
+# ==========================================
+
+# Stary format (publikacja bez karty SD) -> format przeglądarki
+LEGACY_KEYS = {
+    "temp_ds18": "temperature_ds18",
+    "temp_dht": "temperature_dht",
+}
+
+
+def from_legacy(msg):
+    rec = {LEGACY_KEYS.get(k, k): v for k, v in msg.items()
+           if not k.startswith("relay")}
+    relay_1 = {"active": bool(msg.get("relay1", False))}
+    if msg.get("relay1_mode") == "cycle":
+        relay_1[str(msg.get("relay1_on_ms", 0))] = msg.get("relay1_off_ms", 0)
+    rec["relay_1"] = relay_1
+    rec["relay_2"] = {"active": bool(msg.get("relay2", False))}
+    return rec
+
+
+class Collector:
+    """
+    Odbiera pomiary z outboxa ESP32 (QoS 1, at-least-once) i dopisuje je do
+    pliku NDJSON czytanego przez das_tower_viewer.py, po jednym rekordzie na
+    linię (także z paczek). Duplikaty (ponowne wysłanie po rozłączeniu) są
+    odrzucane po seq, luki w seq są raportowane. Restart licznika seq w ESP32
+    (seq == 1 albo spadek o więcej niż SEQ_RESTART_WINDOW) ustawia last_seq
+    od nowa zamiast odrzucać kolejne rekordy jako duplikaty.
+    """
+
+    def __init__(self, path):
+        self.path = path
+        self.last_seq = self._last_seq_in_file()
+        self.received = 0
+        self.duplicates = 0
+        self.gaps = 0
+        self.restarts = 0
+
+    def _last_seq_in_file(self):
+        last = None
+        if self.path.exists():
+            with self.path.open("r", encoding="utf-8") as f:
+                for line in f:
+                    try:
+                        seq = json.loads(line).get("seq")
+                    except ValueError:
+                        continue
+                    if isinstance(seq, int):
+                        last = seq
+        return last
+
+    def handle(self, payload):
+        try:
+            msg = json.loads(payload)
+        except ValueError:
+            print(f"[collector] invalid JSON: {payload[:80]!r}", file=sys.stderr)
+            return
+
+        # Paczka: {"seq_first": A, "seq_last": B, "records": [...]}
+        records = msg["records"] if isinstance(msg.get("records"), list) else [msg]
+        self.store(records)
+
+    def handle_cbor(self, payload):
+        try:
+            records = das_tower_cbor.decode(payload)
+        except (ValueError, UnicodeDecodeError) as e:
+            print(f"[collector] invalid CBOR payload: {e}", file=sys.stderr)
+            return
+        self.store(records)
+
+    def store(self, records):
+        with self.path.open("a", encoding="utf-8") as f:
+            for rec in records:
+                self._store(rec, f)
+
+    def _store(self, msg, f):
+        # Stary format (relay1, temp_ds18) ma inne nazwy pól
+        if "relay1" in msg:
+            msg = from_legacy(msg)
+
+        # Bez seq: publikacja bezpośrednia (brak karty SD) - bez deduplikacji
+        seq = msg.get("seq")
+        if seq is not None and self.last_seq is not None:
+            if seq <= self.last_seq and self._is_restart(seq):
+                self.restarts += 1
+                print(f"[collector] seq restart: {seq} after {self.last_seq}, resyncing",
+                      file=sys.stderr)
+            elif seq <= self.last_seq:
+                self.duplicates += 1
+                return
+            elif seq > self.last_seq + 1:
+                self.gaps += 1
+                print(f"[collector] gap: seq {self.last_seq + 1}..{seq - 1} missing",
+                      file=sys.stderr)
+
+        f.write(json.dumps(msg) + "\n")
+        if seq is not None:
+            self.last_seq = seq
+        self.received += 1
+
+    def _is_restart(self, seq):
+        return seq == 1 or seq < self.last_seq - SEQ_RESTART_WINDOW
+
+
+def main():
+    parser = argparse.ArgumentParser(description="DAS tower MQTT -> NDJSON collector")
+    parser.add_argument("--host", default=BROKER_HOST)
+    parser.add_argument("--port", type=int, default=BROKER_PORT)
+    parser.add_argument("--out", type=Path, default=DATA_FILE)
+    args = parser.parse_args()
+
+    collector = Collector(args.out)
+
+    def on_connect(client, userdata, flags, rc, *extra):
+        print(f"[collector] connected (rc={rc}), last seq {collector.last_seq}")
+        client.subscribe([(TOPIC, 1), (TOPIC_CBOR, 1)])
+
+    def on_message(client, userdata, message):
+        if message.topic == TOPIC_CBOR:
+            collector.handle_cbor(message.payload)
+        else:
+            collector.handle(message.payload.decode("utf-8", errors="replace"))
+
+    client = mqtt.Client()
+    client.on_connect = on_connect
+    client.on_message = on_message
+    client.connect(args.host, args.port)
+    try:
+        client.loop_forever()
+    except KeyboardInterrupt:
+        print(f"[collector] {collector.received} stored, {collector.duplicates} duplicates, "
+              f"{collector.gaps} gaps, {collector.restarts} seq restarts")
+
+
+if __name__ == "__main__":
+    main()
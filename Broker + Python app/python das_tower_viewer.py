@@ -27,6 +27,9 @@ SENSORS = {
     "Relay 1 (Pump)": "relay_1",
     "Relay 2 (LED)": "relay_2",
 }
+# Sondy DS18B20 na różnych wysokościach wieży ("temp_probes": [...], LOGREC_PROBES)
+for _i in range(8):
+    SENSORS[f"DS18B20 Probe {_i} (°C)"] = f"temp_probe_{_i}"
 
 # ==========================================
 
@@ -69,10 +72,19 @@ class NDJSONReader(threading.Thread):
                     line = line.strip()
                     if not line: continue
                     record = json.loads(line)
-                    if "timestamp" in record:
-                        # Wymuszamy format datetime
-                        record["timestamp"] = pd.to_datetime(record["timestamp"])
-                        records.append(record)
+                    # Paczka z MQTT: {"seq_first", "seq_last", "records": [...]}
+                    batch = record["records"] if isinstance(record.get("records"), list) else [record]
+                    for record in batch:
+                        # Tablica sond -> osobne kolumny temp_probe_0, temp_probe_1, ...
+                        for i, value in enumerate(record.pop("temp_probes", None) or []):
+                            record[f"temp_probe_{i}"] = value
+                        # pH powtórzone z poprzedniej próbki nie trafia na wykres (bez "schodków")
+                        if record.pop("ph_fresh", True) is False:
+                            record["ph"] = None
+                        if "timestamp" in record:
+                            # Wymuszamy format datetime
+                            record["timestamp"] = pd.to_datetime(record["timestamp"])
+                            records.append(record)
                 except Exception:
                     continue
             if records:
@@ -189,6 +201,10 @@ class DasTowerApp:
 
         sensor_display_name = self.selected_sensor.get()
         key = SENSORS[sensor_display_name]
+        if key not in self.df.columns:
+            self.big_value.config(text="--")
+            self.status.config(text=f"No data for {sensor_display_name}")
+            return
         
         self.ax.clear()
         
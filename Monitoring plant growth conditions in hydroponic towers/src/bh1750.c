@@ -154,9 +154,9 @@ esp_err_t bh1750_set_measurement_time(i2c_dev_t *dev, uint8_t time)
     return ESP_OK;
 }
 
-esp_err_t bh1750_read(i2c_dev_t *dev, uint16_t *level)
+esp_err_t bh1750_read_raw(i2c_dev_t *dev, uint16_t *raw)
 {
-    CHECK_ARG(dev && level);
+    CHECK_ARG(dev && raw);
 
     uint8_t buf[2];
 
@@ -164,8 +164,18 @@ esp_err_t bh1750_read(i2c_dev_t *dev, uint16_t *level)
     I2C_DEV_CHECK(dev, i2c_dev_read(dev, NULL, 0, buf, 2));
     I2C_DEV_GIVE_MUTEX(dev);
 
-    *level = buf[0] << 8 | buf[1];
-    *level = (*level * 10) / 12; // convert to LUX
+    *raw = buf[0] << 8 | buf[1];
+
+    return ESP_OK;
+}
+
+esp_err_t bh1750_read(i2c_dev_t *dev, uint16_t *level)
+{
+    CHECK_ARG(dev && level);
+
+    uint16_t raw;
+    CHECK(bh1750_read_raw(dev, &raw));
+    *level = (uint16_t)(((uint32_t)raw * 10 + 6) / 12); // convert to LUX, rounded
 
     return ESP_OK;
 }
\ No newline at end of file
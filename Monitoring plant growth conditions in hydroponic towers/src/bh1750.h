@@ -140,6 +140,17 @@ esp_err_t bh1750_set_measurement_time(i2c_dev_t *dev, uint8_t time);
  */
 esp_err_t bh1750_read(i2c_dev_t *dev, uint16_t *level);
 
+/**
+ * @brief Read raw measurement result (counts) from the device.
+ *
+ * Lux = raw / 1.2 * 69 / MTreg, halved in ::BH1750_RES_HIGH2 mode.
+ *
+ * @param dev Pointer to device descriptor
+ * @param[out] raw Raw 16-bit measurement result
+ * @return `ESP_OK` on success
+ */
+esp_err_t bh1750_read_raw(i2c_dev_t *dev, uint16_t *raw);
+
 #ifdef __cplusplus
 }
 #endif
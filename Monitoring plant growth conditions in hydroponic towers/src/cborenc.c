@@ -0,0 +1,95 @@
+#include "cborenc.h"
+#include <string.h>
+
+// Typy główne CBOR (3 najstarsze bity pierwszego bajtu)
+#define CBOR_UINT   0x00
+#define CBOR_NINT   0x20
+#define CBOR_TEXT   0x60
+#define CBOR_ARRAY  0x80
+#define CBOR_MAP    0xA0
+#define CBOR_FALSE  0xF4
+#define CBOR_TRUE   0xF5
+#define CBOR_NULL   0xF6
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t len) {
+    w->buf = buf;
+    w->len = len;
+    w->pos = 0;
+    w->overflow = false;
+}
+
+static void put_bytes(cbor_writer_t *w, const void *data, size_t n) {
+    if (w->overflow || w->len - w->pos < n) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->pos, data, n);
+    w->pos += n;
+}
+
+// Nagłówek elementu: typ główny + argument w najkrótszej formie (big-endian)
+static void put_head(cbor_writer_t *w, uint8_t major, uint64_t arg) {
+    uint8_t b[9];
+    size_t n;
+
+    if (arg < 24) {
+        b[0] = major | (uint8_t)arg;
+        n = 1;
+    } else if (arg <= UINT8_MAX) {
+        b[0] = major | 24;
+        b[1] = (uint8_t)arg;
+        n = 2;
+    } else if (arg <= UINT16_MAX) {
+        b[0] = major | 25;
+        b[1] = (uint8_t)(arg >> 8);
+        b[2] = (uint8_t)arg;
+        n = 3;
+    } else if (arg <= UINT32_MAX) {
+        b[0] = major | 26;
+        for (int i = 0; i < 4; i++) b[1 + i] = (uint8_t)(arg >> (24 - 8 * i));
+        n = 5;
+    } else {
+        b[0] = major | 27;
+        for (int i = 0; i < 8; i++) b[1 + i] = (uint8_t)(arg >> (56 - 8 * i));
+        n = 9;
+    }
+    put_bytes(w, b, n);
+}
+
+void cbor_put_uint(cbor_writer_t *w, uint64_t value) {
+    put_head(w, CBOR_UINT, value);
+}
+
+void cbor_put_int(cbor_writer_t *w, int64_t value) {
+    // Liczba ujemna n jest kodowana jako -1 - n
+    if (value < 0) put_head(w, CBOR_NINT, (uint64_t)(-1 - value));
+    else put_head(w, CBOR_UINT, (uint64_t)value);
+}
+
+void cbor_put_text(cbor_writer_t *w, const char *text) {
+    size_t n = strlen(text);
+    put_head(w, CBOR_TEXT, n);
+    put_bytes(w, text, n);
+}
+
+void cbor_put_array(cbor_writer_t *w, size_t count) {
+    put_head(w, CBOR_ARRAY, count);
+}
+
+void cbor_put_map(cbor_writer_t *w, size_t count) {
+    put_head(w, CBOR_MAP, count);
+}
+
+void cbor_put_bool(cbor_writer_t *w, bool value) {
+    uint8_t b = value ? CBOR_TRUE : CBOR_FALSE;
+    put_bytes(w, &b, 1);
+}
+
+void cbor_put_null(cbor_writer_t *w) {
+    uint8_t b = CBOR_NULL;
+    put_bytes(w, &b, 1);
+}
+
+int cbor_writer_finish(const cbor_writer_t *w) {
+    return w->overflow ? -1 : (int)w->pos;
+}
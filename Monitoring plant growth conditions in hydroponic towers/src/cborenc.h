@@ -0,0 +1,42 @@
+#ifndef CBORENC_H
+#define CBORENC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Minimalny koder CBOR (RFC 8949) do payloadów MQTT.
+ *
+ * Tylko typy potrzebne do pomiarów: liczby całkowite, tekst, tablice i mapy
+ * o znanej długości, null i bool. Bez zmiennoprzecinkowych - wartości są
+ * przesyłane jako liczby całkowite ze skalą ze schematu (logrec.h).
+ *
+ * Koder pisze do bufora podanego przez wywołującego i nie alokuje pamięci.
+ * Przepełnienie jest zapamiętywane w writerze; kolejne zapisy są pomijane,
+ * a cbor_writer_finish() zwraca wtedy -1.
+ */
+
+typedef struct {
+    uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+} cbor_writer_t;
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t len);
+
+void cbor_put_uint(cbor_writer_t *w, uint64_t value);
+void cbor_put_int(cbor_writer_t *w, int64_t value);
+void cbor_put_text(cbor_writer_t *w, const char *text);
+void cbor_put_array(cbor_writer_t *w, size_t count);
+void cbor_put_map(cbor_writer_t *w, size_t count);
+void cbor_put_bool(cbor_writer_t *w, bool value);
+void cbor_put_null(cbor_writer_t *w);
+
+/**
+ * @return liczba zapisanych bajtów lub -1 gdy bufor był za mały
+ */
+int cbor_writer_finish(const cbor_writer_t *w);
+
+#endif // CBORENC_H
@@ -1,64 +1,132 @@
 #include "dht.h"
+#include "esp_attr.h"
 #include "esp_log.h"
-#include "esp_rom_sys.h"
-#include "driver/gpio.h"
+#include "driver/rmt_rx.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/task.h"
 
 static const char *TAG = "DHT22";
 
-// Prosta funkcja opóźnienia w mikrosekundach
-static void delay_us(uint32_t us)
+#define RMT_RESOLUTION_HZ  1000000   // 1 tick = 1 us
+#define RX_SYMBOLS         64        // Ramka: ~43 symbole (odpowiedź + 40 bitów)
+#define RX_GLITCH_NS       1000
+#define RX_IDLE_NS         200000    // Najdłuższy impuls ramki to 80 us
+#define START_LOW_MS       10        // Sygnał startu: min. 1 ms, max. 20 ms
+#define FRAME_TIMEOUT_MS   20        // Ramka trwa ~5 ms
+#define BIT_THRESHOLD_US   50        // Stan wysoki: "0" = 26..28 us, "1" = 70 us
+
+static rmt_channel_handle_t rx_chan = NULL;
+static QueueHandle_t rx_done = NULL;
+static rmt_symbol_word_t rx_buf[RX_SYMBOLS];
+static dht_stats_t stats;
+
+// Przerwanie RMT: koniec ramki (stan wysoki dłużej niż RX_IDLE_NS)
+static bool IRAM_ATTR rx_done_cb(rmt_channel_handle_t ch, const rmt_rx_done_event_data_t *edata, void *ctx)
 {
-    esp_rom_delay_us(us);
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR(rx_done, edata, &woken);
+    return woken == pdTRUE;
 }
 
-esp_err_t dht22_read(float *temperature, float *humidity)
+esp_err_t dht22_init(void)
 {
-    int data[40] = {0};
-    uint8_t bytes[5] = {0};
+    rmt_rx_channel_config_t cfg = {
+        .gpio_num = DHT_GPIO,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = RMT_RESOLUTION_HZ,
+        .mem_block_symbols = RX_SYMBOLS,
+    };
+    rmt_rx_event_callbacks_t cbs = { .on_recv_done = rx_done_cb };
 
-    // Inicjalizacja - sygnał startu
-    gpio_set_direction(DHT_GPIO, GPIO_MODE_OUTPUT);
-    gpio_set_level(DHT_GPIO, 0);
-    delay_us(1000 * 20); // 20 ms
-    gpio_set_level(DHT_GPIO, 1);
-    delay_us(40);
-
-    gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT);
-
-    // Synchronizacja
-    int timeout = 0;
-    while (gpio_get_level(DHT_GPIO) == 1 && timeout++ < 100) delay_us(1);
-    timeout = 0;
-    while (gpio_get_level(DHT_GPIO) == 0 && timeout++ < 100) delay_us(1);
-    timeout = 0;
-    while (gpio_get_level(DHT_GPIO) == 1 && timeout++ < 100) delay_us(1);
-
-    // Odczyt 40 bitów
-    for (int i = 0; i < 40; i++) {
-        timeout = 0;
-        while (gpio_get_level(DHT_GPIO) == 0 && timeout++ < 100) delay_us(1);
-
-        int t = 0;
-        while (gpio_get_level(DHT_GPIO) == 1 && t < 100) {
-            delay_us(1);
-            t++;
-        }
-        if (t > 40) data[i] = 1;
-        else data[i] = 0;
+    rx_done = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    if (!rx_done) return ESP_ERR_NO_MEM;
+
+    esp_err_t err = rmt_new_rx_channel(&cfg, &rx_chan);
+    if (err == ESP_OK) err = rmt_rx_register_event_callbacks(rx_chan, &cbs, NULL);
+    if (err == ESP_OK) {
+        // Wejście zostaje podłączone do RMT, wyjście open-drain daje sygnał startu
+        gpio_set_level(DHT_GPIO, 1);
+        err = gpio_set_direction(DHT_GPIO, GPIO_MODE_INPUT_OUTPUT_OD);
+    }
+    if (err == ESP_OK) err = gpio_pullup_en(DHT_GPIO);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "RMT init failed: %s", esp_err_to_name(err));
+        rx_chan = NULL;
     }
+    return err;
+}
 
-    // Składanie bajtów
+// Ostatnie 40 impulsów wysokich przed końcem ramki to bity danych (MSB first).
+// Początek nagrania (zwolnienie linii, odpowiedź 80/80 us) jest pomijany.
+static bool decode(const rmt_symbol_word_t *sym, size_t count, uint8_t bytes[5])
+{
+    uint16_t high[RX_SYMBOLS * 2];
+    int n = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (sym[i].level0 && sym[i].duration0) high[n++] = sym[i].duration0;
+        if (sym[i].level1 && sym[i].duration1) high[n++] = sym[i].duration1;
+    }
+    if (n < 40) {
+        return false;
+    }
+
+    const uint16_t *bits = &high[n - 40];
     for (int i = 0; i < 5; i++) {
+        bytes[i] = 0;
         for (int j = 0; j < 8; j++) {
-            bytes[i] <<= 1;
-            bytes[i] |= data[i * 8 + j];
+            bytes[i] = (uint8_t)((bytes[i] << 1) | (bits[i * 8 + j] > BIT_THRESHOLD_US));
         }
     }
+    return true;
+}
+
+esp_err_t dht22_read(float *temperature, float *humidity)
+{
+    if (!rx_chan) return ESP_ERR_INVALID_STATE;
+    stats.reads++;
+
+    // Sygnał startu; +1 tick, bo vTaskDelay(n) trwa od n-1 do n ticków
+    gpio_set_level(DHT_GPIO, 0);
+    vTaskDelay(pdMS_TO_TICKS(START_LOW_MS) + 1);
+
+    // Odbiornik uzbrojony przed zwolnieniem linii, więc łapie całą ramkę.
+    // Kanał włączony tylko na czas odczytu: trzyma blokadę PM (bez light sleep)
+    rmt_receive_config_t rx_cfg = {
+        .signal_range_min_ns = RX_GLITCH_NS,
+        .signal_range_max_ns = RX_IDLE_NS,
+    };
+    xQueueReset(rx_done);
+    esp_err_t err = rmt_enable(rx_chan);
+    if (err == ESP_OK) {
+        err = rmt_receive(rx_chan, rx_buf, sizeof(rx_buf), &rx_cfg);
+        if (err != ESP_OK) rmt_disable(rx_chan);
+    }
+    gpio_set_level(DHT_GPIO, 1);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    rmt_rx_done_event_data_t evt;
+    BaseType_t received = xQueueReceive(rx_done, &evt, pdMS_TO_TICKS(FRAME_TIMEOUT_MS) + 1);
+    rmt_disable(rx_chan);  // Bez ramki przerywa też zawieszony odbiór
+    if (received != pdTRUE) {
+        stats.timeouts++;
+        return ESP_ERR_TIMEOUT;
+    }
+
+    uint8_t bytes[5];
+    if (!decode(evt.received_symbols, evt.num_symbols, bytes)) {
+        ESP_LOGE(TAG, "Incomplete frame (%u symbols)", (unsigned)evt.num_symbols);
+        stats.timeouts++;
+        return ESP_ERR_INVALID_RESPONSE;
+    }
 
     // Sprawdzenie sumy kontrolnej
     if (((bytes[0] + bytes[1] + bytes[2] + bytes[3]) & 0xFF) != bytes[4]) {
         ESP_LOGE(TAG, "Checksum error!");
-        return ESP_FAIL;
+        stats.checksum_errors++;
+        return ESP_ERR_INVALID_CRC;
     }
 
     // Konwersja na wartości fizyczne
@@ -72,5 +140,11 @@ esp_err_t dht22_read(float *temperature, float *humidity)
     *humidity = raw_humidity / 10.0;
     *temperature = raw_temperature / 10.0;
 
+    stats.ok++;
     return ESP_OK;
 }
+
+void dht22_get_stats(dht_stats_t *out)
+{
+    *out = stats;
+}
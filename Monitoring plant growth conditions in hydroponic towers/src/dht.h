@@ -3,9 +3,29 @@
 
 #include "esp_err.h"
 #include "driver/gpio.h"
+#include <stdint.h>
 
 #define DHT_GPIO GPIO_NUM_4   // pin, do którego podłączamy czujnik
 
+/*
+ * Odczyt przez odbiornik RMT: sygnał startu to stan niski utrzymywany przez
+ * vTaskDelay, ramkę (odpowiedź + 40 bitów) próbkuje sprzęt z rozdzielczością
+ * 1 us, a przerwanie końca odbioru budzi czekające zadanie przez kolejkę.
+ * Szerokości impulsów nie zależą od opóźnień przerwań (WiFi, MQTT), a CPU
+ * jest wolny przez cały odczyt (~25 ms).
+ */
+
+// Liczniki odczytów od startu (STATUS)
+typedef struct {
+    uint32_t reads;
+    uint32_t ok;
+    uint32_t timeouts;          // Brak ramki / za mało bitów
+    uint32_t checksum_errors;
+} dht_stats_t;
+
+// Kanał RMT RX i pin open-drain; wołane raz przed pierwszym odczytem
+esp_err_t dht22_init(void);
 esp_err_t dht22_read(float *temperature, float *humidity);
+void dht22_get_stats(dht_stats_t *out);
 
 #endif // DHT_H
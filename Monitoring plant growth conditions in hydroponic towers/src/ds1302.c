@@ -63,6 +63,28 @@ uint8_t ds1302_read_register(uint8_t reg) {
     return value;
 }
 
+// ================= Tryb burst =================
+// Jedno polecenie 0xBF / 0xBE i 8 rejestrów zegara (0x00..0x07) w jednej transakcji.
+// DS1302 zatrzaskuje rejestry na początku odczytu burst, więc przejście sekundy
+// w trakcie nie rozspójnia pól (jak przy 7 osobnych odczytach).
+void ds1302_burst_read(uint8_t regs[DS1302_CLOCK_REGS]) {
+    ds1302_start();
+    ds1302_write_byte(0xBF);
+    for (int i = 0; i < DS1302_CLOCK_REGS; i++) {
+        regs[i] = ds1302_read_byte();
+    }
+    ds1302_stop();
+}
+
+void ds1302_burst_write(const uint8_t regs[DS1302_CLOCK_REGS]) {
+    ds1302_start();
+    ds1302_write_byte(0xBE);
+    for (int i = 0; i < DS1302_CLOCK_REGS; i++) {
+        ds1302_write_byte(regs[i]);
+    }
+    ds1302_stop();
+}
+
 // ================= Public API =================
 void ds1302_init(void) {
     gpio_reset_pin(DS1302_CLK_PIN);
@@ -88,23 +110,29 @@ void ds1302_init(void) {
 }
 
 void ds1302_set_time(const ds1302_time_t *t) {
-    ds1302_write_register(0x00, dec2bcd(t->sec) & 0x7F);
-    ds1302_write_register(0x01, dec2bcd(t->min));
-    ds1302_write_register(0x02, dec2bcd(t->hour));
-    ds1302_write_register(0x03, dec2bcd(t->day));
-    ds1302_write_register(0x04, dec2bcd(t->month));
-    ds1302_write_register(0x05, dec2bcd(t->dow));
-    ds1302_write_register(0x06, dec2bcd(t->year % 100)); // tylko 2 cyfry
+    uint8_t regs[DS1302_CLOCK_REGS] = {
+        dec2bcd(t->sec) & 0x7F,
+        dec2bcd(t->min),
+        dec2bcd(t->hour),
+        dec2bcd(t->day),
+        dec2bcd(t->month),
+        dec2bcd(t->dow),
+        dec2bcd(t->year % 100),           // tylko 2 cyfry
+        0x00,                             // rejestr kontrolny: write protect wyłączony
+    };
+    ds1302_burst_write(regs);
 }
 
 void ds1302_get_time(ds1302_time_t *t) {
-    t->sec   = bcd2dec(ds1302_read_register(0x00) & 0x7F);
-    t->min   = bcd2dec(ds1302_read_register(0x01));
-    t->hour  = bcd2dec(ds1302_read_register(0x02));
-    t->day   = bcd2dec(ds1302_read_register(0x03));
-    t->month = bcd2dec(ds1302_read_register(0x04));
-    t->dow   = bcd2dec(ds1302_read_register(0x05));
-    t->year  = 2000 + bcd2dec(ds1302_read_register(0x06));
+    uint8_t regs[DS1302_CLOCK_REGS];
+    ds1302_burst_read(regs);
+    t->sec   = bcd2dec(regs[0] & 0x7F);
+    t->min   = bcd2dec(regs[1]);
+    t->hour  = bcd2dec(regs[2] & 0x3F);   // tryb 24h
+    t->day   = bcd2dec(regs[3]);
+    t->month = bcd2dec(regs[4]);
+    t->dow   = bcd2dec(regs[5]);
+    t->year  = 2000 + bcd2dec(regs[6]);
 }
 
 // ================= Obliczanie dnia tygodnia =================
@@ -118,6 +146,20 @@ uint8_t calculate_dow(uint16_t year, uint8_t month, uint8_t day) {
     return d;
 }
 
+// ================= Konwersja na czas Unix =================
+uint32_t ds1302_time_to_unix(const ds1302_time_t *t) {
+    // Liczba dni od 1970-01-01 (algorytm days_from_civil)
+    int32_t y = t->year - (t->month <= 2 ? 1 : 0);
+    int32_t era = y / 400;
+    int32_t yoe = y - era * 400;
+    int32_t mp = (t->month + 9) % 12;
+    int32_t doy = (153 * mp + 2) / 5 + t->day - 1;
+    int32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    int32_t days = era * 146097 + doe - 719468;
+
+    return (uint32_t)days * 86400u + t->hour * 3600u + t->min * 60u + t->sec;
+}
+
 // ================= Ustawienie czasu kompilacji =================
 void ds1302_set_compile_time(void) {
     ds1302_time_t t = {0};
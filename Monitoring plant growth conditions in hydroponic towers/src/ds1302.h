@@ -7,6 +7,9 @@
 #define DS1302_DAT_PIN   GPIO_NUM_14
 #define DS1302_RST_PIN   GPIO_NUM_27
 
+// Rejestry zegara czytane / zapisywane w trybie burst (sek..rok + kontrolny)
+#define DS1302_CLOCK_REGS 8
+
 typedef struct {
     uint8_t sec;
     uint8_t min;
@@ -27,5 +30,12 @@ void ds1302_set_compile_time(void);
 void ds1302_write_register(uint8_t reg, uint8_t value);
 uint8_t ds1302_read_register(uint8_t reg);
 
+// Burst: wszystkie rejestry zegara w jednej transakcji (spójny odczyt)
+void ds1302_burst_read(uint8_t regs[DS1302_CLOCK_REGS]);
+void ds1302_burst_write(const uint8_t regs[DS1302_CLOCK_REGS]);
+
 // Obliczanie dnia tygodnia
 uint8_t calculate_dow(uint16_t year, uint8_t month, uint8_t day);
+
+// Czas RTC jako sekundy od 1970-01-01 (pola RTC traktowane jak UTC, bez strefy)
+uint32_t ds1302_time_to_unix(const ds1302_time_t *t);
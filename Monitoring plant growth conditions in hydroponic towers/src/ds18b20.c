@@ -4,59 +4,255 @@
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs.h"
 
-// Dallas/Maxim CRC8
-static uint8_t ds_crc8(const uint8_t *data, int len)
-{
-	uint8_t crc = 0;
-	for (int i = 0; i < len; i++) {
-		uint8_t inbyte = data[i];
-		for (int j = 0; j < 8; j++) {
-			uint8_t mix = (crc ^ inbyte) & 0x01;
-			crc >>= 1;
-			if (mix) crc ^= 0x8C;
-			inbyte >>= 1;
+static const char *TAG = "DS18B20";
+
+#define NVS_NAMESPACE  "ds18"
+#define NVS_KEY_TABLE  "devices"
+
+// Tablica urządzeń (kolejność = indeks sondy w rekordach)
+static ds18_device_t devices[DS18_MAX_DEVICES];
+static int device_count = 0;
+
+/********************
+ * Tablica urządzeń w NVS
+ ********************/
+static bool table_load(void)
+{
+	nvs_handle_t h;
+	if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+		return false;
+	}
+	size_t size = sizeof(devices);
+	esp_err_t err = nvs_get_blob(h, NVS_KEY_TABLE, devices, &size);
+	nvs_close(h);
+	if (err != ESP_OK || size == 0 || size % sizeof(ds18_device_t)) {
+		return false;
+	}
+
+	device_count = (int)(size / sizeof(ds18_device_t));
+	for (int i = 0; i < device_count; i++) {
+		if (onewire_crc8(devices[i].rom, 7) != devices[i].rom[7] ||
+		    devices[i].resolution < 9 || devices[i].resolution > 12) {
+			device_count = 0;
+			return false;
+		}
+	}
+	return true;
+}
+
+static esp_err_t table_save(void)
+{
+	nvs_handle_t h;
+	esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+	if (err != ESP_OK) {
+		return err;
+	}
+	if (device_count > 0) {
+		err = nvs_set_blob(h, NVS_KEY_TABLE, devices, device_count * sizeof(ds18_device_t));
+	} else {
+		err = nvs_erase_key(h, NVS_KEY_TABLE);
+		if (err == ESP_ERR_NVS_NOT_FOUND) err = ESP_OK;
+	}
+	if (err == ESP_OK) err = nvs_commit(h);
+	nvs_close(h);
+	return err;
+}
+
+// ROM search; keeps resolution of devices already in the table
+static int table_scan(OneWire *ow)
+{
+	ds18_device_t found[DS18_MAX_DEVICES];
+	int n = 0;
+	OneWireSearch s;
+	onewire_search_reset(&s);
+	while (n < DS18_MAX_DEVICES && onewire_search(ow, &s)) {
+		if (s.rom[0] != DS18_FAMILY_CODE) {
+			continue;
+		}
+		memcpy(found[n].rom, s.rom, 8);
+		found[n].resolution = DS18_DEFAULT_RESOLUTION;
+		for (int i = 0; i < device_count; i++) {
+			if (memcmp(devices[i].rom, s.rom, 8) == 0) {
+				found[n].resolution = devices[i].resolution;
+			}
+		}
+		n++;
+	}
+	memcpy(devices, found, n * sizeof(ds18_device_t));
+	device_count = n;
+	return n;
+}
+
+/********************
+ * Scratchpad
+ ********************/
+// Reset + MATCH ROM (rom != NULL) or SKIP ROM
+static bool address(OneWire *ow, const uint8_t *rom)
+{
+	if (!onewire_reset(ow)) {
+		return false;
+	}
+	if (rom) {
+		onewire_select_rom(ow, rom);
+	} else {
+		onewire_skip_rom(ow);
+	}
+	return true;
+}
+
+static bool read_scratchpad(OneWire *ow, const uint8_t *rom, uint8_t scratch[9])
+{
+	if (!address(ow, rom)) {
+		return false;
+	}
+	onewire_write_byte(ow, 0xBE); // READ SCRATCHPAD
+	onewire_read_bytes(ow, scratch, 9);
+	return onewire_crc8(scratch, 8) == scratch[8];
+}
+
+// Config register: bits 6..5 = resolution - 9. TH/TL (alarm) are kept.
+// Written to scratchpad only (not EEPROM) - the table in NVS restores it on boot.
+static bool write_resolution(OneWire *ow, const uint8_t rom[8], uint8_t bits)
+{
+	uint8_t scratch[9];
+	if (!read_scratchpad(ow, rom, scratch)) {
+		return false;
+	}
+	uint8_t config = (uint8_t)(((bits - 9) << 5) | 0x1F);
+	if (scratch[4] == config) {
+		return true;
+	}
+	if (!address(ow, rom)) {
+		return false;
+	}
+	onewire_write_byte(ow, 0x4E); // WRITE SCRATCHPAD
+	onewire_write_byte(ow, scratch[2]);
+	onewire_write_byte(ow, scratch[3]);
+	onewire_write_byte(ow, config);
+	return true;
+}
+
+/********************
+ * API
+ ********************/
+int ds18_init(OneWire *ow, bool rescan)
+{
+	bool cached = !rescan && table_load();
+	if (!cached) {
+		table_scan(ow);
+		esp_err_t err = table_save();
+		if (err != ESP_OK) {
+			ESP_LOGW(TAG, "Cannot store device table: %s", esp_err_to_name(err));
 		}
 	}
-	return crc;
+
+	for (int i = 0; i < device_count; i++) {
+		const uint8_t *r = devices[i].rom;
+		bool ok = write_resolution(ow, r, devices[i].resolution);
+		ESP_LOGI(TAG, "Probe %d: %02X-%02X%02X%02X%02X%02X%02X, %d bit%s", i,
+		         r[0], r[6], r[5], r[4], r[3], r[2], r[1], devices[i].resolution,
+		         ok ? "" : " (not responding)");
+	}
+	ESP_LOGI(TAG, "%d probe(s) %s", device_count, cached ? "from NVS" : "found by ROM search");
+	return device_count;
+}
+
+int ds18_resume(OneWire *ow)
+{
+	// Probes stay powered in deep sleep and keep their scratchpad resolution
+	if (table_load()) {
+		return device_count;
+	}
+	return ds18_init(ow, false);
+}
+
+int ds18_get_device_count(void)
+{
+	return device_count;
+}
+
+const ds18_device_t *ds18_get_device(int index)
+{
+	if (index < 0 || index >= device_count) {
+		return NULL;
+	}
+	return &devices[index];
+}
+
+esp_err_t ds18_set_resolution(OneWire *ow, int index, uint8_t bits)
+{
+	if (index < 0 || index >= device_count || bits < 9 || bits > 12) {
+		return ESP_ERR_INVALID_ARG;
+	}
+	if (!write_resolution(ow, devices[index].rom, bits)) {
+		return ESP_ERR_NOT_FOUND;
+	}
+	devices[index].resolution = bits;
+	return table_save();
+}
+
+uint32_t ds18_conversion_time_ms(void)
+{
+	uint8_t bits = device_count ? 9 : DS18_DEFAULT_RESOLUTION;
+	for (int i = 0; i < device_count; i++) {
+		if (devices[i].resolution > bits) bits = devices[i].resolution;
+	}
+	// 750 ms at 12 bit, half per bit less (93.75 ms at 9 bit)
+	uint32_t shift = 12u - bits;
+	return (750u + (1u << shift) - 1u) >> shift;
 }
 
 // Request temperature conversion on all devices (SKIP ROM)
 bool ds18_request_temperatures(OneWire *ow)
 {
 	// Reset + presence
-	if (!onewire_reset(ow)) {
+	if (!address(ow, NULL)) {
 		return false;
 	}
-	onewire_skip_rom(ow);      // broadcast
-	onewire_write_byte(ow, 0x44); // CONVERT T
+	onewire_write_byte(ow, 0x44); // CONVERT T, broadcast
+	return true;
+}
+
+// Poll conversion status: DS18B20 holds read slots low until CONVERT T is done
+bool ds18_wait_conversion(OneWire *ow, uint32_t timeout_ms)
+{
+	TickType_t start = xTaskGetTickCount();
+	while (!onewire_read_bit(ow)) {
+		if ((xTaskGetTickCount() - start) >= pdMS_TO_TICKS(timeout_ms)) {
+			return false;
+		}
+		vTaskDelay(pdMS_TO_TICKS(10)); // jeden slot to ~70 us, nie trzeba odpytywać częściej
+	}
 	return true;
 }
 
 // Read temperature (C) from device index
 float ds18_get_temp_c_by_index(OneWire *ow, int index)
 {
-	(void)index; // w tej prostej implementacji obsługujemy tylko SKIP ROM / jedno urządzenie
-	// Reset + presence
-	if (!onewire_reset(ow)) {
+	// Pusta tablica: jedna sonda na magistrali, adresowana przez SKIP ROM
+	const uint8_t *rom = NULL;
+	if (device_count > 0) {
+		if (index < 0 || index >= device_count) {
+			return NAN;
+		}
+		rom = devices[index].rom;
+	} else if (index != 0) {
 		return NAN;
 	}
-	onewire_skip_rom(ow);
-	onewire_write_byte(ow, 0xBE); // READ SCRATCHPAD
 
 	uint8_t scratch[9];
-	for (int i = 0; i < 9; i++) {
-		scratch[i] = onewire_read_byte(ow);
-	}
-
-	// CRC check
-	if (ds_crc8(scratch, 8) != scratch[8]) {
+	if (!read_scratchpad(ow, rom, scratch)) {
 		return NAN;
 	}
 
+	// Przy niższej rozdzielczości najmłodsze bity są nieokreślone
+	int bits = 9 + ((scratch[4] >> 5) & 0x03);
 	int16_t raw = (int16_t)((scratch[1] << 8) | scratch[0]);
-	// standardowa konwersja: resolution default 12-bit -> /16.0
-	float temp_c = raw / 16.0f;
-	return temp_c;
+	raw &= (int16_t)~((1 << (12 - bits)) - 1);
+	return raw / 16.0f;
 }
-
@@ -3,10 +3,41 @@
 #define DS18B20_H
 
 #include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
 #include "onewire.h" // potrzebne dla deklaracji OneWire
 
+#define DS18_MAX_DEVICES        8     // Sondy na jednej magistrali (tablica w NVS)
+#define DS18_FAMILY_CODE        0x28
+#define DS18_DEFAULT_RESOLUTION 12
+
+// Device table entry (order = probe index in measurements and records)
+typedef struct {
+	uint8_t rom[8];
+	uint8_t resolution;   // 9..12 bit: 94 / 188 / 375 / 750 ms conversion
+} ds18_device_t;
+
+// Load device table from NVS (namespace "ds18"); scan the bus when the table is
+// empty or rescan is set and store the result. Applies per-device resolution.
+// Returns number of devices (0 = single probe mode with SKIP ROM).
+int ds18_init(OneWire *ow, bool rescan);
+// After deep sleep: load the table from NVS without bus traffic (falls back to
+// ds18_init when the table is missing). Returns number of devices.
+int ds18_resume(OneWire *ow);
+int ds18_get_device_count(void);
+const ds18_device_t *ds18_get_device(int index);
+// Set resolution (9..12 bit) of device index and store it in NVS
+esp_err_t ds18_set_resolution(OneWire *ow, int index, uint8_t bits);
+// Worst case conversion time of the current table [ms]
+uint32_t ds18_conversion_time_ms(void);
+
 // Request temperature conversion on all devices
 bool ds18_request_temperatures(OneWire *ow);
+// Wait for conversion started by ds18_request_temperatures() by polling the bus
+// (read slots return 0 while any device converts, 1 when done). Must be called
+// before any other 1-Wire traffic. Returns false on timeout (e.g. parasite power,
+// where the bus cannot signal busy) - the caller may still read the scratchpad.
+bool ds18_wait_conversion(OneWire *ow, uint32_t timeout_ms);
 // Read temperature (C) from device index (0 = first). If not present returns NAN
 float ds18_get_temp_c_by_index(OneWire *ow, int index);
 
@@ -0,0 +1,214 @@
+#include "dutycycle.h"
+#include "relay.h"
+#include "sysclock.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#include "driver/rtc_io.h"
+#include <string.h>
+
+static const char *TAG = "DUTY";
+
+#define DUTY_RTC_MAGIC  0x44555459u   // "DUTY"
+
+// Stan w pamięci RTC slow: przetrwa deep sleep, zerowany przy zimnym starcie
+typedef struct {
+    uint32_t magic;
+    duty_stats_t stats;
+    int64_t sleep_until_us;   // Zaplanowane wybudzenie timerem [us zegara systemowego], 0 = brak
+    uint8_t level_armed;      // Stan czujnika poziomu w chwili zaśnięcia
+    uint32_t head;            // Najstarszy rekord
+    uint32_t count;
+    logrec_t queue[DUTY_QUEUE_RECORDS];
+} duty_rtc_t;
+
+static RTC_DATA_ATTR duty_rtc_t rtc;
+
+// Etapy startu bieżącego wybudzenia (zwykły RAM)
+static struct {
+    const char *stage;
+    int64_t us;
+} marks[DUTY_BOOT_MARKS];
+static int mark_count = 0;
+static int64_t start_us = 0;
+static duty_wake_t wake_cause = DUTY_WAKE_COLD;
+static gpio_num_t button_pin = GPIO_NUM_NC;
+static gpio_num_t level_pin = GPIO_NUM_NC;
+
+duty_wake_t duty_init(gpio_num_t button_gpio, gpio_num_t level_gpio)
+{
+    start_us = esp_timer_get_time();
+    int64_t now_us = sysclock_now_ns() / 1000;
+    button_pin = button_gpio;
+    level_pin = level_gpio;
+
+    switch (esp_sleep_get_wakeup_cause()) {
+        case ESP_SLEEP_WAKEUP_TIMER: wake_cause = DUTY_WAKE_TIMER; break;
+        case ESP_SLEEP_WAKEUP_EXT0:  wake_cause = DUTY_WAKE_BUTTON; break;
+        case ESP_SLEEP_WAKEUP_EXT1:  wake_cause = DUTY_WAKE_LEVEL; break;
+        default:                     wake_cause = DUTY_WAKE_COLD; break;
+    }
+    if (rtc.magic != DUTY_RTC_MAGIC || rtc.head >= DUTY_QUEUE_RECORDS ||
+        rtc.count > DUTY_QUEUE_RECORDS) {
+        if (wake_cause != DUTY_WAKE_COLD) {
+            ESP_LOGW(TAG, "RTC state lost - starting cold");
+        }
+        memset(&rtc, 0, sizeof(rtc));
+        rtc.magic = DUTY_RTC_MAGIC;
+        wake_cause = DUTY_WAKE_COLD;
+    }
+    if (wake_cause == DUTY_WAKE_COLD) {
+        return wake_cause;
+    }
+
+    // Piny ext0/ext1 zostają w domenie RTC po wybudzeniu
+    rtc_gpio_deinit(button_pin);
+    rtc_gpio_deinit(level_pin);
+
+    rtc.stats.wakes++;
+    if (wake_cause == DUTY_WAKE_TIMER && rtc.sleep_until_us > 0 && now_us > rtc.sleep_until_us) {
+        rtc.stats.last_boot_us = now_us - rtc.sleep_until_us;
+    } else {
+        rtc.stats.last_boot_us = start_us;
+    }
+    return wake_cause;
+}
+
+const char *duty_wake_name(duty_wake_t wake)
+{
+    switch (wake) {
+        case DUTY_WAKE_TIMER:  return "timer";
+        case DUTY_WAKE_BUTTON: return "pH button";
+        case DUTY_WAKE_LEVEL:  return "water level";
+        default:               return "cold start";
+    }
+}
+
+uint8_t duty_level_armed(void)
+{
+    return rtc.level_armed;
+}
+
+/* ==============================
+   KOLEJKA REKORDÓW W PAMIĘCI RTC
+   ============================== */
+void duty_queue_push(const logrec_t *rec)
+{
+    if (rtc.count == DUTY_QUEUE_RECORDS) {
+        rtc.head = (rtc.head + 1) % DUTY_QUEUE_RECORDS;
+        rtc.count--;
+        rtc.stats.dropped++;
+    }
+    rtc.queue[(rtc.head + rtc.count) % DUTY_QUEUE_RECORDS] = *rec;
+    rtc.count++;
+    rtc.stats.queued++;
+}
+
+int duty_queue_count(void)
+{
+    return (int)rtc.count;
+}
+
+const logrec_t *duty_queue_get(int i)
+{
+    if (i < 0 || i >= (int)rtc.count) {
+        return NULL;
+    }
+    return &rtc.queue[(rtc.head + i) % DUTY_QUEUE_RECORDS];
+}
+
+void duty_queue_drop(int n)
+{
+    if (n > (int)rtc.count) n = rtc.count;
+    if (n <= 0) return;
+    rtc.head = (rtc.head + n) % DUTY_QUEUE_RECORDS;
+    rtc.count -= n;
+}
+
+bool duty_batch_due(uint32_t now, int max_records, uint32_t max_age_sec)
+{
+    if (rtc.count == 0) {
+        return false;
+    }
+    if ((int)rtc.count >= max_records || rtc.count == DUTY_QUEUE_RECORDS) {
+        return true;
+    }
+    uint32_t oldest = rtc.queue[rtc.head].timestamp;
+    return now >= oldest && now - oldest >= max_age_sec;
+}
+
+void duty_count_batch(void)
+{
+    rtc.stats.batches++;
+}
+
+/* ==============================
+   CZAS STARTU
+   ============================== */
+void duty_boot_mark(const char *stage)
+{
+    if (mark_count < DUTY_BOOT_MARKS) {
+        marks[mark_count].stage = stage;
+        marks[mark_count].us = esp_timer_get_time();
+        mark_count++;
+    }
+}
+
+void duty_boot_log(void)
+{
+    char line[256];
+    int len = snprintf(line, sizeof(line), "Wake #%lu (%s): boot %lld ms",
+                       rtc.stats.wakes, duty_wake_name(wake_cause), rtc.stats.last_boot_us / 1000);
+    int64_t prev = start_us;
+    for (int i = 0; i < mark_count && len < (int)sizeof(line); i++) {
+        // Czas etapu i (w nawiasie) chwila jego końca od wybudzenia
+        len += snprintf(line + len, sizeof(line) - len, ", %s %lld ms (@%lld)", marks[i].stage,
+                        (marks[i].us - prev) / 1000,
+                        (rtc.stats.last_boot_us + marks[i].us - start_us) / 1000);
+        prev = marks[i].us;
+    }
+    ESP_LOGI(TAG, "%s", line);
+}
+
+/* ==============================
+   USYPIANIE
+   ============================== */
+void duty_sleep(uint32_t wake_unix, int level_state)
+{
+    // Przekaźniki: stan OFF zatrzaśnięty na czas snu (zwalnia relay_init)
+    relay_set_relay1_off();
+    relay_set_relay2_off();
+    gpio_hold_en(RELAY1_GPIO);
+    gpio_hold_en(RELAY2_GPIO);
+    gpio_deep_sleep_hold_en();
+
+    // Przycisk pH do GND: pull-up RTC działa też w deep sleep
+    rtc_gpio_pullup_en(button_pin);
+    rtc_gpio_pulldown_dis(button_pin);
+    esp_sleep_enable_ext0_wakeup(button_pin, 0);
+    if (level_state >= 0) {
+        esp_sleep_enable_ext1_wakeup(1ULL << level_pin,
+                                     level_state ? ESP_EXT1_WAKEUP_ALL_LOW : ESP_EXT1_WAKEUP_ANY_HIGH);
+        rtc.level_armed = (uint8_t)level_state;
+    }
+
+    rtc.sleep_until_us = 0;
+    if (wake_unix) {
+        int64_t now_us = sysclock_now_ns() / 1000;
+        int64_t until_us = (int64_t)wake_unix * 1000000;
+        int64_t sleep_us = until_us > now_us ? until_us - now_us : 1000;
+        esp_sleep_enable_timer_wakeup((uint64_t)sleep_us);
+        rtc.sleep_until_us = now_us + sleep_us;
+        ESP_LOGI(TAG, "Deep sleep for %lld s, %d record(s) queued in RTC memory",
+                 sleep_us / 1000000, (int)rtc.count);
+    } else {
+        ESP_LOGI(TAG, "Deep sleep until button or water level, %d record(s) queued", (int)rtc.count);
+    }
+    esp_deep_sleep_start();
+}
+
+void duty_get_stats(duty_stats_t *out)
+{
+    *out = rtc.stats;
+}
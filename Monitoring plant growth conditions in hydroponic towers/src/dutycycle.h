@@ -0,0 +1,108 @@
+#ifndef DUTYCYCLE_H
+#define DUTYCYCLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "logrec.h"
+
+/*
+ * Tryb cyklicznego deep sleep (wieże na baterii / panelu słonecznym).
+ *
+ * Między blokami pomiarowymi układ jest w deep sleep; budzi go timer RTC
+ * (termin bloku), przycisk pH (ext0, poziom niski) albo zmiana czujnika
+ * poziomu wody (ext1). Po wybudzeniu RAM jest pusty, więc wszystko, co musi
+ * przetrwać między blokami, leży w pamięci RTC slow (RTC_DATA_ATTR): tu
+ * kolejka rekordów jeszcze niezapisanych na kartę i niewysłanych (kopie
+ * logrec_t z własnym CRC), liczniki i termin wybudzenia timerem.
+ *
+ * Karta SD i Wi-Fi startują tylko przy wybudzeniu, w którym paczka jest
+ * należna (duty_batch_due) - pozostałe wybudzenia to odczyt czujników
+ * i powrót do snu. Zanik zasilania gubi rekordy z kolejki RTC (do
+ * DUTY_QUEUE_RECORDS) - koszt niewłączania karty co blok.
+ *
+ * Czas startu: duty_boot_mark() zapisuje etapy (esp_timer), a
+ * duty_boot_log() wypisuje je jedną linią dla każdego wybudzenia.
+ */
+
+#define DUTY_QUEUE_RECORDS     16      // Rekordy w pamięci RTC (64 B każdy)
+#define DUTY_BOOT_MARKS        8       // Etapy startu w logu wybudzenia
+
+typedef enum {
+    DUTY_WAKE_COLD = 0,       // Zasilenie / reset (stan RTC wyzerowany)
+    DUTY_WAKE_TIMER,          // Termin bloku
+    DUTY_WAKE_BUTTON,         // Przycisk pH (ext0)
+    DUTY_WAKE_LEVEL,          // Czujnik poziomu wody (ext1)
+} duty_wake_t;
+
+typedef struct {
+    uint32_t wakes;           // Wybudzenia od zimnego startu
+    uint32_t batches;         // Wybudzenia z kartą SD i Wi-Fi
+    uint32_t queued;          // Rekordy dodane do kolejki RTC
+    uint32_t dropped;         // Najstarsze rekordy nadpisane w pełnej kolejce
+    int64_t last_boot_us;     // Od wybudzenia do app_main (ostatnie wybudzenie)
+} duty_stats_t;
+
+/**
+ * Przyczyna startu i stan z pamięci RTC. Wołać na początku app_main: czas
+ * wywołania jest punktem odniesienia dla duty_boot_mark(). Przy zimnym starcie
+ * (lub uszkodzonym stanie RTC) kolejka i liczniki są zerowane.
+ * @param button_gpio, level_gpio piny wybudzenia ext0 / ext1 (wracają do GPIO)
+ */
+duty_wake_t duty_init(gpio_num_t button_gpio, gpio_num_t level_gpio);
+
+// Nazwa przyczyny wybudzenia (log)
+const char *duty_wake_name(duty_wake_t wake);
+
+// Poziom czujnika wody, przeciwny do którego uzbrojono ext1 przed snem
+uint8_t duty_level_armed(void);
+
+/**
+ * Kopiuje rekord do kolejki RTC (pełna kolejka nadpisuje najstarszy).
+ */
+void duty_queue_push(const logrec_t *rec);
+
+// Liczba rekordów w kolejce RTC
+int duty_queue_count(void);
+
+// Rekord i-ty od najstarszego (NULL poza zakresem)
+const logrec_t *duty_queue_get(int i);
+
+// Usuwa n najstarszych rekordów (zapisanych na kartę lub wysłanych)
+void duty_queue_drop(int n);
+
+/**
+ * Czy uruchomić kartę i Wi-Fi: co najmniej max_records rekordów w kolejce,
+ * najstarszy starszy niż max_age_sec albo kolejka pełna.
+ */
+bool duty_batch_due(uint32_t now, int max_records, uint32_t max_age_sec);
+
+// Liczy wybudzenie z paczką (STATUS, log)
+void duty_count_batch(void);
+
+/**
+ * Koniec etapu startu (nazwa: literał). Czas od poprzedniego etapu lub
+ * od duty_init.
+ */
+void duty_boot_mark(const char *stage);
+
+/**
+ * Jedna linia: przyczyna, czas od wybudzenia do app_main (timer: z zegara
+ * systemowego wobec zaplanowanego wybudzenia; ext0/ext1: od startu esp_timer,
+ * bez bootloadera) i etapy z duty_boot_mark().
+ */
+void duty_boot_log(void);
+
+/**
+ * Deep sleep do wake_unix [s Unix] (0 = bez timera). Przekaźniki zostają
+ * wyłączone i zatrzaśnięte (gpio_hold) na czas snu; ext0 budzi przy wciśnięciu
+ * przycisku, ext1 przy poziomie wody różnym od level_state (< 0: czujnik
+ * nie działa, bez ext1 - pływający pin budziłby bez końca). Nie wraca.
+ */
+void duty_sleep(uint32_t wake_unix, int level_state);
+
+// Liczniki (STATUS)
+void duty_get_stats(duty_stats_t *out);
+
+#endif // DUTYCYCLE_H
@@ -0,0 +1,163 @@
+#include "jsonw.h"
+#include <string.h>
+
+void jsonw_init(jsonw_t *w, char *buf, size_t len) {
+    w->buf = buf;
+    w->len = len;
+    w->pos = 0;
+    w->overflow = false;
+    w->need_sep = false;
+}
+
+static void put(jsonw_t *w, const char *data, size_t n) {
+    if (w->overflow || w->len - w->pos < n) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->pos, data, n);
+    w->pos += n;
+}
+
+static void put_char(jsonw_t *w, char c) {
+    put(w, &c, 1);
+}
+
+static void separator(jsonw_t *w) {
+    if (w->need_sep) put(w, ", ", 2);
+}
+
+// Cyfry dziesiętne od końca bufora; zwraca wskaźnik na pierwszą cyfrę
+static char *u64_digits(uint64_t v, char *end) {
+    do {
+        *--end = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    return end;
+}
+
+static void put_uint(jsonw_t *w, uint64_t v) {
+    char tmp[20];
+    char *p = u64_digits(v, tmp + sizeof(tmp));
+    put(w, p, (size_t)(tmp + sizeof(tmp) - p));
+}
+
+static void put_int(jsonw_t *w, int64_t v) {
+    if (v < 0) {
+        put_char(w, '-');
+        put_uint(w, (uint64_t)0 - (uint64_t)v);
+    } else {
+        put_uint(w, (uint64_t)v);
+    }
+}
+
+/********************
+ * Struktura
+ ********************/
+void jsonw_object_begin(jsonw_t *w) {
+    separator(w);
+    put_char(w, '{');
+    w->need_sep = false;
+}
+
+void jsonw_object_end(jsonw_t *w) {
+    put_char(w, '}');
+    w->need_sep = true;
+}
+
+void jsonw_array_begin(jsonw_t *w) {
+    separator(w);
+    put_char(w, '[');
+    w->need_sep = false;
+}
+
+void jsonw_array_end(jsonw_t *w) {
+    put_char(w, ']');
+    w->need_sep = true;
+}
+
+void jsonw_key_n(jsonw_t *w, const char *key, size_t max_len) {
+    separator(w);
+    put_char(w, '"');
+    put(w, key, strnlen(key, max_len));
+    put(w, "\": ", 3);
+    w->need_sep = false;
+}
+
+void jsonw_key(jsonw_t *w, const char *key) {
+    jsonw_key_n(w, key, SIZE_MAX);
+}
+
+void jsonw_key_uint(jsonw_t *w, uint64_t key) {
+    separator(w);
+    put_char(w, '"');
+    put_uint(w, key);
+    put(w, "\": ", 3);
+    w->need_sep = false;
+}
+
+/********************
+ * Wartości
+ ********************/
+void jsonw_str(jsonw_t *w, const char *value) {
+    separator(w);
+    put_char(w, '"');
+    put(w, value, strlen(value));
+    put_char(w, '"');
+    w->need_sep = true;
+}
+
+void jsonw_int(jsonw_t *w, int64_t value) {
+    separator(w);
+    put_int(w, value);
+    w->need_sep = true;
+}
+
+void jsonw_uint(jsonw_t *w, uint64_t value) {
+    separator(w);
+    put_uint(w, value);
+    w->need_sep = true;
+}
+
+void jsonw_fixed(jsonw_t *w, int64_t raw, int decimals) {
+    separator(w);
+    w->need_sep = true;
+
+    if (decimals <= 0) {
+        for (int i = 0; i < -decimals; i++) raw *= 10;
+        put_int(w, raw);
+        return;
+    }
+
+    // Cyfry modułu z dopełnieniem zerami do decimals + 1 (np. 5 -> "005" -> 0.05)
+    uint64_t mag = raw < 0 ? (uint64_t)0 - (uint64_t)raw : (uint64_t)raw;
+    char tmp[24];
+    char *end = tmp + sizeof(tmp);
+    char *p = u64_digits(mag, end);
+    if (decimals > 18) decimals = 18;
+    while (end - p < decimals + 1) *--p = '0';
+
+    if (raw < 0) put_char(w, '-');
+    size_t int_len = (size_t)(end - p) - (size_t)decimals;
+    put(w, p, int_len);
+    put_char(w, '.');
+    put(w, p + int_len, (size_t)decimals);
+}
+
+void jsonw_bool(jsonw_t *w, bool value) {
+    separator(w);
+    if (value) put(w, "true", 4);
+    else put(w, "false", 5);
+    w->need_sep = true;
+}
+
+void jsonw_null(jsonw_t *w) {
+    separator(w);
+    put(w, "null", 4);
+    w->need_sep = true;
+}
+
+int jsonw_finish(jsonw_t *w) {
+    if (w->overflow || w->pos >= w->len) return -1;
+    w->buf[w->pos] = '\0';
+    return (int)w->pos;
+}
@@ -0,0 +1,66 @@
+#ifndef JSONW_H
+#define JSONW_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Strumieniowy writer JSON dla payloadów firmware (NDJSON logu i MQTT).
+ *
+ * Pisze bezpośrednio do bufora podanego przez wywołującego (np. wycinka bufora
+ * wiadomości), nie używa sterty ani printf. Liczby stałoprzecinkowe
+ * (jsonw_fixed) są formatowane arytmetyką całkowitą, więc do payloadu nie
+ * trafia programowy printf liczb zmiennoprzecinkowych. Każda funkcja używa
+ * najwyżej kilkudziesięciu bajtów stosu.
+ *
+ * Separatory (", " między elementami, ": " po kluczu) są wstawiane
+ * automatycznie. Przepełnienie jest zapamiętywane w writerze; kolejne zapisy
+ * są pomijane, a jsonw_finish() zwraca wtedy -1 (jak cborenc.h).
+ */
+
+typedef struct {
+    char *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+    bool need_sep;            // Przed kolejnym elementem potrzebny ", "
+} jsonw_t;
+
+void jsonw_init(jsonw_t *w, char *buf, size_t len);
+
+void jsonw_object_begin(jsonw_t *w);
+void jsonw_object_end(jsonw_t *w);
+void jsonw_array_begin(jsonw_t *w);
+void jsonw_array_end(jsonw_t *w);
+
+/**
+ * Klucz obiektu. Nazwa nie jest escapowana (nazwy pól schematu to [a-z0-9_]).
+ * jsonw_key_n przyjmuje nazwę bez '\0' (np. logrec_field_t.name).
+ */
+void jsonw_key(jsonw_t *w, const char *key);
+void jsonw_key_n(jsonw_t *w, const char *key, size_t max_len);
+void jsonw_key_uint(jsonw_t *w, uint64_t key);
+
+/**
+ * Tekst bez escapowania - tylko dla znanych wartości (znaczniki czasu, tryby).
+ */
+void jsonw_str(jsonw_t *w, const char *value);
+void jsonw_int(jsonw_t *w, int64_t value);
+void jsonw_uint(jsonw_t *w, uint64_t value);
+
+/**
+ * Liczba stałoprzecinkowa raw * 10^-decimals, np. (2150, 2) -> 21.50,
+ * (-5, 2) -> -0.05. decimals <= 0 daje liczbę całkowitą raw * 10^-decimals.
+ */
+void jsonw_fixed(jsonw_t *w, int64_t raw, int decimals);
+void jsonw_bool(jsonw_t *w, bool value);
+void jsonw_null(jsonw_t *w);
+
+/**
+ * Kończy tekst znakiem '\0' (nie liczonym do długości).
+ * @return długość JSON lub -1 gdy bufor był za mały
+ */
+int jsonw_finish(jsonw_t *w);
+
+#endif // JSONW_H
@@ -1,77 +1,135 @@
 #include "level.h"
 #include "driver/gpio.h"
+#include "esp_attr.h"
 #include "esp_log.h"
-#include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "esp_timer.h"
 
 static const char *TAG = "LEVEL_SENSOR";
 
 // ============== STRUKTURA STANU CZUJNIKA ==============
 typedef struct {
-    uint8_t current_state;           // Obecny stan (surowy odczyt)
-    uint8_t debounce_state;          // Stan po deboucingu (0=pusty, 1=woda)
-    uint32_t debounce_timer_ms;      // Timer debouncer
+    volatile uint8_t debounce_state; // Stan po deboucingu (0=pusty, 1=woda)
+    esp_timer_handle_t debounce_timer;
+    QueueHandle_t subscribers[LEVEL_MAX_SUBSCRIBERS];
+    int subscriber_count;
+    level_stats_t stats;
 } level_sensor_t;
 
 static level_sensor_t level_sensor = {
-    .current_state = 0,              // Zaczynamy od stanu "brak wody" (pin LOW)
-    .debounce_state = 0,
-    .debounce_timer_ms = 0
+    .debounce_state = 0,             // Zaczynamy od stanu "brak wody" (pin LOW)
 };
 
+static portMUX_TYPE level_mux = portMUX_INITIALIZER_UNLOCKED;
+
+// ============== PRZERWANIE I DEBOUNCING ==============
+/**
+ * Przerwanie poziomem przeciwnym do zaakceptowanego stanu - ten sam poziom
+ * budzi układ z automatycznego light sleep (zbocza w uśpieniu giną).
+ * Przerwanie wyłącza się do czasu decyzji timera, więc drgania kontaktronu
+ * nie generują kolejnych przerwań.
+ * esp_timer_start_once jest bezpieczne w przerwaniu (IRAM).
+ */
+static void IRAM_ATTR level_isr_handler(void *arg) {
+    gpio_intr_disable(LEVEL_SENSOR_PIN);
+    level_sensor.stats.edges++;
+    esp_timer_start_once(level_sensor.debounce_timer, DEBOUNCE_TIME_MS * 1000);
+}
+
+// Czekaj na poziom różny od stanu state (przerwanie + wybudzenie)
+static esp_err_t level_arm(uint8_t state) {
+    gpio_int_type_t wake = state ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL;
+    esp_err_t err = gpio_wakeup_enable(LEVEL_SENSOR_PIN, wake);
+    if (err == ESP_OK) err = gpio_intr_enable(LEVEL_SENSOR_PIN);
+    return err;
+}
+
+/**
+ * Logika:
+ * - 0 (LOW)  = Brak wody / pływak poniżej kontaktronu
+ * - 1 (HIGH) = Jest woda / pływak przy kontaktronie
+ *
+ * Wołane z zadania esp_timer: tylko rozesłanie zdarzenia, bez blokowania
+ * (logowanie i reakcja należą do subskrybentów).
+ */
+static void level_debounce_cb(void *arg) {
+    uint8_t raw_state = gpio_get_level(LEVEL_SENSOR_PIN);
+    if (raw_state == level_sensor.debounce_state) {
+        level_arm(raw_state);
+        return;  // Drgania wróciły do stanu wyjściowego
+    }
+    level_sensor.debounce_state = raw_state;
+    level_arm(raw_state);
+
+    level_event_t evt = {
+        .state = raw_state,
+        .time_us = esp_timer_get_time(),
+    };
+    portENTER_CRITICAL(&level_mux);
+    level_sensor.stats.transitions++;
+    int count = level_sensor.subscriber_count;
+    portEXIT_CRITICAL(&level_mux);
+
+    for (int i = 0; i < count; i++) {
+        if (xQueueSend(level_sensor.subscribers[i], &evt, 0) != pdTRUE) {
+            level_sensor.stats.dropped++;
+        }
+    }
+}
+
 // ============== INICJALIZACJA ==============
-void level_sensor_init(void) {
+esp_err_t level_sensor_init(void) {
     ESP_LOGI(TAG, "Inicjalizacja czujnika poziomów...");
-    
+
     // Konfiguracja pinu GPIO
     gpio_config_t io_conf = {
         .pin_bit_mask = (1ULL << LEVEL_SENSOR_PIN),  // Wybór pinu
         .mode = GPIO_MODE_INPUT,                      // Tryb wejścia
-        .pull_up_en = GPIO_PULLUP_ENABLE,            // Włączenie pull-up (3.3V w spoczynku)
+        .pull_up_en = GPIO_PULLUP_DISABLE,           // GPIO34 (tylko wejście) nie ma pull-up - zewnętrzny rezystor do 3.3V
         .pull_down_en = GPIO_PULLDOWN_DISABLE,       // Wyłączenie pull-down
-        .intr_type = GPIO_INTR_DISABLE               // Bez przerwań (polling)
+        .intr_type = GPIO_INTR_DISABLE               // Poziom ustawia level_arm()
+    };
+    esp_timer_create_args_t timer_args = {
+        .callback = level_debounce_cb,
+        .name = "level_debounce",
     };
-    
-    gpio_config(&io_conf);
-    ESP_LOGI(TAG, "Pin GPIO%d skonfigurowany z pull-up rezystorem", LEVEL_SENSOR_PIN);
+
+    esp_err_t err = gpio_config(&io_conf);
+    if (err == ESP_OK) err = esp_timer_create(&timer_args, &level_sensor.debounce_timer);
+    if (err == ESP_OK) {
+        // Stan początkowy bez czekania na zbocze
+        level_sensor.debounce_state = gpio_get_level(LEVEL_SENSOR_PIN);
+        // Wspólna usługa ISR (instalowana też przez przyciski i przycisk pH)
+        err = gpio_install_isr_service(0);
+        if (err == ESP_ERR_INVALID_STATE) err = ESP_OK;
+    }
+    if (err == ESP_OK) err = gpio_isr_handler_add(LEVEL_SENSOR_PIN, level_isr_handler, NULL);
+    if (err == ESP_OK) err = level_arm(level_sensor.debounce_state);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Level sensor init failed: %s", esp_err_to_name(err));
+        return err;
+    }
+    ESP_LOGI(TAG, "Pin GPIO%d: przerwanie poziomem (wybudza z light sleep), debouncing %d ms, stan: %s",
+             LEVEL_SENSOR_PIN, DEBOUNCE_TIME_MS, level_sensor_has_water() ? "WODA" : "PUSTY");
+    return ESP_OK;
 }
 
-// ============== ODCZYT I DEBOUNCING ==============
-/**
- * Aktualizuj stan czujnika z deboucingiem
- * 
- * Logika (ZMIENIONA):
- * - 0 (LOW)  = Brak wody / pływak poniżej kontaktronu
- * - 1 (HIGH) = Jest woda / pływak przy kontaktronie
- * 
- * Debouncing: Stan zmienia się tylko po DEBOUNCE_TIME_MS ms stabilności
- */
-static void level_sensor_update(void) {
-    // Odczyt surowego stanu
-    uint8_t raw_state = gpio_get_level(LEVEL_SENSOR_PIN);
-    
-    // Debouncing - licz czas zmienności
-    if (raw_state != level_sensor.current_state) {
-        // Wykryto zmianę - uruchom timer
-        level_sensor.debounce_timer_ms += SENSOR_POLL_INTERVAL_MS;
-        
-        if (level_sensor.debounce_timer_ms >= DEBOUNCE_TIME_MS) {
-            // Stan jest stabilny przez DEBOUNCE_TIME_MS - zaakceptuj zmianę
-            level_sensor.current_state = raw_state;
-            level_sensor.debounce_state = raw_state;
-            level_sensor.debounce_timer_ms = 0;
-            
-            // Logowanie zmiany stanu
-            if (raw_state == 1) {
-                ESP_LOGW(TAG, "⚠️  WODA WYKRYTA (pin HIGH) - pływak dotknął kontaktronu");
-            } else {
-                ESP_LOGI(TAG, "✓ BRAK WODY (pin LOW) - pływak poniżej kontaktronu");
-            }
-        }
-    } else {
-        // Stan jest stabilny - resetuj timer
-        level_sensor.debounce_timer_ms = 0;
+QueueHandle_t level_sensor_subscribe(void) {
+    QueueHandle_t q = xQueueCreate(LEVEL_EVENT_QUEUE_LEN, sizeof(level_event_t));
+    if (!q) {
+        return NULL;
+    }
+    portENTER_CRITICAL(&level_mux);
+    bool added = level_sensor.subscriber_count < LEVEL_MAX_SUBSCRIBERS;
+    if (added) {
+        level_sensor.subscribers[level_sensor.subscriber_count++] = q;
+    }
+    portEXIT_CRITICAL(&level_mux);
+    if (!added) {
+        vQueueDelete(q);
+        return NULL;
     }
+    return q;
 }
 
 // ============== FUNKCJE ZWRACAJĄCE STAN ==============
@@ -91,34 +149,8 @@ bool level_sensor_is_empty(void) {
     return (level_sensor.debounce_state == 0);  // 0 = LOW = brak wody
 }
 
-// ============== GŁÓWNA PĘTLA ZADANIA ==============
-static void level_sensor_task(void *pvParameters) {
-    ESP_LOGI(TAG, "Czujnik poziomów uruchomiony");
-    
-    while (1) {
-        // Aktualizuj stan z deboucingiem
-        level_sensor_update();
-        
-        // Okresowy wydruk diagnostyki
-        static uint32_t print_counter = 0;
-        print_counter++;
-        
-        if (print_counter >= (2000 / SENSOR_POLL_INTERVAL_MS)) {  // Co 2 sekundy
-            print_counter = 0;
-            
-            ESP_LOGI(TAG, "Stan: Raw=%d, Debounced=%d, Status=%s",
-                level_sensor.current_state,
-                level_sensor.debounce_state,
-                level_sensor_has_water() ? "🌊 WODA" : "☐ PUSTY"
-            );
-        }
-        
-        // Czekaj przed następnym odczytem
-        vTaskDelay(pdMS_TO_TICKS(SENSOR_POLL_INTERVAL_MS));
-    }
-}
-
-// ============== URUCHOMIENIE ZADANIA ==============
-void level_sensor_start_task(void) {
-    xTaskCreate(level_sensor_task, "level_sensor_task", 2048, NULL, 5, NULL);
+void level_sensor_get_stats(level_stats_t *out) {
+    portENTER_CRITICAL(&level_mux);
+    *out = level_sensor.stats;
+    portEXIT_CRITICAL(&level_mux);
 }
@@ -3,25 +3,48 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 
 // ============== KONFIGURACJA ==============
-#define LEVEL_SENSOR_PIN GPIO_NUM_34     // Pin GPIO podłączony do czujnika
+#define LEVEL_SENSOR_PIN GPIO_NUM_34     // Pin GPIO podłączony do czujnika (tylko wejście, bez
+                                         // wewnętrznego pull-up: wymaga zewnętrznego, np. 10k do 3.3V)
 #define DEBOUNCE_TIME_MS 500             // Czas histerezowy (ms)
-#define SENSOR_POLL_INTERVAL_MS 50       // Czas między odczytami (ms)
+#define LEVEL_MAX_SUBSCRIBERS 4          // Kolejki zdarzeń (sterowanie pompą, log, MQTT)
+#define LEVEL_EVENT_QUEUE_LEN 4          // Zdarzeń na subskrybenta
+
+// ============== ZDARZENIA ==============
+/**
+ * Zmiana stanu po deboucingu, rozsyłana do kolejek subskrybentów
+ */
+typedef struct {
+    uint8_t state;                       // 0 = brak wody, 1 = jest woda
+    int64_t time_us;                     // esp_timer_get_time() w chwili akceptacji
+} level_event_t;
+
+typedef struct {
+    uint32_t edges;                      // Przerwania z pinu (zmiany i drgania styków)
+    uint32_t transitions;                // Zmiany stanu po deboucingu
+    uint32_t dropped;                    // Zdarzenia odrzucone przez pełną kolejkę
+} level_stats_t;
 
 // ============== INICJALIZACJA ==============
 /**
- * Inicjalizuje czujnik poziomów (GPIO, pull-up, itp)
- * Należy wywołać raz w app_main()
+ * Inicjalizuje czujnik poziomów (GPIO, przerwanie poziomem, timer
+ * debouncingu). Należy wywołać raz w app_main(). Bez zadania odpytującego:
+ * CPU budzi dopiero poziom różny od zaakceptowanego stanu (także z light
+ * sleep, przy esp_sleep_enable_gpio_wakeup), a nowy stan jest akceptowany,
+ * jeśli utrzymuje się po DEBOUNCE_TIME_MS (jednorazowy esp_timer).
  */
-void level_sensor_init(void);
+esp_err_t level_sensor_init(void);
 
-// ============== FUNKCJE OBSŁUGI ==============
 /**
- * Uruchamia zadanie FreeRTOS do odczytywania czujnika
- * Powinno być wywołane po level_sensor_init()
+ * Nowa kolejka level_event_t dla subskrybenta (do LEVEL_MAX_SUBSCRIBERS).
+ * Zdarzenia są wysyłane bez czekania - pełna kolejka gubi zdarzenie.
+ * @return kolejka lub NULL (brak miejsca / pamięci)
  */
-void level_sensor_start_task(void);
+QueueHandle_t level_sensor_subscribe(void);
 
 // ============== FUNKCJE ZWRACAJĄCE STAN ==============
 /**
@@ -48,4 +71,9 @@ bool level_sensor_has_water(void);
  */
 bool level_sensor_is_empty(void);
 
+/**
+ * Liczniki przerwań i zdarzeń (komenda STATUS)
+ */
+void level_sensor_get_stats(level_stats_t *out);
+
 #endif // LEVEL_SENSOR_H
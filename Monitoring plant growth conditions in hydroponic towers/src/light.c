@@ -0,0 +1,116 @@
+#include "light.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+static const char *TAG = "LIGHT";
+
+#define MEAS_TIME_MAX_MS  180   // H-res / H-res2 przy MTreg 69 (typowo 120 ms)
+
+static i2c_dev_t *dev = NULL;
+static uint8_t mtreg = LIGHT_MTREG_DEFAULT;
+static bool hres2 = true;
+static bool started = false;
+static int64_t ready_us = 0;
+
+static uint32_t meas_time_ms(void)
+{
+    return (MEAS_TIME_MAX_MS * mtreg + LIGHT_MTREG_DEFAULT - 1) / LIGHT_MTREG_DEFAULT;
+}
+
+// lux = raw / 1.2 * 69 / MTreg (/ 2 w H-res2), w mililuksach bez utraty części ułamkowej
+static uint32_t raw_to_mlux(uint16_t raw)
+{
+    uint64_t num = (uint64_t)raw * LIGHT_MTREG_DEFAULT * 10 * 1000;
+    uint32_t den = 12u * mtreg * (hres2 ? 2u : 1u);
+    return (uint32_t)((num + den / 2) / den);
+}
+
+// Zakres na kolejny pomiar: raw ~ LIGHT_TARGET_RAW przy zmierzonym świetle
+static void select_range(uint32_t mlux)
+{
+    if (mlux == 0) {
+        hres2 = true;
+        mtreg = LIGHT_MTREG_MAX;
+        return;
+    }
+    // MTreg w H-res2 = TARGET * 69 / (2.4 * lux)
+    uint64_t m = (uint64_t)LIGHT_TARGET_RAW * LIGHT_MTREG_DEFAULT * 10 * 1000 / (24ull * mlux);
+    hres2 = m >= LIGHT_MTREG_MIN;
+    if (!hres2) {
+        m *= 2;  // H-res: dwa razy mniej zliczeń na luks
+    }
+    if (m < LIGHT_MTREG_MIN) m = LIGHT_MTREG_MIN;
+    if (m > LIGHT_MTREG_MAX) m = LIGHT_MTREG_MAX;
+    mtreg = (uint8_t)m;
+}
+
+esp_err_t light_init(i2c_dev_t *d)
+{
+    dev = d;
+    started = false;
+    mtreg = LIGHT_MTREG_DEFAULT;
+    hres2 = true;
+    return bh1750_power_down(dev);
+}
+
+esp_err_t light_start(void)
+{
+    if (!dev) return ESP_ERR_INVALID_STATE;
+
+    esp_err_t err = bh1750_power_on(dev);
+    if (err == ESP_OK) err = bh1750_set_measurement_time(dev, mtreg);
+    if (err == ESP_OK) err = bh1750_setup(dev, BH1750_MODE_ONE_TIME, hres2 ? BH1750_RES_HIGH2 : BH1750_RES_HIGH);
+    started = err == ESP_OK;
+    ready_us = esp_timer_get_time() + (int64_t)meas_time_ms() * 1000;
+    return err;
+}
+
+static esp_err_t collect(uint16_t *raw)
+{
+    int64_t left_us = ready_us - esp_timer_get_time();
+    if (left_us > 0) {
+        // +1 tick, bo vTaskDelay(n) trwa od n-1 do n ticków
+        vTaskDelay(pdMS_TO_TICKS((left_us + 999) / 1000) + 1);
+    }
+    started = false;
+    return bh1750_read_raw(dev, raw);
+}
+
+esp_err_t light_read(float *lux)
+{
+    esp_err_t err = started ? ESP_OK : light_start();
+    uint16_t raw = 0;
+    if (err == ESP_OK) err = collect(&raw);
+
+    // Nasycenie: powtórz na najmniej czułym zakresie, zanim wynik trafi do rekordu
+    if (err == ESP_OK && raw >= LIGHT_SATURATED_RAW && (hres2 || mtreg > LIGHT_MTREG_MIN)) {
+        ESP_LOGD(TAG, "Saturated at MTreg %u (%s), retrying", mtreg, hres2 ? "H-res2" : "H-res");
+        hres2 = false;
+        mtreg = LIGHT_MTREG_MIN;
+        err = light_start();
+        if (err == ESP_OK) err = collect(&raw);
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    uint32_t mlux = raw_to_mlux(raw);
+    *lux = mlux / 1000.0f;
+
+    uint8_t old_mtreg = mtreg;
+    bool old_hres2 = hres2;
+    select_range(mlux);
+    if (mtreg != old_mtreg || hres2 != old_hres2) {
+        ESP_LOGD(TAG, "Range: MTreg %u (%s) -> %u (%s)", old_mtreg, old_hres2 ? "H-res2" : "H-res",
+                 mtreg, hres2 ? "H-res2" : "H-res");
+    }
+    return ESP_OK;
+}
+
+void light_get_range(uint8_t *out_mtreg, bool *out_hres2)
+{
+    *out_mtreg = mtreg;
+    *out_hres2 = hres2;
+}
@@ -0,0 +1,38 @@
+#ifndef LIGHT_H
+#define LIGHT_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "bh1750.h"
+
+/*
+ * Pomiar światła BH1750 w trybie jednorazowym (czujnik sam przechodzi w
+ * power-down po pomiarze) z automatycznym doborem zakresu: MTreg 31..254 w
+ * trybie H-res2 (0.11 lx przy MTreg 254), a przy silnym świetle H-res
+ * (do ~120 klx przy MTreg 31). Zakres na kolejny blok wynika z ostatniego
+ * wyniku; nasycony odczyt jest powtarzany na najmniej czułym zakresie.
+ *
+ * light_start() tylko wysyła komendy; light_read() czeka (vTaskDelay) na
+ * resztę czasu integracji, więc w międzyczasie można czytać inne czujniki.
+ */
+
+#define LIGHT_MTREG_MIN      31
+#define LIGHT_MTREG_MAX      254
+#define LIGHT_MTREG_DEFAULT  69    // Wartość fabryczna
+#define LIGHT_TARGET_RAW     20000 // Cel ~30% skali: zapas na zmianę światła między blokami
+#define LIGHT_SATURATED_RAW  65000
+
+// dev musi mieć utworzony mutex (bh1750_init_desc) i żyć przez cały czas pracy
+esp_err_t light_init(i2c_dev_t *dev);
+
+// Rozpoczyna pomiar jednorazowy na bieżącym zakresie
+esp_err_t light_start(void);
+
+// Odbiera wynik (startuje pomiar, jeśli nie był rozpoczęty) i dobiera zakres
+esp_err_t light_read(float *lux);
+
+// Bieżący zakres (STATUS)
+void light_get_range(uint8_t *mtreg, bool *hres2);
+
+#endif // LIGHT_H
@@ -0,0 +1,401 @@
+#include "logrec.h"
+#include "cborenc.h"
+#include "jsonw.h"
+#include <string.h>
+
+// Schemat bieżącej wersji - nazwy pól jak w NDJSON przeglądarki
+#define FIELD(n, t, m, s) { .name = n, .type = t, .offset = offsetof(logrec_t, m), .scale = s }
+#define ARRAY(n, t, m, s, c) { .name = n, .type = t, .offset = offsetof(logrec_t, m), .scale = s, .count = c }
+
+static const logrec_field_t schema[LOGREC_FIELD_COUNT] = {
+    FIELD("seq",              LOGREC_TYPE_U32, seq,           0),
+    FIELD("timestamp",        LOGREC_TYPE_U32, timestamp,     0),
+    FIELD("temperature_ds18", LOGREC_TYPE_I16, temp_ds18,    -2),
+    FIELD("temperature_dht",  LOGREC_TYPE_I16, temp_dht,     -2),
+    FIELD("humidity",         LOGREC_TYPE_U16, humidity,     -2),
+    FIELD("ph",               LOGREC_TYPE_U16, ph,           -2),
+    FIELD("light",            LOGREC_TYPE_U32, light,        -2),
+    FIELD("relay1_on_ms",     LOGREC_TYPE_U32, relay1_on_ms,  0),
+    FIELD("relay1_off_ms",    LOGREC_TYPE_U32, relay1_off_ms, 0),
+    FIELD("flags",            LOGREC_TYPE_U8,  flags,         0),
+    ARRAY("temp_probes",      LOGREC_TYPE_I16, temp_probe,   -2, LOGREC_PROBES),
+};
+
+/********************
+ * CRC
+ ********************/
+uint16_t logrec_crc16(const void *data, size_t len) {
+    const uint8_t *p = data;
+    uint16_t crc = 0xFFFF;
+    while (len--) {
+        crc ^= (uint16_t)(*p++) << 8;
+        for (int i = 0; i < 8; i++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/********************
+ * Nagłówek
+ ********************/
+void logrec_header_init(logrec_header_t *hdr, uint32_t created) {
+    memset(hdr, 0, sizeof(*hdr));
+    hdr->magic = LOGREC_MAGIC;
+    hdr->version = LOGREC_VERSION;
+    hdr->header_size = LOGREC_HEADER_SIZE;
+    hdr->record_size = LOGREC_RECORD_SIZE;
+    hdr->field_count = LOGREC_FIELD_COUNT;
+    hdr->created = created;
+    memcpy(hdr->fields, schema, sizeof(schema));
+    hdr->crc = logrec_crc16(hdr, offsetof(logrec_header_t, crc));
+}
+
+esp_err_t logrec_header_check(const logrec_header_t *hdr) {
+    if (hdr->magic != LOGREC_MAGIC || hdr->version == 0 || hdr->version > LOGREC_VERSION) {
+        return ESP_ERR_INVALID_VERSION;
+    }
+    if (hdr->header_size != LOGREC_HEADER_SIZE || hdr->record_size == 0 ||
+        hdr->field_count > LOGREC_FIELD_COUNT) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (hdr->crc != logrec_crc16(hdr, offsetof(logrec_header_t, crc))) {
+        return ESP_ERR_INVALID_CRC;
+    }
+    return ESP_OK;
+}
+
+/********************
+ * Rekord
+ ********************/
+void logrec_seal(logrec_t *rec) {
+    rec->crc = logrec_crc16(rec, offsetof(logrec_t, crc));
+}
+
+bool logrec_is_valid(const logrec_t *rec) {
+    return rec->crc == logrec_crc16(rec, offsetof(logrec_t, crc));
+}
+
+int16_t logrec_pack_i16(float value, float mul) {
+    if (value != value) return LOGREC_NA_I16;  // NAN
+    float v = value * mul + (value >= 0 ? 0.5f : -0.5f);
+    if (v >= 32767.0f) return INT16_MAX;
+    if (v <= -32767.0f) return -INT16_MAX;
+    return (int16_t)v;
+}
+
+uint16_t logrec_pack_u16(float value, float mul) {
+    if (value != value) return LOGREC_NA_U16;
+    float v = value * mul + 0.5f;
+    if (v <= 0.0f) return 0;
+    if (v >= 65534.0f) return UINT16_MAX - 1;
+    return (uint16_t)v;
+}
+
+uint32_t logrec_pack_u32(float value, float mul) {
+    if (value != value) return LOGREC_NA_U32;
+    float v = value * mul + 0.5f;
+    if (v <= 0.0f) return 0;
+    if (v >= 4294967040.0f) return UINT32_MAX - 1;
+    return (uint32_t)v;
+}
+
+/********************
+ * Pola wg schematu
+ ********************/
+static size_t type_size(uint8_t type) {
+    switch (type) {
+        case LOGREC_TYPE_U8:  return 1;
+        case LOGREC_TYPE_I16: return 2;
+        case LOGREC_TYPE_U16: return 2;
+        case LOGREC_TYPE_U32: return 4;
+        default:              return 0;
+    }
+}
+
+static int field_count(const logrec_field_t *fd) {
+    return fd->count > 1 ? fd->count : 1;
+}
+
+// Element index pola (0 dla pól pojedynczych)
+static bool field_read(const logrec_field_t *fd, const uint8_t *rec, size_t rec_size, int index,
+                       int64_t *raw, bool *na) {
+    uint8_t u8;
+    int16_t i16;
+    uint16_t u16;
+    uint32_t u32;
+
+    size_t size = type_size(fd->type);
+    size_t off = fd->offset + (size_t)index * size;
+    if (size == 0 || index >= field_count(fd) || off + size > rec_size) return false;
+
+    switch (fd->type) {
+        case LOGREC_TYPE_U8:
+            memcpy(&u8, rec + off, 1);
+            *raw = u8; *na = false;
+            return true;
+        case LOGREC_TYPE_I16:
+            memcpy(&i16, rec + off, 2);
+            *raw = i16; *na = i16 == LOGREC_NA_I16;
+            return true;
+        case LOGREC_TYPE_U16:
+            memcpy(&u16, rec + off, 2);
+            *raw = u16; *na = u16 == LOGREC_NA_U16;
+            return true;
+        default:
+            memcpy(&u32, rec + off, 4);
+            *raw = u32; *na = u32 == LOGREC_NA_U32;
+            return true;
+    }
+}
+
+static void field_write(const logrec_field_t *fd, uint8_t *rec, int index, int64_t raw) {
+    uint8_t u8 = (uint8_t)raw;
+    uint16_t u16 = (uint16_t)raw;
+    uint32_t u32 = (uint32_t)raw;
+    size_t size = type_size(fd->type);
+    uint8_t *p = rec + fd->offset + (size_t)index * size;
+
+    if (size == 1) memcpy(p, &u8, 1);
+    else if (size == 2) memcpy(p, &u16, 2);  // I16 i U16 - ten sam układ bitów
+    else if (size == 4) memcpy(p, &u32, 4);
+}
+
+static int64_t field_na(const logrec_field_t *fd) {
+    switch (fd->type) {
+        case LOGREC_TYPE_I16: return LOGREC_NA_I16;
+        case LOGREC_TYPE_U16: return LOGREC_NA_U16;
+        case LOGREC_TYPE_U32: return LOGREC_NA_U32;
+        default:              return 0;
+    }
+}
+
+// Liczba elementów do wypisania: tablica bez końcowych braków odczytu
+static int field_used(const logrec_field_t *fd, const uint8_t *rec, size_t rec_size) {
+    int n = field_count(fd);
+    int64_t raw;
+    bool na;
+    while (n > 0 && (!field_read(fd, rec, rec_size, n - 1, &raw, &na) || na)) n--;
+    return n;
+}
+
+bool logrec_upgrade(const logrec_header_t *old_hdr, const void *old_rec, logrec_t *out) {
+    const uint8_t *r = old_rec;
+    uint16_t crc;
+    memcpy(&crc, r + old_hdr->record_size - 2, sizeof(crc));
+    if (crc != logrec_crc16(r, old_hdr->record_size - 2u)) return false;
+
+    memset(out, 0, sizeof(*out));
+    for (int f = 0; f < LOGREC_FIELD_COUNT; f++) {
+        const logrec_field_t *fd = &schema[f];
+        const logrec_field_t *src = NULL;
+        for (int i = 0; i < old_hdr->field_count; i++) {
+            if (strncmp(old_hdr->fields[i].name, fd->name, LOGREC_NAME_LEN) == 0) {
+                src = &old_hdr->fields[i];
+                break;
+            }
+        }
+        for (int e = 0; e < field_count(fd); e++) {
+            int64_t raw;
+            bool na;
+            if (!src || !field_read(src, r, old_hdr->record_size, e, &raw, &na) || na) raw = field_na(fd);
+            field_write(fd, (uint8_t *)out, e, raw);
+        }
+    }
+    logrec_seal(out);
+    return true;
+}
+
+/********************
+ * NDJSON (dekoder, writer jsonw.h)
+ ********************/
+
+static bool schema_get(const logrec_header_t *hdr, const uint8_t *rec, const char *name,
+                       int64_t *raw, bool *na) {
+    for (int i = 0; i < hdr->field_count; i++) {
+        const logrec_field_t *fd = &hdr->fields[i];
+        if (strncmp(fd->name, name, LOGREC_NAME_LEN) == 0) {
+            return field_read(fd, rec, hdr->record_size, 0, raw, na);
+        }
+    }
+    return false;
+}
+
+bool logrec_field_get(const logrec_t *rec, const char *name, int64_t *raw, bool *na) {
+    bool na_tmp;
+    for (int i = 0; i < LOGREC_FIELD_COUNT; i++) {
+        if (strncmp(schema[i].name, name, LOGREC_NAME_LEN) == 0) {
+            return field_read(&schema[i], (const uint8_t *)rec, sizeof(*rec), 0, raw, na ? na : &na_tmp);
+        }
+    }
+    return false;
+}
+
+// "YYYY-MM-DD HH:MM:SS" (UTC) arytmetyką całkowitą - bez gmtime_r i printf
+static void format_timestamp(uint32_t t, char out[20]) {
+    uint32_t days = t / 86400u, sec = t % 86400u;
+
+    // Data cywilna z numeru dnia (H. Hinnant, days_from_civil odwrotnie)
+    uint32_t z = days + 719468u;
+    uint32_t era = z / 146097u;
+    uint32_t doe = z - era * 146097u;
+    uint32_t yoe = (doe - doe / 1460u + doe / 36524u - doe / 146096u) / 365u;
+    uint32_t doy = doe - (365u * yoe + yoe / 4u - yoe / 100u);
+    uint32_t mp = (5u * doy + 2u) / 153u;
+    uint32_t day = doy - (153u * mp + 2u) / 5u + 1u;
+    uint32_t month = mp < 10u ? mp + 3u : mp - 9u;
+    uint32_t year = yoe + era * 400u + (month <= 2u ? 1u : 0u);
+
+    uint32_t v[6] = { year, month, day, sec / 3600u, sec / 60u % 60u, sec % 60u };
+    static const char sep[6] = { '-', '-', ' ', ':', ':', '\0' };
+    char *p = out;
+    for (int i = 0; i < 6; i++) {
+        if (i == 0) {
+            for (uint32_t div = 1000; div > 0; div /= 10) *p++ = (char)('0' + v[0] / div % 10);
+        } else {
+            *p++ = (char)('0' + v[i] / 10 % 10);
+            *p++ = (char)('0' + v[i] % 10);
+        }
+        *p++ = sep[i];
+    }
+}
+
+// Jeden rekord jako obiekt JSON w formacie przeglądarki
+static void write_record(jsonw_t *w, const logrec_header_t *hdr, const uint8_t *r) {
+    int64_t raw;
+    bool na;
+
+    jsonw_object_begin(w);
+
+    // Timestamp w formacie RTC (przeglądarka parsuje "YYYY-MM-DD HH:MM:SS")
+    if (schema_get(hdr, r, "timestamp", &raw, &na)) {
+        char ts[20];
+        format_timestamp((uint32_t)raw, ts);
+        jsonw_key(w, "timestamp");
+        jsonw_str(w, ts);
+    }
+
+    // Pola liczbowe opisane schematem (stałoprzecinkowo: raw * 10^scale)
+    for (int i = 0; i < hdr->field_count; i++) {
+        const logrec_field_t *fd = &hdr->fields[i];
+        if (strncmp(fd->name, "timestamp", LOGREC_NAME_LEN) == 0 ||
+            strncmp(fd->name, "flags", LOGREC_NAME_LEN) == 0 ||
+            strncmp(fd->name, "relay", 5) == 0) {
+            continue;
+        }
+        if (!field_read(fd, r, hdr->record_size, 0, &raw, &na)) continue;
+
+        jsonw_key_n(w, fd->name, LOGREC_NAME_LEN);
+        if (fd->count > 1) {
+            int used = field_used(fd, r, hdr->record_size);
+            jsonw_array_begin(w);
+            for (int e = 0; e < used; e++) {
+                field_read(fd, r, hdr->record_size, e, &raw, &na);
+                if (na) jsonw_null(w);
+                else jsonw_fixed(w, raw, -fd->scale);
+            }
+            jsonw_array_end(w);
+        } else if (na) {
+            jsonw_null(w);
+        } else {
+            jsonw_fixed(w, raw, -fd->scale);
+        }
+    }
+
+    // Flagi -> pola przeglądarki (level, ph_fresh, relay_1, relay_2)
+    if (schema_get(hdr, r, "flags", &raw, &na)) {
+        uint8_t flags = (uint8_t)raw;
+        if (flags & LOGREC_FLAG_LEVEL_VALID) {
+            jsonw_key(w, "level");
+            jsonw_int(w, (flags & LOGREC_FLAG_LEVEL) ? 1 : 0);
+        }
+        if (flags & LOGREC_FLAG_PH_FRESH_VALID) {
+            jsonw_key(w, "ph_fresh");
+            jsonw_bool(w, flags & LOGREC_FLAG_PH_FRESH);
+        }
+
+        int64_t on_ms = 0, off_ms = 0;
+        bool na_on, na_off;
+        schema_get(hdr, r, "relay1_on_ms", &on_ms, &na_on);
+        schema_get(hdr, r, "relay1_off_ms", &off_ms, &na_off);
+
+        jsonw_key(w, "relay_1");
+        jsonw_object_begin(w);
+        jsonw_key(w, "active");
+        jsonw_bool(w, flags & LOGREC_FLAG_RELAY1);
+        if ((flags & LOGREC_FLAG_RELAY1_CYCLE) && on_ms > 0 && off_ms > 0) {
+            jsonw_key_uint(w, (uint64_t)on_ms);
+            jsonw_int(w, off_ms);
+        }
+        jsonw_object_end(w);
+
+        jsonw_key(w, "relay_2");
+        jsonw_object_begin(w);
+        jsonw_key(w, "active");
+        jsonw_bool(w, flags & LOGREC_FLAG_RELAY2);
+        jsonw_object_end(w);
+    }
+
+    jsonw_object_end(w);
+}
+
+int logrec_format_ndjson(const logrec_header_t *hdr, const void *rec, char *buf, size_t len) {
+    jsonw_t w;
+    jsonw_init(&w, buf, len);
+    write_record(&w, hdr, rec);
+    return jsonw_finish(&w);
+}
+
+int logrec_format_batch(const logrec_header_t *hdr, const logrec_t *recs, size_t count,
+                        char *buf, size_t len) {
+    if (count == 0) return -1;
+
+    jsonw_t w;
+    jsonw_init(&w, buf, len);
+    jsonw_object_begin(&w);
+    jsonw_key(&w, "seq_first");
+    jsonw_uint(&w, recs[0].seq);
+    jsonw_key(&w, "seq_last");
+    jsonw_uint(&w, recs[count - 1].seq);
+    jsonw_key(&w, "records");
+    jsonw_array_begin(&w);
+    for (size_t i = 0; i < count; i++) {
+        write_record(&w, hdr, (const uint8_t *)&recs[i]);
+    }
+    jsonw_array_end(&w);
+    jsonw_object_end(&w);
+    return jsonw_finish(&w);
+}
+
+/********************
+ * CBOR (MQTT)
+ ********************/
+int logrec_format_cbor(const logrec_t *recs, size_t count, uint8_t *buf, size_t len) {
+    cbor_writer_t w;
+    cbor_writer_init(&w, buf, len);
+    if (count == 0) return -1;
+
+    cbor_put_map(&w, 2);
+    cbor_put_text(&w, "v");
+    cbor_put_uint(&w, LOGREC_VERSION);
+    cbor_put_text(&w, "r");
+    cbor_put_array(&w, count);
+
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *r = (const uint8_t *)&recs[i];
+        cbor_put_array(&w, LOGREC_FIELD_COUNT);
+        for (int f = 0; f < LOGREC_FIELD_COUNT; f++) {
+            const logrec_field_t *fd = &schema[f];
+            int used = fd->count > 1 ? field_used(fd, r, sizeof(recs[i])) : 1;
+            if (fd->count > 1) cbor_put_array(&w, (size_t)used);
+            for (int e = 0; e < used; e++) {
+                int64_t raw;
+                bool na;
+                field_read(fd, r, sizeof(recs[i]), e, &raw, &na);
+                if (na) cbor_put_null(&w);
+                else cbor_put_int(&w, raw);
+            }
+        }
+    }
+    return cbor_writer_finish(&w);
+}
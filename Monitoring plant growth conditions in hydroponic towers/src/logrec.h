@@ -0,0 +1,179 @@
+#ifndef LOGREC_H
+#define LOGREC_H
+
+#include "esp_err.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Binarny format logu pomiarów na karcie SD.
+ *
+ * Plik = nagłówek (LOGREC_HEADER_SIZE bajtów, zawiera opis schematu)
+ *      + ciąg rekordów o stałym rozmiarze LOGREC_RECORD_SIZE.
+ *
+ * Rekord ma 64 bajty (wersja 1: 32), nagłówek 256, więc rekordy nigdy nie
+ * przecinają granicy sektora 4 KiB. Każdy rekord kończy się CRC-16/CCITT. Wartości fizyczne są
+ * zapisane jako liczby całkowite ze stałym mnożnikiem 10^scale (np. 0.01 °C),
+ * a brak odczytu (NAN) jako wartość LOGREC_NA_* danego typu.
+ * Pole może być tablicą (count > 1 w opisie pola, np. temperatury sond
+ * DS18B20). Wszystkie pola są little-endian (ESP32 i x86).
+ *
+ * Dekoder na PC: tools/dasdecode.c (zamienia plik na NDJSON dla przeglądarki).
+ */
+
+#define LOGREC_MAGIC        0x4C534144u   // "DASL"
+#define LOGREC_VERSION      2
+#define LOGREC_HEADER_SIZE  256
+#define LOGREC_RECORD_SIZE  64
+#define LOGREC_NAME_LEN     16
+#define LOGREC_PROBES       8     // Sondy DS18B20 na magistrali 1-Wire
+
+// Wartości oznaczające brak odczytu
+#define LOGREC_NA_I16       INT16_MIN
+#define LOGREC_NA_U16       UINT16_MAX
+#define LOGREC_NA_U32       UINT32_MAX
+
+// Bity pola flags
+#define LOGREC_FLAG_RELAY1        0x01  // Przekaźnik 1 (pompa) włączony
+#define LOGREC_FLAG_RELAY2        0x02  // Przekaźnik 2 (LED) włączony
+#define LOGREC_FLAG_RELAY1_CYCLE  0x04  // Przekaźnik 1 w trybie cyklicznym (R1:TIME)
+#define LOGREC_FLAG_RELAY2_CYCLE  0x08  // Przekaźnik 2 w trybie cyklicznym
+#define LOGREC_FLAG_LEVEL         0x10  // Czujnik poziomu: jest woda
+#define LOGREC_FLAG_LEVEL_VALID   0x20  // Pole LEVEL zawiera odczyt
+#define LOGREC_FLAG_PH_FRESH      0x40  // pH zmierzone od poprzedniego rekordu (inaczej ostatnia znana wartość)
+#define LOGREC_FLAG_PH_FRESH_VALID 0x80 // Pole PH_FRESH ustawione (starsze rekordy go nie mają)
+
+typedef enum {
+    LOGREC_TYPE_U8 = 1,
+    LOGREC_TYPE_I16,
+    LOGREC_TYPE_U16,
+    LOGREC_TYPE_U32,
+} logrec_type_t;
+
+/**
+ * Opis pola w nagłówku (schemat). Dekoder nie musi znać struktury rekordu.
+ */
+typedef struct __attribute__((packed)) {
+    char name[LOGREC_NAME_LEN];   // Nazwa pola (jak w NDJSON przeglądarki)
+    uint8_t type;                 // logrec_type_t
+    uint8_t offset;               // Offset w rekordzie
+    int8_t scale;                 // Wykładnik: wartość = raw * 10^scale
+    uint8_t count;                // Liczba elementów tablicy (0 i 1 = pojedyncza wartość)
+} logrec_field_t;
+
+#define LOGREC_FIELD_COUNT  11
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;               // LOGREC_MAGIC
+    uint16_t version;             // LOGREC_VERSION
+    uint16_t header_size;         // LOGREC_HEADER_SIZE
+    uint16_t record_size;         // LOGREC_RECORD_SIZE
+    uint16_t field_count;         // Liczba wpisów w fields
+    uint32_t created;             // Czas utworzenia pliku (sekundy, czas RTC)
+    logrec_field_t fields[LOGREC_FIELD_COUNT];
+    uint32_t bucket_sec;          // 0 = surowe pomiary, >0 = średnie z przedziałów (kompakcja)
+    uint8_t padding[LOGREC_HEADER_SIZE - 20 - LOGREC_FIELD_COUNT * sizeof(logrec_field_t) - 2];
+    uint16_t crc;                 // CRC-16 wszystkich poprzednich bajtów
+} logrec_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;                 // Numer kolejny rekordu
+    uint32_t timestamp;           // Czas RTC jako sekundy od 1970 (bez strefy)
+    int16_t temp_ds18;            // 0.01 °C
+    int16_t temp_dht;             // 0.01 °C
+    uint16_t humidity;            // 0.01 %
+    uint16_t ph;                  // 0.01 pH
+    uint32_t light;               // 0.01 lx
+    uint32_t relay1_on_ms;        // Czas włączenia w trybie cyklicznym
+    uint32_t relay1_off_ms;       // Czas przerwy w trybie cyklicznym
+    uint8_t flags;                // LOGREC_FLAG_*
+    uint8_t reserved;
+    int16_t temp_probe[LOGREC_PROBES];  // 0.01 °C, sondy DS18B20 w kolejności tablicy urządzeń
+    uint8_t reserved2[16];
+    uint16_t crc;                 // CRC-16 poprzednich 62 bajtów
+} logrec_t;
+
+_Static_assert(sizeof(logrec_t) == LOGREC_RECORD_SIZE, "logrec_t size");
+_Static_assert(sizeof(logrec_header_t) == LOGREC_HEADER_SIZE, "logrec_header_t size");
+
+/**
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+ */
+uint16_t logrec_crc16(const void *data, size_t len);
+
+/**
+ * Wypełnia nagłówek bieżącym schematem i liczy CRC.
+ */
+void logrec_header_init(logrec_header_t *hdr, uint32_t created);
+
+/**
+ * Sprawdza nagłówek: ESP_OK, ESP_ERR_INVALID_VERSION (zły magic/wersja),
+ * ESP_ERR_INVALID_SIZE (rozmiary), ESP_ERR_INVALID_CRC.
+ */
+esp_err_t logrec_header_check(const logrec_header_t *hdr);
+
+/**
+ * Liczy i wpisuje CRC rekordu.
+ */
+void logrec_seal(logrec_t *rec);
+
+/**
+ * Sprawdza CRC rekordu.
+ */
+bool logrec_is_valid(const logrec_t *rec);
+
+/**
+ * Konwersje wartości fizycznych na pola stałoprzecinkowe (NAN -> LOGREC_NA_*).
+ * mul to mnożnik (np. 100 dla 0.01), wartości spoza zakresu są obcinane.
+ */
+int16_t logrec_pack_i16(float value, float mul);
+uint16_t logrec_pack_u16(float value, float mul);
+uint32_t logrec_pack_u32(float value, float mul);
+
+/**
+ * Przepisuje rekord starszej wersji (opisany nagłówkiem old_hdr) na bieżący
+ * schemat: pola o tej samej nazwie są kopiowane, nowe pola dostają
+ * LOGREC_NA_*. Wynik jest zapieczętowany (logrec_seal).
+ * @return false gdy CRC starego rekordu się nie zgadza
+ */
+bool logrec_upgrade(const logrec_header_t *old_hdr, const void *old_rec, logrec_t *out);
+
+/**
+ * Odczytuje surową wartość pola rekordu wg nazwy ze schematu (np. "ph").
+ * Dla pola tablicowego zwraca pierwszy element.
+ * @param na [out] true gdy pole ma wartość LOGREC_NA_* (może być NULL)
+ * @return false gdy pole nie istnieje
+ */
+bool logrec_field_get(const logrec_t *rec, const char *name, int64_t *raw, bool *na);
+
+/**
+ * Formatuje rekord jako jedną linię NDJSON w formacie przeglądarki
+ * (das_tower_viewer.py), korzystając wyłącznie ze schematu z nagłówka.
+ * Pole tablicowe jest listą bez końcowych braków odczytu, np.
+ * "temp_probes": [21.50, null, 19.75].
+ * @return długość linii (bez '\0') lub -1 gdy bufor jest za mały
+ */
+int logrec_format_ndjson(const logrec_header_t *hdr, const void *rec, char *buf, size_t len);
+
+/**
+ * Formatuje paczkę rekordów (publikacja MQTT) jako jeden obiekt JSON:
+ *   {"seq_first": A, "seq_last": B, "records": [{...}, {...}]}
+ * Rekordy w tablicy mają format logrec_format_ndjson().
+ * @return długość (bez '\0') lub -1 gdy bufor jest za mały albo count == 0
+ */
+int logrec_format_batch(const logrec_header_t *hdr, const logrec_t *recs, size_t count,
+                        char *buf, size_t len);
+
+/**
+ * Koduje paczkę rekordów w CBOR (cborenc.h) - zwarta alternatywa dla JSON:
+ *   {"v": LOGREC_VERSION, "r": [[seq, timestamp, temperature_ds18, ...], ...]}
+ * Każdy rekord to tablica surowych wartości całkowitych w kolejności pól
+ * schematu wersji "v" (wartość = raw * 10^scale), null dla braku odczytu.
+ * Pole tablicowe to zagnieżdżona tablica bez końcowych braków odczytu.
+ * Zmiana schematu wymaga podniesienia LOGREC_VERSION (dekoder Pythona).
+ * @return długość lub -1 gdy bufor jest za mały albo count == 0
+ */
+int logrec_format_cbor(const logrec_t *recs, size_t count, uint8_t *buf, size_t len);
+
+#endif // LOGREC_H
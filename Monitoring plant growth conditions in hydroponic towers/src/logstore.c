@@ -0,0 +1,791 @@
+#include "logstore.h"
+#include "esp_log.h"
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <strings.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static const char *TAG = "LOGSTORE";
+
+/********************
+ * Nazwy plików
+ ********************/
+esp_err_t logstore_day_path(const char *dir, uint32_t timestamp, const char *ext,
+                            char *out, size_t out_len) {
+    time_t t = (time_t)timestamp;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+
+    int n = snprintf(out, out_len, "%s/%04d%02d%02d.%s", dir,
+                     tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, ext);
+    if (n < 0 || (size_t)n >= out_len) return ESP_ERR_INVALID_SIZE;
+    return ESP_OK;
+}
+
+/********************
+ * Indeks
+ ********************/
+esp_err_t logstore_index_write(FILE *f, const logstore_index_t *entries, size_t count, bool sync) {
+    if (!f || (!entries && count)) return ESP_ERR_INVALID_ARG;
+    if (count == 0) return ESP_OK;
+
+    if (fwrite(entries, sizeof(*entries), count, f) != count || fflush(f) != 0) return ESP_FAIL;
+    if (sync && fsync(fileno(f)) != 0) return ESP_FAIL;
+    return ESP_OK;
+}
+
+static bool index_entry_valid(const logstore_index_t *e, uint32_t dat_size, uint32_t record_size) {
+    return e->offset >= LOGREC_HEADER_SIZE && e->offset < dat_size &&
+           (e->offset - LOGREC_HEADER_SIZE) % record_size == 0;
+}
+
+static bool index_read(FILE *f, long i, logstore_index_t *e) {
+    return fseek(f, i * (long)sizeof(*e), SEEK_SET) == 0 && fread(e, 1, sizeof(*e), f) == sizeof(*e);
+}
+
+uint32_t logstore_index_seek(const char *idx_path, uint32_t t0, uint32_t dat_size,
+                             uint32_t record_size) {
+    FILE *f = fopen(idx_path, "rb");
+    if (!f) return LOGREC_HEADER_SIZE;
+
+    long n = 0;
+    if (fseek(f, 0, SEEK_END) == 0) n = ftell(f) / (long)sizeof(logstore_index_t);
+
+    // Wpisy dopisane przed zanikiem zasilania mogą wskazywać poza koniec .DAT
+    logstore_index_t e;
+    while (n > 0 && (!index_read(f, n - 1, &e) || !index_entry_valid(&e, dat_size, record_size))) n--;
+
+    // Ostatni wpis z timestamp < t0 (wcześniejsze rekordy na pewno są przed zakresem)
+    long lo = 0, hi = n;
+    while (lo < hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (!index_read(f, mid, &e)) break;
+        if (e.timestamp < t0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    uint32_t offset = LOGREC_HEADER_SIZE;
+    if (lo > 0 && index_read(f, lo - 1, &e) && index_entry_valid(&e, dat_size, record_size)) {
+        offset = e.offset;
+    }
+    fclose(f);
+    return offset;
+}
+
+/********************
+ * Czytnik pliku doby
+ ********************/
+esp_err_t logstore_reader_open(logstore_reader_t *r, const char *dat_path) {
+    memset(r, 0, sizeof(*r));
+    r->f = fopen(dat_path, "rb");
+    if (!r->f) return ESP_ERR_NOT_FOUND;
+
+    logrec_header_t *hdr = &r->hdr;
+    esp_err_t err = fread(hdr, 1, sizeof(*hdr), r->f) == sizeof(*hdr) ? logrec_header_check(hdr)
+                                                                     : ESP_ERR_INVALID_SIZE;
+    // Starsza wersja: rekordy rozszerzane przy odczycie (muszą się zmieścić w logrec_t)
+    r->upgrade = err == ESP_OK && hdr->version < LOGREC_VERSION;
+    if (err == ESP_OK && (r->upgrade ? hdr->record_size < 2 || hdr->record_size > LOGREC_RECORD_SIZE
+                                     : hdr->record_size != LOGREC_RECORD_SIZE)) {
+        err = ESP_ERR_INVALID_VERSION;
+    }
+    long size = 0;
+    if (err == ESP_OK && fseek(r->f, 0, SEEK_END) == 0) size = ftell(r->f);
+    if (err == ESP_OK && fseek(r->f, LOGREC_HEADER_SIZE, SEEK_SET) != 0) err = ESP_FAIL;
+    if (err != ESP_OK) {
+        logstore_reader_close(r);
+        return err;
+    }
+
+    r->record_size = hdr->record_size;
+    r->size = size > 0 ? (uint32_t)size : 0;
+    r->offset = LOGREC_HEADER_SIZE;
+    return ESP_OK;
+}
+
+bool logstore_reader_seek(logstore_reader_t *r, uint32_t offset) {
+    if (offset < LOGREC_HEADER_SIZE) offset = LOGREC_HEADER_SIZE;
+    offset -= (offset - LOGREC_HEADER_SIZE) % r->record_size;
+    if (offset == r->offset) return true;
+    if (fseek(r->f, (long)offset, SEEK_SET) != 0) return false;
+    r->offset = offset;
+    return true;
+}
+
+size_t logstore_reader_read(logstore_reader_t *r, logrec_t *recs, size_t max, bool *valid) {
+    size_t got = fread(recs, r->record_size, max, r->f);
+    r->offset += (uint32_t)got * r->record_size;
+    if (!r->upgrade) {
+        for (size_t i = 0; i < got; i++) valid[i] = logrec_is_valid(&recs[i]);
+        return got;
+    }
+    // Krótsze rekordy leżą na początku bufora - rozszerzamy od końca
+    for (size_t i = got; i-- > 0;) {
+        uint8_t old[LOGREC_RECORD_SIZE];
+        memcpy(old, (uint8_t *)recs + i * r->record_size, r->record_size);
+        valid[i] = logrec_upgrade(&r->hdr, old, &recs[i]);
+    }
+    return got;
+}
+
+void logstore_reader_close(logstore_reader_t *r) {
+    if (r->f) fclose(r->f);
+    r->f = NULL;
+}
+
+/********************
+ * Odczyt zakresu
+ ********************/
+// Czyta jeden plik doby; zwraca false, gdy trzeba przerwać cały odczyt
+static bool read_day(const char *dir, uint32_t day_ts, uint32_t t0, uint32_t t1,
+                     logstore_record_cb_t cb, void *ctx, logstore_range_stats_t *st) {
+    char dat_path[LOGSTORE_PATH_MAX];
+    char idx_path[LOGSTORE_PATH_MAX];
+    if (logstore_day_path(dir, day_ts, "DAT", dat_path, sizeof(dat_path)) != ESP_OK ||
+        logstore_day_path(dir, day_ts, "IDX", idx_path, sizeof(idx_path)) != ESP_OK) {
+        return true;
+    }
+
+    logstore_reader_t rd;
+    esp_err_t err = logstore_reader_open(&rd, dat_path);
+    if (err == ESP_ERR_NOT_FOUND) return true;  // Brak pomiarów tego dnia
+    st->files++;
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "%s: pomijam plik (%s)", dat_path, esp_err_to_name(err));
+        return true;
+    }
+
+    uint32_t offset = logstore_index_seek(idx_path, t0, rd.size, rd.record_size);
+    if (!logstore_reader_seek(&rd, offset)) {
+        logstore_reader_close(&rd);
+        return true;
+    }
+
+    logrec_t chunk[LOGSTORE_READ_RECORDS];
+    bool valid[LOGSTORE_READ_RECORDS];
+    bool more = true, done = false;
+    size_t got;
+    while (!done && (got = logstore_reader_read(&rd, chunk, LOGSTORE_READ_RECORDS, valid)) > 0) {
+        for (size_t i = 0; i < got && !done; i++) {
+            const logrec_t *rec = &chunk[i];
+            st->records_read++;
+            if (!valid[i]) {
+                st->bad_crc++;
+                continue;
+            }
+            if (rec->timestamp < t0) continue;
+            if (rec->timestamp >= t1) {
+                // Rekordy są posortowane - reszta pliku jest poza zakresem
+                done = true;
+            } else {
+                st->records_matched++;
+                if (!cb(rec, ctx)) {
+                    more = false;
+                    done = true;
+                }
+            }
+        }
+    }
+
+    logstore_reader_close(&rd);
+    return more;
+}
+
+static size_t list_days(const char *dir, uint32_t from, uint32_t below, uint32_t *days, size_t max);
+
+esp_err_t logstore_read_range(const char *dir, uint32_t t0, uint32_t t1,
+                              logstore_record_cb_t cb, void *ctx,
+                              logstore_range_stats_t *stats) {
+    if (!dir || !cb || t1 <= t0) return ESP_ERR_INVALID_ARG;
+
+    logstore_range_stats_t st = {0};
+    uint32_t first_day = t0 / LOGSTORE_SECONDS_PER_DAY;
+    uint32_t last_day = (t1 - 1) / LOGSTORE_SECONDS_PER_DAY;
+
+    // Tylko istniejące pliki dób - szeroki zakres (READ:0:4294967295) to ~50 tys. dni kalendarza
+    uint32_t days[LOGSTORE_LIST_DAYS];
+    size_t n;
+    bool more = true;
+    for (uint32_t from = first_day;
+         more && (n = list_days(dir, from, last_day + 1, days, LOGSTORE_LIST_DAYS)) > 0;
+         from = days[n - 1] + 1) {
+        for (size_t i = 0; i < n && more; i++) {
+            more = read_day(dir, days[i] * LOGSTORE_SECONDS_PER_DAY, t0, t1, cb, ctx, &st);
+        }
+    }
+
+    if (stats) *stats = st;
+    return ESP_OK;
+}
+
+/********************
+ * Odzyskiwanie po zaniku zasilania
+ ********************/
+// Najnowszy (newest) lub najstarszy plik doby w katalogu z nazwą w (after, below)
+static bool find_day(const char *dir, const char *after, const char *below, bool newest,
+                     char *out, size_t out_len) {
+    DIR *d = opendir(dir);
+    if (!d) return false;
+
+    char best[16] = "";
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        if (strlen(name) != 12 || strcasecmp(name + 8, ".DAT") != 0) continue;
+        bool digits = true;
+        for (int i = 0; i < 8; i++) {
+            if (name[i] < '0' || name[i] > '9') digits = false;
+        }
+        if (!digits) continue;
+        if (below && strcasecmp(name, below) >= 0) continue;
+        if (after && strcasecmp(name, after) <= 0) continue;
+        if (best[0] == '\0' || (strcasecmp(name, best) > 0) == newest) strcpy(best, name);
+    }
+    closedir(d);
+
+    if (best[0] == '\0' || strlen(best) >= out_len) return false;
+    strcpy(out, best);
+    return true;
+}
+
+bool logstore_find_last_day(const char *dir, const char *below, char *out, size_t out_len) {
+    return find_day(dir, NULL, below, true, out, out_len);
+}
+
+bool logstore_find_next_day(const char *dir, const char *after, char *out, size_t out_len) {
+    return find_day(dir, after, NULL, false, out, out_len);
+}
+
+static bool record_read(FILE *f, uint32_t index, logrec_t *rec) {
+    long off = (long)(LOGREC_HEADER_SIZE + (uint64_t)index * LOGREC_RECORD_SIZE);
+    return fseek(f, off, SEEK_SET) == 0 && fread(rec, 1, sizeof(*rec), f) == sizeof(*rec);
+}
+
+// Szuka ostatniego poprawnego rekordu w [lo, hi) od końca; zwraca jego indeks + 1 lub 0
+static uint32_t scan_back(FILE *f, uint32_t lo, uint32_t hi, logrec_t *last, uint32_t *checked) {
+    logrec_t chunk[LOGSTORE_READ_RECORDS];
+    uint32_t i = hi;
+    while (i > lo) {
+        uint32_t n = i - lo < LOGSTORE_READ_RECORDS ? i - lo : LOGSTORE_READ_RECORDS;
+        uint32_t first = i - n;
+        long off = (long)(LOGREC_HEADER_SIZE + (uint64_t)first * LOGREC_RECORD_SIZE);
+        if (fseek(f, off, SEEK_SET) != 0 || fread(chunk, sizeof(logrec_t), n, f) != n) return 0;
+        for (uint32_t j = n; j-- > 0;) {
+            (*checked)++;
+            if (logrec_is_valid(&chunk[j])) {
+                *last = chunk[j];
+                return first + j + 1;
+            }
+        }
+        i = first;
+    }
+    return 0;
+}
+
+// Gdy ogon jest cały uszkodzony: najnowszy wpis indeksu wskazujący poprawny rekord
+static uint32_t scan_index(FILE *f, const char *idx_path, uint32_t limit, logrec_t *last,
+                           uint32_t *checked) {
+    FILE *fi = fopen(idx_path, "rb");
+    if (!fi) return 0;
+
+    long n = 0;
+    if (fseek(fi, 0, SEEK_END) == 0) n = ftell(fi) / (long)sizeof(logstore_index_t);
+
+    uint32_t end = 0;
+    logstore_index_t e;
+    for (long k = n - 1; k >= 0 && end == 0; k--) {
+        if (!index_read(fi, k, &e) || e.offset < LOGREC_HEADER_SIZE ||
+            (e.offset - LOGREC_HEADER_SIZE) % LOGREC_RECORD_SIZE) {
+            continue;
+        }
+        uint32_t r = (e.offset - LOGREC_HEADER_SIZE) / LOGREC_RECORD_SIZE;
+        if (r >= limit) continue;
+
+        logrec_t rec;
+        (*checked)++;
+        if (!record_read(f, r, &rec) || !logrec_is_valid(&rec)) continue;
+
+        // Rekord z indeksu jest poprawny - ostatni poprawny do kolejnego wpisu
+        uint32_t hi = r + LOGSTORE_INDEX_STRIDE < limit ? r + LOGSTORE_INDEX_STRIDE : limit;
+        end = scan_back(f, r, hi, last, checked);
+    }
+    fclose(fi);
+    return end;
+}
+
+esp_err_t logstore_recover_file(const char *dat_path, const char *idx_path,
+                                logstore_recovery_t *res) {
+    memset(res, 0, sizeof(*res));
+
+    FILE *f = fopen(dat_path, "rb");
+    if (!f) return ESP_ERR_NOT_FOUND;
+
+    logrec_header_t hdr;
+    esp_err_t err = fread(&hdr, 1, sizeof(hdr), f) == sizeof(hdr) ? logrec_header_check(&hdr)
+                                                                  : ESP_ERR_INVALID_SIZE;
+    if (err == ESP_OK && hdr.record_size != LOGREC_RECORD_SIZE) err = ESP_ERR_INVALID_VERSION;
+    if (err != ESP_OK) {
+        fclose(f);
+        return err;
+    }
+
+    long size = 0;
+    if (fseek(f, 0, SEEK_END) == 0) size = ftell(f);
+    uint32_t count = (uint32_t)((size - LOGREC_HEADER_SIZE) / LOGREC_RECORD_SIZE);
+
+    uint32_t lo = count > LOGSTORE_RECOVER_TAIL_RECORDS ? count - LOGSTORE_RECOVER_TAIL_RECORDS : 0;
+    logrec_t last;
+    uint32_t end = scan_back(f, lo, count, &last, &res->checked);
+    if (end == 0 && lo > 0) end = scan_index(f, idx_path, lo, &last, &res->checked);
+    fclose(f);
+
+    if (end > 0) {
+        res->has_record = true;
+        res->last_seq = last.seq;
+        res->last_timestamp = last.timestamp;
+    } else if (lo > 0) {
+        // Nie da się potwierdzić niczego - zostaw pełne rekordy, obetnij tylko niepełny
+        end = count;
+    }
+    res->records = end;
+
+    uint32_t new_size = LOGREC_HEADER_SIZE + end * LOGREC_RECORD_SIZE;
+    if ((long)new_size < size) {
+        if (truncate(dat_path, new_size) != 0) return ESP_FAIL;
+        res->truncated_bytes = (uint32_t)(size - new_size);
+    }
+
+    // Wpisy indeksu za nowym końcem pliku (rosnące offsety - wystarczy obciąć koniec)
+    FILE *fi = fopen(idx_path, "rb");
+    if (fi) {
+        long n = 0, k;
+        if (fseek(fi, 0, SEEK_END) == 0) n = ftell(fi) / (long)sizeof(logstore_index_t);
+        logstore_index_t e;
+        for (k = n; k > 0 && index_read(fi, k - 1, &e) && e.offset >= new_size; k--) {
+        }
+        fclose(fi);
+        if (k < n) {
+            if (truncate(idx_path, k * (long)sizeof(logstore_index_t)) != 0) return ESP_FAIL;
+            res->truncated_index = (uint32_t)(n - k);
+        }
+    }
+    return ESP_OK;
+}
+
+/********************
+ * Kompakcja
+ ********************/
+// Stały bufor roboczy kompakcji (wejście + wyjście), bez alokacji na stercie
+static logrec_t compact_in[LOGSTORE_COMPACT_RECORDS];
+static logrec_t compact_out[LOGSTORE_COMPACT_RECORDS];
+
+// Pola uśredniane w przedziale (kolejność w sum/n)
+enum { AVG_TEMP_DS18, AVG_TEMP_DHT, AVG_HUMIDITY, AVG_PH, AVG_LIGHT, AVG_PROBE0,
+       AVG_COUNT = AVG_PROBE0 + LOGREC_PROBES };
+
+typedef struct {
+    bool open;
+    uint32_t bucket;              // Numer przedziału (timestamp / bucket_sec)
+    logrec_t last;                // Ostatni rekord: seq, przekaźniki, flagi
+    int64_t sum[AVG_COUNT];
+    uint32_t n[AVG_COUNT];
+} bucket_acc_t;
+
+typedef struct {
+    FILE *f;
+    uint32_t fill;
+    uint32_t written;
+    bool error;
+} compact_writer_t;
+
+static bool path_exists(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0;
+}
+
+static void compact_paths(const char *dir, const char *name, char *dat, char *idx, char *tmp) {
+    snprintf(dat, LOGSTORE_PATH_MAX, "%s/%.8s.DAT", dir, name);
+    snprintf(idx, LOGSTORE_PATH_MAX, "%s/%.8s.IDX", dir, name);
+    snprintf(tmp, LOGSTORE_PATH_MAX, "%s/%.8s.TMP", dir, name);
+}
+
+static void writer_flush(compact_writer_t *w) {
+    if (w->fill && fwrite(compact_out, sizeof(logrec_t), w->fill, w->f) != w->fill) w->error = true;
+    w->written += w->fill;
+    w->fill = 0;
+}
+
+static void writer_put(compact_writer_t *w, const logrec_t *rec) {
+    compact_out[w->fill++] = *rec;
+    if (w->fill == LOGSTORE_COMPACT_RECORDS) writer_flush(w);
+}
+
+static void acc_field(bucket_acc_t *a, int i, int64_t v, bool na) {
+    if (na) return;
+    a->sum[i] += v;
+    a->n[i]++;
+}
+
+static void acc_add(bucket_acc_t *a, const logrec_t *r) {
+    acc_field(a, AVG_TEMP_DS18, r->temp_ds18, r->temp_ds18 == LOGREC_NA_I16);
+    acc_field(a, AVG_TEMP_DHT, r->temp_dht, r->temp_dht == LOGREC_NA_I16);
+    acc_field(a, AVG_HUMIDITY, r->humidity, r->humidity == LOGREC_NA_U16);
+    acc_field(a, AVG_PH, r->ph, r->ph == LOGREC_NA_U16);
+    acc_field(a, AVG_LIGHT, r->light, r->light == LOGREC_NA_U32);
+    for (int p = 0; p < LOGREC_PROBES; p++) {
+        acc_field(a, AVG_PROBE0 + p, r->temp_probe[p], r->temp_probe[p] == LOGREC_NA_I16);
+    }
+    a->last = *r;
+}
+
+static int64_t acc_mean(const bucket_acc_t *a, int i) {
+    int64_t half = (int64_t)(a->n[i] / 2);
+    return (a->sum[i] + (a->sum[i] >= 0 ? half : -half)) / (int64_t)a->n[i];
+}
+
+// Rekord przedziału: średnie pomiarów, stan przekaźników i seq z ostatniego rekordu
+static void acc_emit(const bucket_acc_t *a, uint32_t bucket_sec, compact_writer_t *w) {
+    logrec_t out = a->last;
+    out.timestamp = a->bucket * bucket_sec;
+    out.temp_ds18 = a->n[AVG_TEMP_DS18] ? (int16_t)acc_mean(a, AVG_TEMP_DS18) : LOGREC_NA_I16;
+    out.temp_dht = a->n[AVG_TEMP_DHT] ? (int16_t)acc_mean(a, AVG_TEMP_DHT) : LOGREC_NA_I16;
+    out.humidity = a->n[AVG_HUMIDITY] ? (uint16_t)acc_mean(a, AVG_HUMIDITY) : LOGREC_NA_U16;
+    out.ph = a->n[AVG_PH] ? (uint16_t)acc_mean(a, AVG_PH) : LOGREC_NA_U16;
+    out.light = a->n[AVG_LIGHT] ? (uint32_t)acc_mean(a, AVG_LIGHT) : LOGREC_NA_U32;
+    for (int p = 0; p < LOGREC_PROBES; p++) {
+        out.temp_probe[p] = a->n[AVG_PROBE0 + p] ? (int16_t)acc_mean(a, AVG_PROBE0 + p) : LOGREC_NA_I16;
+    }
+    logrec_seal(&out);
+    writer_put(w, &out);
+}
+
+bool logstore_keep_unless_field(const logrec_t *rec, void *ctx) {
+    const logstore_field_match_t *m = ctx;
+    int64_t raw;
+    return !(logrec_field_get(rec, m->field, &raw, NULL) && raw == m->raw);
+}
+
+bool logstore_keep_newer_than(const logrec_t *rec, void *ctx) {
+    return rec->timestamp >= *(const uint32_t *)ctx;
+}
+
+esp_err_t logstore_index_rebuild(const char *dat_path, const char *idx_path) {
+    FILE *in = fopen(dat_path, "rb");
+    if (!in) return ESP_ERR_NOT_FOUND;
+
+    logrec_header_t hdr;
+    if (fread(&hdr, 1, sizeof(hdr), in) != sizeof(hdr) || logrec_header_check(&hdr) != ESP_OK ||
+        hdr.record_size != LOGREC_RECORD_SIZE) {
+        fclose(in);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    FILE *out = fopen(idx_path, "wb");
+    if (!out) {
+        fclose(in);
+        return ESP_FAIL;
+    }
+
+    uint32_t k = 0;
+    size_t got;
+    bool error = false;
+    while ((got = fread(compact_in, sizeof(logrec_t), LOGSTORE_COMPACT_RECORDS, in)) > 0) {
+        for (size_t i = 0; i < got; i++, k++) {
+            if (k % LOGSTORE_INDEX_STRIDE || !logrec_is_valid(&compact_in[i])) continue;
+            logstore_index_t e = {
+                .timestamp = compact_in[i].timestamp,
+                .offset = LOGREC_HEADER_SIZE + k * LOGREC_RECORD_SIZE,
+            };
+            if (fwrite(&e, 1, sizeof(e), out) != sizeof(e)) error = true;
+        }
+    }
+    fclose(in);
+    if (fclose(out) != 0) error = true;
+    return error ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t logstore_compact_finish(const char *dir, const char *name) {
+    char dat[LOGSTORE_PATH_MAX], idx[LOGSTORE_PATH_MAX], tmp[LOGSTORE_PATH_MAX];
+    compact_paths(dir, name, dat, idx, tmp);
+
+    bool has_dat = path_exists(dat);
+    if (path_exists(tmp)) {
+        if (has_dat) {
+            // Przerwane przed usunięciem oryginału - .TMP może być niepełny
+            unlink(tmp);
+        } else {
+            // Oryginał już usunięty - .TMP jest kompletny
+            ESP_LOGW(TAG, "Dokańczam kompakcję %s", dat);
+            unlink(idx);
+            if (rename(tmp, dat) != 0) return ESP_FAIL;
+            has_dat = true;
+        }
+    }
+    if (has_dat && !path_exists(idx)) return logstore_index_rebuild(dat, idx);
+    return ESP_OK;
+}
+
+esp_err_t logstore_compact_file(const char *dir, const char *name,
+                                const logstore_compact_t *spec,
+                                logstore_compact_stats_t *stats) {
+    char dat[LOGSTORE_PATH_MAX], idx[LOGSTORE_PATH_MAX], tmp[LOGSTORE_PATH_MAX];
+    compact_paths(dir, name, dat, idx, tmp);
+    logstore_compact_stats_t st = {0};
+
+    // Starsza wersja: czytnik rozszerza rekordy, plik dostaje bieżący schemat
+    logstore_reader_t in;
+    esp_err_t err = logstore_reader_open(&in, dat);
+    if (err != ESP_OK) return err;
+    bool upgrade = in.upgrade;
+    logrec_header_t hdr = in.hdr;
+    if (upgrade) {
+        logrec_header_init(&hdr, in.hdr.created);
+        hdr.bucket_sec = in.hdr.bucket_sec;
+        hdr.crc = logrec_crc16(&hdr, offsetof(logrec_header_t, crc));
+        ESP_LOGI(TAG, "%s: aktualizacja formatu v%u -> v%d", dat, in.hdr.version, LOGREC_VERSION);
+    }
+
+    // Uśredniamy tylko do przedziału grubszego niż obecny
+    bool average = spec->bucket_sec > hdr.bucket_sec;
+    if (average) {
+        hdr.bucket_sec = spec->bucket_sec;
+        hdr.crc = logrec_crc16(&hdr, offsetof(logrec_header_t, crc));
+    }
+
+    compact_writer_t w = { .f = fopen(tmp, "wb") };
+    if (!w.f) {
+        logstore_reader_close(&in);
+        return ESP_FAIL;
+    }
+    if (fwrite(&hdr, 1, sizeof(hdr), w.f) != sizeof(hdr)) w.error = true;
+
+    bucket_acc_t acc = {0};
+    size_t got;
+    bool valid[LOGSTORE_COMPACT_RECORDS];
+    while (!w.error && (got = logstore_reader_read(&in, compact_in, LOGSTORE_COMPACT_RECORDS, valid)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            const logrec_t *rec = &compact_in[i];
+            st.records_in++;
+            if (!valid[i] ||
+                (spec->keep && !spec->keep(rec, spec->keep_ctx))) {
+                st.deleted++;
+                continue;
+            }
+            if (!average) {
+                writer_put(&w, rec);
+                continue;
+            }
+            uint32_t bucket = rec->timestamp / spec->bucket_sec;
+            if (acc.open && bucket != acc.bucket) {
+                acc_emit(&acc, spec->bucket_sec, &w);
+                acc.open = false;
+            }
+            if (!acc.open) {
+                memset(&acc, 0, sizeof(acc));
+                acc.open = true;
+                acc.bucket = bucket;
+            }
+            acc_add(&acc, rec);
+        }
+    }
+    if (acc.open) acc_emit(&acc, spec->bucket_sec, &w);
+    writer_flush(&w);
+
+    uint32_t in_size = in.size;
+    logstore_reader_close(&in);
+    if (fflush(w.f) != 0 || fsync(fileno(w.f)) != 0) w.error = true;
+    if (fclose(w.f) != 0) w.error = true;
+    if (w.error) {
+        ESP_LOGE(TAG, "Kompakcja %s: błąd zapisu %s", dat, tmp);
+        unlink(tmp);
+        return ESP_FAIL;
+    }
+
+    st.records_out = w.written;
+    st.bytes_in = in_size;
+    st.bytes_out = w.written ? LOGREC_HEADER_SIZE + w.written * LOGREC_RECORD_SIZE : 0;
+
+    // Nic nie usunięto ani nie przepisano - oryginał (i jego indeks) zostaje
+    if (!upgrade && !average && st.deleted == 0 && w.written > 0) {
+        unlink(tmp);
+        st.bytes_out = st.bytes_in;
+        if (stats) *stats = st;
+        return ESP_OK;
+    }
+    st.rewritten = true;
+    if (stats) *stats = st;
+
+    // Podmiana: od tej chwili każdy stan naprawia logstore_compact_finish()
+    unlink(idx);
+    if (w.written == 0) {
+        unlink(dat);
+        unlink(tmp);
+        return ESP_OK;
+    }
+    if (unlink(dat) != 0 || rename(tmp, dat) != 0) return ESP_FAIL;
+    return logstore_index_rebuild(dat, idx);
+}
+
+/********************
+ * Retencja
+ ********************/
+uint32_t logstore_day_from_name(const char *name) {
+    int y = (name[0] - '0') * 1000 + (name[1] - '0') * 100 + (name[2] - '0') * 10 + (name[3] - '0');
+    unsigned m = (unsigned)((name[4] - '0') * 10 + (name[5] - '0'));
+    unsigned d = (unsigned)((name[6] - '0') * 10 + (name[7] - '0'));
+
+    // days_from_civil (H. Hinnant)
+    y -= m <= 2;
+    int era = (y >= 0 ? y : y - 399) / 400;
+    unsigned yoe = (unsigned)(y - era * 400);
+    unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (uint32_t)(era * 146097 + (int)doe - 719468);
+}
+
+// Jeden przebieg readdir: do max najstarszych dób w [from, below) z plikiem .DAT
+// (lub .TMP po przerwanej kompakcji), rosnąco. Więcej dób = kolejne wywołanie.
+static size_t list_days(const char *dir, uint32_t from, uint32_t below, uint32_t *days, size_t max) {
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+
+    size_t n = 0;
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        const char *name = de->d_name;
+        if (strlen(name) != 12 || (strcasecmp(name + 8, ".DAT") != 0 && strcasecmp(name + 8, ".TMP") != 0)) {
+            continue;
+        }
+        bool digits = true;
+        for (int i = 0; i < 8; i++) {
+            if (name[i] < '0' || name[i] > '9') digits = false;
+        }
+        if (!digits) continue;
+        uint32_t day = logstore_day_from_name(name);
+        if (day < from || day >= below) continue;
+
+        // Wstawienie do posortowanej listy najstarszych (bez duplikatów .DAT/.TMP)
+        size_t i = n;
+        while (i > 0 && days[i - 1] > day) i--;
+        if ((i > 0 && days[i - 1] == day) || i == max) continue;
+        if (n < max) n++;
+        memmove(&days[i + 1], &days[i], (n - 1 - i) * sizeof(days[0]));
+        days[i] = day;
+    }
+    closedir(d);
+    return n;
+}
+
+// Ścieżka pliku doby i wskaźnik na samą nazwę "YYYYMMDD.DAT"
+static const char *day_dat_path(const char *dir, uint32_t day, char *path) {
+    if (logstore_day_path(dir, day * LOGSTORE_SECONDS_PER_DAY, "DAT", path, LOGSTORE_PATH_MAX) != ESP_OK) {
+        return NULL;
+    }
+    return strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+}
+
+esp_err_t logstore_purge(const char *dir, logstore_keep_cb_t keep, void *ctx, uint32_t last_day,
+                         const char *skip, logstore_purge_stats_t *stats) {
+    if (!dir || !keep) return ESP_ERR_INVALID_ARG;
+
+    logstore_purge_stats_t st = { .first_day = UINT32_MAX };
+    uint32_t below = last_day == UINT32_MAX ? UINT32_MAX : last_day + 1;
+    uint32_t days[LOGSTORE_LIST_DAYS];
+    size_t n;
+    for (uint32_t from = 0; from < below && (n = list_days(dir, from, below, days, LOGSTORE_LIST_DAYS)) > 0;
+         from = days[n - 1] + 1) {
+        for (size_t i = 0; i < n; i++) {
+            char path[LOGSTORE_PATH_MAX];
+            const char *base = day_dat_path(dir, days[i], path);
+            if (!base || (skip && strcasecmp(base, skip) == 0)) continue;
+
+            logstore_compact_finish(dir, base);
+            logstore_compact_t spec = { .keep = keep, .keep_ctx = ctx };
+            logstore_compact_stats_t cs;
+            if (logstore_compact_file(dir, base, &spec, &cs) != ESP_OK) continue;
+            st.files_checked++;
+            st.records_deleted += cs.deleted;
+            if (!cs.rewritten) continue;
+            if (days[i] < st.first_day) st.first_day = days[i];
+            if (cs.records_out) {
+                st.files_rewritten++;
+            } else {
+                st.files_deleted++;
+            }
+        }
+    }
+
+    if (stats) *stats = st;
+    return ESP_OK;
+}
+
+// Retencja jednego istniejącego pliku doby: usunięcie albo uśrednienie
+static void retention_day(const char *dir, uint32_t day, bool del, const logstore_retention_t *policy,
+                          const char *skip, logstore_retention_stats_t *st) {
+    char path[LOGSTORE_PATH_MAX];
+    const char *base = day_dat_path(dir, day, path);
+    if (!base || (skip && strcasecmp(base, skip) == 0)) return;
+
+    logstore_compact_finish(dir, base);
+    FILE *f = fopen(path, "rb");
+    if (!f) return;
+    st->files_checked++;
+
+    if (del) {
+        fclose(f);
+        char idx[LOGSTORE_PATH_MAX];
+        snprintf(idx, sizeof(idx), "%s/%.8s.IDX", dir, base);
+        unlink(idx);
+        if (unlink(path) == 0) st->files_deleted++;
+        if (day < st->first_day) st->first_day = day;
+        return;
+    }
+
+    logrec_header_t hdr;
+    bool done = fread(&hdr, 1, sizeof(hdr), f) == sizeof(hdr) &&
+                logrec_header_check(&hdr) == ESP_OK && hdr.version == LOGREC_VERSION &&
+                hdr.bucket_sec >= policy->bucket_sec;
+    fclose(f);
+    if (done) return;
+
+    logstore_compact_t spec = { .bucket_sec = policy->bucket_sec };
+    logstore_compact_stats_t cs;
+    if (logstore_compact_file(dir, base, &spec, &cs) == ESP_OK) {
+        if (cs.rewritten && day < st->first_day) st->first_day = day;
+        st->files_compacted++;
+        st->bytes_before += cs.bytes_in;
+        st->bytes_after += cs.bytes_out;
+    }
+}
+
+esp_err_t logstore_retention(const char *dir, uint32_t now, const logstore_retention_t *policy,
+                             const char *skip, logstore_retention_stats_t *stats) {
+    if (!dir || !policy) return ESP_ERR_INVALID_ARG;
+
+    logstore_retention_stats_t st = { .first_day = UINT32_MAX };
+    uint32_t now_day = now / LOGSTORE_SECONDS_PER_DAY;
+    uint32_t days[LOGSTORE_LIST_DAYS];
+    size_t n;
+    bool young = false;
+    for (uint32_t from = 0; !young && (n = list_days(dir, from, now_day, days, LOGSTORE_LIST_DAYS)) > 0;
+         from = days[n - 1] + 1) {
+        for (size_t i = 0; i < n; i++) {
+            uint32_t day = days[i];
+            uint32_t age = now - (day + 1) * LOGSTORE_SECONDS_PER_DAY;  // Wiek końca doby
+            bool del = policy->delete_age_sec && age >= policy->delete_age_sec;
+            bool avg = policy->bucket_sec && policy->downsample_age_sec &&
+                       age >= policy->downsample_age_sec;
+            if (!del && !avg) {
+                young = true;  // Kolejne doby są jeszcze młodsze
+                break;
+            }
+            retention_day(dir, day, del, policy, skip, &st);
+        }
+    }
+
+    if (stats) *stats = st;
+    return ESP_OK;
+}
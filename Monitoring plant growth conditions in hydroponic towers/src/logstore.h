@@ -0,0 +1,308 @@
+#ifndef LOGSTORE_H
+#define LOGSTORE_H
+
+#include "esp_err.h"
+#include "logrec.h"
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+/**
+ * Dzienne pliki logu binarnego i rzadki indeks czasu.
+ *
+ * Katalog logu zawiera jeden plik na dobę (nazwy 8.3, CONFIG_FATFS_LFN_NONE):
+ *   LOG/20261015.DAT  - log binarny (logrec.h), doba wg timestampu rekordu
+ *   LOG/20261015.IDX  - indeks: co LOGSTORE_INDEX_STRIDE rekord para
+ *                       (timestamp, offset w .DAT), zawsze pierwszy rekord pliku
+ *
+ * Odczyt zakresu [t0, t1) otwiera tylko pliki dób z tego zakresu i w każdym
+ * skacze przez indeks (wyszukiwanie binarne) do najbliższego rekordu przed t0,
+ * więc czyta najwyżej LOGSTORE_INDEX_STRIDE zbędnych rekordów na plik.
+ * Zakłada, że timestampy w pliku są niemalejące (czas RTC).
+ *
+ * Kompakcja (logstore_compact_file) przepisuje plik doby strumieniowo przez
+ * YYYYMMDD.TMP ze stałym buforem LOGSTORE_COMPACT_RECORDS rekordów: usuwa
+ * rekordy wg predykatu i/lub uśrednia je w przedziałach czasu (np. godzinnych).
+ *
+ * Moduł używa wyłącznie stdio/POSIX - działa też na PC (tools/).
+ */
+
+#define LOGSTORE_INDEX_STRIDE   16      // Wpis indeksu co tyle rekordów
+#define LOGSTORE_READ_RECORDS   16      // Rekordów czytanych jednym fread
+#define LOGSTORE_SECONDS_PER_DAY 86400u
+#define LOGSTORE_PATH_MAX       64
+// Odzyskiwanie: ile rekordów od końca pliku sprawdzać przed sięgnięciem do indeksu
+// (2 sektory = cały bufor sdlog, czyli wszystko, co mogło nie zostać zapisane)
+#define LOGSTORE_RECOVER_TAIL_RECORDS  256
+// Kompakcja: rekordów w buforze wejściowym i wyjściowym (2 x 2 KiB)
+#define LOGSTORE_COMPACT_RECORDS       32
+// Retencja / usuwanie: ile dób zbiera jeden przebieg readdir
+#define LOGSTORE_LIST_DAYS             16
+
+typedef struct __attribute__((packed)) {
+    uint32_t timestamp;           // Timestamp rekordu
+    uint32_t offset;              // Offset rekordu w pliku .DAT
+} logstore_index_t;
+
+/**
+ * Pozycja rekordu w logu: doba (dni od 1970-01-01) i offset w pliku .DAT.
+ */
+typedef struct {
+    uint32_t day;
+    uint32_t offset;
+} logstore_pos_t;
+
+/**
+ * Czytnik pliku doby dowolnej obsługiwanej wersji logrec. Rekordy starszej
+ * wersji (np. v1, 32 B) są przy odczycie rozszerzane do logrec_t
+ * (logrec_upgrade), więc pliki sprzed aktualizacji firmware są czytelne bez
+ * przepisywania. Offsety w pliku liczone są w jego własnym record_size.
+ */
+typedef struct {
+    FILE *f;
+    logrec_header_t hdr;          // Nagłówek pliku (schemat i record_size)
+    uint32_t record_size;         // Rozmiar rekordu w pliku
+    uint32_t size;                // Rozmiar pliku przy otwarciu
+    uint32_t offset;              // Offset następnego rekordu
+    bool upgrade;                 // Plik starszej wersji
+} logstore_reader_t;
+
+/**
+ * Liczniki odczytu zakresu (pozwalają sprawdzić, ile pracy kosztował odczyt).
+ */
+typedef struct {
+    uint32_t files;               // Otwarte pliki .DAT
+    uint32_t records_read;        // Rekordy przeczytane z karty
+    uint32_t records_matched;     // Rekordy przekazane do callbacka
+    uint32_t bad_crc;             // Rekordy pominięte (błędne CRC)
+} logstore_range_stats_t;
+
+/**
+ * Wynik odzyskiwania pliku doby po zaniku zasilania.
+ */
+typedef struct {
+    bool has_record;              // Plik zawiera co najmniej jeden poprawny rekord
+    uint32_t last_seq;            // seq ostatniego poprawnego rekordu
+    uint32_t last_timestamp;      // timestamp ostatniego poprawnego rekordu
+    uint32_t records;             // Liczba rekordów po odzyskaniu
+    uint32_t truncated_bytes;     // Bajty obcięte z końca .DAT
+    uint32_t truncated_index;     // Wpisy obcięte z końca .IDX
+    uint32_t checked;             // Rekordy sprawdzone (CRC) podczas odzyskiwania
+} logstore_recovery_t;
+
+/**
+ * Callback odczytu zakresu; zwrócenie false przerywa odczyt.
+ */
+typedef bool (*logstore_record_cb_t)(const logrec_t *rec, void *ctx);
+
+/**
+ * Predykat kompakcji: true = zachowaj rekord, false = usuń.
+ */
+typedef bool (*logstore_keep_cb_t)(const logrec_t *rec, void *ctx);
+
+typedef struct {
+    logstore_keep_cb_t keep;      // NULL = zachowaj wszystkie
+    void *keep_ctx;
+    uint32_t bucket_sec;          // 0 = bez uśredniania, np. 3600 = średnie godzinowe
+} logstore_compact_t;
+
+typedef struct {
+    uint32_t records_in;
+    uint32_t records_out;
+    uint32_t deleted;             // Usunięte przez predykat
+    uint32_t bytes_in;
+    uint32_t bytes_out;
+    bool rewritten;               // false = plik bez zmian (nic do usunięcia)
+} logstore_compact_stats_t;
+
+/**
+ * Polityka retencji katalogu logu. Wiek liczony od końca doby pliku.
+ */
+typedef struct {
+    uint32_t downsample_age_sec;  // Uśredniaj pliki starsze niż (0 = nigdy)
+    uint32_t bucket_sec;          // Przedział uśredniania (np. 3600)
+    uint32_t delete_age_sec;      // Usuwaj pliki starsze niż (0 = nigdy)
+} logstore_retention_t;
+
+typedef struct {
+    uint32_t files_checked;
+    uint32_t files_compacted;
+    uint32_t files_deleted;
+    uint32_t bytes_before;        // Rozmiar skompaktowanych plików przed...
+    uint32_t bytes_after;         // ...i po kompakcji
+    uint32_t first_day;           // Najwcześniejsza zmieniona doba (UINT32_MAX = żadna)
+} logstore_retention_stats_t;
+
+typedef struct {
+    uint32_t files_checked;
+    uint32_t files_rewritten;     // Pliki przepisane bez usuniętych rekordów
+    uint32_t files_deleted;       // Pliki, z których usunięto wszystkie rekordy
+    uint32_t records_deleted;
+    uint32_t first_day;           // Najwcześniejsza zmieniona doba (UINT32_MAX = żadna)
+} logstore_purge_stats_t;
+
+/**
+ * Predykat: usuń rekordy, w których pole field ma surową wartość raw
+ * (ctx = logstore_field_match_t).
+ */
+typedef struct {
+    const char *field;            // Nazwa pola ze schematu (np. "flags")
+    int64_t raw;                  // Wartość surowa (np. 700 dla pH 7.00)
+} logstore_field_match_t;
+
+bool logstore_keep_unless_field(const logrec_t *rec, void *ctx);
+
+/**
+ * Predykat: zachowaj rekordy z timestamp >= *(uint32_t *)ctx.
+ */
+bool logstore_keep_newer_than(const logrec_t *rec, void *ctx);
+
+/**
+ * Buduje ścieżkę pliku doby: "<dir>/YYYYMMDD.<ext>" dla podanego timestampu.
+ * @param ext "DAT" lub "IDX"
+ * @return ESP_OK lub ESP_ERR_INVALID_SIZE gdy bufor jest za mały
+ */
+esp_err_t logstore_day_path(const char *dir, uint32_t timestamp, const char *ext,
+                            char *out, size_t out_len);
+
+/**
+ * Dopisuje wpisy na koniec otwartego indeksu doby (tryb "ab") i robi commit
+ * (fflush, opcjonalnie fsync). Wołane po commicie danych, które wpisy opisują,
+ * więc indeks nigdy nie wskazuje rekordów, których nie ma na karcie.
+ */
+esp_err_t logstore_index_write(FILE *f, const logstore_index_t *entries, size_t count, bool sync);
+
+/**
+ * Zwraca offset w pliku .DAT, od którego trzeba czytać, aby nie pominąć
+ * rekordów z timestampem >= t0. Bez indeksu (lub z uszkodzonym) zwraca
+ * offset pierwszego rekordu. Wpisy wskazujące poza dat_size lub niezgodne
+ * z record_size pliku są ignorowane.
+ */
+uint32_t logstore_index_seek(const char *idx_path, uint32_t t0, uint32_t dat_size,
+                             uint32_t record_size);
+
+/**
+ * Otwiera plik doby i sprawdza nagłówek; ustawia odczyt na pierwszy rekord.
+ * @return ESP_OK, ESP_ERR_NOT_FOUND (brak pliku), ESP_ERR_INVALID_SIZE /
+ *         ESP_ERR_INVALID_CRC (uszkodzony nagłówek), ESP_ERR_INVALID_VERSION
+ *         (wersja nowsza niż firmware lub rekord większy niż logrec_t)
+ */
+esp_err_t logstore_reader_open(logstore_reader_t *r, const char *dat_path);
+
+/**
+ * Ustawia odczyt na rekord pod offsetem; offset niewyrównany do rekordu
+ * (np. kursor zapisany przed aktualizacją formatu) jest zaokrąglany w dół.
+ * @return false przy błędzie fseek
+ */
+bool logstore_reader_seek(logstore_reader_t *r, uint32_t offset);
+
+/**
+ * Czyta do max kolejnych rekordów jednym fread; valid[i] = poprawne CRC.
+ * @return Liczba przeczytanych rekordów (0 = koniec pliku)
+ */
+size_t logstore_reader_read(logstore_reader_t *r, logrec_t *recs, size_t max, bool *valid);
+
+void logstore_reader_close(logstore_reader_t *r);
+
+/**
+ * Odczytuje rekordy z zakresu [t0, t1) z plików dziennych w katalogu dir.
+ * Otwiera tylko istniejące pliki dób (przebiegi readdir po LOGSTORE_LIST_DAYS),
+ * więc koszt nie zależy od szerokości zakresu. Rekordy z błędnym CRC są pomijane.
+ *
+ * @param stats [out] Liczniki odczytu (może być NULL)
+ * @return ESP_OK (także gdy brak plików), ESP_ERR_INVALID_ARG
+ */
+esp_err_t logstore_read_range(const char *dir, uint32_t t0, uint32_t t1,
+                              logstore_record_cb_t cb, void *ctx,
+                              logstore_range_stats_t *stats);
+
+/**
+ * Znajduje najnowszy plik doby (YYYYMMDD.DAT) w katalogu, starszy niż below.
+ * @param below Nazwa pliku (np. "20261015.DAT") lub NULL - bez ograniczenia
+ * @param out Bufor na nazwę pliku (min. 13 znaków)
+ * @return true jeśli znaleziono
+ */
+bool logstore_find_last_day(const char *dir, const char *below, char *out, size_t out_len);
+
+/**
+ * Znajduje najstarszy plik doby nowszy niż after (np. "20261015.DAT").
+ */
+bool logstore_find_next_day(const char *dir, const char *after, char *out, size_t out_len);
+
+/**
+ * Numer doby (dni od 1970-01-01) z nazwy pliku "YYYYMMDD.DAT".
+ */
+uint32_t logstore_day_from_name(const char *name);
+
+/**
+ * Odzyskuje plik doby po zaniku zasilania: znajduje ostatni rekord z poprawnym
+ * CRC i obcina wszystko za nim (niepełny rekord, niezapisany sektor) oraz wpisy
+ * indeksu wskazujące poza nowy koniec pliku.
+ *
+ * Koszt nie zależy od rozmiaru pliku: sprawdzane jest najwyżej
+ * LOGSTORE_RECOVER_TAIL_RECORDS rekordów od końca. Tylko gdy wśród nich nie ma
+ * żadnego poprawnego (uszkodzenie większe niż niezapisany bufor), sprawdzane są
+ * kolejne wpisy indeksu od najnowszego (po LOGSTORE_INDEX_STRIDE rekordów każdy).
+ * Bez indeksu pełne rekordy spoza okna są wtedy zostawiane bez zmian.
+ *
+ * @return ESP_OK, ESP_ERR_NOT_FOUND (brak pliku), ESP_ERR_INVALID_VERSION /
+ *         ESP_ERR_INVALID_SIZE / ESP_ERR_INVALID_CRC (uszkodzony nagłówek),
+ *         ESP_FAIL (błąd I/O)
+ */
+esp_err_t logstore_recover_file(const char *dat_path, const char *idx_path,
+                                logstore_recovery_t *res);
+
+/**
+ * Odbudowuje indeks .IDX na podstawie pliku .DAT (jeden przebieg, stały bufor).
+ */
+esp_err_t logstore_index_rebuild(const char *dat_path, const char *idx_path);
+
+/**
+ * Dokańcza kompakcję przerwaną zanikiem zasilania dla pliku doby name
+ * ("YYYYMMDD.DAT"): przenosi kompletny .TMP na miejsce usuniętego .DAT albo
+ * usuwa niedokończony .TMP, a brakujący indeks odbudowuje.
+ */
+esp_err_t logstore_compact_finish(const char *dir, const char *name);
+
+/**
+ * Kompaktuje plik doby: strumieniowo przepisuje rekordy spełniające predykat
+ * (opcjonalnie uśrednione w przedziałach spec->bucket_sec) do YYYYMMDD.TMP,
+ * następnie podmienia plik i odbudowuje indeks. Pracuje na statycznym buforze
+ * (funkcja nie jest wielowątkowa). Plik bez żadnego rekordu jest usuwany.
+ * Plik starszej wersji logrec jest przy okazji przepisywany na bieżący schemat
+ * (logrec_upgrade); sama aktualizacja to spec z samymi zerami. Gdy nic nie
+ * trzeba usunąć ani przepisać, oryginał zostaje bez zmian (stats->rewritten).
+ *
+ * Kolejność podmiany: .TMP zamknięty -> usuń .IDX -> usuń .DAT -> .TMP na .DAT
+ * -> odbuduj .IDX; każdy stan pośredni naprawia logstore_compact_finish().
+ */
+esp_err_t logstore_compact_file(const char *dir, const char *name,
+                                const logstore_compact_t *spec,
+                                logstore_compact_stats_t *stats);
+
+/**
+ * Usuwa z plików dób do last_day włącznie (UINT32_MAX = wszystkie) rekordy,
+ * dla których keep zwraca false (np. logstore_keep_unless_field,
+ * logstore_keep_newer_than). Przegląda tylko istniejące pliki; plik bez
+ * rekordów do usunięcia nie jest przepisywany. Offsety rekordów w przepisanych
+ * dobach (od stats->first_day) się zmieniają - pozycje trzymane poza logiem
+ * (kursor outboxa) trzeba potem odświeżyć.
+ *
+ * @param skip Nazwa pliku, którego nie ruszać (otwarty log), lub NULL
+ */
+esp_err_t logstore_purge(const char *dir, logstore_keep_cb_t keep, void *ctx, uint32_t last_day,
+                         const char *skip, logstore_purge_stats_t *stats);
+
+/**
+ * Stosuje politykę retencji do plików dób starszych niż now: usuwa lub uśrednia.
+ * Pliki już uśrednione z przedziałem >= bucket_sec są pomijane (pole bucket_sec
+ * nagłówka). Listę istniejących plików zbiera przebiegiem readdir (po
+ * LOGSTORE_LIST_DAYS najstarszych) i dopiero potem zmienia katalog.
+ *
+ * @param skip Nazwa pliku, którego nie ruszać (otwarty log), lub NULL
+ */
+esp_err_t logstore_retention(const char *dir, uint32_t now, const logstore_retention_t *policy,
+                             const char *skip, logstore_retention_stats_t *stats);
+
+#endif // LOGSTORE_H
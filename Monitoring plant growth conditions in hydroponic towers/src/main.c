@@ -4,21 +4,37 @@
  * 
  * Architektura systemu: Interwałowe Bloki Pomiarowe
  * 
- * System pracuje w oparciu o harmonogram zarządzany przez zegar RTC DS1302.
- * Domyślnie system wykonuje 2 pomiary na dobę (86400s / 2 = 43200s interwału).
- * Harmonogram można edytować przez UART komendą: SET_FREQ:X
+ * System pracuje w oparciu o harmonogram zarządzany przez zegar RTC DS1302
+ * (przez zegar systemowy ustawiany z RTC, patrz sysclock.h).
+ * Każdy kanał (temperatura wody, powietrze, światło, pH, poziom wody) ma
+ * własny okres i fazę w tabeli harmonogramu (schedtab.h, NVS). Domyślnie
+ * wszystkie kanały 2 razy na dobę (86400s / 2 = 43200s interwału).
+ * Tabelę można edytować przez UART: SCHED:KANAŁ:OKRES[:FAZA], SET_FREQ:X
+ * (wszystkie kanały naraz). Kanały o bliskich terminach są łączone w jeden
+ * blok (esp_timer na termin), a między blokami układ śpi w automatycznym
+ * light sleep (CONFIG_PM_ENABLE).
  * 
- * Każdy blok akwizycji zawiera:
+ * Każdy blok akwizycji zawiera (tylko kanały należne w tym bloku):
  * 1. Odczyt sensorów automatycznych (DS18B20, DHT22, BH1750)
- * 2. Pobranie ostatniego zmierzonego pH (pomiar manualny)
- * 3. Zapis danych na kartę SD w formacie NDJSON z timestampem RTC
+ * 2. Próbkę pH (kanał PH, wstrzymywana na czas pracy pompy) lub ostatnią
+ *    próbkę z przycisku, z flagą świeżości
+ * 3. Zapis danych na kartę SD (binarny log z CRC, patrz logrec.h) z timestampem RTC
  * 4. Publikacja danych na brokerze MQTT
  * 
- * pH jest mierzone manualnie przez przycisk z przerwaniem i debouncingiem 20ms
+ * pH jest próbkowane w blokach kanału PH (odroczenie na czas pracy pompy
+ * i jej ustalania się, PH:SCHED) oraz na żądanie przyciskiem z przerwaniem
+ * i debouncingiem 20ms
+ *
+ * DUTY_CYCLE_MODE = 1 (zasilanie bateryjne / solarne): po zimnym starcie
+ * system działa jak wyżej przez DUTY_CONSOLE_WINDOW_SEC, potem między blokami
+ * śpi w deep sleep. Wybudzenie (timer, przycisk pH, czujnik poziomu) idzie
+ * skróconą ścieżką: czujniki, rekord do kolejki w pamięci RTC, sen. Karta SD
+ * i Wi-Fi startują tylko, gdy paczka jest należna (dutycycle.h).
  * ============================================================================
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
 #include <math.h>
@@ -29,6 +45,9 @@
 #include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_pm.h"
+#include "esp_sleep.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 #include "nvs_flash.h"
@@ -38,8 +57,10 @@
 #include "ds18b20.h"
 #include "dht.h"
 #include "bh1750.h"
+#include "light.h"
 #include "ph_sensor.h"
 #include "ds1302.h"
+#include "sysclock.h"
 #include "relay.h"
 #include "mqtt.h"
 #include "wifi.h"
@@ -47,6 +68,14 @@
 #include "onewire.h"
 #include "i2cdev.h"
 #include "level.h"
+#include "schedtab.h"
+#include "dutycycle.h"
+#include "storage.h"
+#include "outbox.h"
+#include "recbuf.h"
+#include "payload_bench.h"
+#include "onewire_bench.h"
+#include "ph_bench.h"
 
 /* ============================================================================
  * KONFIGURACJA GLOBALNA
@@ -59,11 +88,23 @@ static const char *TAG = "MAIN";
 #define UART_BAUDRATE      115200
 #define UART_RX_BUF_SIZE   256
 #define UART_TX_BUF_SIZE   256
+#define UART_QUEUE_SIZE    10
+// Light sleep: zbocza RX budzą układ, ale te znaki giną - po ciszy na konsoli
+// pierwsza komenda wymaga powtórzenia (lub wcześniejszego ENTER)
+#define UART_WAKEUP_THRESHOLD  3
 
-// Parametry harmonogramu pomiarów
+// Zarządzanie energią (CONFIG_PM_ENABLE, light sleep: CONFIG_FREERTOS_USE_TICKLESS_IDLE)
+#define PM_MAX_FREQ_MHZ    240
+#define PM_MIN_FREQ_MHZ    80     // Minimum dla Wi-Fi i UART 115200 przy zmianie taktowania
+
+// Parametry harmonogramu pomiarów (okres kanałów bez tabeli w NVS)
 #define SECONDS_PER_DAY    86400
 #define DEFAULT_MEASUREMENTS_PER_DAY 2
 
+// Powiadomienia zadania harmonogramu (xTaskNotify, bity)
+#define SCHED_NOTIFY_DEADLINE  (1u << 0)   // Wybił timer terminu bloku
+#define SCHED_NOTIFY_UPDATE    (1u << 1)   // SET_FREQ / SCHED / PH:SCHED zmieniły tabelę
+
 // Piny I2C (dla BH1750 i innych czujników I2C)
 #define I2C_SDA_GPIO       GPIO_NUM_21
 #define I2C_SCL_GPIO       GPIO_NUM_22
@@ -71,11 +112,20 @@ static const char *TAG = "MAIN";
 
 // Pin OneWire (DS18B20)
 #define ONEWIRE_GPIO       GPIO_NUM_2
+// Konwersja trwa 94..750 ms (9..12 bit, DS18:RES); zakończenie wykrywane
+// odpytywaniem magistrali, limit = czas najwolniejszej sondy + margines
+#define DS18_CONVERSION_MARGIN_MS   50
 
 // Pin przycisku pH
 #define PH_BUTTON_GPIO     GPIO_NUM_32
 #define PH_DEBOUNCE_MS     20
 
+// Próbka pH kanału PH nie wcześniej niż PH_PUMP_SETTLE_SEC po przełączeniu
+// pompy (R1); odroczona próbuje co PH_DEFER_RETRY_SEC. Zmiana w locie: PH:SCHED:I:S
+// (zapisywana w NVS razem z tabelą harmonogramu, schedtab_ph_settle)
+#define PH_PUMP_SETTLE_SEC        120
+#define PH_DEFER_RETRY_SEC        30
+
 // Konfiguracja WiFi i MQTT (zmień na swoje wartości!)
 #define WIFI_SSID          "Sieć OPD"
 #define WIFI_PASSWORD      "pies12345"
@@ -83,49 +133,130 @@ static const char *TAG = "MAIN";
 
 
 
-// Ścieżka pliku danych na SD
-#define SD_DATA_FILE       "/sdcard/measurements.ndjson"
+// Katalog danych na SD: binarny log dzienny YYYYMMDD.DAT + indeks YYYYMMDD.IDX
+// (nazwy 8.3 - CONFIG_FATFS_LFN_NONE). Dekodowanie do NDJSON na PC: tools/dasdecode
+#define SD_DATA_DIR        "/sdcard/LOG"
+
+// Plik danych starego firmware (tablica JSON) - migrowany raz do SD_DATA_DIR.
+// Bez LFN FATFS widzi długą nazwę pod aliasem 8.3, więc sprawdzamy obie
+#define SD_LEGACY_FILE     "/sdcard/measurements.ndjson"
+#define SD_LEGACY_FILE_83  "/sdcard/MEASUR~1.NDJ"
+
+// Okno trwałości zapisu na SD (group commit): rekordy czekają w RAM najwyżej
+// tyle rekordów / sekund, pełne sektory 4 KiB są zapisywane od razu
+#define SD_COMMIT_MAX_RECORDS  16
+#define SD_COMMIT_MAX_AGE_SEC  300
+
+// Przy przepełnieniu kolejki zapisu (karta nie nadąża) tracimy najstarszy rekord
+#define SD_OVERFLOW_POLICY     STORAGE_DROP_OLDEST
+
+// Retencja: pliki dób starsze niż 30 dni są zastępowane średnimi godzinowymi
+// (~0.8 KiB/dobę). Usuwanie najstarszych danych: SD_DELETE_AFTER_DAYS > 0
+#define SD_DOWNSAMPLE_AFTER_DAYS  30
+#define SD_DOWNSAMPLE_SEC         3600
+#define SD_DELETE_AFTER_DAYS      0
+
+// MQTT: do 8 rekordów w jednej wiadomości (mniej czasu pracy radia), niepełna
+// paczka najpóźniej po 15 min. Zmiana w locie: BATCH:N:T
+#define MQTT_BATCH_RECORDS        8
+#define MQTT_BATCH_MAX_AGE_SEC    900
+
+// Kodowanie payloadu MQTT: OUTBOX_FORMAT_JSON (das_tower/measurements) lub
+// OUTBOX_FORMAT_CBOR (das_tower/measurements/cbor, ~6x mniej bajtów). FORMAT:JSON/CBOR
+#define MQTT_PAYLOAD_FORMAT       OUTBOX_FORMAT_JSON
+
+// Zmiany poziomu wody publikowane od razu, niezależnie od bloku pomiarowego, z QoS 0
+// (mqtt_publish_qos0, bez PUBACK) - w odróżnieniu od rekordów pomiarów (QoS 1)
+#define LEVEL_TOPIC               "das_tower/level"
+
+// Tryb cyklicznego deep sleep (1 = śpij między blokami, też -DDUTY_CYCLE_MODE=1).
+// Po zimnym starcie konsola UART działa przez DUTY_CONSOLE_WINDOW_SEC (SET_FREQ,
+// kalibracja), później jest niedostępna aż do resetu.
+#ifndef DUTY_CYCLE_MODE
+#define DUTY_CYCLE_MODE           0
+#endif
+#define DUTY_CONSOLE_WINDOW_SEC   120
+// Karta SD i Wi-Fi przy tylu rekordach w pamięci RTC albo gdy najstarszy czeka 6 h
+#define DUTY_BATCH_RECORDS        MQTT_BATCH_RECORDS
+#define DUTY_BATCH_MAX_AGE_SEC    21600
+#define DUTY_CONNECT_TIMEOUT_SEC  20      // Wi-Fi + broker
+#define DUTY_FLUSH_TIMEOUT_SEC    15      // Zapis paczki na kartę i PUBACK
+// Oscylator RC zegara RTC w deep sleep ma dryf rzędu %: wybudzenie wcześniej
+// niż tyle przed terminem to tylko ponowne uśpienie na resztę
+#define DUTY_EARLY_WAKE_SEC       2
+
+#if DUTY_CYCLE_MODE
+#define DUTY_RTC_ATTR  RTC_DATA_ATTR      // Harmonogram i próbka pH przetrwają deep sleep
+#else
+#define DUTY_RTC_ATTR
+#endif
 
 /* ============================================================================
  * STRUKTURY GLOBALNE
  * ============================================================================ */
 
 typedef struct {
-    float temperature_ds18;     // Temperatura DS18B20 [°C]
+    float temperature_ds18;     // Temperatura DS18B20 [°C] (sonda 0)
+    float temperature_probes[DS18_MAX_DEVICES];  // Sondy DS18B20 wg tablicy urządzeń [°C]
+    int probe_count;            // Odczytane sondy (bez tablicy w NVS: 1, adresowana SKIP ROM)
     float temperature_dht;      // Temperatura DHT22 [°C]
     float humidity;             // Wilgotność DHT22 [%]
     float light;                // Natężenie światła BH1750 [lux]
-    float ph;                   // pH zmierzone ręcznie
-    float last_manual_ph;       // Ostatnia zmierzona wartość pH
+    float ph;                   // Ostatnia próbka pH (harmonogram lub przycisk)
+    bool ph_fresh;              // Próbka pH pobrana od poprzedniego bloku (nie kopia)
     uint32_t timestamp_unix;    // Timestamp RTC (Unix)
     char rtc_string[32];        // Timestamp w formacie: YYYY-MM-DD HH:MM:SS
 } measurement_block_t;
 
+// Czasy etapów bloku pomiarowego [us]
+typedef struct {
+    int64_t acquire_us;         // Odczyt czujników
+    int64_t store_us;           // Przekazanie rekordu do zadania zapisu
+    int64_t publish_us;         // Publikacja MQTT
+    int64_t max_acquire_us;
+    int64_t max_store_us;
+    int64_t max_publish_us;
+    int64_t late_us;            // Opóźnienie startu bloku względem terminu
+    int64_t max_late_us;
+    uint32_t blocks;
+} block_timing_t;
+
 typedef struct {
-    uint32_t measurements_per_day;
-    uint32_t measurement_interval_sec;
-    SemaphoreHandle_t update_semaphore;
+    uint32_t channel_due[SCHEDTAB_CHANNELS];  // Najbliższy termin kanału [s Unix], 0 = wyłączony
+    uint32_t next_deadline;     // Termin następnego bloku [s Unix]
+    uint32_t next_channels;     // Kanały tego bloku (maska 1 << SCHEDTAB_*)
+    uint32_t ph_deferred_since; // Początek odroczenia próbki pH przez pompę [s Unix], 0 = brak
+    TaskHandle_t task;
+    esp_timer_handle_t deadline_timer;
 } scheduler_config_t;
 
 /* ============================================================================
  * ZMIENNE GLOBALNE
  * ============================================================================ */
 
-static scheduler_config_t scheduler = {
-    .measurements_per_day = DEFAULT_MEASUREMENTS_PER_DAY,
-    .measurement_interval_sec = SECONDS_PER_DAY / DEFAULT_MEASUREMENTS_PER_DAY,
-    .update_semaphore = NULL
+static DUTY_RTC_ATTR scheduler_config_t scheduler = {
+    .task = NULL
 };
 
 static measurement_block_t current_measurement = {0};
-static float last_manual_ph_value = 0.0f;
-static bool ph_measurement_pending = false;
+static block_timing_t block_timing = {0};
+// Ostatnia próbka pH: zapis w ph_take_sample, odbiór w bloku pomiarowym (ph_mux)
+static DUTY_RTC_ATTR float last_ph_value = NAN;
+static DUTY_RTC_ATTR bool ph_sample_fresh = false;
+static int64_t ph_last_sample_us = 0;   // 0 = jeszcze nie mierzono
+static portMUX_TYPE ph_mux = portMUX_INITIALIZER_UNLOCKED;
 static SemaphoreHandle_t ph_measurement_semaphore = NULL;
 
 static OneWire ow;
+static SemaphoreHandle_t ow_mutex = NULL;  // Magistrala 1-Wire: blok pomiarowy i komendy DS18:*
 static i2c_dev_t bh1750_dev;
 static ph_sensor_t ph_sensor;
 static QueueHandle_t ph_measurement_queue = NULL;
+static QueueHandle_t uart_queue = NULL;           // Zdarzenia sterownika UART (bez odpytywania)
+static TaskHandle_t relay_timer_handle = NULL;
+static SemaphoreHandle_t relay_mutex = NULL;      // relay_timer i przełączanie R1/R2: UART, pętla R1:TIME, poziom wody
+static bool level_ok = false;                     // Czujnik poziomu zainicjalizowany
+static QueueHandle_t level_event_queue = NULL;    // Subskrypcja zdarzeń czujnika poziomu
 
 // Struktura do obsługi czasowego sterowania relay w pętli
 typedef struct {
@@ -142,27 +273,152 @@ static relay_timer_t relay_timer = {
     .relay_id = 0
 };
 
+/**
+ * Świeży odczyt temperatury wody (sonda 0) do kompensacji pH; przy błędzie
+ * ostatnia wartość z bloku pomiarowego (NAN = ph_sensor przyjmie 25 °C)
+ */
+static float read_water_temperature(void)
+{
+    float t = NAN;
+    xSemaphoreTake(ow_mutex, portMAX_DELAY);
+    if (ds18_request_temperatures(&ow)) {
+        ds18_wait_conversion(&ow, ds18_conversion_time_ms() + DS18_CONVERSION_MARGIN_MS);
+        t = ds18_get_temp_c_by_index(&ow, 0);
+    }
+    xSemaphoreGive(ow_mutex);
+    return isnan(t) ? current_measurement.temperature_ds18 : t;
+}
+
+/**
+ * Punkt kalibracji pH (CALPH4 / CALPH7 / CALPH10): seria DMA + temperatura wody
+ */
+static void ph_calibrate_point(const char *cmd)
+{
+    float temperature = read_water_temperature();
+    float ph;
+    ph_burst_t burst;
+    esp_err_t ret = ph_sensor_read_burst(&ph_sensor, temperature, &ph, &burst);
+    if (ret == ESP_OK) {
+        ret = ph_sensor_calibration(&ph_sensor, cmd, burst.mean_mv, temperature);
+    }
+    if (ret == ESP_OK) {
+        printf("[UART] %s: %.1f ± %.1f mV at %.1f°C, slope %.2f mV/pH at 25°C\n", cmd,
+               burst.mean_mv, burst.stddev_mv, temperature, ph_sensor_mv_per_ph(&ph_sensor, 25.0f));
+    } else {
+        printf("[UART] %s failed: %s\n", cmd, esp_err_to_name(ret));
+    }
+}
+
+/**
+ * Próbka pH (kanał PH lub przycisk): seria DMA, kompensacja Nernsta wg
+ * temperatury wody - z bloku, jeśli sondy były właśnie czytane, inaczej
+ * świeży odczyt (NAN). Wynik trafia do najbliższego rekordu jako świeży.
+ */
+static esp_err_t ph_take_sample(const char *source, float temperature)
+{
+    if (isnan(temperature)) {
+        temperature = read_water_temperature();
+    }
+    float ph;
+    ph_burst_t burst;
+    esp_err_t ret = ph_sensor_read_burst(&ph_sensor, temperature, &ph, &burst);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "pH %s measurement failed: %s", source, esp_err_to_name(ret));
+        return ret;
+    }
+
+    portENTER_CRITICAL(&ph_mux);
+    last_ph_value = ph;
+    ph_sample_fresh = true;
+    ph_last_sample_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&ph_mux);
+    xSemaphoreGive(ph_measurement_semaphore);
+
+    printf("[pH] %s measurement captured: %.2f (%.1f ± %.1f mV at %.1f°C, %u samples)\n",
+           source, ph, burst.mean_mv, burst.stddev_mv, temperature, burst.used);
+    return ESP_OK;
+}
+
 /* ============================================================================
  * OBSŁUGA UART - KOMENDA INTERFEJSU
  * ============================================================================ */
 
+/**
+ * Wypisuje rekord z karty jako linię NDJSON (komenda READ)
+ */
+static bool print_record_cb(const logrec_t *rec, void *ctx)
+{
+    const logrec_header_t *hdr = ctx;
+    char line[384];
+    if (logrec_format_ndjson(hdr, rec, line, sizeof(line)) > 0) {
+        printf("%s\n", line);
+    }
+    return true;
+}
+
+/**
+ * Tabela harmonogramu z najbliższym terminem każdego kanału (SCHED, STATUS)
+ */
+static void print_schedule(void)
+{
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        schedtab_entry_t e = schedtab_get(i);
+        uint32_t due = scheduler.channel_due[i];
+        if (e.period_sec == 0) {
+            printf("  %-6s         off\n", schedtab_name(i));
+        } else if (due == 0) {
+            // Przed startem scheduler_task
+            printf("  %-6s         every %lu s, phase %lu s\n", schedtab_name(i), e.period_sec, e.phase_sec);
+        } else {
+            printf("  %-6s         every %lu s, phase %lu s, next %02lu:%02lu:%02lu\n", schedtab_name(i),
+                   e.period_sec, e.phase_sec, due % SECONDS_PER_DAY / 3600, due % 3600 / 60, due % 60);
+        }
+    }
+}
+
 /**
  * Parse UART command from queue and execute it
  * Supported commands:
- *   - SET_FREQ:X      (X = 1..24 pomiary na dobę)
+ *   - SET_FREQ:X      (X = 1..24 pomiary na dobę, wszystkie kanały)
+ *   - SCHED           (tabela harmonogramu kanałów)
+ *   - SCHED:K:P[:F]   (kanał K = WATER/AIR/LIGHT/PH/LEVEL co P s z fazą F s od północy; P = 0: wyłączony)
  *   - R1:ON / R1:OFF  (sterowanie przekaźnikiem 1)
  *   - R2:ON / R2:OFF  (sterowanie przekaźnikiem 2)
  *   - STATUS          (wyświetl aktualny stan)
  *   - ENTERPH         (wejdź w tryb kalibracji pH)
- *   - CALPH7 / CALPH4 (kalibruj punkt)
- *   - EXITPH          (wyjdź z trybu kalibracji)
+ *   - CALPH4 / CALPH7 / CALPH10 (kalibruj punkt w buforze, temperatura z DS18B20)
+ *   - EXITPH          (zapisz kalibrację w NVS i wyjdź z trybu kalibracji)
+ *   - PH:SCHED:I:S    (kanał PH co I s, próbka S s po przełączeniu pompy, 0 < S < I; I = 0: tylko przycisk)
+ *   - READ:T0:T1      (wypisz rekordy z SD z zakresu [T0, T1), sekundy czasu RTC)
+ *   - PURGE:BEFORE:T  (usuń z SD rekordy starsze niż T, sekundy czasu RTC)
+ *   - PURGE:FIELD:P:V (usuń z SD rekordy, w których pole P ma surową wartość V, np. ph:700)
+ *   - BATCH:N:T       (MQTT: do N rekordów w wiadomości, niepełna paczka po T s)
+ *   - FORMAT:JSON / FORMAT:CBOR (kodowanie payloadu MQTT)
+ *   - BENCH:JSON[:N]  (pomiar formatowania payloadu: snprintf vs jsonw)
+ *   - BENCH:OW[:N]    (test backendu 1-Wire: czas CPU i błędy CRC przy ruchu MQTT)
+ *   - BENCH:PH[:N]    (odczyt pH: pojedyncza próbka vs seria DMA, czas i szum)
+ *   - DS18:SCAN       (wyszukaj sondy DS18B20 i zapisz tablicę w NVS)
+ *   - DS18:RES:I:B    (rozdzielczość sondy I: B = 9..12 bitów)
  */
 static void uart_command_handler(void *arg)
 {
     char buffer[256];
     int len;
+    uart_event_t event;
 
     while (1) {
+        // Czekaj na dane bez budzenia co 100 ms (light sleep między komendami)
+        if (xQueueReceive(uart_queue, &event, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (event.type == UART_FIFO_OVF || event.type == UART_BUFFER_FULL) {
+            uart_flush_input(UART_NUM);
+            xQueueReset(uart_queue);
+            continue;
+        }
+        if (event.type != UART_DATA) {
+            continue;
+        }
         len = uart_read_bytes(UART_NUM, (uint8_t *)buffer, sizeof(buffer) - 1, pdMS_TO_TICKS(100));
         
         if (len > 0) {
@@ -182,24 +438,55 @@ static void uart_command_handler(void *arg)
             if (strncmp(buffer, "SET_FREQ:", 9) == 0) {
                 int freq = atoi(buffer + 9);
                 if (freq > 0 && freq <= 24) {
-                    scheduler.measurements_per_day = freq;
-                    scheduler.measurement_interval_sec = SECONDS_PER_DAY / freq;
-                    xSemaphoreGive(scheduler.update_semaphore);
-                    printf("[UART] Measurement frequency set to %d per day (interval: %ld seconds)\n", 
-                           freq, scheduler.measurement_interval_sec);
+                    esp_err_t ret = schedtab_set_all(SECONDS_PER_DAY / freq);
+                    xTaskNotify(scheduler.task, SCHED_NOTIFY_UPDATE, eSetBits);
+                    printf("[UART] Measurement frequency set to %d per day on all channels (interval: %d seconds)%s\n",
+                           freq, SECONDS_PER_DAY / freq, ret == ESP_OK ? "" : " - NVS save failed");
                 } else {
                     printf("[UART] Invalid frequency: %d (must be 1-24)\n", freq);
                 }
             }
+            // SCHED
+            else if (strcmp(buffer, "SCHED") == 0) {
+                printf("[UART] Schedule (channels due within 1/%d of their period join one block):\n",
+                       SCHEDTAB_MERGE_DIV);
+                print_schedule();
+            }
+            // SCHED:K:P[:F]
+            else if (strncmp(buffer, "SCHED:", 6) == 0) {
+                char *colon = strchr(buffer + 6, ':');
+                int ch = colon ? schedtab_parse(buffer + 6, colon - (buffer + 6)) : -1;
+                uint32_t period = colon ? strtoul(colon + 1, NULL, 10) : 0;
+                char *phase_colon = colon ? strchr(colon + 1, ':') : NULL;
+                uint32_t phase = phase_colon ? strtoul(phase_colon + 1, NULL, 10) : 0;
+                esp_err_t ret = ch < 0 ? ESP_ERR_INVALID_ARG : schedtab_set(ch, period, phase);
+                if (ret == ESP_ERR_INVALID_ARG) {
+                    printf("[UART] Usage: SCHED:WATER|AIR|LIGHT|PH|LEVEL:P[:F] (P = 0 off or %d..%d s, F < P)\n",
+                           SCHEDTAB_MIN_PERIOD_SEC, SCHEDTAB_MAX_PERIOD_SEC);
+                } else {
+                    xTaskNotify(scheduler.task, SCHED_NOTIFY_UPDATE, eSetBits);
+                    if (period) {
+                        printf("[UART] Channel %s every %lu s, phase %lu s%s\n", schedtab_name(ch),
+                               period, phase, ret == ESP_OK ? "" : " - NVS save failed");
+                    } else {
+                        printf("[UART] Channel %s off%s\n", schedtab_name(ch),
+                               ret == ESP_OK ? "" : " - NVS save failed");
+                    }
+                }
+            }
             // R1:ON / R1:OFF / R1:TIME:ON_MS:OFF_MS
             else if (strcmp(buffer, "R1:ON") == 0) {
+                xSemaphoreTake(relay_mutex, portMAX_DELAY);
                 relay_timer.active = false;  // Zatrzymaj timer jeśli był aktywny
                 relay_set_relay1_on();
+                xSemaphoreGive(relay_mutex);
                 printf("[UART] Relay 1 ON\n");
             }
             else if (strcmp(buffer, "R1:OFF") == 0) {
+                xSemaphoreTake(relay_mutex, portMAX_DELAY);
                 relay_timer.active = false;  // Zatrzymaj timer jeśli był aktywny
                 relay_set_relay1_off();
+                xSemaphoreGive(relay_mutex);
                 printf("[UART] Relay 1 OFF (timer stopped if was running)\n");
             }
             else if (strncmp(buffer, "R1:TIME:", 8) == 0) {
@@ -208,10 +495,13 @@ static void uart_command_handler(void *arg)
                 char *colon = strchr(buffer + 8, ':');
                 int off_ms = colon ? atoi(colon + 1) : 0;
                 if (on_ms > 0 && off_ms > 0) {
+                    xSemaphoreTake(relay_mutex, portMAX_DELAY);
                     relay_timer.on_ms = on_ms;
                     relay_timer.off_ms = off_ms;
                     relay_timer.relay_id = 1;
                     relay_timer.active = true;
+                    xSemaphoreGive(relay_mutex);
+                    xTaskNotifyGive(relay_timer_handle);
                     printf("[UART] Relay 1 timer started: ON %dms, OFF %dms, REPEATING\n", on_ms, off_ms);
                     printf("[UART] To stop: R1:OFF\n");
                 } else {
@@ -220,44 +510,284 @@ static void uart_command_handler(void *arg)
             }
             // R2:ON / R2:OFF
             else if (strcmp(buffer, "R2:ON") == 0) {
+                xSemaphoreTake(relay_mutex, portMAX_DELAY);
                 relay_set_relay2_on();
+                xSemaphoreGive(relay_mutex);
                 printf("[UART] Relay 2 ON\n");
             }
             else if (strcmp(buffer, "R2:OFF") == 0) {
+                xSemaphoreTake(relay_mutex, portMAX_DELAY);
                 relay_set_relay2_off();
+                xSemaphoreGive(relay_mutex);
                 printf("[UART] Relay 2 OFF\n");
             }
             // STATUS
             else if (strcmp(buffer, "STATUS") == 0) {
                 ds1302_time_t rtc_time;
-                ds1302_get_time(&rtc_time);
+                sysclock_get_time(&rtc_time);
                 printf("\n========== SYSTEM STATUS ==========\n");
                 printf("RTC Time:        %04d-%02d-%02d %02d:%02d:%02d\n",
                        rtc_time.year, rtc_time.month, rtc_time.day,
                        rtc_time.hour, rtc_time.min, rtc_time.sec);
-                printf("Measurements/day: %ld (interval: %ld sec)\n", 
-                       scheduler.measurements_per_day, scheduler.measurement_interval_sec);
-                printf("Last manual pH:  %.2f\n", last_manual_ph_value);
+                sysclock_stats_t clk;
+                sysclock_get_stats(&clk);
+                printf("RTC discipline:  %lu reads, last offset %ld s (%lu slewed, %lu stepped)\n",
+                       clk.disciplines, (long)clk.last_offset_sec, clk.slews, clk.steps);
+                printf("Schedule:\n");
+                print_schedule();
+                portENTER_CRITICAL(&ph_mux);
+                float ph_value = last_ph_value;
+                int64_t ph_at_us = ph_last_sample_us;
+                portEXIT_CRITICAL(&ph_mux);
+                if (ph_at_us) {
+                    printf("Last pH:         %.2f (%lld s ago)\n", ph_value,
+                           (esp_timer_get_time() - ph_at_us) / 1000000);
+                } else {
+                    printf("Last pH:         none\n");
+                }
+                if (scheduler.ph_deferred_since) {
+                    printf("pH sampling:     %lu s after pump switch, deferred for %lu s\n", schedtab_ph_settle(),
+                           sysclock_now_unix() - scheduler.ph_deferred_since);
+                } else {
+                    printf("pH sampling:     %lu s after pump switch\n", schedtab_ph_settle());
+                }
+                printf("pH calibration:  offset %.1f mV, slope %.2f mV/pH at 25°C (%s)\n",
+                       ph_sensor.offset_mv, ph_sensor_mv_per_ph(&ph_sensor, 25.0f),
+                       isnan(ph_sensor.base_voltage) ? "pH 4/7" : "pH 4/7/10");
                 printf("Relay 1 (Pump):  %s\n", relay_get_relay1_state() ? "ON" : "OFF");
                 printf("Relay 2 (LED):   %s\n", relay_get_relay2_state() ? "ON" : "OFF");
+                if (level_ok) {
+                    level_stats_t lvl;
+                    level_sensor_get_stats(&lvl);
+                    printf("Water level:     %s (%lu edges, %lu transitions, %lu dropped)\n",
+                           level_sensor_has_water() ? "WATER" : "EMPTY",
+                           lvl.edges, lvl.transitions, lvl.dropped);
+                } else {
+                    printf("Water level:     sensor not initialized\n");
+                }
+                printf("DS18B20 probes:  %d (conversion %lu ms)\n",
+                       ds18_get_device_count(), ds18_conversion_time_ms());
+                for (int i = 0; i < current_measurement.probe_count; i++) {
+                    const ds18_device_t *d = ds18_get_device(i);
+                    if (!d) break;
+                    printf("  probe %d:       %02X-%02X%02X%02X%02X%02X%02X %d bit, last %.2f°C\n", i,
+                           d->rom[0], d->rom[6], d->rom[5], d->rom[4], d->rom[3], d->rom[2], d->rom[1],
+                           d->resolution, current_measurement.temperature_probes[i]);
+                }
+                uint8_t light_mtreg;
+                bool light_hres2;
+                light_get_range(&light_mtreg, &light_hres2);
+                printf("BH1750 range:    MTreg %u, %s\n", light_mtreg, light_hres2 ? "H-res2" : "H-res");
+                dht_stats_t dht_stats;
+                dht22_get_stats(&dht_stats);
+                printf("DHT22 reads:     %lu ok / %lu (%lu checksum errors, %lu timeouts)\n",
+                       dht_stats.ok, dht_stats.reads, dht_stats.checksum_errors, dht_stats.timeouts);
+                sdlog_stats_t sd_stats;
+                sensor_sdcard_get_stats(&sd_stats);
+                printf("SD commits:      %lu (fill %lu, records %lu, age %lu, sync %lu)\n",
+                       sd_stats.flushes, sd_stats.flushes_fill, sd_stats.flushes_records,
+                       sd_stats.flushes_age, sd_stats.flushes_sync);
+                printf("SD bytes:        %llu in, %llu sectors, WA %.2f\n",
+                       sd_stats.bytes_in, sd_stats.sectors_written,
+                       sdlog_write_amplification(&sd_stats));
+                storage_stats_t st_stats;
+                storage_get_stats(&st_stats);
+                printf("SD queue:        %lu submitted, %lu written, %lu dropped, %lu errors (max pending %lu)\n",
+                       st_stats.submitted, st_stats.written, st_stats.dropped,
+                       st_stats.write_errors, st_stats.max_pending);
+                printf("SD write time:   last %lld us, max %lld us (submit max %lld us)\n",
+                       st_stats.last_write_us, st_stats.max_write_us, st_stats.max_submit_us);
+                recbuf_stats_t rb_stats;
+                recbuf_get_stats(&rb_stats);
+                printf("Record pool:     %lu/%d in use (max %lu, %lu alloc failures)\n",
+                       rb_stats.in_use, RECBUF_COUNT, rb_stats.max_in_use, rb_stats.alloc_failed);
+                outbox_stats_t ob_stats;
+                outbox_get_stats(&ob_stats);
+                printf("MQTT outbox:     acked seq %lu / last %lu, %lu in flight, %lu acked, %lu rewinds (%s)\n",
+                       ob_stats.acked_seq, ob_stats.last_seq, ob_stats.inflight,
+                       ob_stats.acked, ob_stats.rewinds, ob_stats.connected ? "connected" : "offline");
+                printf("MQTT sent:       %lu messages, %lu records, %lu B payload (%lu B/record)\n",
+                       ob_stats.sent, ob_stats.records_sent, ob_stats.bytes_sent,
+                       ob_stats.records_sent ? ob_stats.bytes_sent / ob_stats.records_sent : 0);
+                printf("Block timing:    acquire %lld/%lld ms, store %lld/%lld us, MQTT %lld/%lld ms (last/max, %lu blocks)\n",
+                       block_timing.acquire_us / 1000, block_timing.max_acquire_us / 1000,
+                       block_timing.store_us, block_timing.max_store_us,
+                       block_timing.publish_us / 1000, block_timing.max_publish_us / 1000,
+                       block_timing.blocks);
+                uint32_t next = scheduler.next_deadline;
+                char channels[48];
+                schedtab_mask_str(scheduler.next_channels, channels, sizeof(channels));
+                printf("Next block:      %02lu:%02lu:%02lu (%s), start late %lld/%lld us (last/max)\n",
+                       next % SECONDS_PER_DAY / 3600, next % 3600 / 60, next % 60, channels,
+                       block_timing.late_us, block_timing.max_late_us);
+#if DUTY_CYCLE_MODE
+                printf("Duty cycle:      deep sleep after console window, batch at %d records / %d s\n",
+                       DUTY_BATCH_RECORDS, DUTY_BATCH_MAX_AGE_SEC);
+#endif
                 printf("====================================\n\n");
             }
             // ENTERPH
             else if (strcmp(buffer, "ENTERPH") == 0) {
-                printf("[UART] Entering pH calibration mode. Commands: CALPH4, CALPH7, EXITPH\n");
-            }
-            // CALPH7
-            else if (strcmp(buffer, "CALPH7") == 0) {
-                printf("[UART] Calibrating pH to neutral (7.0) - do kalibracji!\n");
-                // Tutaj wywołaj funkcję kalibracji z ph_sensor
+                ph_sensor_calibration(&ph_sensor, buffer, 0.0f, NAN);
+                printf("[UART] Entering pH calibration mode. Commands: CALPH4, CALPH7, CALPH10, EXITPH\n");
             }
-            // CALPH4
-            else if (strcmp(buffer, "CALPH4") == 0) {
-                printf("[UART] Calibrating pH to acid (4.0) - do kalibracji!\n");
+            // CALPH4 / CALPH7 / CALPH10
+            else if (strcmp(buffer, "CALPH4") == 0 || strcmp(buffer, "CALPH7") == 0 ||
+                     strcmp(buffer, "CALPH10") == 0) {
+                ph_calibrate_point(buffer);
             }
             // EXITPH
             else if (strcmp(buffer, "EXITPH") == 0) {
-                printf("[UART] Exiting pH calibration mode\n");
+                esp_err_t ret = ph_sensor_calibration(&ph_sensor, buffer, 0.0f, NAN);
+                printf("[UART] Exiting pH calibration mode, calibration %s\n",
+                       ret == ESP_OK ? "saved to NVS" : esp_err_to_name(ret));
+            }
+            // READ:T0:T1
+            else if (strncmp(buffer, "READ:", 5) == 0) {
+                char *colon = strchr(buffer + 5, ':');
+                uint32_t t0 = strtoul(buffer + 5, NULL, 10);
+                uint32_t t1 = colon ? strtoul(colon + 1, NULL, 10) : 0;
+                if (t1 > t0) {
+                    static logrec_header_t hdr;
+                    logrec_header_init(&hdr, 0);
+                    logstore_range_stats_t rs;
+                    // Przez zadanie zapisu: bez wyścigu z zapisem i z rekordami z bufora RAM
+                    esp_err_t ret = storage_read_range(t0, t1, print_record_cb, &hdr, &rs);
+                    if (ret == ESP_OK) {
+                        printf("[UART] READ: %lu records (%lu files, %lu read, %lu bad CRC)\n",
+                               rs.records_matched, rs.files, rs.records_read, rs.bad_crc);
+                    } else {
+                        printf("[UART] READ failed: %s\n", esp_err_to_name(ret));
+                    }
+                } else {
+                    printf("[UART] Usage: READ:T0:T1 (T1 > T0, seconds)\n");
+                }
+            }
+            // PURGE:BEFORE:T / PURGE:FIELD:P:V
+            else if (strncmp(buffer, "PURGE:", 6) == 0) {
+                logstore_keep_cb_t keep = NULL;
+                void *ctx = NULL;
+                uint32_t before = 0;
+                uint32_t last_day = UINT32_MAX;
+                char field[16];
+                logstore_field_match_t match = { .field = field };
+
+                if (strncmp(buffer + 6, "BEFORE:", 7) == 0) {
+                    before = strtoul(buffer + 13, NULL, 10);
+                    if (before > 0) {
+                        keep = logstore_keep_newer_than;
+                        ctx = &before;
+                        last_day = before / LOGSTORE_SECONDS_PER_DAY;  // Późniejsze doby mają tylko t >= T
+                    }
+                } else if (strncmp(buffer + 6, "FIELD:", 6) == 0) {
+                    const char *name = buffer + 12;
+                    char *colon = strchr(name, ':');
+                    logrec_t probe = {0};
+                    int64_t raw;
+                    if (colon && colon > name && (size_t)(colon - name) < sizeof(field)) {
+                        memcpy(field, name, colon - name);
+                        field[colon - name] = '\0';
+                        if (logrec_field_get(&probe, field, &raw, NULL)) {
+                            match.raw = strtoll(colon + 1, NULL, 10);
+                            keep = logstore_keep_unless_field;
+                            ctx = &match;
+                        }
+                    }
+                }
+
+                if (keep) {
+                    logstore_purge_stats_t ps;
+                    esp_err_t ret = storage_purge(keep, ctx, last_day, &ps);
+                    if (ret == ESP_OK) {
+                        printf("[UART] PURGE: %lu records deleted (%lu files rewritten, %lu removed)\n",
+                               ps.records_deleted, ps.files_rewritten, ps.files_deleted);
+                    } else {
+                        printf("[UART] PURGE failed: %s\n", esp_err_to_name(ret));
+                    }
+                } else {
+                    printf("[UART] Usage: PURGE:BEFORE:T (T > 0, seconds) or PURGE:FIELD:P:V (schema field, raw value)\n");
+                }
+            }
+            // BATCH:N:T
+            else if (strncmp(buffer, "BATCH:", 6) == 0) {
+                char *colon = strchr(buffer + 6, ':');
+                uint32_t n = strtoul(buffer + 6, NULL, 10);
+                uint32_t t = colon ? strtoul(colon + 1, NULL, 10) : 0;
+                if (outbox_set_batch(n, t) == ESP_OK) {
+                    printf("[UART] MQTT batch: up to %lu records, max age %lu s\n", n, t);
+                } else {
+                    printf("[UART] Usage: BATCH:N:T (N = 1..%d records, T seconds)\n", OUTBOX_BATCH_MAX);
+                }
+            }
+            // FORMAT:JSON / FORMAT:CBOR
+            else if (strcmp(buffer, "FORMAT:JSON") == 0) {
+                outbox_set_format(OUTBOX_FORMAT_JSON);
+                printf("[UART] MQTT payload: JSON on %s\n", OUTBOX_TOPIC);
+            }
+            else if (strcmp(buffer, "FORMAT:CBOR") == 0) {
+                outbox_set_format(OUTBOX_FORMAT_CBOR);
+                printf("[UART] MQTT payload: CBOR on %s\n", OUTBOX_TOPIC_CBOR);
+            }
+            // BENCH:JSON[:N]
+            else if (strncmp(buffer, "BENCH:JSON", 10) == 0) {
+                uint32_t n = buffer[10] == ':' ? strtoul(buffer + 11, NULL, 10) : 1000;
+                payload_bench_run(n);
+            }
+            // BENCH:OW[:N]
+            else if (strncmp(buffer, "BENCH:OW", 8) == 0) {
+                uint32_t n = buffer[8] == ':' ? strtoul(buffer + 9, NULL, 10) : 500;
+                onewire_bench_run(&ow, ow_mutex, n);
+            }
+            // BENCH:PH[:N]
+            else if (strncmp(buffer, "BENCH:PH", 8) == 0) {
+                uint32_t n = buffer[8] == ':' ? strtoul(buffer + 9, NULL, 10) : 50;
+                ph_bench_run(&ph_sensor, n);
+            }
+            // PH:SCHED:I:S
+            else if (strncmp(buffer, "PH:SCHED:", 9) == 0) {
+                // Skrót do kanału PH tabeli harmonogramu (faza zostaje, jeśli mieści się w okresie).
+                // Bez S zostaje dotychczasowy czas ustalania się - też musi być krótszy niż I
+                char *colon = strchr(buffer + 9, ':');
+                uint32_t interval = strtoul(buffer + 9, NULL, 10);
+                uint32_t settle = colon ? strtoul(colon + 1, NULL, 10) : schedtab_ph_settle();
+                esp_err_t ret = schedtab_set_ph(interval, settle);
+                if (ret == ESP_ERR_INVALID_ARG) {
+                    printf("[UART] Usage: PH:SCHED:I:S (I = 0 off or %d..%d s, 0 < S < I, S <= %d s)\n",
+                           SCHEDTAB_MIN_PERIOD_SEC, SCHEDTAB_MAX_PERIOD_SEC, SCHEDTAB_SETTLE_MAX_SEC);
+                } else if (ret != ESP_OK) {
+                    printf("[UART] PH:SCHED failed: %s\n", esp_err_to_name(ret));
+                } else {
+                    xTaskNotify(scheduler.task, SCHED_NOTIFY_UPDATE, eSetBits);
+                    if (interval) {
+                        printf("[UART] pH sampling every %lu s, %lu s after pump switch\n",
+                               interval, settle);
+                    } else {
+                        printf("[UART] pH sampling off (button only)\n");
+                    }
+                }
+            }
+            // DS18:SCAN
+            else if (strcmp(buffer, "DS18:SCAN") == 0) {
+                xSemaphoreTake(ow_mutex, portMAX_DELAY);
+                int n = ds18_init(&ow, true);
+                xSemaphoreGive(ow_mutex);
+                printf("[UART] DS18B20: %d probe(s) found, table stored in NVS\n", n);
+            }
+            // DS18:RES:I:B
+            else if (strncmp(buffer, "DS18:RES:", 9) == 0) {
+                char *colon = strchr(buffer + 9, ':');
+                int index = atoi(buffer + 9);
+                int bits = colon ? atoi(colon + 1) : 0;
+                xSemaphoreTake(ow_mutex, portMAX_DELAY);
+                esp_err_t ret = ds18_set_resolution(&ow, index, (uint8_t)bits);
+                xSemaphoreGive(ow_mutex);
+                if (ret == ESP_OK) {
+                    printf("[UART] DS18B20 probe %d: %d bit (conversion %lu ms)\n",
+                           index, bits, ds18_conversion_time_ms());
+                } else {
+                    printf("[UART] Usage: DS18:RES:I:B (I = 0..%d, B = 9..12): %s\n",
+                           ds18_get_device_count() - 1, esp_err_to_name(ret));
+                }
             }
             else {
                 printf("[UART] Unknown command: %s\n", buffer);
@@ -276,30 +806,88 @@ static void relay_timer_task(void *arg)
      * Zadanie obsługuje cykliczne włączanie/wyłączanie przekaźnika
      * Parametry ustawiają się w uart_command_handler
      * Pętla odpala się po każdym odebraniu komendy R1:TIME lub R2:TIME
+     * Przełączenie i sprawdzenie active pod relay_mutex: R1:OFF / R1:ON albo
+     * brak wody w trakcie cyklu nie zostaną nadpisane przez pętlę.
      */
     while (1) {
-        if (relay_timer.active) {
-            if (relay_timer.relay_id == 1) {
+        xSemaphoreTake(relay_mutex, portMAX_DELAY);
+        relay_timer_t cycle = relay_timer;
+        if (cycle.active) {
+            if (cycle.relay_id == 1) {
                 relay_set_relay1_on();
-            } else if (relay_timer.relay_id == 2) {
+            } else if (cycle.relay_id == 2) {
                 relay_set_relay2_on();
             }
-            
-            vTaskDelay(pdMS_TO_TICKS(relay_timer.on_ms));
-            
-            if (relay_timer.relay_id == 1) {
-                relay_set_relay1_off();
-            } else if (relay_timer.relay_id == 2) {
-                relay_set_relay2_off();
+        }
+        xSemaphoreGive(relay_mutex);
+
+        if (cycle.active) {
+            vTaskDelay(pdMS_TO_TICKS(cycle.on_ms));
+
+            // Zatrzymana pętla: przekaźnik już ustawił ten, kto ją zatrzymał
+            xSemaphoreTake(relay_mutex, portMAX_DELAY);
+            if (relay_timer.active) {
+                if (cycle.relay_id == 1) {
+                    relay_set_relay1_off();
+                } else if (cycle.relay_id == 2) {
+                    relay_set_relay2_off();
+                }
             }
-            
+            xSemaphoreGive(relay_mutex);
+
             printf("[RELAY_TIMER] Relay %d: ON %ldms, OFF %ldms (next cycle)\n",
-                   relay_timer.relay_id, relay_timer.on_ms, relay_timer.off_ms);
-            
-            vTaskDelay(pdMS_TO_TICKS(relay_timer.off_ms));
+                   cycle.relay_id, cycle.on_ms, cycle.off_ms);
+
+            vTaskDelay(pdMS_TO_TICKS(cycle.off_ms));
+        } else {
+            // Czekaj na R1:TIME (powiadomienie) zamiast odpytywać co 100 ms
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+    }
+}
+
+/* ============================================================================
+ * ZDARZENIA CZUJNIKA POZIOMU WODY
+ * ============================================================================ */
+
+static void level_event_task(void *arg)
+{
+    /**
+     * Budzi się tylko przy zmianie stanu po deboucingu (level.c). Brak wody
+     * zatrzymuje pompę (R1) i jej pętlę R1:TIME - ponowne włączenie ręcznie.
+     * Stan trafia też do każdego rekordu (flaga LEVEL) i na LEVEL_TOPIC.
+     */
+    QueueHandle_t events = arg;
+    level_event_t evt;
+
+    while (1) {
+        if (xQueueReceive(events, &evt, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+
+        if (evt.state) {
+            ESP_LOGI(TAG, "Water level: water detected");
         } else {
-            // Czekaj jeśli pętla nie jest aktywna
-            vTaskDelay(pdMS_TO_TICKS(100));
+            ESP_LOGW(TAG, "Water level: tank empty");
+            xSemaphoreTake(relay_mutex, portMAX_DELAY);
+            if (relay_timer.active && relay_timer.relay_id == 1) {
+                relay_timer.active = false;
+            }
+            bool pump_on = relay_get_relay1_state();
+            if (pump_on) {
+                relay_set_relay1_off();
+            }
+            xSemaphoreGive(relay_mutex);
+            if (pump_on) {
+                printf("[LEVEL] Low water - pump (relay 1) stopped\n");
+            }
+        }
+
+        if (mqtt_is_connected()) {
+            char msg[64];
+            int len = snprintf(msg, sizeof(msg), "{\"level\":%u,\"uptime_ms\":%lld}",
+                               evt.state, evt.time_us / 1000);
+            mqtt_publish_qos0(LEVEL_TOPIC, msg, len);
         }
     }
 }
@@ -310,6 +898,8 @@ static void relay_timer_task(void *arg)
 
 static void IRAM_ATTR ph_button_isr_handler(void *arg)
 {
+    /* Przerwanie poziomem (budzi z light sleep): wyłącz do puszczenia przycisku */
+    gpio_intr_disable(PH_BUTTON_GPIO);
     /* Minimalistyczne: prześlij zdarzenie do kolejki */
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
     uint32_t event = 1;
@@ -322,35 +912,20 @@ static void IRAM_ATTR ph_button_isr_handler(void *arg)
 static void ph_button_task(void *arg)
 {
     uint32_t event;
-    uint32_t debounce_timestamp = 0;
-    const uint32_t debounce_ticks = pdMS_TO_TICKS(PH_DEBOUNCE_MS);
 
     while (1) {
         if (xQueueReceive(ph_measurement_queue, &event, portMAX_DELAY)) {
-            uint32_t current_ticks = xTaskGetTickCount();
-
-            // Debouncing: zignoruj jeśli mniej niż PH_DEBOUNCE_MS od ostatniego zdarzenia
-            if (current_ticks - debounce_timestamp < debounce_ticks) {
-                continue;
-            }
-            debounce_timestamp = current_ticks;
-
             ESP_LOGI(TAG, "pH button pressed - initiating manual measurement");
-
-            // Odczyt pH z ADC
-            // Załóżmy temperaturę na podstawie ostatniej wartości DHT
-            float temperature = isnan(current_measurement.temperature_dht) ? 25.0f : current_measurement.temperature_dht;
-            
-            esp_err_t ret = ph_sensor_read_adc(&ph_sensor, ADC1_CHANNEL_0, temperature, &current_measurement.ph);
-            if (ret == ESP_OK) {
-                last_manual_ph_value = current_measurement.ph;
-                ph_measurement_pending = true;
-                xSemaphoreGive(ph_measurement_semaphore);
-                printf("[pH] Manual measurement captured: %.2f\n", current_measurement.ph);
+            if (ph_take_sample("Manual", NAN) == ESP_OK) {
                 printf("[pH] Ready for next data block.\n");
-            } else {
-                ESP_LOGW(TAG, "pH measurement failed: %s", esp_err_to_name(ret));
             }
+
+            // Debouncing: przerwanie wraca po puszczeniu i PH_DEBOUNCE_MS ciszy
+            while (gpio_get_level(PH_BUTTON_GPIO) == 0) {
+                vTaskDelay(pdMS_TO_TICKS(PH_DEBOUNCE_MS));
+            }
+            vTaskDelay(pdMS_TO_TICKS(PH_DEBOUNCE_MS));
+            gpio_intr_enable(PH_BUTTON_GPIO);
         }
     }
 }
@@ -362,10 +937,11 @@ static void ph_button_task(void *arg)
 // Forward declarations
 static void init_uart(void);
 static void init_i2c(void);
-static void init_sensors(void);
+static void init_sensors(bool cold_start);
 static void init_relay(void);
 static void init_wifi_mqtt(void);
 static void init_sdcard(void);
+static void init_power_management(void);
 
 static void init_uart(void)
 {
@@ -379,7 +955,8 @@ static void init_uart(void)
 
     ESP_ERROR_CHECK(uart_param_config(UART_NUM, &uart_config));
     ESP_ERROR_CHECK(uart_set_pin(UART_NUM, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE));
-    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, UART_RX_BUF_SIZE, UART_TX_BUF_SIZE, 0, NULL, 0));
+    ESP_ERROR_CHECK(uart_driver_install(UART_NUM, UART_RX_BUF_SIZE, UART_TX_BUF_SIZE,
+                                        UART_QUEUE_SIZE, &uart_queue, 0));
 
     // Przedmontuj UART na stdout (aby printf działał)
     esp_vfs_dev_uart_use_driver(UART_NUM);
@@ -390,37 +967,45 @@ static void init_uart(void)
 
 static void init_i2c(void)
 {
-    i2c_dev_t i2c_dev = {
-        .port = I2C_NUM_0,
-        .addr = 0x23,  // Domyślny adres BH1750
-        .cfg = {
-            .sda_io_num = I2C_SDA_GPIO,
-            .scl_io_num = I2C_SCL_GPIO,
-            .master.clk_speed = I2C_FREQ
-        }
-    };
-
     ESP_ERROR_CHECK(i2cdev_init());
-    bh1750_dev = i2c_dev;
+    // Stały deskryptor BH1750 (z mutexem) na cały czas pracy
+    ESP_ERROR_CHECK(bh1750_init_desc(&bh1750_dev, BH1750_ADDR_LO, I2C_NUM_0, I2C_SDA_GPIO, I2C_SCL_GPIO));
+    bh1750_dev.cfg.master.clk_speed = I2C_FREQ;
     ESP_LOGI(TAG, "I2C initialized");
 }
 
-static void init_sensors(void)
+/**
+ * cold_start = false: wybudzenie z deep sleep - bez ruchu na magistralach,
+ * który nie jest potrzebny przed pierwszym odczytem (rozdzielczość sond,
+ * próbny odczyt DHT22, ustawianie RTC)
+ */
+static void init_sensors(bool cold_start)
 {
-    // DS18B20 (OneWire)
+    // DS18B20 (OneWire): tablica sond z NVS, przy pierwszym starcie wyszukiwanie ROM
     onewire_init(&ow, ONEWIRE_GPIO);
-    ESP_LOGI(TAG, "DS18B20 OneWire initialized");
-
-    // DHT22
-    esp_err_t ret = dht22_read(&current_measurement.temperature_dht, &current_measurement.humidity);
+    ow_mutex = xSemaphoreCreateMutex();
+    int probes = cold_start ? ds18_init(&ow, false) : ds18_resume(&ow);
+    ESP_LOGI(TAG, "DS18B20 OneWire initialized (%s backend, %d probes)", onewire_backend_name(), probes);
+
+    // DHT22 (odbiornik RMT); próbny odczyt tylko przy zimnym starcie - blok
+    // po wybudzeniu czyta od razu, a DHT22 wymaga 2 s między odczytami
+    esp_err_t ret = dht22_init();
+    if (ret == ESP_OK && cold_start) {
+        ret = dht22_read(&current_measurement.temperature_dht, &current_measurement.humidity);
+    }
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "DHT22 initialized successfully");
     } else {
         ESP_LOGW(TAG, "DHT22 initialization warning: %s", esp_err_to_name(ret));
     }
 
-    // BH1750 (light sensor)
-    // Inicjalizacja specyficzna dla BH1750 - załóżmy, że moduł to zapewnia
+    // BH1750 (light sensor): power-down do pierwszego bloku pomiarowego
+    ret = light_init(&bh1750_dev);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "BH1750 initialized");
+    } else {
+        ESP_LOGW(TAG, "BH1750 initialization warning: %s", esp_err_to_name(ret));
+    }
 
     // pH Sensor
     ret = ph_sensor_init(&ph_sensor);
@@ -430,36 +1015,53 @@ static void init_sensors(void)
         ESP_LOGW(TAG, "pH sensor initialization failed: %s", esp_err_to_name(ret));
     }
 
-    // DS1302 (RTC)
+    // DS1302 (RTC); po deep sleep zegar systemowy biegł dalej - tylko korekta
     ds1302_init();
-    ds1302_set_compile_time();  // Ustaw czas kompilacji (jeśli brak baterii)
-    ESP_LOGI(TAG, "DS1302 RTC initialized");
+    if (cold_start) {
+        ds1302_set_compile_time();  // Ustaw czas kompilacji (jeśli brak baterii)
+        ESP_LOGI(TAG, "DS1302 RTC initialized");
+        ret = sysclock_init();
+    } else {
+        ret = sysclock_resume();
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "System clock from RTC failed: %s", esp_err_to_name(ret));
+    }
 
-    // Level sensor (opcjonalnie - wyłączony ze względu na stack overflow)
-    level_sensor_init();
-    // level_sensor_start_task();
-    // ESP_LOGI(TAG, "Level sensor initialized");
+    // Level sensor (przerwanie + esp_timer, bez zadania odpytującego)
+    ret = level_sensor_init();
+    if (ret == ESP_OK) {
+        level_ok = true;
+        level_event_queue = level_sensor_subscribe();
+        ESP_LOGI(TAG, "Level sensor initialized");
+    } else {
+        ESP_LOGW(TAG, "Level sensor initialization failed: %s", esp_err_to_name(ret));
+    }
 }
 
 static void init_relay(void)
 {
+    relay_mutex = xSemaphoreCreateMutex();
     relay_init();
     relay_buttons_init();
     ESP_LOGI(TAG, "Relays and buttons initialized");
 }
 
-static void init_wifi_mqtt(void)
+static void init_nvs(void)
 {
-    // Inicjalizacja NVS (wymagana dla WiFi)
+    // Inicjalizacja NVS (WiFi, tablica sond DS18B20)
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
         ESP_ERROR_CHECK(nvs_flash_erase());
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+}
 
+static void init_wifi_mqtt(void)
+{
     // WiFi
-    ret = wifi_init_sta(WIFI_SSID, WIFI_PASSWORD);
+    esp_err_t ret = wifi_init_sta(WIFI_SSID, WIFI_PASSWORD);
     if (ret != ESP_OK) {
         ESP_LOGW(TAG, "WiFi initialization failed: %s", esp_err_to_name(ret));
     } else {
@@ -482,7 +1084,72 @@ static void init_sdcard(void)
         ESP_LOGW(TAG, "SD card initialization failed: %s", esp_err_to_name(ret));
     } else {
         ESP_LOGI(TAG, "SD card initialized and mounted at /sdcard");
+        sensor_sdcard_set_durability(SD_COMMIT_MAX_RECORDS, SD_COMMIT_MAX_AGE_SEC);
+
+        // Obetnij ogon uszkodzony zanikiem zasilania i wznów numerację seq
+        sensor_binlog_recover(SD_DATA_DIR, NULL);
+
+        // Stary plik JSON -> log binarny, jednorazowo (po sukcesie zostaje jako .OLD)
+        const char *legacy[] = { SD_LEGACY_FILE_83, SD_LEGACY_FILE };
+        for (size_t i = 0; i < sizeof(legacy) / sizeof(legacy[0]); i++) {
+            ret = sensor_json_migrate(legacy[i], SD_DATA_DIR, NULL);
+            if (ret != ESP_OK && ret != ESP_ERR_NOT_FOUND) {
+                ESP_LOGW(TAG, "SD data file migration failed: %s", esp_err_to_name(ret));
+            }
+        }
+
+        logstore_retention_t retention = {
+            .downsample_age_sec = SD_DOWNSAMPLE_AFTER_DAYS * SECONDS_PER_DAY,
+            .bucket_sec = SD_DOWNSAMPLE_SEC,
+            .delete_age_sec = SD_DELETE_AFTER_DAYS * SECONDS_PER_DAY,
+        };
+        storage_set_retention(&retention);
+
+        // Outbox MQTT: publikacja z logu od kursora ostatniego PUBACK
+        ret = outbox_init(SD_DATA_DIR);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "MQTT outbox init failed: %s", esp_err_to_name(ret));
+        } else {
+            outbox_set_batch(MQTT_BATCH_RECORDS, MQTT_BATCH_MAX_AGE_SEC);
+            outbox_set_format(MQTT_PAYLOAD_FORMAT);
+        }
+
+        // Od tej chwili kartę obsługuje wyłącznie zadanie zapisu
+        ret = storage_start(SD_DATA_DIR, SD_OVERFLOW_POLICY);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Storage task start failed: %s", esp_err_to_name(ret));
+        }
+    }
+}
+
+/**
+ * Automatyczny light sleep między zdarzeniami. Budzą: timery (esp_timer,
+ * FreeRTOS), Wi-Fi (DTIM), RX konsoli UART i przerwania poziomem z GPIO
+ * (przycisk pH, czujnik poziomu - gpio_wakeup_enable).
+ */
+static void init_power_management(void)
+{
+#if CONFIG_PM_ENABLE
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = PM_MAX_FREQ_MHZ,
+        .min_freq_mhz = PM_MIN_FREQ_MHZ,
+#if CONFIG_FREERTOS_USE_TICKLESS_IDLE
+        .light_sleep_enable = true,
+#endif
+    };
+    esp_err_t err = esp_pm_configure(&pm_config);
+    if (err == ESP_OK) err = uart_set_wakeup_threshold(UART_NUM, UART_WAKEUP_THRESHOLD);
+    if (err == ESP_OK) err = esp_sleep_enable_uart_wakeup(UART_NUM);
+    if (err == ESP_OK) err = esp_sleep_enable_gpio_wakeup();
+    if (err == ESP_OK) {
+        ESP_LOGI(TAG, "Power management: %d..%d MHz, light sleep %s", PM_MIN_FREQ_MHZ, PM_MAX_FREQ_MHZ,
+                 pm_config.light_sleep_enable ? "enabled" : "disabled (no tickless idle)");
+    } else {
+        ESP_LOGW(TAG, "Power management setup failed: %s", esp_err_to_name(err));
     }
+#else
+    ESP_LOGI(TAG, "Power management disabled (CONFIG_PM_ENABLE not set)");
+#endif
 }
 
 /* ============================================================================
@@ -490,177 +1157,593 @@ static void init_sdcard(void)
  * ============================================================================ */
 
 /**
- * Odczytaj wszystkie sensory i uaktualnij strukturę measurement_block_t
+ * Próbka pH kanału PH. Podczas pracy pompy i przez schedtab_ph_settle() s po jej
+ * przełączeniu przepływ i mieszanie zaburzają odczyt - kanał jest odraczany
+ * (ponowna próba za PH_DEFER_RETRY_SEC). Pompa w pętli R1:TIME z krótkim
+ * cyklem mogłaby go blokować bez końca, więc po odroczeniu dłuższym niż okres
+ * kanału mierzymy mimo to. changed_us == 0: przekaźnik nie przełączany od
+ * startu (po deep sleep stoi w OFF).
+ * @return false = próbka odroczona
  */
-static void read_all_sensors(void)
+static bool ph_scheduled_sample(float water_temperature)
 {
-    ESP_LOGI(TAG, "=== Starting measurement block ===");
+    int64_t changed_us = relay_get_relay1_changed_us();
+    bool pump_busy = relay_get_relay1_state() ||
+                     (changed_us && esp_timer_get_time() - changed_us < (int64_t)schedtab_ph_settle() * 1000000);
+    uint32_t now = sysclock_now_unix();
+    if (pump_busy) {
+        if (!scheduler.ph_deferred_since) {
+            scheduler.ph_deferred_since = now;
+            ESP_LOGI(TAG, "pH sample deferred - pump %s", relay_get_relay1_state() ? "on" : "settling");
+        }
+        if (now - scheduler.ph_deferred_since < schedtab_get(SCHEDTAB_PH).period_sec) {
+            return false;
+        }
+        ESP_LOGW(TAG, "pH sample taken despite pump activity (deferred %lu s)",
+                 now - scheduler.ph_deferred_since);
+    }
+    scheduler.ph_deferred_since = 0;
+    // Błąd próbki nie odracza kanału: następna próba w kolejnym terminie
+    ph_take_sample("Scheduled", water_temperature);
+    return true;
+}
 
-    // 1. DS18B20 - Temperatura
-    ds18_request_temperatures(&ow);
-    vTaskDelay(pdMS_TO_TICKS(750));  // Czekaj na konwersję temperatury
-    current_measurement.temperature_ds18 = ds18_get_temp_c_by_index(&ow, 0);
-    ESP_LOGI(TAG, "DS18B20 Temp: %.2f°C", current_measurement.temperature_ds18);
+/**
+ * Odczytaj czujniki kanałów z maski (1 << SCHEDTAB_*) i uaktualnij strukturę
+ * measurement_block_t. Pola kanałów spoza maski zostają z poprzedniego
+ * odczytu (STATUS), w rekordzie są puste (encode_measurement).
+ * @return kanały obsłużone: maska bez PH, gdy próbkę odroczyła pompa
+ */
+static uint32_t read_all_sensors(uint32_t mask)
+{
+    ESP_LOGI(TAG, "=== Starting measurement block ===");
+    uint32_t served = mask;
+    bool water = mask & (1u << SCHEDTAB_WATER);
+    bool air = mask & (1u << SCHEDTAB_AIR);
+    bool light = mask & (1u << SCHEDTAB_LIGHT);
+
+    // 1. DS18B20 - start konwersji na wszystkich sondach; wyniki odbieramy na
+    //    końcu, a w oknie konwersji (94..750 ms) czytamy pozostałe czujniki
+    bool ds18_started = false;
+    if (water) {
+        xSemaphoreTake(ow_mutex, portMAX_DELAY);
+        ds18_started = ds18_request_temperatures(&ow);
+        if (!ds18_started) {
+            ESP_LOGW(TAG, "DS18B20: no presence pulse");
+        }
+    }
+    // BH1750 - integracja (do ~660 ms przy MTreg 254) też biegnie w tle
+    esp_err_t light_ret = light ? light_start() : ESP_OK;
 
     // 2. DHT22 - Temperatura i wilgotność
-    esp_err_t ret = dht22_read(&current_measurement.temperature_dht, &current_measurement.humidity);
-    if (ret == ESP_OK) {
-        ESP_LOGI(TAG, "DHT22 Temp: %.2f°C, Humidity: %.2f%%", 
-                 current_measurement.temperature_dht, current_measurement.humidity);
-    } else {
-        ESP_LOGW(TAG, "DHT22 read failed: %s", esp_err_to_name(ret));
-        current_measurement.temperature_dht = NAN;
-        current_measurement.humidity = NAN;
+    if (air) {
+        esp_err_t ret = dht22_read(&current_measurement.temperature_dht, &current_measurement.humidity);
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "DHT22 Temp: %.2f°C, Humidity: %.2f%%", 
+                     current_measurement.temperature_dht, current_measurement.humidity);
+        } else {
+            ESP_LOGW(TAG, "DHT22 read failed: %s", esp_err_to_name(ret));
+            current_measurement.temperature_dht = NAN;
+            current_measurement.humidity = NAN;
+        }
     }
 
-    // 3. BH1750 - Natężenie światła
-    // Załóżmy, że bh1750_read_lux() jest funkcją w module bh1750
-    // current_measurement.light = bh1750_read_lux(&bh1750_dev);
-    current_measurement.light = 500.0f;  // Placeholder
-    ESP_LOGI(TAG, "BH1750 Light: %.2f lux", current_measurement.light);
+    // 3. BH1750 - Natężenie światła (odbiór wyniku, dobór zakresu na następny blok)
+    if (light) {
+        if (light_ret == ESP_OK) {
+            light_ret = light_read(&current_measurement.light);
+        }
+        if (light_ret == ESP_OK) {
+            ESP_LOGI(TAG, "BH1750 Light: %.2f lux", current_measurement.light);
+        } else {
+            ESP_LOGW(TAG, "BH1750 read failed: %s", esp_err_to_name(light_ret));
+            current_measurement.light = NAN;
+        }
+    }
 
-    // 4. pH - Użyj ostatniej zmierzonej wartości
-    if (ph_measurement_pending) {
-        // Użyj wartości zmierzonej manualnie
-        ph_measurement_pending = false;
-    } else {
-        // Użyj ostatniej znanej wartości
-        current_measurement.ph = last_manual_ph_value;
+    // 1b. DS18B20 - odbiór wyników, gdy sondy zgłoszą koniec konwersji
+    if (water) {
+        int probes = ds18_get_device_count();
+        current_measurement.probe_count = probes > 0 ? probes : 1;
+        if (ds18_started) {
+            int64_t wait_start = esp_timer_get_time();
+            uint32_t timeout_ms = ds18_conversion_time_ms() + DS18_CONVERSION_MARGIN_MS;
+            if (!ds18_wait_conversion(&ow, timeout_ms)) {
+                ESP_LOGW(TAG, "DS18B20: conversion still busy after %lu ms", timeout_ms);
+            }
+            ESP_LOGD(TAG, "DS18B20: waited %lld ms for conversion", (esp_timer_get_time() - wait_start) / 1000);
+        }
+        for (int i = 0; i < current_measurement.probe_count; i++) {
+            current_measurement.temperature_probes[i] = ds18_started ? ds18_get_temp_c_by_index(&ow, i) : NAN;
+            ESP_LOGI(TAG, "DS18B20 probe %d Temp: %.2f°C", i, current_measurement.temperature_probes[i]);
+        }
+        xSemaphoreGive(ow_mutex);
+        current_measurement.temperature_ds18 = current_measurement.temperature_probes[0];
     }
-    ESP_LOGI(TAG, "pH (manual): %.2f", current_measurement.ph);
 
-    // 5. RTC - Timestamp
+    // 4. pH - próbka kanału PH (po zwolnieniu 1-Wire: bez WATER czyta temperaturę
+    //    sam), potem ostatnia próbka; świeża tylko w pierwszym bloku po jej pobraniu
+    if ((mask & (1u << SCHEDTAB_PH)) &&
+        !ph_scheduled_sample(water ? current_measurement.temperature_ds18 : NAN)) {
+        served &= ~(1u << SCHEDTAB_PH);
+    }
+    portENTER_CRITICAL(&ph_mux);
+    current_measurement.ph = last_ph_value;
+    current_measurement.ph_fresh = ph_sample_fresh;
+    ph_sample_fresh = false;
+    portEXIT_CRITICAL(&ph_mux);
+    ESP_LOGI(TAG, "pH: %.2f (%s)", current_measurement.ph, current_measurement.ph_fresh ? "fresh" : "repeated");
+
+    // 5. RTC - Timestamp (zegar systemowy dyscyplinowany przez DS1302)
     ds1302_time_t rtc_time;
-    ds1302_get_time(&rtc_time);
+    sysclock_get_time(&rtc_time);
     
     snprintf(current_measurement.rtc_string, sizeof(current_measurement.rtc_string),
              "%04d-%02d-%02d %02d:%02d:%02d",
              rtc_time.year, rtc_time.month, rtc_time.day,
              rtc_time.hour, rtc_time.min, rtc_time.sec);
     
-    // Uproszczona konwersja Unix timestamp (w rzeczywistości trzeba dokładniej)
-    current_measurement.timestamp_unix = time(NULL);
+    current_measurement.timestamp_unix = ds1302_time_to_unix(&rtc_time);
 
     ESP_LOGI(TAG, "RTC Time: %s", current_measurement.rtc_string);
+    return served;
 }
 
 /**
- * Zapisz blok pomiarowy na kartę SD w formacie NDJSON
+ * Zakoduj blok pomiarowy raz do rekordu binarnego z puli recbuf (jeden schemat:
+ * logrec.h). Ten sam rekord trafia na kartę SD i do MQTT (outbox) bez kopiowania
+ * i ponownego formatowania z current_measurement. Kanały spoza maski (nie
+ * czytane w tym bloku) mają pola NA; pH zawsze z ostatnią próbką i flagą świeżości.
  */
-static void save_measurement_to_sd(void)
-{
-    // Przygotuj JSON
-    char json_line[512];
-    int len = snprintf(json_line, sizeof(json_line),
-        "{\"timestamp\":\"%s\",\"temp_ds18\":%.2f,\"temp_dht\":%.2f,\"humidity\":%.2f,\"light\":%.2f,\"ph\":%.2f}\n",
-        current_measurement.rtc_string,
-        current_measurement.temperature_ds18,
-        current_measurement.temperature_dht,
-        current_measurement.humidity,
-        current_measurement.light,
-        current_measurement.ph);
-
-    if (len > 0 && len < (int)sizeof(json_line)) {
-        esp_err_t ret = sensor_json_append(SD_DATA_FILE, "measurement", 1.0, current_measurement.rtc_string);
-        if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "Measurement saved to SD: %s", json_line);
-        } else {
-            ESP_LOGW(TAG, "SD save failed: %s", esp_err_to_name(ret));
-        }
+static logrec_t *encode_measurement(uint32_t mask)
+{
+    logrec_t *rec = recbuf_alloc();
+    if (!rec) return NULL;
+    bool water = mask & (1u << SCHEDTAB_WATER);
+    bool air = mask & (1u << SCHEDTAB_AIR);
+
+    rec->timestamp = current_measurement.timestamp_unix;
+    rec->temp_ds18 = water ? logrec_pack_i16(current_measurement.temperature_ds18, 100.0f) : LOGREC_NA_I16;
+    for (int i = 0; i < LOGREC_PROBES; i++) {
+        rec->temp_probe[i] = water && i < current_measurement.probe_count
+                           ? logrec_pack_i16(current_measurement.temperature_probes[i], 100.0f)
+                           : LOGREC_NA_I16;
     }
+    rec->temp_dht = air ? logrec_pack_i16(current_measurement.temperature_dht, 100.0f) : LOGREC_NA_I16;
+    rec->humidity = air ? logrec_pack_u16(current_measurement.humidity, 100.0f) : LOGREC_NA_U16;
+    rec->ph = logrec_pack_u16(current_measurement.ph, 100.0f);
+    rec->light = mask & (1u << SCHEDTAB_LIGHT) ? logrec_pack_u32(current_measurement.light, 100.0f)
+                                               : LOGREC_NA_U32;
+
+    if (relay_get_relay1_state()) rec->flags |= LOGREC_FLAG_RELAY1;
+    if (relay_get_relay2_state()) rec->flags |= LOGREC_FLAG_RELAY2;
+    if (level_ok) {
+        rec->flags |= LOGREC_FLAG_LEVEL_VALID;
+        if (level_sensor_has_water()) rec->flags |= LOGREC_FLAG_LEVEL;
+    }
+    rec->flags |= LOGREC_FLAG_PH_FRESH_VALID;
+    if (current_measurement.ph_fresh) rec->flags |= LOGREC_FLAG_PH_FRESH;
+    // Spójna kopia relay_timer (UART zmienia go pod relay_mutex). Ścieżka
+    // duty_cycle_wake nie woła init_relay(), więc mutexu może nie być.
+    relay_timer_t cycle;
+    if (relay_mutex) xSemaphoreTake(relay_mutex, portMAX_DELAY);
+    cycle = relay_timer;
+    if (relay_mutex) xSemaphoreGive(relay_mutex);
+    if (cycle.active && cycle.relay_id == 1) {
+        rec->flags |= LOGREC_FLAG_RELAY1_CYCLE;
+        rec->relay1_on_ms = cycle.on_ms;
+        rec->relay1_off_ms = cycle.off_ms;
+    }
+    if (cycle.active && cycle.relay_id == 2) rec->flags |= LOGREC_FLAG_RELAY2_CYCLE;
+    return rec;
 }
 
 /**
- * Publikuj dane na MQTT
+ * Przekaż rekord do zadania zapisu na kartę SD (64 B zamiast ~250 B JSON).
+ * Nie czeka na kartę. Zapisany rekord (z nadanym seq) wysyła na MQTT outbox.
  */
-static void publish_to_mqtt(void)
+static esp_err_t save_measurement_to_sd(logrec_t *rec)
 {
-    char payload[768];
-    const char *relay1_mode = relay_timer.active && relay_timer.relay_id == 1 ? "cycle" : "manual";
-    const char *relay2_mode = relay_timer.active && relay_timer.relay_id == 2 ? "cycle" : "manual";
-    
-    int len = snprintf(payload, sizeof(payload),
-        "{\"timestamp\":\"%s\",\"temp_ds18\":%.2f,\"temp_dht\":%.2f,\"humidity\":%.2f,\"light\":%.2f,\"ph\":%.2f,"
-        "\"relay1\":%s,\"relay1_mode\":\"%s\",\"relay1_on_ms\":%lu,\"relay1_off_ms\":%lu,"
-        "\"relay2\":%s,\"relay2_mode\":\"%s\"}",
-        current_measurement.rtc_string,
-        current_measurement.temperature_ds18,
-        current_measurement.temperature_dht,
-        current_measurement.humidity,
-        current_measurement.light,
-        current_measurement.ph,
-        relay_get_relay1_state() ? "true" : "false",
-        relay1_mode,
-        relay_timer.relay_id == 1 ? relay_timer.on_ms : 0,
-        relay_timer.relay_id == 1 ? relay_timer.off_ms : 0,
-        relay_get_relay2_state() ? "true" : "false",
-        relay2_mode);
-
-    if (len > 0 && len < (int)sizeof(payload)) {
-        bool ret = mqtt_publish("das_tower/measurements", payload);
-        if (ret) {
-            ESP_LOGI(TAG, "MQTT published successfully (R1:%s [%s], R2:%s [%s])", 
-                     relay_get_relay1_state() ? "ON" : "OFF", relay1_mode,
-                     relay_get_relay2_state() ? "ON" : "OFF", relay2_mode);
-        } else {
-            ESP_LOGW(TAG, "MQTT publish failed");
+    esp_err_t ret = storage_submit(rec);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Measurement queued for SD (%d bytes)", (int)sizeof(*rec));
+    } else {
+        ESP_LOGW(TAG, "SD queue failed: %s", esp_err_to_name(ret));
+    }
+    return ret;
+}
+
+/**
+ * Publikuj rekord na MQTT bezpośrednio (QoS 1) - tylko gdy brak karty SD
+ * i outbox nie działa. PUBACK nie trafia do outboxa; w trybie deep sleep
+ * liczy je duty_direct_ack_cb, zanim rekordy znikną z kolejki RTC. Ten sam
+ * format co outbox, ale bez seq (numer nadaje dopiero zapis do logu).
+ */
+static void publish_to_mqtt(const logrec_t *rec)
+{
+    static logrec_header_t direct_hdr;
+    if (direct_hdr.magic == 0) {
+        logrec_header_init(&direct_hdr, 0);
+        for (int i = 0; i < direct_hdr.field_count; i++) {
+            if (strncmp(direct_hdr.fields[i].name, "seq", LOGREC_NAME_LEN) == 0) {
+                memmove(&direct_hdr.fields[i], &direct_hdr.fields[i + 1],
+                        (direct_hdr.field_count - i - 1) * sizeof(logrec_field_t));
+                direct_hdr.field_count--;
+                break;
+            }
         }
     }
+
+    char payload[384];
+    int len = logrec_format_ndjson(&direct_hdr, rec, payload, sizeof(payload));
+    if (len < 0) return;
+
+    if (mqtt_publish_qos1(OUTBOX_TOPIC, payload, len) >= 0) {
+        ESP_LOGI(TAG, "MQTT published directly (R1:%s, R2:%s)",
+                 relay_get_relay1_state() ? "ON" : "OFF", relay_get_relay2_state() ? "ON" : "OFF");
+    } else {
+        ESP_LOGW(TAG, "MQTT publish failed");
+    }
 }
 
 /* ============================================================================
  * GŁÓWNE ZADANIE HARMONOGRAMU
  * ============================================================================ */
 
+/**
+ * Terminy wszystkich kanałów od nowa, ściśle po now (start, zmiana tabeli,
+ * przegapiony termin). Siatka od północy: te same godziny każdej doby.
+ * @return kanały włączone
+ */
+static uint32_t scheduler_reset_due(uint32_t now)
+{
+    uint32_t enabled = 0;
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        scheduler.channel_due[i] = schedtab_next_due(i, now);
+        if (scheduler.channel_due[i]) enabled |= 1u << i;
+    }
+    return enabled;
+}
+
+/**
+ * Po bloku: kanał obsłużony dostaje termin po swoim bieżącym (dołączony
+ * wcześniej niż termin nie traci go podwójnie) albo po now, gdy termin minął.
+ * PH odroczone przez pompę wraca za PH_DEFER_RETRY_SEC.
+ */
+static void scheduler_advance(uint32_t mask, uint32_t served, uint32_t now)
+{
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        if (served & (1u << i)) {
+            uint32_t due = scheduler.channel_due[i];
+            scheduler.channel_due[i] = schedtab_next_due(i, due > now ? due : now);
+        }
+    }
+    if ((mask & ~served) & (1u << SCHEDTAB_PH)) {
+        scheduler.channel_due[SCHEDTAB_PH] = now + PH_DEFER_RETRY_SEC;
+    }
+}
+
+// Najbliższy blok z terminów kanałów (0 = wszystkie wyłączone)
+static void scheduler_plan(void)
+{
+    scheduler.next_deadline = schedtab_plan(scheduler.channel_due, &scheduler.next_channels);
+}
+
+static void deadline_timer_cb(void *arg)
+{
+    xTaskNotify(scheduler.task, SCHED_NOTIFY_DEADLINE, eSetBits);
+}
+
+/**
+ * Blok pomiarowy kanałów z maski: odczyt, zapis, publikacja (z pomiarem czasu
+ * etapów). late_us = opóźnienie startu względem terminu (< 0: blok poza
+ * harmonogramem). Bez rekordu, gdy nic nie zmierzono (samo odroczone PH).
+ * @return kanały obsłużone (read_all_sensors)
+ */
+static uint32_t run_measurement_block(uint32_t mask, int64_t late_us)
+{
+    char channels[48];
+    schedtab_mask_str(mask, channels, sizeof(channels));
+    ESP_LOGI(TAG, "Time for measurement block! (%s)", channels);
+
+    int64_t t0 = esp_timer_get_time();
+    uint32_t served = read_all_sensors(mask);
+    if (served == 0) {
+        return 0;
+    }
+    int64_t t1 = esp_timer_get_time();
+    logrec_t *rec = encode_measurement(served);
+    esp_err_t stored = rec ? save_measurement_to_sd(rec) : ESP_ERR_NO_MEM;
+    int64_t t2 = esp_timer_get_time();
+    if (stored == ESP_ERR_INVALID_STATE) publish_to_mqtt(rec);
+    if (stored != ESP_OK) recbuf_unref(rec);  // Przy ESP_OK rekord należy do zadania zapisu
+    int64_t t3 = esp_timer_get_time();
+
+    block_timing.acquire_us = t1 - t0;
+    block_timing.store_us = t2 - t1;
+    block_timing.publish_us = t3 - t2;
+    if (block_timing.acquire_us > block_timing.max_acquire_us) block_timing.max_acquire_us = block_timing.acquire_us;
+    if (block_timing.store_us > block_timing.max_store_us) block_timing.max_store_us = block_timing.store_us;
+    if (block_timing.publish_us > block_timing.max_publish_us) block_timing.max_publish_us = block_timing.publish_us;
+    if (late_us >= 0) {
+        block_timing.late_us = late_us;
+        if (late_us > block_timing.max_late_us) block_timing.max_late_us = late_us;
+    }
+    block_timing.blocks++;
+    ESP_LOGI(TAG, "Block timing: acquire %lld ms, store %lld us, MQTT %lld ms",
+             block_timing.acquire_us / 1000, block_timing.store_us, block_timing.publish_us / 1000);
+    return served;
+}
+
 static void scheduler_task(void *arg)
 {
-    uint32_t last_measurement_time = 0;
-    uint32_t current_time_sec = 0;
+    /**
+     * Jeden jednorazowy esp_timer na termin: między blokami zadanie śpi bez
+     * budzenia co sekundę, a przy CONFIG_PM_ENABLE układ wchodzi w light sleep.
+     * Timer liczy czas monotoniczny, termin jest w czasie zegara (sysclock),
+     * więc korekta zegara może obudzić za wcześnie - wtedy uzbrajamy na resztę.
+     */
+    esp_timer_create_args_t timer_args = {
+        .callback = deadline_timer_cb,
+        .name = "sched_deadline",
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &scheduler.deadline_timer));
 
     // Czekaj na inicjalizację RTC
     vTaskDelay(pdMS_TO_TICKS(2000));
 
-    ESP_LOGI(TAG, "Scheduler task started. Measurement interval: %ld seconds", 
-             scheduler.measurement_interval_sec);
+    ESP_LOGI(TAG, "Scheduler task started");
+
+    // Pierwszy blok zaraz po starcie (wszystkie włączone kanały), kolejne w
+    // terminach kanałów wyrównanych do zegara
+    uint32_t enabled = scheduler_reset_due(sysclock_now_unix());
+    if (enabled) {
+        uint32_t served = run_measurement_block(enabled, -1);
+        scheduler_advance(enabled, served, sysclock_now_unix());
+    }
 
     while (1) {
-        // Odczytaj bieżący czas z RTC
-        ds1302_time_t rtc_time;
-        ds1302_get_time(&rtc_time);
-        
-        // Prosta konwersja na sekundy od północy
-        current_time_sec = rtc_time.hour * 3600 + rtc_time.min * 60 + rtc_time.sec;
+        scheduler_plan();
+        uint32_t deadline = scheduler.next_deadline;
+        uint32_t channels = scheduler.next_channels;
+        int64_t deadline_ns = (int64_t)deadline * 1000000000;
+        if (deadline) {
+            char names[48];
+            schedtab_mask_str(channels, names, sizeof(names));
+            ESP_LOGI(TAG, "Next measurement block at %02lu:%02lu:%02lu (%s)",
+                     deadline % SECONDS_PER_DAY / 3600, deadline % 3600 / 60, deadline % 60, names);
+        } else {
+            ESP_LOGI(TAG, "All channels off - waiting for SCHED / SET_FREQ");
+        }
 
-        // Sprawdź, czy minął czas do następnego pomiaru
-        if (current_time_sec - last_measurement_time >= scheduler.measurement_interval_sec) {
-            ESP_LOGI(TAG, "Time for measurement block!");
-            
-            // Wykonaj sekwencję pomiaru
-            read_all_sensors();
-            save_measurement_to_sd();
-            publish_to_mqtt();
+        uint32_t bits = 0;
+        int64_t now_ns = 0;
+        if (deadline == 0) {
+            // Wszystkie kanały wyłączone: zadanie budzi tylko zmiana tabeli
+            xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        }
+        while (deadline && (now_ns = sysclock_now_ns()) < deadline_ns) {
+            esp_timer_stop(scheduler.deadline_timer);
+            esp_timer_start_once(scheduler.deadline_timer, (deadline_ns - now_ns + 999) / 1000);
+            xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+            if (bits & SCHED_NOTIFY_UPDATE) break;
+        }
+
+        // Obsłuż zmianę tabeli (SCHED, SET_FREQ, PH:SCHED) - terminy od teraz
+        if (deadline == 0 || (bits & SCHED_NOTIFY_UPDATE)) {
+            esp_timer_stop(scheduler.deadline_timer);
+            if (bits & SCHED_NOTIFY_UPDATE) {
+                scheduler_reset_due(sysclock_now_unix());
+                scheduler.ph_deferred_since = 0;
+                ESP_LOGI(TAG, "Scheduler updated from schedule table");
+            }
+            continue;
+        }
+
+        uint32_t served = run_measurement_block(channels, (now_ns - deadline_ns) / 1000);
+        scheduler_advance(channels, served, sysclock_now_unix());
+    }
+}
+
+/* ============================================================================
+ * TRYB CYKLICZNEGO DEEP SLEEP (DUTY_CYCLE_MODE)
+ * ============================================================================ */
+
+#if DUTY_CYCLE_MODE
+
+static volatile uint32_t duty_direct_acks = 0;  // PUBACK publikacji bez karty
+
+static void duty_direct_ack_cb(int msg_id)
+{
+    duty_direct_acks++;
+}
+
+static bool duty_timed_out(int64_t until_us)
+{
+    vTaskDelay(pdMS_TO_TICKS(50));
+    return esp_timer_get_time() >= until_us;
+}
+
+/**
+ * Paczka: rekordy z kolejki RTC przez zadanie zapisu na kartę (outbox wysyła
+ * je od kursora razem z zaległościami), Wi-Fi tylko na ten czas. Rekord
+ * opuszcza kolejkę RTC po zapisie na kartę - brak PUBACK nadrobi outbox przy
+ * następnej paczce. Bez karty: publikacja bezpośrednia i zwolnienie kolejki
+ * dopiero po PUBACK wszystkich wiadomości.
+ */
+static void duty_flush_batch(void)
+{
+    int count = duty_queue_count();
+    duty_count_batch();
+
+    init_sdcard();
+    outbox_set_batch(MQTT_BATCH_RECORDS, 0);  // Bez czekania na pełną paczkę - zaraz sen
+
+    storage_stats_t st;
+    storage_get_stats(&st);
+    uint32_t written_before = st.written;
+    int submitted = 0;
+    while (submitted < count) {
+        logrec_t *rec = recbuf_alloc();
+        if (!rec) break;
+        *rec = *duty_queue_get(submitted);
+        if (storage_submit(rec) != ESP_OK) {
+            recbuf_unref(rec);
+            break;
+        }
+        submitted++;
+    }
+    if (submitted > 0) {
+        storage_request_sync();
+    } else {
+        mqtt_set_callbacks(duty_direct_ack_cb, NULL);
+    }
+    duty_boot_mark("sd");
 
-            last_measurement_time = current_time_sec;
+    init_wifi_mqtt();
+    int64_t until = esp_timer_get_time() + (int64_t)DUTY_CONNECT_TIMEOUT_SEC * 1000000;
+    while (!mqtt_is_connected() && !duty_timed_out(until)) {
+    }
+    duty_boot_mark("connect");
+
+    until = esp_timer_get_time() + (int64_t)DUTY_FLUSH_TIMEOUT_SEC * 1000000;
+    if (submitted > 0) {
+        outbox_stats_t ob;
+        do {
+            storage_get_stats(&st);
+            outbox_get_stats(&ob);
+        } while ((st.written - written_before < (uint32_t)submitted ||
+                  (mqtt_is_connected() && ob.acked_seq != ob.last_seq)) &&
+                 !duty_timed_out(until));
+        if (st.written - written_before >= (uint32_t)submitted) {
+            duty_queue_drop(submitted);
+        }
+        ESP_LOGI(TAG, "Batch: %lu/%d record(s) on SD, MQTT acked seq %lu of %lu",
+                 st.written - written_before, submitted, ob.acked_seq, ob.last_seq);
+    } else if (mqtt_is_connected()) {
+        for (int i = 0; i < count; i++) {
+            publish_to_mqtt(duty_queue_get(i));
         }
+        while (duty_direct_acks < (uint32_t)count && !duty_timed_out(until)) {
+        }
+        if (duty_direct_acks >= (uint32_t)count) {
+            duty_queue_drop(count);
+        }
+        ESP_LOGI(TAG, "Batch without SD card: %lu/%d message(s) acked", duty_direct_acks, count);
+    } else {
+        ESP_LOGW(TAG, "Batch: no SD card and no broker - %d record(s) stay in RTC memory", count);
+    }
+    duty_boot_mark("publish");
+}
 
-        // Czekaj 1 sekundę przed następnym sprawdzeniem
-        vTaskDelay(pdMS_TO_TICKS(1000));
+/**
+ * Wybudzenie z deep sleep zamiast pełnego app_main: bez konsoli UART,
+ * przekaźników (zatrzaśnięte w OFF), zadań FreeRTOS i Wi-Fi. Do końca odczytu
+ * log jest na poziomie domyślnym (WARN w sdkconfig) - przy 115200 baud każdy
+ * znak to ~87 us przed pierwszym pomiarem. Nie wraca.
+ */
+static void duty_cycle_wake(duty_wake_t cause)
+{
+    scheduler.task = NULL;
+    scheduler.deadline_timer = NULL;
+    ph_measurement_semaphore = xSemaphoreCreateBinary();
+
+    init_nvs();
+    schedtab_init(SECONDS_PER_DAY / DEFAULT_MEASUREMENTS_PER_DAY, PH_PUMP_SETTLE_SEC);
+    init_i2c();
+    init_sensors(false);
+    duty_boot_mark("init");
+
+    uint32_t now = sysclock_now_unix();
+    uint32_t mask = 0;
+    if (cause == DUTY_WAKE_TIMER) {
+        // Kanały zaplanowanego bloku; pompa stoi w czasie snu, więc PH bez odroczenia
+        if (now + DUTY_EARLY_WAKE_SEC >= scheduler.next_deadline) {
+            mask = scheduler.next_channels;
+        }
+    } else if (cause == DUTY_WAKE_BUTTON) {
+        // Próbka czeka w pamięci RTC na najbliższy blok jako świeża
+        ph_take_sample("Manual", NAN);
+    } else if (cause == DUTY_WAKE_LEVEL) {
+        // Debouncing jak w level.c: rekord poza harmonogramem tylko dla trwałej zmiany
+        vTaskDelay(pdMS_TO_TICKS(DEBOUNCE_TIME_MS));
+        if (level_ok && level_sensor_get_raw() != duty_level_armed()) {
+            mask = 1u << SCHEDTAB_LEVEL;
+        }
+    }
 
-        // Obsłuż aktualizację harmonogramu (jeśli zmieniono SET_FREQ)
-        if (xSemaphoreTake(scheduler.update_semaphore, pdMS_TO_TICKS(100)) == pdTRUE) {
-            ESP_LOGI(TAG, "Scheduler updated: %ld measurements per day (interval: %ld sec)",
-                     scheduler.measurements_per_day, scheduler.measurement_interval_sec);
-            last_measurement_time = current_time_sec;  // Reset Timer
+    if (mask) {
+        uint32_t served = read_all_sensors(mask);
+        logrec_t *rec = served ? encode_measurement(served) : NULL;
+        if (rec) {
+            duty_queue_push(rec);
+            recbuf_unref(rec);
         }
+        // Rekord od czujnika poziomu nie przesuwa terminów kanałów
+        if (cause == DUTY_WAKE_TIMER) {
+            scheduler_advance(mask, served, sysclock_now_unix());
+            scheduler_plan();
+        }
+        duty_boot_mark("block");
+    }
+    esp_log_level_set("*", ESP_LOG_INFO);
+
+    now = sysclock_now_unix();
+    if (duty_batch_due(now, DUTY_BATCH_RECORDS, DUTY_BATCH_MAX_AGE_SEC)) {
+        duty_flush_batch();
+    }
+
+    // Termin przegapiony (np. długa paczka): terminy kanałów od teraz
+    if (scheduler.next_deadline && scheduler.next_deadline <= now) {
+        scheduler_reset_due(now);
+        scheduler_plan();
     }
+    duty_boot_log();
+    duty_sleep(scheduler.next_deadline, level_ok ? level_sensor_get_raw() : -1);
 }
 
+/**
+ * Koniec okna konsoli po zimnym starcie: dokończ zapis na kartę i zaśnij do
+ * terminu, który wyznaczył scheduler_task. Nie wraca.
+ */
+static void duty_cycle_start(void)
+{
+    // Blok w toku trzyma magistralę 1-Wire do końca odczytu
+    xSemaphoreTake(ow_mutex, portMAX_DELAY);
+    storage_stats_t st;
+    storage_request_sync();
+    int64_t until = esp_timer_get_time() + (int64_t)DUTY_FLUSH_TIMEOUT_SEC * 1000000;
+    do {
+        storage_get_stats(&st);
+    } while (st.written + st.dropped + st.write_errors < st.submitted && !duty_timed_out(until));
+
+    uint32_t now = sysclock_now_unix();
+    if (scheduler.next_deadline && scheduler.next_deadline <= now) {
+        scheduler_reset_due(now);
+        scheduler_plan();
+    }
+    printf("[DUTY] Entering deep sleep duty cycle, console disabled until reset\n");
+    duty_sleep(scheduler.next_deadline, level_ok ? level_sensor_get_raw() : -1);
+}
+
+#endif // DUTY_CYCLE_MODE
+
 /* ============================================================================
  * app_main() - PUNKT WEJŚCIA
  * ============================================================================ */
 
 void app_main(void)
 {
+#if DUTY_CYCLE_MODE
+    // Najpierw przyczyna startu: wybudzenie z deep sleep idzie skróconą ścieżką
+    duty_wake_t wake = duty_init(PH_BUTTON_GPIO, LEVEL_SENSOR_PIN);
+    if (wake != DUTY_WAKE_COLD) {
+        duty_cycle_wake(wake);
+    }
+#endif
+    // Domyślny poziom w sdkconfig to WARN (krótszy start po deep sleep)
+    esp_log_level_set("*", ESP_LOG_INFO);
+
     ESP_LOGI(TAG, "========================================");
     ESP_LOGI(TAG, "     DAS Tower v1 - Starting System     ");
     ESP_LOGI(TAG, "========================================");
@@ -674,12 +1757,11 @@ void app_main(void)
     printf("║  Measurement Interval Block Architecture   ║\n");
     printf("╚════════════════════════════════════════════╝\n\n");
 
-    // Semafor dla harmonogramu
-    scheduler.update_semaphore = xSemaphoreCreateBinary();
-
     // Inicjalizacja czujników
+    init_nvs();
+    schedtab_init(SECONDS_PER_DAY / DEFAULT_MEASUREMENTS_PER_DAY, PH_PUMP_SETTLE_SEC);
     init_i2c();
-    init_sensors();
+    init_sensors(true);
     init_relay();
     init_wifi_mqtt();
     init_sdcard();
@@ -694,30 +1776,58 @@ void app_main(void)
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = GPIO_PULLUP_ENABLE,
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
-        .intr_type = GPIO_INTR_NEGEDGE  // Zbocze opadające (wciśnięcie)
+        .intr_type = GPIO_INTR_LOW_LEVEL  // Poziom niski (wciśnięcie), też wybudza z light sleep
     };
     gpio_config(&ph_btn_conf);
     gpio_install_isr_service(0);
     gpio_isr_handler_add(PH_BUTTON_GPIO, ph_button_isr_handler, NULL);
+    gpio_wakeup_enable(PH_BUTTON_GPIO, GPIO_INTR_LOW_LEVEL);
+
+    init_power_management();
 
     printf("[INIT] All hardware initialized successfully\n");
-    printf("[INIT] Measurement block interval: %ld seconds (%ld per day)\n\n",
-           scheduler.measurement_interval_sec, scheduler.measurements_per_day);
+    printf("[INIT] Measurement schedule (SCHED to change):\n");
+    print_schedule();
+    printf("\n");
 
     // Utwórz zadania FreeRTOS
-    xTaskCreate(uart_command_handler, "uart_task", 4096, NULL, 5, NULL);
-    xTaskCreate(relay_timer_task, "relay_timer_task", 4096, NULL, 7, NULL);
+    xTaskCreate(relay_timer_task, "relay_timer_task", 4096, NULL, 7, &relay_timer_handle);
     xTaskCreate(ph_button_task, "ph_button_task", 4096, NULL, 10, NULL);
-    xTaskCreate(scheduler_task, "scheduler_task", 4096, NULL, 8, NULL);
+    if (level_event_queue) {
+        xTaskCreate(level_event_task, "level_event_task", 3072, level_event_queue, 9, NULL);
+    }
+    xTaskCreate(scheduler_task, "scheduler_task", 4096, NULL, 8, &scheduler.task);
+    // Ostatnie: komendy powiadamiają zadania powyżej przez ich uchwyty
+    xTaskCreate(uart_command_handler, "uart_task", 4096, NULL, 5, NULL);
 
     printf("[TASK] All FreeRTOS tasks created\n");
     printf("[READY] System ready for commands via UART\n");
     printf("[UART] Available commands:\n");
-    printf("       - SET_FREQ:X         (1-24 measurements per day)\n");
+    printf("       - SET_FREQ:X         (1-24 measurements per day, all channels)\n");
+    printf("       - SCHED              (schedule table: period and phase per channel)\n");
+    printf("       - SCHED:CH:P[:F]     (CH = WATER/AIR/LIGHT/PH/LEVEL every P s, phase F; P=0 off)\n");
     printf("       - R1:ON/OFF          (relay 1 control, stops timer)\n");
     printf("       - R1:TIME:ON:OFF     (relay 1 looping timer - repeating)\n");
     printf("       - R2:ON/OFF          (relay 2 control)\n");
     printf("       - STATUS             (display system status)\n");
     printf("       - ENTERPH            (pH calibration mode)\n");
-    printf("       - CALPH7/CALPH4      (calibrate pH)\n\n");
+    printf("       - CALPH4/7/10        (calibrate pH point, EXITPH saves)\n");
+    printf("       - PH:SCHED:I:S       (PH channel every I s, S s after pump switch, 0<S<I; I=0 off)\n");
+    printf("       - READ:T0:T1         (print SD records from [T0, T1), seconds)\n");
+    printf("       - PURGE:BEFORE:T     (delete SD records older than T, seconds)\n");
+    printf("       - PURGE:FIELD:P:V    (delete SD records where field P has raw value V)\n");
+    printf("       - BATCH:N:T          (MQTT batch: N records, flush after T seconds)\n");
+    printf("       - FORMAT:JSON/CBOR   (MQTT payload encoding)\n");
+    printf("       - BENCH:JSON[:N]     (payload formatting benchmark)\n");
+    printf("       - BENCH:OW[:N]       (1-Wire backend benchmark under MQTT load)\n");
+    printf("       - BENCH:PH[:N]       (pH single-shot vs DMA burst: time and noise)\n");
+    printf("       - DS18:SCAN          (search DS18B20 probes, store table in NVS)\n");
+    printf("       - DS18:RES:I:B       (probe I resolution, B = 9..12 bit)\n\n");
+
+#if DUTY_CYCLE_MODE
+    printf("[DUTY] Deep sleep between blocks in %d s - configure via UART until then\n",
+           DUTY_CONSOLE_WINDOW_SEC);
+    vTaskDelay(pdMS_TO_TICKS(DUTY_CONSOLE_WINDOW_SEC * 1000));
+    duty_cycle_start();
+#endif
 }
\ No newline at end of file
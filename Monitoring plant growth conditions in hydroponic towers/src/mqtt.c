@@ -4,8 +4,14 @@
 #include "dht.h"
 
 static const char *TAG = "MQTT";
+
+// Limit kolejki klienta (wiadomości QoS 1 czekające na wysłanie lub PUBACK)
+#define MQTT_OUTBOX_LIMIT  (64 * 1024)
+
 static esp_mqtt_client_handle_t client = NULL;
 static bool mqtt_connected = false;
+static mqtt_ack_cb_t ack_cb = NULL;
+static mqtt_conn_cb_t conn_cb = NULL;
 
 static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
 {
@@ -18,10 +24,15 @@ static void mqtt_event_handler(void *handler_args, esp_event_base_t base, int32_
         case MQTT_EVENT_CONNECTED:
             ESP_LOGI(TAG, "MQTT Connected to broker");
             mqtt_connected = true;
+            if (conn_cb) conn_cb(true);
             break;
         case MQTT_EVENT_DISCONNECTED:
             ESP_LOGW(TAG, "MQTT Disconnected from broker");
             mqtt_connected = false;
+            if (conn_cb) conn_cb(false);
+            break;
+        case MQTT_EVENT_PUBLISHED:
+            if (ack_cb) ack_cb(event->msg_id);
             break;
         case MQTT_EVENT_ERROR:
             ESP_LOGE(TAG, "MQTT Error");
@@ -36,6 +47,7 @@ esp_err_t mqtt_init(const char *broker_url)
 {
     esp_mqtt_client_config_t mqtt_cfg = {
         .broker.address.uri = broker_url,
+        .outbox.limit = MQTT_OUTBOX_LIMIT,
     };
     client = esp_mqtt_client_init(&mqtt_cfg);
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, mqtt_event_handler, NULL);
@@ -49,6 +61,36 @@ bool mqtt_publish(const char *topic, const char *data)
     return msg_id != -1;
 }
 
+void mqtt_set_callbacks(mqtt_ack_cb_t on_ack, mqtt_conn_cb_t on_conn)
+{
+    ack_cb = on_ack;
+    conn_cb = on_conn;
+}
+
+bool mqtt_is_connected(void)
+{
+    return mqtt_connected && client;
+}
+
+int mqtt_publish_qos1(const char *topic, const char *data, int len)
+{
+    if (!mqtt_connected || !client) return -1;
+    return esp_mqtt_client_publish(client, topic, data, len, 1, 0);
+}
+
+int mqtt_enqueue_qos1(const char *topic, const char *data, int len)
+{
+    if (!mqtt_connected || !client) return -1;
+    // store = true: wiadomość zostaje w kolejce klienta do PUBACK
+    return esp_mqtt_client_enqueue(client, topic, data, len, 1, 0, true);
+}
+
+int mqtt_publish_qos0(const char *topic, const char *data, int len)
+{
+    if (!mqtt_connected || !client) return -1;
+    return esp_mqtt_client_publish(client, topic, data, len, 0, 0);
+}
+
 // Funkcja do wysyłania danych
 void mqtt_publish_dht(float temperature, float humidity)
 {
@@ -8,4 +8,33 @@
 esp_err_t mqtt_init(const char *broker_url);
 bool mqtt_publish(const char *topic, const char *data);
 
+/* Zdarzenia dla outboxa (outbox.c). Wołane z zadania klienta MQTT - callback
+ * ma tylko przekazać zdarzenie dalej (kolejka), bez blokowania. */
+typedef void (*mqtt_ack_cb_t)(int msg_id);          // PUBACK dla QoS 1
+typedef void (*mqtt_conn_cb_t)(bool connected);     // Połączenie / rozłączenie
+
+void mqtt_set_callbacks(mqtt_ack_cb_t on_ack, mqtt_conn_cb_t on_conn);
+bool mqtt_is_connected(void);
+
+/**
+ * Publikacja QoS 1 z długością danych.
+ * @return msg_id (potwierdzany przez mqtt_ack_cb_t) lub -1 gdy brak połączenia / błąd
+ */
+int mqtt_publish_qos1(const char *topic, const char *data, int len);
+
+/**
+ * Wstawia wiadomość QoS 1 do kolejki klienta (esp_mqtt_client_enqueue) bez
+ * czekania na gniazdo - wysyła ją zadanie klienta MQTT. Dla outboxa wołanego
+ * z zadania zapisu, które nie może stać na wolnym łączu.
+ * @return msg_id (potwierdzany przez mqtt_ack_cb_t) lub -1 gdy brak połączenia,
+ *         -2 gdy kolejka klienta jest pełna (MQTT_OUTBOX_LIMIT)
+ */
+int mqtt_enqueue_qos1(const char *topic, const char *data, int len);
+
+/**
+ * Publikacja QoS 0 z długością danych (bez potwierdzeń; LEVEL_TOPIC i ruch testowy BENCH:OW).
+ * @return msg_id lub -1 gdy brak połączenia / błąd
+ */
+int mqtt_publish_qos0(const char *topic, const char *data, int len);
+
 #endif // MQTT_H
@@ -1,5 +1,16 @@
 #include "onewire.h"
 #include "driver/gpio.h"
+#include <string.h>
+
+/********************
+ * Backend GPIO (bit-banging)
+ ********************/
+#if !ONEWIRE_BACKEND_RMT
+
+const char *onewire_backend_name(void)
+{
+    return "gpio";
+}
 
 // Inicjalizacja magistrali
 void onewire_init(OneWire *ow, uint8_t pin)
@@ -85,6 +96,25 @@ uint8_t onewire_read_byte(OneWire *ow)
     return byte;
 }
 
+void onewire_write_bytes(OneWire *ow, const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        onewire_write_byte(ow, data[i]);
+    }
+}
+
+void onewire_read_bytes(OneWire *ow, uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        data[i] = onewire_read_byte(ow);
+    }
+}
+
+#endif // !ONEWIRE_BACKEND_RMT
+
+/********************
+ * Wspólne dla obu backendów
+ ********************/
 // Skip ROM
 void onewire_skip_rom(OneWire *ow)
 {
@@ -95,7 +125,82 @@ void onewire_skip_rom(OneWire *ow)
 void onewire_select_rom(OneWire *ow, const uint8_t rom[8])
 {
     onewire_write_byte(ow, 0x55);
-    for (int i = 0; i < 8; i++) {
-        onewire_write_byte(ow, rom[i]);
+    onewire_write_bytes(ow, rom, 8);
+}
+
+// Dallas/Maxim CRC8
+uint8_t onewire_crc8(const uint8_t *data, int len)
+{
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++) {
+        uint8_t inbyte = data[i];
+        for (int j = 0; j < 8; j++) {
+            uint8_t mix = (crc ^ inbyte) & 0x01;
+            crc >>= 1;
+            if (mix) crc ^= 0x8C;
+            inbyte >>= 1;
+        }
+    }
+    return crc;
+}
+
+// Wyszukiwanie ROM (Maxim AN187)
+void onewire_search_reset(OneWireSearch *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+bool onewire_search(OneWire *ow, OneWireSearch *s)
+{
+    if (s->last_device) {
+        return false;
+    }
+    if (!onewire_reset(ow)) {
+        onewire_search_reset(s);
+        return false;
+    }
+    onewire_write_byte(ow, 0xF0); // SEARCH ROM
+
+    int last_zero = 0;
+    for (int bit = 1; bit <= 64; bit++) {
+        uint8_t id_bit = onewire_read_bit(ow);
+        uint8_t cmp_bit = onewire_read_bit(ow);
+        if (id_bit && cmp_bit) {
+            // Żadne urządzenie nie odpowiedziało
+            onewire_search_reset(s);
+            return false;
+        }
+
+        uint8_t mask = 1 << ((bit - 1) % 8);
+        uint8_t *byte = &s->rom[(bit - 1) / 8];
+        uint8_t dir;
+        if (id_bit != cmp_bit) {
+            dir = id_bit;           // Wszystkie urządzenia mają ten sam bit
+        } else {
+            // Rozbieżność: przed ostatnią idziemy jak poprzednio, na niej w gałąź 1
+            if (bit < s->last_discrepancy) {
+                dir = (*byte & mask) ? 1 : 0;
+            } else {
+                dir = bit == s->last_discrepancy;
+            }
+            if (!dir) {
+                last_zero = bit;
+            }
+        }
+
+        if (dir) {
+            *byte |= mask;
+        } else {
+            *byte &= ~mask;
+        }
+        onewire_write_bit(ow, dir);
+    }
+
+    s->last_discrepancy = last_zero;
+    s->last_device = last_zero == 0;
+    if (s->rom[0] == 0 || onewire_crc8(s->rom, 7) != s->rom[7]) {
+        onewire_search_reset(s);
+        return false;
     }
+    return true;
 }
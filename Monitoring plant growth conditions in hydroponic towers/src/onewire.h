@@ -3,15 +3,57 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_rom_sys.h" // esp_rom_delay_us
 
+/*
+ * Backend wybierany przy kompilacji (to samo API):
+ *   0 - bit-banging GPIO z esp_rom_delay_us (onewire.c), CPU zajęty przez cały slot,
+ *       przerwania WiFi mogą rozciągnąć slot i popsuć CRC
+ *   1 - peryferium RMT (onewire_rmt.c): sloty nadaje i próbkuje sprzęt, zadanie
+ *       czeka na zakończenie transferu w kolejce (CPU wolny); włączone kanały
+ *       trzymają blokadę PM, więc przy CONFIG_PM_ENABLE nie ma light sleep
+ * Np. build_flags = -DONEWIRE_BACKEND_RMT=1 w platformio.ini.
+ * Porównanie obu: komenda UART BENCH:OW (onewire_bench.c).
+ */
+#ifndef ONEWIRE_BACKEND_RMT
+#define ONEWIRE_BACKEND_RMT 0
+#endif
+
+#if ONEWIRE_BACKEND_RMT
+#include "driver/rmt_tx.h"
+#include "driver/rmt_rx.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#define ONEWIRE_RMT_RX_SYMBOLS  64  // Jeden blok pamięci RMT = 8 bajtów na transfer
+#endif
+
 typedef struct {
     uint8_t pin;
+#if ONEWIRE_BACKEND_RMT
+    rmt_channel_handle_t tx;
+    rmt_channel_handle_t rx;
+    rmt_encoder_handle_t bytes_enc;   // Bajty -> sloty zapisu (LSB first)
+    rmt_encoder_handle_t copy_enc;    // Pojedyncze symbole (reset, bit)
+    QueueHandle_t rx_done;            // rmt_rx_done_event_data_t z przerwania RMT
+    rmt_symbol_word_t rx_buf[ONEWIRE_RMT_RX_SYMBOLS];
+#endif
 } OneWire;
 
+// Stan wyszukiwania ROM (SEARCH ROM, 0xF0)
+typedef struct {
+    uint8_t rom[8];             // Ostatnio znaleziony adres
+    int last_discrepancy;       // Bit ostatniej rozbieżności z wybraną gałęzią 0
+    bool last_device;           // Przeszukano całe drzewo
+} OneWireSearch;
+
 // Inicjalizacja magistrali 1-Wire
 void onewire_init(OneWire *ow, uint8_t pin);
 
+// Nazwa backendu ("gpio" / "rmt")
+const char *onewire_backend_name(void);
+
 // Reset magistrali, zwraca 1 jeśli obecny jest urządzenie
 uint8_t onewire_reset(OneWire *ow);
 
@@ -23,8 +65,20 @@ uint8_t onewire_read_bit(OneWire *ow);
 void onewire_write_byte(OneWire *ow, uint8_t byte);
 uint8_t onewire_read_byte(OneWire *ow);
 
+// Odczyt / zapis wielu bajtów (RMT: jeden transfer na 8 bajtów)
+void onewire_write_bytes(OneWire *ow, const uint8_t *data, size_t len);
+void onewire_read_bytes(OneWire *ow, uint8_t *data, size_t len);
+
 // Skip ROM / Select ROM
 void onewire_skip_rom(OneWire *ow);
 void onewire_select_rom(OneWire *ow, const uint8_t rom[8]);
 
+// Wyszukiwanie ROM: po onewire_search_reset kolejne wywołania onewire_search
+// zwracają adresy urządzeń (false = koniec albo błąd CRC/magistrali)
+void onewire_search_reset(OneWireSearch *s);
+bool onewire_search(OneWire *ow, OneWireSearch *s);
+
+// Dallas/Maxim CRC8 (adres ROM, scratchpad)
+uint8_t onewire_crc8(const uint8_t *data, int len);
+
 #endif // ONEWIRE_H
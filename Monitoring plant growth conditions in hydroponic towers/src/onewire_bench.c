@@ -0,0 +1,178 @@
+#include "onewire_bench.h"
+#include "ds18b20.h"
+#include "mqtt.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "BENCH_OW";
+
+#define BASELINE_MS  1000   // Okno odniesienia dla licznika pętli
+#define WARMUP_MS    300    // Rozruch zadania ruchu przed pomiarem
+
+typedef struct {
+    const char *name;
+    bool load;
+    uint32_t transactions;
+    int64_t elapsed_us;
+    int64_t cpu_us;
+    uint32_t crc_errors;
+    uint32_t no_presence;
+    uint32_t published;
+} phase_t;
+
+typedef struct {
+    OneWire *ow;
+    SemaphoreHandle_t mutex;
+    phase_t *phases;
+    size_t phase_count;
+    TaskHandle_t caller;
+} bench_ctx_t;
+
+static volatile bool spin_run;
+static volatile uint32_t spins;
+static volatile bool traffic_run;
+static volatile uint32_t traffic_sent;
+static TaskHandle_t bench_handle;
+static char traffic_msg[ONEWIRE_BENCH_MSG_SIZE];
+
+// Najniższy priorytet: dostaje tylko czas, którego nikt inny nie potrzebuje
+static void spin_task(void *arg) {
+    while (spin_run) {
+        spins++;
+    }
+    xTaskNotifyGive(bench_handle);
+    vTaskDelete(NULL);
+}
+
+static void traffic_task(void *arg) {
+    while (traffic_run) {
+        if (mqtt_publish_qos0(ONEWIRE_BENCH_TOPIC, traffic_msg, sizeof(traffic_msg)) >= 0) {
+            traffic_sent++;
+        }
+        vTaskDelay(1);
+    }
+    xTaskNotifyGive(bench_handle);
+    vTaskDelete(NULL);
+}
+
+// Jedna transakcja: odczyt scratchpadu pierwszej sondy (SKIP ROM przy pustej tablicy)
+static void transaction(bench_ctx_t *ctx, phase_t *p) {
+    const ds18_device_t *dev = ds18_get_device(0);
+    uint8_t scratch[9];
+
+    xSemaphoreTake(ctx->mutex, portMAX_DELAY);
+    bool present = onewire_reset(ctx->ow);
+    if (present) {
+        if (dev) {
+            onewire_select_rom(ctx->ow, dev->rom);
+        } else {
+            onewire_skip_rom(ctx->ow);
+        }
+        onewire_write_byte(ctx->ow, 0xBE); // READ SCRATCHPAD
+        onewire_read_bytes(ctx->ow, scratch, sizeof(scratch));
+    }
+    xSemaphoreGive(ctx->mutex);
+
+    if (!present) {
+        p->no_presence++;
+    } else if (onewire_crc8(scratch, 8) != scratch[8]) {
+        p->crc_errors++;
+    }
+}
+
+static void run_phase(bench_ctx_t *ctx, phase_t *p) {
+    if (p->load) {
+        traffic_run = true;
+        traffic_sent = 0;
+        xTaskCreate(traffic_task, "bench_traffic", 3072, NULL, 2, NULL);
+        vTaskDelay(pdMS_TO_TICKS(WARMUP_MS));
+    }
+
+    // Odniesienie: pętle na mikrosekundę przy samym obciążeniu fazy
+    uint32_t s0 = spins;
+    int64_t t0 = esp_timer_get_time();
+    vTaskDelay(pdMS_TO_TICKS(BASELINE_MS));
+    double spins_per_us = (double)(uint32_t)(spins - s0) / (double)(esp_timer_get_time() - t0);
+
+    s0 = spins;
+    t0 = esp_timer_get_time();
+    for (uint32_t i = 0; i < p->transactions; i++) {
+        transaction(ctx, p);
+    }
+    p->elapsed_us = esp_timer_get_time() - t0;
+
+    // Czas, którego zabrakło zadaniu pętli = czas CPU zajęty przez transakcje
+    double idle_us = spins_per_us > 0 ? (uint32_t)(spins - s0) / spins_per_us : 0;
+    p->cpu_us = p->elapsed_us - (int64_t)idle_us;
+    if (p->cpu_us < 0) p->cpu_us = 0;
+
+    if (p->load) {
+        traffic_run = false;
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        p->published = traffic_sent;
+    }
+}
+
+static void bench_task(void *arg) {
+    bench_ctx_t *ctx = arg;
+
+    spin_run = true;
+    spins = 0;
+    xTaskCreatePinnedToCore(spin_task, "bench_spin", 2048, NULL, tskIDLE_PRIORITY + 1, NULL,
+                            ONEWIRE_BENCH_CORE);
+
+    for (size_t i = 0; i < ctx->phase_count; i++) {
+        run_phase(ctx, &ctx->phases[i]);
+    }
+
+    spin_run = false;
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    xTaskNotifyGive(ctx->caller);
+    vTaskDelete(NULL);
+}
+
+esp_err_t onewire_bench_run(OneWire *ow, SemaphoreHandle_t bus_mutex, uint32_t transactions) {
+    if (transactions == 0) return ESP_ERR_INVALID_ARG;
+    // Odczyt scratchpadu to ~7 ms: 2000 transakcji = ~15 s na fazę
+    if (transactions > 2000) transactions = 2000;
+
+    if (!mqtt_is_connected()) {
+        ESP_LOGW(TAG, "MQTT not connected - loaded phase will run without traffic");
+    }
+    memset(traffic_msg, 'x', sizeof(traffic_msg));
+
+    phase_t phases[] = {
+        { .name = "idle", .load = false, .transactions = transactions },
+        { .name = "mqtt load", .load = true, .transactions = transactions },
+    };
+    bench_ctx_t ctx = {
+        .ow = ow,
+        .mutex = bus_mutex,
+        .phases = phases,
+        .phase_count = sizeof(phases) / sizeof(phases[0]),
+        .caller = xTaskGetCurrentTaskHandle(),
+    };
+
+    // Wyżej niż ruch MQTT i blok pomiarowy, na rdzeniu z Wi-Fi
+    if (xTaskCreatePinnedToCore(bench_task, "bench_ow", ONEWIRE_BENCH_STACK, &ctx, 5, &bench_handle,
+                                ONEWIRE_BENCH_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Cannot create bench task");
+        return ESP_ERR_NO_MEM;
+    }
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+    printf("\n1-Wire backend \"%s\", %lu scratchpad reads per phase (core %d)\n",
+           onewire_backend_name(), (unsigned long)transactions, ONEWIRE_BENCH_CORE);
+    printf("  %-10s %10s %12s %8s %12s %10s\n", "phase", "us/read", "cpu us/read", "crc err",
+           "no presence", "mqtt msgs");
+    for (size_t i = 0; i < ctx.phase_count; i++) {
+        const phase_t *p = &phases[i];
+        printf("  %-10s %10lu %12lu %8lu %12lu %10lu\n", p->name,
+               (unsigned long)(p->elapsed_us / transactions), (unsigned long)(p->cpu_us / transactions),
+               (unsigned long)p->crc_errors, (unsigned long)p->no_presence, (unsigned long)p->published);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,36 @@
+#ifndef ONEWIRE_BENCH_H
+#define ONEWIRE_BENCH_H
+
+#include "esp_err.h"
+#include "onewire.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <stdint.h>
+
+/**
+ * Test obciążeniowy backendu 1-Wire (komenda UART BENCH:OW).
+ *
+ * Każda transakcja to odczyt scratchpadu pierwszej sondy DS18B20 (reset,
+ * adresowanie, 0xBE, 9 bajtów, CRC). Dwie fazy: bez ruchu sieciowego i z
+ * zadaniem publikującym w pętli wiadomości QoS 0 po ONEWIRE_BENCH_MSG_SIZE B
+ * na ONEWIRE_BENCH_TOPIC (Wi-Fi i lwIP pracują na rdzeniu 0, tam też działa
+ * pomiar). Czas CPU na transakcję liczy zadanie o najniższym priorytecie na
+ * tym samym rdzeniu: ile pętli traci w trakcie transakcji względem okna
+ * odniesienia z tym samym obciążeniem. Backend wybiera się przy kompilacji
+ * (ONEWIRE_BACKEND_RMT w onewire.h), więc porównanie to dwa przebiegi na
+ * dwóch buildach.
+ */
+
+#define ONEWIRE_BENCH_STACK     4096
+#define ONEWIRE_BENCH_CORE      0
+#define ONEWIRE_BENCH_TOPIC     "das_tower/bench"
+#define ONEWIRE_BENCH_MSG_SIZE  1024
+
+/**
+ * Uruchamia obie fazy po transactions odczytów (blokuje wywołującego do końca)
+ * i wypisuje wyniki na konsolę. Magistralę zajmuje przez bus_mutex na czas
+ * każdej transakcji, więc blok pomiarowy może działać równolegle.
+ */
+esp_err_t onewire_bench_run(OneWire *ow, SemaphoreHandle_t bus_mutex, uint32_t transactions);
+
+#endif // ONEWIRE_BENCH_H
@@ -0,0 +1,216 @@
+#include "onewire.h"
+
+#if ONEWIRE_BACKEND_RMT
+
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include <string.h>
+
+static const char *TAG = "ONEWIRE_RMT";
+
+// Takt RMT 1 MHz: czasy symboli w mikrosekundach
+#define RMT_RESOLUTION_HZ     1000000
+#define RMT_TIMEOUT_MS        50
+#define RMT_GLITCH_NS         1000        // Filtr zakłóceń odbiornika (ESP32: max ~3 us)
+
+// Reset: 500 us stanu niskiego, potem 480 us na impuls obecności (60..240 us)
+#define RESET_LOW_US          500
+#define RESET_RELEASE_US      480
+#define RESET_RX_IDLE_NS      600000      // > RESET_LOW_US, koniec odbioru po impulsie obecności
+#define PRESENCE_MIN_US       50
+
+// Slot 70 us: "1" i odczyt = 6 us niskiego, "0" = 60 us niskiego
+#define SLOT_SHORT_US         6
+#define SLOT_LONG_US          60
+#define SLOT_US               70
+#define SLOT_RX_IDLE_NS       100000      // > najdłuższy stan wysoki w slocie (64 us)
+#define READ_THRESHOLD_US     15          // Urządzenie trzyma "0" dłużej niż punkt próbkowania
+
+#define BYTES_PER_TRANSFER    (ONEWIRE_RMT_RX_SYMBOLS / 8)
+
+static const rmt_symbol_word_t symbol_reset = {
+    .level0 = 0, .duration0 = RESET_LOW_US, .level1 = 1, .duration1 = RESET_RELEASE_US,
+};
+static const rmt_symbol_word_t symbol_bit0 = {
+    .level0 = 0, .duration0 = SLOT_LONG_US, .level1 = 1, .duration1 = SLOT_US - SLOT_LONG_US,
+};
+static const rmt_symbol_word_t symbol_bit1 = {
+    .level0 = 0, .duration0 = SLOT_SHORT_US, .level1 = 1, .duration1 = SLOT_US - SLOT_SHORT_US,
+};
+// Zwolnienie magistrali po włączeniu kanału (open-drain, stan wysoki = pull-up)
+static const rmt_symbol_word_t symbol_release = {
+    .level0 = 1, .duration0 = 1, .level1 = 1, .duration1 = 0,
+};
+
+// Przerwanie RMT: zakończony odbiór trafia do kolejki zadania, które czeka bez CPU
+static bool IRAM_ATTR rx_done_cb(rmt_channel_handle_t ch, const rmt_rx_done_event_data_t *edata, void *ctx)
+{
+    BaseType_t woken = pdFALSE;
+    xQueueSendFromISR((QueueHandle_t)ctx, edata, &woken);
+    return woken == pdTRUE;
+}
+
+const char *onewire_backend_name(void)
+{
+    return "rmt";
+}
+
+// Inicjalizacja magistrali: kanał RX i TX na tym samym pinie (TX open-drain z pętlą zwrotną)
+void onewire_init(OneWire *ow, uint8_t pin)
+{
+    memset(ow, 0, sizeof(*ow));
+    ow->pin = pin;
+
+    rmt_rx_channel_config_t rx_cfg = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = RMT_RESOLUTION_HZ,
+        .mem_block_symbols = ONEWIRE_RMT_RX_SYMBOLS,
+    };
+    rmt_tx_channel_config_t tx_cfg = {
+        .gpio_num = pin,
+        .clk_src = RMT_CLK_SRC_DEFAULT,
+        .resolution_hz = RMT_RESOLUTION_HZ,
+        .mem_block_symbols = 64,
+        .trans_queue_depth = 4,
+        .flags.io_loop_back = true,   // RX widzi sloty nadawane przez TX
+        .flags.io_od_mode = true,
+    };
+    rmt_bytes_encoder_config_t bytes_cfg = {
+        .bit0 = symbol_bit0,
+        .bit1 = symbol_bit1,
+        .flags.msb_first = 0,         // 1-Wire: najmłodszy bit pierwszy
+    };
+    rmt_copy_encoder_config_t copy_cfg = {0};
+    rmt_rx_event_callbacks_t cbs = { .on_recv_done = rx_done_cb };
+
+    ow->rx_done = xQueueCreate(1, sizeof(rmt_rx_done_event_data_t));
+    esp_err_t err = ow->rx_done ? ESP_OK : ESP_ERR_NO_MEM;
+    if (err == ESP_OK) err = rmt_new_rx_channel(&rx_cfg, &ow->rx);
+    if (err == ESP_OK) err = rmt_new_tx_channel(&tx_cfg, &ow->tx);
+    if (err == ESP_OK) err = rmt_new_bytes_encoder(&bytes_cfg, &ow->bytes_enc);
+    if (err == ESP_OK) err = rmt_new_copy_encoder(&copy_cfg, &ow->copy_enc);
+    if (err == ESP_OK) err = rmt_rx_register_event_callbacks(ow->rx, &cbs, ow->rx_done);
+    if (err == ESP_OK) err = gpio_pullup_en(pin);
+    if (err == ESP_OK) err = rmt_enable(ow->rx);
+    if (err == ESP_OK) err = rmt_enable(ow->tx);
+    if (err == ESP_OK) {
+        rmt_transmit_config_t release_cfg = { .flags.eot_level = 1 };
+        err = rmt_transmit(ow->tx, ow->copy_enc, &symbol_release, sizeof(symbol_release), &release_cfg);
+    }
+    if (err == ESP_OK) err = rmt_tx_wait_all_done(ow->tx, RMT_TIMEOUT_MS);
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "RMT 1-Wire init on GPIO %d failed: %s", pin, esp_err_to_name(err));
+        ow->tx = NULL;  // Dalsze operacje zwracają brak urządzenia
+    }
+}
+
+// Nadaje symbole przez enc; przy rx_idle_ns > 0 zbiera też przebieg z magistrali.
+// Zwraca liczbę odebranych symboli (0 bez odbioru) lub -1 przy błędzie.
+static int transfer(OneWire *ow, rmt_encoder_handle_t enc, const void *data, size_t size,
+                    uint32_t rx_idle_ns)
+{
+    if (!ow->tx) return -1;
+
+    if (rx_idle_ns) {
+        rmt_receive_config_t rx_cfg = {
+            .signal_range_min_ns = RMT_GLITCH_NS,
+            .signal_range_max_ns = rx_idle_ns,
+        };
+        xQueueReset(ow->rx_done);
+        if (rmt_receive(ow->rx, ow->rx_buf, sizeof(ow->rx_buf), &rx_cfg) != ESP_OK) return -1;
+    }
+
+    rmt_transmit_config_t tx_cfg = { .flags.eot_level = 1 };
+    if (rmt_transmit(ow->tx, enc, data, size, &tx_cfg) != ESP_OK ||
+        rmt_tx_wait_all_done(ow->tx, RMT_TIMEOUT_MS) != ESP_OK) {
+        return -1;
+    }
+    if (!rx_idle_ns) return 0;
+
+    rmt_rx_done_event_data_t evt;
+    if (xQueueReceive(ow->rx_done, &evt, pdMS_TO_TICKS(RMT_TIMEOUT_MS)) != pdTRUE) {
+        // Przerwij zawieszony odbiór, żeby następny rmt_receive mógł wystartować
+        rmt_disable(ow->rx);
+        rmt_enable(ow->rx);
+        return -1;
+    }
+    return (int)evt.num_symbols;
+}
+
+// Reset 1-Wire
+uint8_t onewire_reset(OneWire *ow)
+{
+    int n = transfer(ow, ow->copy_enc, &symbol_reset, sizeof(symbol_reset), RESET_RX_IDLE_NS);
+    if (n < 2) {
+        return 0;
+    }
+    // [0] = własny impuls resetu, [1] = impuls obecności urządzenia
+    const rmt_symbol_word_t *s = ow->rx_buf;
+    return s[0].level0 == 0 && s[1].level0 == 0 && s[1].duration0 >= PRESENCE_MIN_US ? 1 : 0;
+}
+
+// Zapisywanie bitu
+void onewire_write_bit(OneWire *ow, uint8_t bit)
+{
+    transfer(ow, ow->copy_enc, bit ? &symbol_bit1 : &symbol_bit0, sizeof(rmt_symbol_word_t), 0);
+}
+
+// Odczyt bitu (slot odczytu = slot zapisu "1")
+uint8_t onewire_read_bit(OneWire *ow)
+{
+    int n = transfer(ow, ow->copy_enc, &symbol_bit1, sizeof(symbol_bit1), SLOT_RX_IDLE_NS);
+    if (n < 1) {
+        return 1;  // Magistrala bez odpowiedzi = stan wysoki
+    }
+    return ow->rx_buf[0].duration0 < READ_THRESHOLD_US ? 1 : 0;
+}
+
+void onewire_write_bytes(OneWire *ow, const uint8_t *data, size_t len)
+{
+    if (len) {
+        transfer(ow, ow->bytes_enc, data, len, 0);
+    }
+}
+
+// Do BYTES_PER_TRANSFER bajtów na transfer: nadajemy 0xFF (same sloty odczytu)
+void onewire_read_bytes(OneWire *ow, uint8_t *data, size_t len)
+{
+    static const uint8_t ones[BYTES_PER_TRANSFER] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+    while (len) {
+        size_t chunk = len < BYTES_PER_TRANSFER ? len : BYTES_PER_TRANSFER;
+        int n = transfer(ow, ow->bytes_enc, ones, chunk, SLOT_RX_IDLE_NS);
+        for (size_t i = 0; i < chunk; i++) {
+            uint8_t byte = 0;
+            for (int b = 0; b < 8; b++) {
+                int k = (int)i * 8 + b;
+                // Brak symbolu (błąd transferu) = 1, jak przy bit-bangingu pustej magistrali
+                if (k >= n || ow->rx_buf[k].duration0 < READ_THRESHOLD_US) {
+                    byte |= (uint8_t)(1 << b);
+                }
+            }
+            data[i] = byte;
+        }
+        data += chunk;
+        len -= chunk;
+    }
+}
+
+// Zapisywanie bajtu
+void onewire_write_byte(OneWire *ow, uint8_t byte)
+{
+    onewire_write_bytes(ow, &byte, 1);
+}
+
+// Odczyt bajtu
+uint8_t onewire_read_byte(OneWire *ow)
+{
+    uint8_t byte;
+    onewire_read_bytes(ow, &byte, 1);
+    return byte;
+}
+
+#endif // ONEWIRE_BACKEND_RMT
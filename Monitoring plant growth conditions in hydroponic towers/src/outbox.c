@@ -0,0 +1,539 @@
+#include "outbox.h"
+#include "mqtt.h"
+#include "storage.h"
+#include "sdcard_spi.h"
+#include "recbuf.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static const char *TAG = "OUTBOX";
+
+// Zdarzenia z zadania MQTT (msg_id > 0 to PUBACK)
+#define EV_CONNECTED     (-1)
+#define EV_DISCONNECTED  (-2)
+#define EV_QUEUE_LEN     32
+
+typedef struct __attribute__((packed)) {
+    uint32_t gen;                 // Licznik zapisów - wygrywa większy
+    uint32_t seq;                 // seq ostatniego potwierdzonego rekordu
+    uint32_t day;                 // Pozycja za tym rekordem
+    uint32_t offset;
+    uint16_t flags;               // CURSOR_HAS_SEQ
+    uint16_t crc;
+} cursor_slot_t;
+
+#define CURSOR_HAS_SEQ  0x0001
+
+typedef struct {
+    uint32_t seq;
+    bool has_seq;                 // false = jeszcze nic nie potwierdzono
+    logstore_pos_t next;          // Pozycja pierwszego niepotwierdzonego rekordu
+    uint32_t gen;
+} cursor_t;
+
+typedef struct {
+    int msg_id;
+    bool acked;
+    uint32_t seq;                 // seq ostatniego rekordu wiadomości
+    uint32_t records;
+    logstore_pos_t next;          // Pozycja za ostatnim rekordem wiadomości
+    int64_t sent_us;
+} inflight_t;
+
+typedef struct {
+    logrec_t *rec;                // Rekord współdzielony z zadaniem zapisu (recbuf)
+    logstore_pos_t pos;
+    int64_t written_us;           // Czas zapisu (wiek paczki)
+} ring_entry_t;
+
+static char log_dir[LOGSTORE_PATH_MAX];
+static char cursor_path[LOGSTORE_PATH_MAX];
+static bool initialized = false;
+static QueueHandle_t ev_queue = NULL;
+static logrec_header_t schema_hdr;  // Schemat do formatowania payloadu
+
+static cursor_t cursor;
+static uint32_t unsaved = 0;        // PUBACK od ostatniego zapisu kursora
+static logstore_pos_t send_pos;     // Następny rekord do wysłania
+static inflight_t inflight[OUTBOX_MAX_INFLIGHT];
+static uint32_t inflight_head = 0, inflight_count = 0;
+
+static ring_entry_t ring[OUTBOX_RING_RECORDS];
+static uint32_t ring_next = 0, ring_count = 0;
+static logstore_pos_t newest_pos;   // Pozycja ostatniego zapisanego rekordu
+static bool has_newest = false;
+
+static uint32_t batch_records = 0;  // 1 = rekord na wiadomość (bez tablicy), 0 = brak buforów
+static outbox_format_t payload_format = OUTBOX_FORMAT_JSON;
+static int64_t batch_age_us = 0;
+// Ustawienia z outbox_set_batch (dowolne zadanie) - stosuje je outbox_pump
+static volatile uint32_t batch_records_req = 1;
+static volatile uint32_t batch_age_sec_req = 0;
+// Bufory paczki i payloadu na stercie, dopasowane do batch_records
+static logrec_t *batch = NULL;
+static char *payload = NULL;
+static size_t payload_size = 0;
+
+// Plik doby otwarty na czas jednej paczki - kolejne rekordy bez ponownego fopen
+static logstore_reader_t reader = { .f = NULL };
+static uint32_t reader_day = 0;
+
+static uint32_t tokens = OUTBOX_MAX_INFLIGHT;
+static int64_t refill_us = 0;
+static outbox_stats_t stats = {0};
+
+/********************
+ * Kursor (OUTBOX.CUR)
+ ********************/
+static bool cursor_load(void) {
+    FILE *f = fopen(cursor_path, "rb");
+    if (!f) return false;
+
+    cursor_slot_t slot[2];
+    size_t n = fread(slot, sizeof(cursor_slot_t), 2, f);
+    fclose(f);
+
+    const cursor_slot_t *best = NULL;
+    for (size_t i = 0; i < n; i++) {
+        if (slot[i].crc != logrec_crc16(&slot[i], offsetof(cursor_slot_t, crc))) continue;
+        if (!best || slot[i].gen > best->gen) best = &slot[i];
+    }
+    if (!best) return false;
+
+    cursor.gen = best->gen;
+    cursor.seq = best->seq;
+    cursor.has_seq = best->flags & CURSOR_HAS_SEQ;
+    cursor.next.day = best->day;
+    cursor.next.offset = best->offset;
+    return true;
+}
+
+static esp_err_t cursor_save(void) {
+    cursor.gen++;
+    cursor_slot_t slot = {
+        .gen = cursor.gen,
+        .seq = cursor.seq,
+        .day = cursor.next.day,
+        .offset = cursor.next.offset,
+        .flags = cursor.has_seq ? CURSOR_HAS_SEQ : 0,
+    };
+    slot.crc = logrec_crc16(&slot, offsetof(cursor_slot_t, crc));
+
+    // Sloty na przemian - uszkodzony zapis zostawia poprzedni
+    FILE *f = fopen(cursor_path, "r+b");
+    if (!f) f = fopen(cursor_path, "w+b");
+    if (!f) return ESP_FAIL;
+
+    bool ok = fseek(f, (long)((cursor.gen & 1) * sizeof(slot)), SEEK_SET) == 0 &&
+              fwrite(&slot, 1, sizeof(slot), f) == sizeof(slot) &&
+              fflush(f) == 0 && fsync(fileno(f)) == 0;
+    if (fclose(f) != 0) ok = false;
+    if (!ok) return ESP_FAIL;
+
+    unsaved = 0;
+    stats.cursor_saves++;
+    return ESP_OK;
+}
+
+// Pierwsze uruchomienie: kursor na końcu najnowszego pliku doby
+static void cursor_init_at_end(void) {
+    memset(&cursor, 0, sizeof(cursor));
+    cursor.next.offset = LOGREC_HEADER_SIZE;
+
+    char name[16];
+    if (!logstore_find_last_day(log_dir, NULL, name, sizeof(name))) return;
+
+    char path[LOGSTORE_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s", log_dir, name);
+    cursor.next.day = logstore_day_from_name(name);
+
+    logstore_reader_t rd;
+    if (logstore_reader_open(&rd, path) != ESP_OK) return;
+    if (rd.size >= LOGREC_HEADER_SIZE + rd.record_size) {
+        uint32_t records = (rd.size - LOGREC_HEADER_SIZE) / rd.record_size;
+        logrec_t last;
+        bool valid;
+        cursor.next.offset = LOGREC_HEADER_SIZE + records * rd.record_size;
+        if (logstore_reader_seek(&rd, cursor.next.offset - rd.record_size) &&
+            logstore_reader_read(&rd, &last, 1, &valid) == 1 && valid) {
+            cursor.seq = last.seq;
+            cursor.has_seq = true;
+        }
+    }
+    logstore_reader_close(&rd);
+}
+
+/********************
+ * Odczyt rekordów zza kursora
+ ********************/
+static void day_name(uint32_t day, char *out, size_t len) {
+    char path[LOGSTORE_PATH_MAX];
+    logstore_day_path("", day * LOGSTORE_SECONDS_PER_DAY, "DAT", path, sizeof(path));
+    snprintf(out, len, "%s", path + 1);  // Bez początkowego '/'
+}
+
+static bool pos_equal(const logstore_pos_t *a, const logstore_pos_t *b) {
+    return a->day == b->day && a->offset == b->offset;
+}
+
+static bool ring_find(const logstore_pos_t *pos, logrec_t *rec, int64_t *written_us) {
+    for (uint32_t i = 0; i < ring_count; i++) {
+        if (pos_equal(&ring[i].pos, pos)) {
+            *rec = *ring[i].rec;
+            *written_us = ring[i].written_us;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void reader_close(void) {
+    logstore_reader_close(&reader);
+}
+
+static bool reader_open(uint32_t day) {
+    if (reader.f && reader_day == day) return true;
+    reader_close();
+
+    char name[16], path[LOGSTORE_PATH_MAX];
+    day_name(day, name, sizeof(name));
+    snprintf(path, sizeof(path), "%s/%s", log_dir, name);
+    esp_err_t err = logstore_reader_open(&reader, path);
+    if (err != ESP_OK) {
+        if (err != ESP_ERR_NOT_FOUND) ESP_LOGW(TAG, "%s: skipped (%s)", path, esp_err_to_name(err));
+        return false;
+    }
+    reader_day = day;
+    return true;
+}
+
+// Czyta do max kolejnych rekordów od pos->offset jednym fread (uchwyt doby
+// zostaje otwarty do końca paczki). Plik starszej wersji jest dekodowany wg
+// nagłówka. Rekordy z błędnym CRC i już potwierdzone są pomijane; pos->offset
+// przesuwa się za ostatni przeczytany rekord.
+static uint32_t file_read(logstore_pos_t *pos, logrec_t *recs, uint32_t max) {
+    if (!reader_open(pos->day)) return 0;
+    // Offset niewyrównany do rekordu (kursor sprzed zmiany formatu) - w dół, resztę odsieje seq
+    if (!logstore_reader_seek(&reader, pos->offset)) return 0;
+    pos->offset = reader.offset;
+
+    bool valid[OUTBOX_BATCH_MAX];
+    if (max > OUTBOX_BATCH_MAX) max = OUTBOX_BATCH_MAX;
+    uint32_t count = 0;
+    size_t got;
+    while (count == 0 && (got = logstore_reader_read(&reader, recs, max, valid)) > 0) {
+        for (size_t i = 0; i < got; i++) {
+            // Po kompakcji starego pliku offsety się zmieniają - pilnuje tego seq
+            if (!valid[i] || (cursor.has_seq && recs[i].seq <= cursor.seq)) continue;
+            if (count != i) recs[count] = recs[i];
+            count++;
+        }
+        pos->offset = reader.offset;
+    }
+    return count;
+}
+
+// Do max kolejnych rekordów do wysłania; pos przesuwa się za ostatni z nich.
+// written_us = czas zapisu rekordu z pierścienia RAM, 0 dla rekordów z pliku
+static uint32_t next_records(logstore_pos_t *pos, logrec_t *recs, uint32_t max, int64_t *written_us) {
+    if (!has_newest && !cursor.has_seq) return 0;
+
+    for (int retry = 0; retry < 2; retry++) {
+        while (true) {
+            if (ring_find(pos, recs, written_us)) {
+                pos->offset += LOGREC_RECORD_SIZE;
+                return 1;
+            }
+            *written_us = 0;
+            uint32_t n = file_read(pos, recs, max);
+            if (n) return n;
+
+            // Koniec pliku doby: przejdź do następnego istniejącego pliku
+            if (has_newest && pos->day >= newest_pos.day) break;
+            char name[16], next[16];
+            day_name(pos->day, name, sizeof(name));
+            if (!logstore_find_next_day(log_dir, name, next, sizeof(next))) break;
+            pos->day = logstore_day_from_name(next);
+            pos->offset = LOGREC_HEADER_SIZE;
+        }
+
+        // Rekord zapisany, ale jeszcze w buforze logu i już nie w pierścieniu RAM.
+        // Uchwyt odczytu widzi rozmiar pliku z chwili otwarcia - po sync otwieramy go od nowa
+        if (!has_newest || pos->day != newest_pos.day || pos->offset > newest_pos.offset) break;
+        sensor_sdcard_sync();
+        reader_close();
+    }
+    return 0;
+}
+
+/********************
+ * Zdarzenia MQTT
+ ********************/
+static void on_mqtt_ack(int msg_id) {
+    if (ev_queue) xQueueSend(ev_queue, &msg_id, 0);
+    storage_wake();
+}
+
+static void on_mqtt_conn(bool connected) {
+    int ev = connected ? EV_CONNECTED : EV_DISCONNECTED;
+    if (ev_queue) xQueueSend(ev_queue, &ev, 0);
+    storage_wake();
+}
+
+// Wszystko niepotwierdzone zostanie wysłane ponownie od kursora
+static void rewind_to_cursor(void) {
+    if (inflight_count) stats.rewinds++;
+    inflight_head = 0;
+    inflight_count = 0;
+    send_pos = cursor.next;
+}
+
+static void handle_ack(int msg_id) {
+    for (uint32_t i = 0; i < inflight_count; i++) {
+        inflight_t *e = &inflight[(inflight_head + i) % OUTBOX_MAX_INFLIGHT];
+        if (e->msg_id == msg_id) {
+            e->acked = true;
+            break;
+        }
+    }
+
+    // Kursor przesuwa się tylko po ciągłym prefiksie potwierdzeń
+    while (inflight_count && inflight[inflight_head].acked) {
+        inflight_t *e = &inflight[inflight_head];
+        cursor.seq = e->seq;
+        cursor.has_seq = true;
+        cursor.next = e->next;
+        inflight_head = (inflight_head + 1) % OUTBOX_MAX_INFLIGHT;
+        inflight_count--;
+        unsaved += e->records;
+        stats.acked += e->records;
+    }
+}
+
+static void process_events(void) {
+    int ev;
+    while (xQueueReceive(ev_queue, &ev, 0) == pdTRUE) {
+        if (ev == EV_CONNECTED) {
+            stats.connected = true;
+            tokens = OUTBOX_MAX_INFLIGHT;
+            refill_us = esp_timer_get_time();
+            rewind_to_cursor();
+        } else if (ev == EV_DISCONNECTED) {
+            stats.connected = false;
+            rewind_to_cursor();
+        } else {
+            handle_ack(ev);
+        }
+    }
+}
+
+/********************
+ * Wysyłka
+ ********************/
+// Zbiera do batch_records rekordów zza send_pos i publikuje je jedną wiadomością.
+// Niepełna paczka czeka, aż najstarszy rekord będzie starszy niż batch_age_us
+// (zaległości z pliku wychodzą od razu).
+static bool send_batch(int64_t now) {
+    logstore_pos_t pos = send_pos;
+    uint32_t count = 0;
+    int64_t first_us = 0;
+
+    while (count < batch_records) {
+        int64_t written_us;
+        uint32_t n = next_records(&pos, &batch[count], batch_records - count, &written_us);
+        if (n == 0) break;
+        if (count == 0) first_us = written_us;
+        count += n;
+    }
+    reader_close();
+    logstore_pos_t next = pos;
+    if (count == 0) return false;
+    if (count < batch_records && first_us && now - first_us < batch_age_us) return false;
+
+    int len;
+    const char *topic = OUTBOX_TOPIC;
+    if (payload_format == OUTBOX_FORMAT_CBOR) {
+        len = logrec_format_cbor(batch, count, (uint8_t *)payload, payload_size);
+        topic = OUTBOX_TOPIC_CBOR;
+    } else if (batch_records > 1) {
+        len = logrec_format_batch(&schema_hdr, batch, count, payload, payload_size);
+    } else {
+        len = logrec_format_ndjson(&schema_hdr, &batch[0], payload, payload_size);
+    }
+    if (len < 0) return false;
+    // Kolejka klienta MQTT kopiuje payload - zadanie zapisu nie czeka na gniazdo
+    int msg_id = mqtt_enqueue_qos1(topic, payload, len);
+    if (msg_id <= 0) return false;  // Brak połączenia lub pełna kolejka klienta
+
+    inflight_t *e = &inflight[(inflight_head + inflight_count) % OUTBOX_MAX_INFLIGHT];
+    e->msg_id = msg_id;
+    e->acked = false;
+    e->seq = batch[count - 1].seq;
+    e->records = count;
+    e->next = next;
+    e->sent_us = now;
+    inflight_count++;
+
+    send_pos = next;
+    stats.sent++;
+    stats.records_sent += count;
+    stats.bytes_sent += (uint32_t)len;
+    return true;
+}
+
+/********************
+ * API
+ ********************/
+esp_err_t outbox_init(const char *dir) {
+    if (!dir || strlen(dir) >= sizeof(log_dir)) return ESP_ERR_INVALID_ARG;
+
+    strncpy(log_dir, dir, sizeof(log_dir) - 1);
+    snprintf(cursor_path, sizeof(cursor_path), "%s/OUTBOX.CUR", dir);
+    logrec_header_init(&schema_hdr, 0);
+
+    ev_queue = xQueueCreate(EV_QUEUE_LEN, sizeof(int));
+    if (!ev_queue) return ESP_ERR_NO_MEM;
+
+    if (!cursor_load()) {
+        cursor_init_at_end();
+        cursor_save();
+        ESP_LOGI(TAG, "New outbox cursor at end of log");
+    } else if (sensor_binlog_upgraded(cursor.next.day)) {
+        // Offset kursora liczony w starym rozmiarze rekordu - od początku doby, duplikaty odsieje seq
+        cursor.next.offset = LOGREC_HEADER_SIZE;
+        cursor_save();
+        ESP_LOGI(TAG, "Log file of cursor upgraded - cursor reset to start of day");
+    }
+    send_pos = cursor.next;
+    stats.acked_seq = cursor.seq;
+
+    initialized = true;
+    mqtt_set_callbacks(on_mqtt_ack, on_mqtt_conn);
+    if (mqtt_is_connected()) on_mqtt_conn(true);
+
+    ESP_LOGI(TAG, "Outbox cursor: seq %lu%s (gen %lu)", (unsigned long)cursor.seq,
+             cursor.has_seq ? "" : " (none)", (unsigned long)cursor.gen);
+    return ESP_OK;
+}
+
+void outbox_record_written(logrec_t *rec, const logstore_pos_t *pos) {
+    if (!initialized) return;
+    // Pierścień trzyma referencję rekordu zamiast kopii
+    recbuf_unref(ring[ring_next].rec);
+    recbuf_ref(rec);
+    ring[ring_next].rec = rec;
+    ring[ring_next].pos = *pos;
+    ring[ring_next].written_us = esp_timer_get_time();
+    ring_next = (ring_next + 1) % OUTBOX_RING_RECORDS;
+    if (ring_count < OUTBOX_RING_RECORDS) ring_count++;
+
+    newest_pos = *pos;
+    has_newest = true;
+    stats.last_seq = rec->seq;
+}
+
+void outbox_realign(uint32_t first_day) {
+    if (!initialized) return;
+    for (uint32_t i = 0; i < OUTBOX_RING_RECORDS; i++) {
+        recbuf_unref(ring[i].rec);
+        ring[i].rec = NULL;
+    }
+    ring_next = 0;
+    ring_count = 0;
+    // Pozycję najnowszego rekordu poda następny zapis; do tego czasu czytamy pliki do końca
+    has_newest = false;
+    reader_close();
+
+    if (cursor.next.day >= first_day) {
+        cursor.next.offset = LOGREC_HEADER_SIZE;
+        if (cursor_save() != ESP_OK) ESP_LOGW(TAG, "Cursor save failed");
+    }
+    rewind_to_cursor();
+    ESP_LOGI(TAG, "Log rewritten from day %lu - ring dropped, sending from cursor",
+             (unsigned long)first_day);
+}
+
+// Bufory paczki dla nowego batch_records (zmiana z outbox_set_batch)
+static bool apply_batch(void) {
+    uint32_t records = batch_records_req;
+    batch_age_us = (int64_t)batch_age_sec_req * 1000000;
+    if (records == batch_records) return true;
+
+    size_t size = (size_t)records * OUTBOX_PAYLOAD_PER_RECORD + 64;
+    logrec_t *b = malloc(records * sizeof(logrec_t));
+    char *p = malloc(size);
+    if (!b || !p) {
+        free(b);
+        free(p);
+        ESP_LOGE(TAG, "No memory for %lu-record batch", (unsigned long)records);
+        if (batch_records) batch_records_req = batch_records;  // Zostaje poprzednie N
+        return batch_records > 0;
+    }
+    free(batch);
+    free(payload);
+    batch = b;
+    payload = p;
+    payload_size = size;
+    batch_records = records;
+    return true;
+}
+
+void outbox_pump(void) {
+    if (!initialized) return;
+    process_events();
+
+    int64_t now = esp_timer_get_time();
+    if (inflight_count &&
+        now - inflight[inflight_head].sent_us > (int64_t)OUTBOX_ACK_TIMEOUT_MS * 1000) {
+        ESP_LOGW(TAG, "PUBACK timeout (seq %lu) - resending from cursor",
+                 (unsigned long)inflight[inflight_head].seq);
+        rewind_to_cursor();
+    }
+
+    if (stats.connected && apply_batch()) {
+        // Token bucket: OUTBOX_RATE_PER_SEC, paczka do OUTBOX_MAX_INFLIGHT
+        uint32_t add = (uint32_t)((now - refill_us) * OUTBOX_RATE_PER_SEC / 1000000);
+        if (add) {
+            tokens = tokens + add > OUTBOX_MAX_INFLIGHT ? OUTBOX_MAX_INFLIGHT : tokens + add;
+            refill_us += (int64_t)add * 1000000 / OUTBOX_RATE_PER_SEC;
+        }
+
+        while (tokens && inflight_count < OUTBOX_MAX_INFLIGHT) {
+            if (!send_batch(now)) break;
+            tokens--;
+        }
+    }
+
+    // Kursor na kartę co OUTBOX_SAVE_EVERY potwierdzeń albo gdy nic nie czeka
+    if (unsaved && (unsaved >= OUTBOX_SAVE_EVERY || inflight_count == 0)) {
+        if (cursor_save() != ESP_OK) ESP_LOGW(TAG, "Cursor save failed");
+    }
+    stats.acked_seq = cursor.seq;
+    stats.inflight = inflight_count;
+}
+
+esp_err_t outbox_set_batch(uint32_t max_records, uint32_t max_age_sec) {
+    if (max_records < 1 || max_records > OUTBOX_BATCH_MAX) return ESP_ERR_INVALID_ARG;
+    // Bufory przydziela zadanie zapisu przy następnym outbox_pump
+    batch_records_req = max_records;
+    batch_age_sec_req = max_age_sec;
+    ESP_LOGI(TAG, "MQTT batch: up to %lu records / %lu s", (unsigned long)max_records,
+             (unsigned long)max_age_sec);
+    return ESP_OK;
+}
+
+void outbox_set_format(outbox_format_t format) {
+    payload_format = format;
+    ESP_LOGI(TAG, "MQTT payload: %s on %s", format == OUTBOX_FORMAT_CBOR ? "CBOR" : "JSON",
+             format == OUTBOX_FORMAT_CBOR ? OUTBOX_TOPIC_CBOR : OUTBOX_TOPIC);
+}
+
+void outbox_get_stats(outbox_stats_t *out) {
+    if (out) *out = stats;
+}
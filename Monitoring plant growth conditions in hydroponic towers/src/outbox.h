@@ -0,0 +1,112 @@
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include "esp_err.h"
+#include "logrec.h"
+#include "logstore.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Trwały outbox MQTT (store-and-forward) oparty na logu binarnym na karcie SD.
+ *
+ * Log dzienny (logstore.h) zawiera już każdy rekord z numerem seq, więc outbox
+ * nie kopiuje danych - pamięta tylko kursor: seq i pozycję za ostatnim rekordem
+ * potwierdzonym przez broker (PUBACK, QoS 1). Wszystko za kursorem jest wysyłane
+ * po połączeniu, także po restarcie (at-least-once - odbiorca odrzuca duplikaty
+ * po seq). Zaległości są wysyłane porcjami z limitem szybkości.
+ *
+ * Kursor leży w <dir>/OUTBOX.CUR w dwóch slotach z licznikiem i CRC, więc zanik
+ * zasilania w trakcie zapisu zostawia poprzednią wersję.
+ *
+ * Paczkowanie (outbox_set_batch): do N rekordów w jednej wiadomości
+ * (logrec_format_batch), niepełna paczka wychodzi, gdy najstarszy rekord
+ * czeka dłużej niż T sekund. Przy N = 1 wiadomość to pojedynczy rekord NDJSON.
+ * Jedno PUBACK potwierdza całą paczkę, więc każda wiadomość w oknie
+ * OUTBOX_MAX_INFLIGHT przenosi do N rekordów.
+ *
+ * Payload JSON (OUTBOX_TOPIC) albo CBOR (OUTBOX_TOPIC_CBOR, outbox_set_format).
+ *
+ * Rekordy z pliku są czytane jednym fread na paczkę (plik doby otwarty raz na
+ * paczkę), a wiadomość trafia do kolejki klienta MQTT (mqtt_enqueue_qos1), więc
+ * zadanie zapisu nie czeka na sieć. Bufory paczki i payloadu leżą na stercie
+ * i mają rozmiar dla bieżącego N (N * OUTBOX_PAYLOAD_PER_RECORD + 64 B).
+ *
+ * Poza callbackami MQTT i outbox_set_batch / outbox_set_format wszystkie
+ * funkcje woła zadanie zapisu (storage_task).
+ */
+
+#define OUTBOX_TOPIC           "das_tower/measurements"
+#define OUTBOX_TOPIC_CBOR      "das_tower/measurements/cbor"
+#define OUTBOX_MAX_INFLIGHT    8       // Wiadomości wysłane bez PUBACK
+#define OUTBOX_RATE_PER_SEC    5       // Limit wysyłania (zaległości po rozłączeniu)
+#define OUTBOX_ACK_TIMEOUT_MS  30000   // Brak PUBACK -> ponowne wysłanie od kursora
+#define OUTBOX_SAVE_EVERY      32      // Zapis kursora co tyle PUBACK (i gdy nic nie czeka)
+#define OUTBOX_RING_RECORDS    32      // Ostatnie rekordy w RAM (mogą być jeszcze w oknie trwałości logu)
+#define OUTBOX_BATCH_MAX       64      // Największa paczka rekordów w jednej wiadomości
+#define OUTBOX_PAYLOAD_PER_RECORD 320  // ~250 B JSON na rekord + sondy DS18B20
+
+typedef enum {
+    OUTBOX_FORMAT_JSON = 0,   // NDJSON przeglądarki (logrec_format_ndjson/batch), OUTBOX_TOPIC
+    OUTBOX_FORMAT_CBOR,       // logrec_format_cbor, OUTBOX_TOPIC_CBOR
+} outbox_format_t;
+
+typedef struct {
+    uint32_t acked_seq;       // seq ostatniego potwierdzonego rekordu
+    uint32_t last_seq;        // seq ostatniego zapisanego rekordu
+    uint32_t inflight;        // Wysłane, czekają na PUBACK
+    uint32_t sent;            // Wiadomości
+    uint32_t records_sent;    // Rekordy w wysłanych wiadomościach (z ponownymi)
+    uint32_t bytes_sent;      // Bajty payloadu
+    uint32_t acked;           // Potwierdzone rekordy
+    uint32_t rewinds;         // Powroty do kursora (rozłączenie, timeout PUBACK)
+    uint32_t cursor_saves;
+    bool connected;
+} outbox_stats_t;
+
+/**
+ * Wczytuje kursor (lub tworzy go na końcu istniejącego logu - stare dane nie są
+ * wysyłane przy pierwszym uruchomieniu) i rejestruje callbacki MQTT.
+ * Wołać po sensor_binlog_recover(), przed storage_start().
+ */
+esp_err_t outbox_init(const char *dir);
+
+/**
+ * Informuje outbox o rekordzie zapisanym do logu. Pierścień RAM bierze
+ * referencję rekordu z puli recbuf (bez kopiowania).
+ */
+void outbox_record_written(logrec_t *rec, const logstore_pos_t *pos);
+
+/**
+ * Log został przepisany od doby first_day (usuwanie rekordów, retencja):
+ * offsety w tych dobach są inne. Opróżnia pierścień RAM (klucz = pozycja),
+ * kursor w przepisanej dobie wraca na jej początek, a wysyłka i wiadomości
+ * w locie - do kursora. Rekordy już potwierdzone odsiewa seq. Woła zadanie
+ * zapisu albo storage_purge pod blokadą karty.
+ */
+void outbox_realign(uint32_t first_day);
+
+/**
+ * Przetwarza PUBACK i zmiany połączenia, wysyła kolejne rekordy zza kursora.
+ */
+void outbox_pump(void);
+
+/**
+ * Ustawia paczkowanie: do max_records rekordów (1..OUTBOX_BATCH_MAX) w jednej
+ * wiadomości, niepełna paczka najpóźniej po max_age_sec od zapisu najstarszego
+ * rekordu (0 = bez czekania). Można wołać z dowolnego zadania - bufory
+ * o nowym rozmiarze przydziela zadanie zapisu przy następnym outbox_pump().
+ */
+esp_err_t outbox_set_batch(uint32_t max_records, uint32_t max_age_sec);
+
+/**
+ * Wybiera kodowanie payloadu (i temat). Dotyczy kolejnych wiadomości.
+ */
+void outbox_set_format(outbox_format_t format);
+
+/**
+ * Kopiuje liczniki outboxa.
+ */
+void outbox_get_stats(outbox_stats_t *stats);
+
+#endif // OUTBOX_H
@@ -0,0 +1,108 @@
+#include "payload_bench.h"
+#include "logrec.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char *TAG = "BENCH";
+
+#define BENCH_RECORDS  16
+
+typedef int (*bench_fn_t)(uint32_t i, char *buf, size_t len);
+
+typedef struct {
+    const char *name;
+    bench_fn_t fn;
+    uint32_t iterations;
+    uint64_t cycles;
+    uint64_t bytes;
+    uint32_t stack_used;
+    TaskHandle_t caller;
+} bench_case_t;
+
+static logrec_header_t hdr;
+static logrec_t recs[BENCH_RECORDS];
+static char out[512];  // Poza stosem - mierzymy sam formatter
+
+static void make_records(void) {
+    for (uint32_t i = 0; i < BENCH_RECORDS; i++) {
+        logrec_t *r = &recs[i];
+        memset(r, 0, sizeof(*r));
+        r->seq = i;
+        r->timestamp = 1760486400u + i * 600;
+        r->temp_ds18 = logrec_pack_i16(19.5f + i * 0.07f, 100.0f);
+        for (int p = 0; p < LOGREC_PROBES; p++) r->temp_probe[p] = p == 0 ? r->temp_ds18 : LOGREC_NA_I16;
+        r->temp_dht = logrec_pack_i16(21.0f + i * 0.5f, 100.0f);
+        r->humidity = logrec_pack_u16(55.0f + i * 0.3f, 100.0f);
+        r->ph = logrec_pack_u16(5.5f + (i % 10) * 0.05f, 100.0f);
+        r->light = logrec_pack_u32(i * 37.25f, 100.0f);
+        r->flags = (i & 1) ? LOGREC_FLAG_RELAY1 : 0;
+        logrec_seal(r);
+    }
+}
+
+// Dawny publish_to_mqtt(): pięć wartości float przez %.2f
+static int format_snprintf(uint32_t i, char *buf, size_t len) {
+    const logrec_t *r = &recs[i % BENCH_RECORDS];
+    return snprintf(buf, len,
+        "{\"timestamp\":\"%s\",\"temp_ds18\":%.2f,\"temp_dht\":%.2f,\"humidity\":%.2f,\"light\":%.2f,\"ph\":%.2f,"
+        "\"relay1\":%s,\"relay1_mode\":\"%s\",\"relay1_on_ms\":%lu,\"relay1_off_ms\":%lu,"
+        "\"relay2\":%s,\"relay2_mode\":\"%s\"}",
+        "2026-10-15 12:00:00", r->temp_ds18 / 100.0f, r->temp_dht / 100.0f, r->humidity / 100.0f,
+        r->light / 100.0f, r->ph / 100.0f, (r->flags & LOGREC_FLAG_RELAY1) ? "true" : "false",
+        "manual", 0UL, 0UL, "false", "manual");
+}
+
+static int format_jsonw(uint32_t i, char *buf, size_t len) {
+    return logrec_format_ndjson(&hdr, &recs[i % BENCH_RECORDS], buf, len);
+}
+
+static void bench_task(void *arg) {
+    bench_case_t *c = arg;
+
+    esp_cpu_cycle_count_t start = esp_cpu_get_cycle_count();
+    for (uint32_t i = 0; i < c->iterations; i++) {
+        int n = c->fn(i, out, sizeof(out));
+        if (n > 0) c->bytes += (uint32_t)n;
+    }
+    c->cycles = (uint32_t)(esp_cpu_get_cycle_count() - start);
+
+    c->stack_used = PAYLOAD_BENCH_STACK - uxTaskGetStackHighWaterMark(NULL);
+    xTaskNotifyGive(c->caller);
+    vTaskDelete(NULL);
+}
+
+esp_err_t payload_bench_run(uint32_t iterations) {
+    if (iterations == 0) return ESP_ERR_INVALID_ARG;
+    // Licznik cykli 32-bitowy: przy 240 MHz przepełnia się po ~17 s
+    if (iterations > 2000) iterations = 2000;
+
+    logrec_header_init(&hdr, 0);
+    make_records();
+
+    bench_case_t cases[] = {
+        { .name = "snprintf", .fn = format_snprintf },
+        { .name = "jsonw", .fn = format_jsonw },
+    };
+
+    printf("\nPayload formatting, %lu records per case (stack %d B per task)\n",
+           (unsigned long)iterations, PAYLOAD_BENCH_STACK);
+    printf("  %-10s %12s %10s %12s\n", "writer", "cycles/rec", "bytes/rec", "stack [B]");
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        bench_case_t *c = &cases[i];
+        c->iterations = iterations;
+        c->caller = xTaskGetCurrentTaskHandle();
+        if (xTaskCreate(bench_task, "bench_task", PAYLOAD_BENCH_STACK, c, 1, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Cannot create bench task");
+            return ESP_ERR_NO_MEM;
+        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        printf("  %-10s %12lu %10lu %12lu\n", c->name, (unsigned long)(c->cycles / iterations),
+               (unsigned long)(c->bytes / iterations), (unsigned long)c->stack_used);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,25 @@
+#ifndef PAYLOAD_BENCH_H
+#define PAYLOAD_BENCH_H
+
+#include "esp_err.h"
+#include <stdint.h>
+
+/**
+ * Mikrobenchmark formatowania payloadu na ESP32 (komenda UART BENCH:JSON).
+ *
+ * Porównuje dawną ścieżkę publish_to_mqtt (snprintf z %.2f) z writerem jsonw
+ * (logrec_format_ndjson): cykle CPU na rekord (esp_cpu_get_cycle_count) i
+ * szczyt użycia stosu. Każdy wariant działa w osobnym zadaniu ze stosem
+ * PAYLOAD_BENCH_STACK, a szczyt to rozmiar stosu minus
+ * uxTaskGetStackHighWaterMark. Działa też w QEMU (idf.py qemu monitor);
+ * odpowiednik na PC: tools/bench_json.c.
+ */
+
+#define PAYLOAD_BENCH_STACK  4096
+
+/**
+ * Uruchamia pomiar (blokuje wywołującego do końca) i wypisuje wyniki na konsolę.
+ */
+esp_err_t payload_bench_run(uint32_t iterations);
+
+#endif // PAYLOAD_BENCH_H
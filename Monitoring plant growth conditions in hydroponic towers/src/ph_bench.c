@@ -0,0 +1,72 @@
+#include "ph_bench.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <math.h>
+#include <stdio.h>
+
+static const char *TAG = "BENCH_PH";
+
+typedef struct {
+    const char *name;
+    uint32_t ok;
+    int64_t total_us;
+    double sum;
+    double sum_sq;
+} path_stats_t;
+
+static void add(path_stats_t *p, float mv, int64_t us) {
+    p->ok++;
+    p->total_us += us;
+    p->sum += mv;
+    p->sum_sq += (double)mv * mv;
+}
+
+static void print_row(const path_stats_t *p, float ph_per_mv) {
+    if (p->ok == 0) {
+        printf("  %-8s %10s\n", p->name, "failed");
+        return;
+    }
+    double mean = p->sum / p->ok;
+    double var = p->ok > 1 ? (p->sum_sq - p->sum * mean) / (p->ok - 1) : 0.0;
+    double sd = var > 0 ? sqrt(var) : 0.0;
+    printf("  %-8s %10lu %12.1f %10.2f %10.3f\n", p->name, (unsigned long)(p->total_us / p->ok),
+           mean, sd, sd * ph_per_mv);
+}
+
+esp_err_t ph_bench_run(ph_sensor_t *sensor, uint32_t readings) {
+    if (!sensor || readings < 2) return ESP_ERR_INVALID_ARG;
+    if (readings > 500) readings = 500;
+
+    path_stats_t single = { .name = "single" };
+    path_stats_t burst = { .name = "dma" };
+    float intra_sd = 0.0f;
+
+    for (uint32_t i = 0; i < readings; i++) {
+        float mv;
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t err = ph_sensor_sample_mv(sensor, PH_ADC_CHANNEL, &mv);
+        int64_t t1 = esp_timer_get_time();
+        if (err == ESP_OK) add(&single, mv, t1 - t0);
+
+        ph_burst_t b;
+        err = ph_sensor_burst_mv(sensor, &b);
+        if (err == ESP_OK) {
+            add(&burst, b.mean_mv, b.duration_us);
+            intra_sd += b.stddev_mv;
+        } else {
+            ESP_LOGW(TAG, "Burst %lu failed: %s", (unsigned long)i, esp_err_to_name(err));
+        }
+    }
+
+    float ph_per_mv = fabsf(1.0f / ph_sensor_mv_per_ph(sensor, sensor->temperature));
+    printf("\npH acquisition, %lu readings per path (burst %d samples @ %d Hz, trim %d%%, calibration: %s)\n",
+           (unsigned long)readings, PH_BURST_SAMPLES, PH_BURST_SAMPLE_HZ, PH_BURST_TRIM_PCT,
+           sensor->cali_source);
+    printf("  %-8s %10s %12s %10s %10s\n", "path", "us/read", "mean [mV]", "sd [mV]", "sd [pH]");
+    print_row(&single, ph_per_mv);
+    print_row(&burst, ph_per_mv);
+    if (burst.ok) {
+        printf("  sample spread within a burst: %.2f mV\n", intra_sd / burst.ok);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,23 @@
+#ifndef PH_BENCH_H
+#define PH_BENCH_H
+
+#include "esp_err.h"
+#include "ph_sensor.h"
+#include <stdint.h>
+
+/**
+ * Porównanie ścieżek odczytu pH (komenda UART BENCH:PH).
+ *
+ * Robi readings odczytów pojedynczą próbką (adc_oneshot) i tyle samo serii
+ * DMA (ph_sensor_burst_mv), przy nieruchomej sondzie w buforze. Dla każdej
+ * ścieżki wypisuje czas na odczyt, średnie napięcie i rozrzut między
+ * odczytami (odchylenie standardowe w mV i w jednostkach pH wg bieżącej
+ * kalibracji) - to ten rozrzut widać jako skoki ręcznych odczytów pH.
+ */
+
+/**
+ * Uruchamia pomiar (blokuje wywołującego do końca) i wypisuje wyniki na konsolę.
+ */
+esp_err_t ph_bench_run(ph_sensor_t *sensor, uint32_t readings);
+
+#endif // PH_BENCH_H
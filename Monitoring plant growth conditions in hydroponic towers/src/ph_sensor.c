@@ -2,11 +2,20 @@
 #include "esp_log.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "esp_adc/adc_cali_scheme.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
 static const char *TAG = "PH_SENSOR";
 
+static SemaphoreHandle_t burst_lock = NULL;  // Bufory serii są statyczne (UART i przycisk)
+
 // ================== POMOCNICZE ==================
 
 static void str_to_upper(char *str) {
@@ -16,40 +25,268 @@ static void str_to_upper(char *str) {
     }
 }
 
+// ================== NERNST ==================
+
+// S(T) = ln(10) * R * (T + 273.15) / F [mV/pH], liczone przy kompilacji co 5 °C
+#define NERNST_T_MIN   0
+#define NERNST_T_STEP  5
+static const float nernst_mv[] = {
+    54.197f, 55.189f, 56.181f, 57.173f, 58.165f, 59.157f, 60.149f,   //  0..30 °C
+    61.141f, 62.133f, 63.125f, 64.117f, 65.109f, 66.101f,            // 35..60 °C
+};
+#define NERNST_COUNT   (sizeof(nernst_mv) / sizeof(nernst_mv[0]))
+
+float ph_sensor_nernst_mv(float temperature) {
+    if (isnan(temperature)) temperature = PH_DEFAULT_TEMPERATURE;
+    float pos = (temperature - NERNST_T_MIN) / NERNST_T_STEP;
+    if (pos <= 0.0f) return nernst_mv[0];
+    if (pos >= (float)(NERNST_COUNT - 1)) return nernst_mv[NERNST_COUNT - 1];
+    int i = (int)pos;
+    return nernst_mv[i] + (nernst_mv[i + 1] - nernst_mv[i]) * (pos - i);
+}
+
+float ph_sensor_mv_per_ph(const ph_sensor_t *sensor, float temperature) {
+    return sensor->gain * ph_sensor_nernst_mv(temperature);
+}
+
+// Najmniejsze kwadraty dla V = offset + gain * S(T) * (pH - 7) po punktach kalibracji
+static esp_err_t fit_calibration(ph_sensor_t *sensor) {
+    const struct { float ph, v, t; } pts[] = {
+        { 4.0f,  sensor->acid_voltage,    sensor->acid_temp },
+        { 7.0f,  sensor->neutral_voltage, sensor->neutral_temp },
+        { 10.0f, sensor->base_voltage,    sensor->base_temp },
+    };
+    float n = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (size_t i = 0; i < sizeof(pts) / sizeof(pts[0]); i++) {
+        if (isnan(pts[i].v)) continue;
+        float x = ph_sensor_nernst_mv(pts[i].t) * (pts[i].ph - 7.0f);
+        n += 1;
+        sx += x;
+        sy += pts[i].v;
+        sxx += x * x;
+        sxy += x * pts[i].v;
+    }
+    float det = n * sxx - sx * sx;
+    if (n < 2 || fabsf(det) < 1e-3f) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    float gain = (n * sxy - sx * sy) / det;
+    if (fabsf(gain) < 1e-3f) {
+        return ESP_ERR_INVALID_STATE;  // Ten sam odczyt w różnych buforach
+    }
+    sensor->gain = gain;
+    sensor->offset_mv = (sy - gain * sx) / n;
+    return ESP_OK;
+}
+
 // ================== NVS ==================
 
+static esp_err_t set_float(nvs_handle_t handle, const char *key, float value) {
+    if (isnan(value)) {
+        esp_err_t err = nvs_erase_key(handle, key);
+        return err == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : err;
+    }
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+static float get_float(nvs_handle_t handle, const char *key, float fallback) {
+    float value;
+    size_t size = sizeof(value);
+    if (nvs_get_blob(handle, key, &value, &size) != ESP_OK || size != sizeof(value)) {
+        return fallback;
+    }
+    return value;
+}
+
 esp_err_t ph_sensor_save_to_nvs(ph_sensor_t *sensor) {
     nvs_handle_t handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &handle);
     if (err != ESP_OK) return err;
 
-    err = nvs_set_blob(handle, NVS_KEY_NEUTRAL, &sensor->neutral_voltage, sizeof(sensor->neutral_voltage));
-    if (err == ESP_OK) {
-        err = nvs_set_blob(handle, NVS_KEY_ACID, &sensor->acid_voltage, sizeof(sensor->acid_voltage));
-    }
+    err = set_float(handle, NVS_KEY_NEUTRAL, sensor->neutral_voltage);
+    if (err == ESP_OK) err = set_float(handle, NVS_KEY_ACID, sensor->acid_voltage);
+    if (err == ESP_OK) err = set_float(handle, NVS_KEY_BASE, sensor->base_voltage);
+    if (err == ESP_OK) err = set_float(handle, NVS_KEY_NEUTRAL_T, sensor->neutral_temp);
+    if (err == ESP_OK) err = set_float(handle, NVS_KEY_ACID_T, sensor->acid_temp);
+    if (err == ESP_OK) err = set_float(handle, NVS_KEY_BASE_T, sensor->base_temp);
     if (err == ESP_OK) err = nvs_commit(handle);
 
     nvs_close(handle);
     return err;
 }
 
+// Wpisy sprzed kompensacji (tylko neutral_v / acid_v) traktujemy jak kalibrację przy 25 °C
 static esp_err_t load_from_nvs(ph_sensor_t *sensor) {
     nvs_handle_t handle;
     esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &handle);
     if (err != ESP_OK) return err;
 
-    size_t size = sizeof(float);
-    err = nvs_get_blob(handle, NVS_KEY_NEUTRAL, &sensor->neutral_voltage, &size);
-    if (err != ESP_OK) sensor->neutral_voltage = PH_DEFAULT_NEUTRAL_VOLTAGE;
-
-    size = sizeof(float);
-    err = nvs_get_blob(handle, NVS_KEY_ACID, &sensor->acid_voltage, &size);
-    if (err != ESP_OK) sensor->acid_voltage = PH_DEFAULT_ACID_VOLTAGE;
+    sensor->neutral_voltage = get_float(handle, NVS_KEY_NEUTRAL, PH_DEFAULT_NEUTRAL_VOLTAGE);
+    sensor->acid_voltage    = get_float(handle, NVS_KEY_ACID, PH_DEFAULT_ACID_VOLTAGE);
+    sensor->base_voltage    = get_float(handle, NVS_KEY_BASE, NAN);
+    sensor->neutral_temp    = get_float(handle, NVS_KEY_NEUTRAL_T, PH_DEFAULT_TEMPERATURE);
+    sensor->acid_temp       = get_float(handle, NVS_KEY_ACID_T, PH_DEFAULT_TEMPERATURE);
+    sensor->base_temp       = get_float(handle, NVS_KEY_BASE_T, PH_DEFAULT_TEMPERATURE);
 
     nvs_close(handle);
     return ESP_OK;
 }
 
+// ================== ADC ==================
+
+// Kalibracja line fitting (jedyny schemat na ESP32): eFuse Two Point / Vref, inaczej Vref 1100 mV
+static esp_err_t init_calibration(ph_sensor_t *sensor) {
+    adc_cali_line_fitting_efuse_val_t efuse;
+    esp_err_t err = adc_cali_scheme_line_fitting_check_efuse(&efuse);
+    if (err != ESP_OK) return err;
+    sensor->cali_source = efuse == ADC_CALI_LINE_FITTING_EFUSE_VAL_EFUSE_TP   ? "eFuse Two Point" :
+                          efuse == ADC_CALI_LINE_FITTING_EFUSE_VAL_EFUSE_VREF ? "eFuse Vref" :
+                                                                                "default Vref";
+    adc_cali_line_fitting_config_t cfg = {
+        .unit_id = ADC_UNIT_1,
+        .atten = PH_ADC_ATTEN,
+        .bitwidth = ADC_BITWIDTH_12,
+        .default_vref = 1100,
+    };
+    return adc_cali_create_scheme_line_fitting(&cfg, &sensor->cali);
+}
+
+static esp_err_t init_adc(ph_sensor_t *sensor) {
+    adc_oneshot_unit_init_cfg_t unit_cfg = { .unit_id = ADC_UNIT_1 };
+    adc_oneshot_chan_cfg_t chan_cfg = { .atten = PH_ADC_ATTEN, .bitwidth = ADC_BITWIDTH_12 };
+    esp_err_t err = adc_oneshot_new_unit(&unit_cfg, &sensor->adc);
+    if (err == ESP_OK) err = adc_oneshot_config_channel(sensor->adc, PH_ADC_CHANNEL, &chan_cfg);
+    if (err != ESP_OK) return err;
+
+    // Tryb ciągły dzieli ADC1 z odczytami pojedynczymi - sterownik blokuje
+    // jednostkę tylko między adc_continuous_start() a adc_continuous_stop()
+    adc_continuous_handle_cfg_t dma_cfg = {
+        .max_store_buf_size = PH_BURST_SAMPLES * SOC_ADC_DIGI_RESULT_BYTES,
+        .conv_frame_size = PH_BURST_FRAME_SIZE,
+    };
+    adc_digi_pattern_config_t pattern = {
+        .atten = PH_ADC_ATTEN,
+        .channel = PH_ADC_CHANNEL,
+        .unit = ADC_UNIT_1,
+        .bit_width = ADC_BITWIDTH_12,
+    };
+    adc_continuous_config_t conv_cfg = {
+        .pattern_num = 1,
+        .adc_pattern = &pattern,
+        .sample_freq_hz = PH_BURST_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE1,
+    };
+    burst_lock = xSemaphoreCreateMutex();
+    if (!burst_lock) return ESP_ERR_NO_MEM;
+    err = adc_continuous_new_handle(&dma_cfg, &sensor->adc_dma);
+    if (err == ESP_OK) err = adc_continuous_config(sensor->adc_dma, &conv_cfg);
+    if (err != ESP_OK) return err;
+
+    err = init_calibration(sensor);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "ADC calibration unavailable: %s", esp_err_to_name(err));
+        sensor->cali = NULL;
+        sensor->cali_source = "none";
+    }
+    return ESP_OK;
+}
+
+// Napięcie dla niecałkowitej wartości raw (średnia serii): interpolacja między
+// punktami krzywej kalibracji odległymi o 64 LSB, bez zaokrąglania do 1 mV.
+// *mv_per_lsb (może być NULL) dostaje nachylenie w tym punkcie.
+static float raw_to_mv(ph_sensor_t *sensor, float raw, float *mv_per_lsb) {
+    const int span = 64;
+    int lo = (int)raw;
+    if (lo > 4095 - span) lo = 4095 - span;
+    if (lo < 0) lo = 0;
+    int mv_lo = lo * 3100 / 4095, mv_hi = (lo + span) * 3100 / 4095;
+    if (sensor->cali) {
+        adc_cali_raw_to_voltage(sensor->cali, lo, &mv_lo);
+        adc_cali_raw_to_voltage(sensor->cali, lo + span, &mv_hi);
+    }
+    float slope = (float)(mv_hi - mv_lo) / span;
+    if (mv_per_lsb) *mv_per_lsb = slope;
+    return mv_lo + slope * (raw - lo);
+}
+
+static int cmp_u16(const void *a, const void *b) {
+    return (int)*(const uint16_t *)a - (int)*(const uint16_t *)b;
+}
+
+esp_err_t ph_sensor_sample_mv(ph_sensor_t *sensor, adc_channel_t channel, float *voltage_mv) {
+    if (!sensor || !voltage_mv || !sensor->adc) return ESP_ERR_INVALID_ARG;
+
+    int raw;
+    esp_err_t err = adc_oneshot_read(sensor->adc, channel, &raw);
+    if (err != ESP_OK) return err;
+
+    int mv = raw * 3100 / 4095;
+    if (sensor->cali) adc_cali_raw_to_voltage(sensor->cali, raw, &mv);
+    *voltage_mv = (float)mv;
+    return ESP_OK;
+}
+
+esp_err_t ph_sensor_burst_mv(ph_sensor_t *sensor, ph_burst_t *burst) {
+    if (!sensor || !burst || !sensor->adc_dma) return ESP_ERR_INVALID_ARG;
+
+    static uint16_t samples[PH_BURST_SAMPLES];   // Poza stosem wołającego
+    static uint8_t frame[PH_BURST_FRAME_SIZE];
+    uint32_t n = 0;
+
+    xSemaphoreTake(burst_lock, portMAX_DELAY);
+    int64_t start = esp_timer_get_time();
+    esp_err_t err = adc_continuous_start(sensor->adc_dma);
+    if (err != ESP_OK) {
+        xSemaphoreGive(burst_lock);
+        return err;
+    }
+
+    // adc_continuous_read czeka na ramkę z DMA (blokada, nie odpytywanie)
+    while (n < PH_BURST_SAMPLES) {
+        uint32_t got = 0;
+        err = adc_continuous_read(sensor->adc_dma, frame, sizeof(frame), &got, PH_BURST_TIMEOUT_MS);
+        if (err != ESP_OK) break;
+        for (uint32_t i = 0; i + SOC_ADC_DIGI_RESULT_BYTES <= got && n < PH_BURST_SAMPLES;
+             i += SOC_ADC_DIGI_RESULT_BYTES) {
+            const adc_digi_output_data_t *d = (const adc_digi_output_data_t *)&frame[i];
+            if (d->type1.channel == PH_ADC_CHANNEL) {
+                samples[n++] = d->type1.data;
+            }
+        }
+    }
+    adc_continuous_stop(sensor->adc_dma);
+    adc_continuous_flush_pool(sensor->adc_dma);  // Resztki nie trafią do następnej serii
+    burst->duration_us = esp_timer_get_time() - start;
+    burst->captured = (uint16_t)n;
+    if (n < PH_BURST_SAMPLES / 2) {
+        xSemaphoreGive(burst_lock);
+        return err != ESP_OK ? err : ESP_ERR_INVALID_SIZE;
+    }
+
+    // Średnia obcięta i mediana odporne na pojedyncze szpilki (WiFi, pompa)
+    qsort(samples, n, sizeof(samples[0]), cmp_u16);
+    uint32_t trim = n * PH_BURST_TRIM_PCT / 100;
+    uint32_t used = n - 2 * trim;
+    uint32_t sum = 0;
+    for (uint32_t i = trim; i < n - trim; i++) sum += samples[i];
+    float mean = (float)sum / used;
+    float var = 0.0f;
+    for (uint32_t i = trim; i < n - trim; i++) {
+        float d = samples[i] - mean;
+        var += d * d;
+    }
+    var /= used > 1 ? used - 1 : 1;
+
+    float mv_per_lsb;
+    burst->mean_mv = raw_to_mv(sensor, mean, &mv_per_lsb);
+    burst->median_mv = raw_to_mv(sensor, samples[n / 2], NULL);
+    burst->stddev_mv = sqrtf(var) * mv_per_lsb;
+    burst->used = (uint16_t)used;
+    xSemaphoreGive(burst_lock);
+    return ESP_OK;
+}
+
 // ================== API ==================
 
 esp_err_t ph_sensor_init(ph_sensor_t *sensor) {
@@ -58,7 +295,11 @@ esp_err_t ph_sensor_init(ph_sensor_t *sensor) {
     // Domyślne wartości
     sensor->neutral_voltage = PH_DEFAULT_NEUTRAL_VOLTAGE;
     sensor->acid_voltage    = PH_DEFAULT_ACID_VOLTAGE;
-    sensor->temperature     = 25.0f;
+    sensor->base_voltage    = NAN;
+    sensor->neutral_temp    = PH_DEFAULT_TEMPERATURE;
+    sensor->acid_temp       = PH_DEFAULT_TEMPERATURE;
+    sensor->base_temp       = PH_DEFAULT_TEMPERATURE;
+    sensor->temperature     = PH_DEFAULT_TEMPERATURE;
 
     // Inicjalizacja NVS
     esp_err_t ret = nvs_flash_init();
@@ -72,46 +313,89 @@ esp_err_t ph_sensor_init(ph_sensor_t *sensor) {
     }
 
     load_from_nvs(sensor);
+    if (fit_calibration(sensor) != ESP_OK) {
+        ESP_LOGW(TAG, "Stored calibration unusable, using defaults");
+        sensor->neutral_voltage = PH_DEFAULT_NEUTRAL_VOLTAGE;
+        sensor->acid_voltage    = PH_DEFAULT_ACID_VOLTAGE;
+        sensor->base_voltage    = NAN;
+        sensor->neutral_temp = sensor->acid_temp = PH_DEFAULT_TEMPERATURE;
+        fit_calibration(sensor);
+    }
 
-    // Konfiguracja ADC1 (12 bit, attenuation 11dB ~0-3.6V)
-    adc1_config_width(ADC_WIDTH_BIT_12);
-    adc1_config_channel_atten(ADC1_CHANNEL_0, ADC_ATTEN_DB_11);
+    // ADC1: odczyty pojedyncze, serie DMA i kalibracja z eFuse
+    ret = init_adc(sensor);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "ADC init failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+
+    ESP_LOGI(TAG, "PH sensor initialized. Neutral=%.2f mV, Acid=%.2f mV, Base=%.2f mV, "
+             "slope %.2f mV/pH at 25°C, ADC calibration: %s",
+             sensor->neutral_voltage, sensor->acid_voltage, sensor->base_voltage,
+             ph_sensor_mv_per_ph(sensor, 25.0f), sensor->cali_source);
+
+    return ESP_OK;
+}
 
-    esp_adc_cal_characterize(ADC_UNIT_1, ADC_ATTEN_DB_11,
-                             ADC_WIDTH_BIT_12, 1100, &sensor->adc_chars);
+esp_err_t ph_sensor_read_adc(ph_sensor_t *sensor, adc_channel_t channel, float temperature, float *ph) {
+    if (!sensor || !ph) return ESP_ERR_INVALID_ARG;
+
+    float voltage_mv;
+    esp_err_t err = ph_sensor_sample_mv(sensor, channel, &voltage_mv);
+    if (err != ESP_OK) return err;
 
-    ESP_LOGI(TAG, "PH sensor initialized. Neutral=%.2f mV, Acid=%.2f mV",
-             sensor->neutral_voltage, sensor->acid_voltage);
+    sensor->last_voltage = voltage_mv;
+    sensor->temperature = temperature;
+    *ph = ph_sensor_calculate(sensor, sensor->last_voltage, temperature);
+
+    ESP_LOGI(TAG, "ADC voltage=%.0fmV, pH=%.2f", voltage_mv, *ph);
 
     return ESP_OK;
 }
 
-esp_err_t ph_sensor_read_adc(ph_sensor_t *sensor, adc1_channel_t channel, float temperature, float *ph) {
+esp_err_t ph_sensor_read_burst(ph_sensor_t *sensor, float temperature, float *ph, ph_burst_t *burst) {
     if (!sensor || !ph) return ESP_ERR_INVALID_ARG;
 
-    int raw = adc1_get_raw(channel);
-    uint32_t voltage_mv = esp_adc_cal_raw_to_voltage(raw, &sensor->adc_chars);
+    ph_burst_t local;
+    if (!burst) burst = &local;
+    esp_err_t err = ph_sensor_burst_mv(sensor, burst);
+    if (err != ESP_OK) return err;
 
-    sensor->last_voltage = (float)voltage_mv;
+    sensor->last_voltage = burst->mean_mv;
+    sensor->last_stddev = burst->stddev_mv;
     sensor->temperature = temperature;
     *ph = ph_sensor_calculate(sensor, sensor->last_voltage, temperature);
 
-    ESP_LOGI(TAG, "ADC raw=%d, voltage=%dmV, pH=%.2f", raw, voltage_mv, *ph);
+    ESP_LOGI(TAG, "ADC burst %u/%u samples, voltage=%.1f±%.1fmV (median %.1f), pH=%.2f",
+             burst->used, burst->captured, burst->mean_mv, burst->stddev_mv, burst->median_mv, *ph);
 
     return ESP_OK;
 }
 
 float ph_sensor_calculate(ph_sensor_t *sensor, float voltage_mv, float temperature) {
-    (void)temperature; // na razie nie używamy kompensacji temperaturowej
-
-    // uproszczony wzór: pH = 7 + 3 * (V - neutral) / (neutral - acid)
-    float slope = 3.0f / (sensor->neutral_voltage - sensor->acid_voltage);
-    float ph = 7.0f + slope * (voltage_mv - sensor->neutral_voltage);
+    // Nachylenie zmienia się z temperaturą wody (Nernst), punkt izopotencjalny ~pH 7
+    float ph = 7.0f + (voltage_mv - sensor->offset_mv) / ph_sensor_mv_per_ph(sensor, temperature);
     sensor->ph_value = ph;
     return ph;
 }
 
-esp_err_t ph_sensor_calibration(ph_sensor_t *sensor, const char *cmd, float voltage_mv) {
+// Zapisuje punkt i dopasowuje prostą; przy nieudanym dopasowaniu przywraca poprzedni punkt
+static esp_err_t set_point(ph_sensor_t *sensor, float *voltage, float *temp, float v, float t) {
+    float old_v = *voltage, old_t = *temp;
+    *voltage = v;
+    *temp = isnan(t) ? PH_DEFAULT_TEMPERATURE : t;
+    esp_err_t err = fit_calibration(sensor);
+    if (err != ESP_OK) {
+        *voltage = old_v;
+        *temp = old_t;
+        return err;
+    }
+    ESP_LOGI(TAG, "Fit: offset %.2f mV at pH 7, slope %.2f mV/pH at 25°C (%.0f%% of Nernst)",
+             sensor->offset_mv, ph_sensor_mv_per_ph(sensor, 25.0f), fabsf(sensor->gain) * 100.0f);
+    return ESP_OK;
+}
+
+esp_err_t ph_sensor_calibration(ph_sensor_t *sensor, const char *cmd, float voltage_mv, float temperature) {
     if (!sensor || !cmd) return ESP_ERR_INVALID_ARG;
 
     char buf[16];
@@ -123,13 +407,14 @@ esp_err_t ph_sensor_calibration(ph_sensor_t *sensor, const char *cmd, float volt
         ESP_LOGI(TAG, ">>> Enter PH Calibration Mode <<<");
         return ESP_OK;
     } else if (strcmp(buf, "CALPH7") == 0) {
-        sensor->neutral_voltage = voltage_mv;
-        ESP_LOGI(TAG, ">>> Calibrated Neutral pH=7.0 at %.2f mV <<<", voltage_mv);
-        return ESP_OK;
+        ESP_LOGI(TAG, ">>> Calibrated Neutral pH=7.0 at %.2f mV, %.1f°C <<<", voltage_mv, temperature);
+        return set_point(sensor, &sensor->neutral_voltage, &sensor->neutral_temp, voltage_mv, temperature);
     } else if (strcmp(buf, "CALPH4") == 0) {
-        sensor->acid_voltage = voltage_mv;
-        ESP_LOGI(TAG, ">>> Calibrated Acid pH=4.0 at %.2f mV <<<", voltage_mv);
-        return ESP_OK;
+        ESP_LOGI(TAG, ">>> Calibrated Acid pH=4.0 at %.2f mV, %.1f°C <<<", voltage_mv, temperature);
+        return set_point(sensor, &sensor->acid_voltage, &sensor->acid_temp, voltage_mv, temperature);
+    } else if (strcmp(buf, "CALPH10") == 0) {
+        ESP_LOGI(TAG, ">>> Calibrated Base pH=10.0 at %.2f mV, %.1f°C <<<", voltage_mv, temperature);
+        return set_point(sensor, &sensor->base_voltage, &sensor->base_temp, voltage_mv, temperature);
     } else if (strcmp(buf, "EXITPH") == 0) {
         ESP_LOGI(TAG, ">>> Saving calibration and exiting <<<");
         return ph_sensor_save_to_nvs(sensor);
@@ -2,38 +2,91 @@
 #define PH_SENSOR_H
 
 #include "esp_err.h"
-#include "driver/adc.h"
-#include "esp_adc_cal.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
+#include "esp_adc/adc_cali.h"
+#include <stdint.h>
 
 // Domyślne wartości kalibracyjne (mV)
 #define PH_DEFAULT_NEUTRAL_VOLTAGE 1500.0f   // odpowiada pH 7
 #define PH_DEFAULT_ACID_VOLTAGE    2032.44f  // odpowiada pH 4
+#define PH_DEFAULT_TEMPERATURE     25.0f     // Gdy brak temperatury wody (NAN)
+
+// ADC1: kanał czujnika (GPIO36), 12 bit, tłumienie 12 dB (~0-3.1 V)
+#define PH_ADC_CHANNEL      ADC_CHANNEL_0
+#define PH_ADC_ATTEN        ADC_ATTEN_DB_12
+
+// Seria DMA (tryb ciągły ADC): próbki zbiera sprzęt, CPU tylko liczy statystykę
+#define PH_BURST_SAMPLES    512
+#define PH_BURST_SAMPLE_HZ  20000   // ESP32: 20 kHz..2 MHz, seria trwa ~26 ms
+#define PH_BURST_TRIM_PCT   10      // Odrzucane z każdego końca posortowanej serii
+#define PH_BURST_FRAME_SIZE 256     // Bajty na ramkę DMA (2 B na próbkę)
+#define PH_BURST_TIMEOUT_MS 100
 
 // Klucze NVS
 #define NVS_NAMESPACE   "ph_sensor"
 #define NVS_KEY_NEUTRAL "neutral_v"
 #define NVS_KEY_ACID    "acid_v"
+#define NVS_KEY_BASE    "base_v"
+#define NVS_KEY_NEUTRAL_T "neutral_t"  // Temperatura wody przy kalibracji punktu
+#define NVS_KEY_ACID_T    "acid_t"
+#define NVS_KEY_BASE_T    "base_t"
 
 typedef struct {
     float ph_value;
     float acid_voltage;
     float neutral_voltage;
+    float base_voltage;                 // pH 10, NAN = kalibracja dwupunktowa
+    float acid_temp;                    // Temperatury wody przy kalibracji punktów [°C]
+    float neutral_temp;
+    float base_temp;
+    float offset_mv;                    // Dopasowanie: napięcie przy pH 7
+    float gain;                         // Dopasowanie: mV na mV Nernsta (wzmocnienie toru, ze znakiem)
     float last_voltage;
     float temperature;
-    esp_adc_cal_characteristics_t adc_chars;
+    float last_stddev;                  // Odchylenie próbek ostatniej serii [mV]
+    adc_oneshot_unit_handle_t adc;      // Pojedyncze próbki (ph_sensor_read_adc)
+    adc_continuous_handle_t adc_dma;    // Serie DMA (ph_sensor_read_burst)
+    adc_cali_handle_t cali;             // Kalibracja z eFuse (Vref / Two Point) lub domyślna
+    const char *cali_source;
 } ph_sensor_t;
 
+// Wynik serii: średnia obcięta, mediana i rozrzut próbek
+typedef struct {
+    float mean_mv;
+    float median_mv;
+    float stddev_mv;
+    uint16_t used;       // Próbki po obcięciu
+    uint16_t captured;
+    int64_t duration_us;
+} ph_burst_t;
+
 // Inicjalizacja czujnika pH (ładuje wartości kalibracji z NVS)
 esp_err_t ph_sensor_init(ph_sensor_t *sensor);
 
-// Odczyt z ADC1 wybranego kanału i przeliczenie na pH
-esp_err_t ph_sensor_read_adc(ph_sensor_t *sensor, adc1_channel_t channel, float temperature, float *ph);
+// Odczyt z ADC1 wybranego kanału i przeliczenie na pH (jedna próbka)
+esp_err_t ph_sensor_read_adc(ph_sensor_t *sensor, adc_channel_t channel, float temperature, float *ph);
 
-// Przeliczenie napięcia (mV) na pH
+// Seria PH_BURST_SAMPLES próbek przez DMA z PH_ADC_CHANNEL i przeliczenie na pH.
+// Zadanie czeka na dane bez zajmowania CPU; burst (może być NULL) dostaje statystykę.
+esp_err_t ph_sensor_read_burst(ph_sensor_t *sensor, float temperature, float *ph, ph_burst_t *burst);
+
+// Samo napięcie [mV] z jednej próbki lub z serii (bez przeliczenia na pH)
+esp_err_t ph_sensor_sample_mv(ph_sensor_t *sensor, adc_channel_t channel, float *voltage_mv);
+esp_err_t ph_sensor_burst_mv(ph_sensor_t *sensor, ph_burst_t *burst);
+
+// Przeliczenie napięcia (mV) na pH z kompensacją Nernsta dla temperatury wody [°C]:
+// pH = 7 + (V - offset) / (gain * S(T)), S(T) z tablicy co 5 °C (59.16 mV/pH przy 25 °C)
 float ph_sensor_calculate(ph_sensor_t *sensor, float voltage_mv, float temperature);
 
-// Tryb kalibracji (komenda: "ENTERPH", "CALPH4", "CALPH7", "EXITPH")
-esp_err_t ph_sensor_calibration(ph_sensor_t *sensor, const char *cmd, float voltage_mv);
+// Nachylenie Nernsta S(T) [mV/pH] i nachylenie toru pomiarowego gain * S(T)
+float ph_sensor_nernst_mv(float temperature);
+float ph_sensor_mv_per_ph(const ph_sensor_t *sensor, float temperature);
+
+// Tryb kalibracji (komenda: "ENTERPH", "CALPH4", "CALPH7", "CALPH10", "EXITPH").
+// Punkt zapamiętuje napięcie i temperaturę wody; offset i gain są dopasowywane
+// metodą najmniejszych kwadratów do 2 lub 3 punktów. EXITPH zapisuje do NVS.
+esp_err_t ph_sensor_calibration(ph_sensor_t *sensor, const char *cmd, float voltage_mv, float temperature);
 
 // Zapis wartości kalibracji do NVS
 esp_err_t ph_sensor_save_to_nvs(ph_sensor_t *sensor);
@@ -0,0 +1,68 @@
+#include "recbuf.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+
+static const char *TAG = "RECBUF";
+
+typedef struct {
+    logrec_t rec;                 // Musi być pierwszym polem (rzutowanie z logrec_t *)
+    uint8_t refs;
+} recbuf_slot_t;
+
+static recbuf_slot_t pool[RECBUF_COUNT];
+static portMUX_TYPE pool_mux = portMUX_INITIALIZER_UNLOCKED;
+static recbuf_stats_t stats = {0};
+
+static recbuf_slot_t *slot_of(logrec_t *rec) {
+    recbuf_slot_t *slot = (recbuf_slot_t *)rec;
+    if (slot < &pool[0] || slot >= &pool[RECBUF_COUNT]) return NULL;
+    return slot;
+}
+
+logrec_t *recbuf_alloc(void) {
+    recbuf_slot_t *slot = NULL;
+
+    portENTER_CRITICAL(&pool_mux);
+    for (int i = 0; i < RECBUF_COUNT; i++) {
+        if (pool[i].refs == 0) {
+            slot = &pool[i];
+            slot->refs = 1;
+            stats.in_use++;
+            if (stats.in_use > stats.max_in_use) stats.max_in_use = stats.in_use;
+            break;
+        }
+    }
+    if (!slot) stats.alloc_failed++;
+    portEXIT_CRITICAL(&pool_mux);
+
+    if (!slot) {
+        ESP_LOGW(TAG, "Record pool exhausted (%d records)", RECBUF_COUNT);
+        return NULL;
+    }
+    memset(&slot->rec, 0, sizeof(slot->rec));
+    return &slot->rec;
+}
+
+void recbuf_ref(logrec_t *rec) {
+    recbuf_slot_t *slot = slot_of(rec);
+    if (!slot) return;
+    portENTER_CRITICAL(&pool_mux);
+    slot->refs++;
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+void recbuf_unref(logrec_t *rec) {
+    recbuf_slot_t *slot = slot_of(rec);
+    if (!slot) return;
+    portENTER_CRITICAL(&pool_mux);
+    if (slot->refs > 0 && --slot->refs == 0) stats.in_use--;
+    portEXIT_CRITICAL(&pool_mux);
+}
+
+void recbuf_get_stats(recbuf_stats_t *out) {
+    if (!out) return;
+    portENTER_CRITICAL(&pool_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&pool_mux);
+}
@@ -0,0 +1,47 @@
+#ifndef RECBUF_H
+#define RECBUF_H
+
+#include "logrec.h"
+#include <stdint.h>
+
+/**
+ * Pula rekordów pomiarowych z licznikiem referencji.
+ *
+ * Blok pomiarowy jest kodowany raz (main.c) do rekordu logrec_t z tej puli,
+ * a odbiorcy - zadanie zapisu SD (storage.h) i outbox MQTT (outbox.h) - trzymają
+ * wskaźnik do tego samego rekordu zamiast własnych kopii. Rekord wraca do puli,
+ * gdy ostatni odbiorca wywoła recbuf_unref().
+ *
+ * Pula jest statyczna (bez sterty); operacje na licznikach są w sekcji krytycznej,
+ * więc można je wołać z dowolnego zadania.
+ */
+
+// Banki zapisu (2 x STORAGE_BANK_RECORDS) + pierścień outboxa (OUTBOX_RING_RECORDS)
+// + rekordy w trakcie kodowania/zapisu
+#define RECBUF_COUNT  52
+
+typedef struct {
+    uint32_t in_use;          // Rekordy aktualnie wydane
+    uint32_t max_in_use;
+    uint32_t alloc_failed;    // Pula pusta - pomiar utracony
+} recbuf_stats_t;
+
+/**
+ * Pobiera wolny rekord z puli (wyzerowany, licznik = 1).
+ * @return wskaźnik lub NULL, gdy pula jest pusta
+ */
+logrec_t *recbuf_alloc(void);
+
+/**
+ * Dodaje referencję (nowy odbiorca rekordu).
+ */
+void recbuf_ref(logrec_t *rec);
+
+/**
+ * Zwalnia referencję; ostatnia zwraca rekord do puli. NULL jest ignorowany.
+ */
+void recbuf_unref(logrec_t *rec);
+
+void recbuf_get_stats(recbuf_stats_t *stats);
+
+#endif // RECBUF_H
@@ -4,6 +4,7 @@
 #include "freertos/timers.h"
 #include "driver/gpio.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "relay.h"
 
 static const char *TAG = "RELAY";
@@ -12,6 +13,7 @@ static const char *TAG = "RELAY";
 
 static volatile bool relay1_on = false;
 static volatile bool relay2_on = false;
+static volatile int64_t relay1_changed_us = 0;   /* esp_timer przy ostatniej zmianie R1 */
 static QueueHandle_t gpio_evt_queue = NULL;
 
 /* Konfiguracja trybu interwałowego */
@@ -48,6 +50,9 @@ static void relay_apply_all(void)
 static void relay_set(gpio_num_t pin, bool on)
 {
     gpio_set_level(pin, relay_level_for(on));
+    if (pin == RELAY1_GPIO) {
+        relay1_changed_us = esp_timer_get_time();
+    }
 }
 
 /* ================== ISR PRZYCISKÓW ================== */
@@ -70,6 +75,9 @@ void relay_init(void)
         .pull_down_en = GPIO_PULLDOWN_DISABLE,
         .intr_type = GPIO_INTR_DISABLE
     };
+    /* Zatrzask z trybu deep sleep (dutycycle.c) blokowałby wyjścia */
+    gpio_hold_dis(RELAY1_GPIO);
+    gpio_hold_dis(RELAY2_GPIO);
     ESP_ERROR_CHECK(gpio_config(&io_conf));
 
     /* Ustaw stan bezpieczny (OFF) zanim podasz sygnały na moduł */
@@ -174,6 +182,11 @@ bool relay_get_relay2_state(void)
     return relay2_on;
 }
 
+int64_t relay_get_relay1_changed_us(void)
+{
+    return relay1_changed_us;
+}
+
 void* relay_get_event_queue(void)
 {
     return (void*)gpio_evt_queue;
@@ -2,6 +2,7 @@
 #define RELAY_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "driver/gpio.h"
 
 /* ================== KONFIGURACJA PINÓW ================== */
@@ -69,6 +70,12 @@ bool relay_get_relay1_state(void);
  */
 bool relay_get_relay2_state(void);
 
+/**
+ * Czas ostatniej zmiany stanu przekaźnika 1 (esp_timer_get_time, us);
+ * 0 = bez zmiany od startu. Harmonogram pH odczekuje po pracy pompy.
+ */
+int64_t relay_get_relay1_changed_us(void);
+
 /**
  * Zwraca kolejkę dla zdarzeń GPIO
  */
@@ -0,0 +1,241 @@
+#include "schedtab.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+static const char *TAG = "SCHEDTAB";
+
+#define NVS_NAMESPACE  "sched"
+#define NVS_KEY_TABLE  "table"
+#define NVS_KEY_SETTLE "ph_settle"
+#define SECONDS_PER_DAY  86400u
+
+static const char *const names[SCHEDTAB_CHANNELS] = {
+    [SCHEDTAB_WATER] = "WATER",
+    [SCHEDTAB_AIR]   = "AIR",
+    [SCHEDTAB_LIGHT] = "LIGHT",
+    [SCHEDTAB_PH]    = "PH",
+    [SCHEDTAB_LEVEL] = "LEVEL",
+};
+
+static schedtab_entry_t table[SCHEDTAB_CHANNELS];
+static uint32_t ph_settle_sec;
+
+static bool entry_valid(uint32_t period_sec, uint32_t phase_sec)
+{
+    if (period_sec == 0) {
+        return phase_sec == 0;
+    }
+    return period_sec >= SCHEDTAB_MIN_PERIOD_SEC && period_sec <= SCHEDTAB_MAX_PERIOD_SEC &&
+           phase_sec < period_sec;
+}
+
+static bool settle_valid(uint32_t settle_sec)
+{
+    return settle_sec > 0 && settle_sec <= SCHEDTAB_SETTLE_MAX_SEC;
+}
+
+/********************
+ * Tabela w NVS
+ ********************/
+static bool table_load(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        return false;
+    }
+    schedtab_entry_t loaded[SCHEDTAB_CHANNELS];
+    size_t size = sizeof(loaded);
+    esp_err_t err = nvs_get_blob(h, NVS_KEY_TABLE, loaded, &size);
+    nvs_close(h);
+    if (err != ESP_OK || size != sizeof(loaded)) {
+        return false;
+    }
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        if (!entry_valid(loaded[i].period_sec, loaded[i].phase_sec)) {
+            return false;
+        }
+    }
+    memcpy(table, loaded, sizeof(table));
+    return true;
+}
+
+static bool settle_load(void)
+{
+    nvs_handle_t h;
+    if (nvs_open(NVS_NAMESPACE, NVS_READONLY, &h) != ESP_OK) {
+        return false;
+    }
+    uint32_t loaded = 0;
+    esp_err_t err = nvs_get_u32(h, NVS_KEY_SETTLE, &loaded);
+    nvs_close(h);
+    if (err != ESP_OK || !settle_valid(loaded)) {
+        return false;
+    }
+    ph_settle_sec = loaded;
+    return true;
+}
+
+static esp_err_t table_save(bool with_settle)
+{
+    nvs_handle_t h;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &h);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(h, NVS_KEY_TABLE, table, sizeof(table));
+    if (err == ESP_OK && with_settle) err = nvs_set_u32(h, NVS_KEY_SETTLE, ph_settle_sec);
+    if (err == ESP_OK) err = nvs_commit(h);
+    nvs_close(h);
+    return err;
+}
+
+/********************
+ * API
+ ********************/
+esp_err_t schedtab_init(uint32_t default_period_sec, uint32_t default_settle_sec)
+{
+    if (!settle_load()) {
+        ph_settle_sec = settle_valid(default_settle_sec) ? default_settle_sec : SCHEDTAB_SETTLE_MAX_SEC;
+    }
+    if (table_load()) {
+        ESP_LOGI(TAG, "Schedule table loaded from NVS");
+        return ESP_OK;
+    }
+    if (!entry_valid(default_period_sec, 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        table[i].period_sec = default_period_sec;
+        table[i].phase_sec = 0;
+    }
+    ESP_LOGI(TAG, "No schedule table in NVS - every channel every %lu s", default_period_sec);
+    return ESP_OK;
+}
+
+esp_err_t schedtab_set(int channel, uint32_t period_sec, uint32_t phase_sec)
+{
+    if (channel < 0 || channel >= SCHEDTAB_CHANNELS || !entry_valid(period_sec, phase_sec)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    table[channel].period_sec = period_sec;
+    table[channel].phase_sec = phase_sec;
+    return table_save(false);
+}
+
+esp_err_t schedtab_set_all(uint32_t period_sec)
+{
+    if (!entry_valid(period_sec, 0)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        table[i].period_sec = period_sec;
+        table[i].phase_sec = 0;
+    }
+    return table_save(false);
+}
+
+esp_err_t schedtab_set_ph(uint32_t period_sec, uint32_t settle_sec)
+{
+    uint32_t phase_sec = table[SCHEDTAB_PH].phase_sec < period_sec ? table[SCHEDTAB_PH].phase_sec : 0;
+    if (!entry_valid(period_sec, phase_sec) || !settle_valid(settle_sec) ||
+        (period_sec && settle_sec >= period_sec)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    table[SCHEDTAB_PH].period_sec = period_sec;
+    table[SCHEDTAB_PH].phase_sec = phase_sec;
+    ph_settle_sec = settle_sec;
+    return table_save(true);
+}
+
+uint32_t schedtab_ph_settle(void)
+{
+    return ph_settle_sec;
+}
+
+schedtab_entry_t schedtab_get(int channel)
+{
+    schedtab_entry_t none = {0};
+    if (channel < 0 || channel >= SCHEDTAB_CHANNELS) {
+        return none;
+    }
+    return table[channel];
+}
+
+const char *schedtab_name(int channel)
+{
+    if (channel < 0 || channel >= SCHEDTAB_CHANNELS) {
+        return "?";
+    }
+    return names[channel];
+}
+
+int schedtab_parse(const char *name, size_t len)
+{
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        if (strlen(names[i]) == len && strncasecmp(names[i], name, len) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void schedtab_mask_str(uint32_t mask, char *buf, size_t size)
+{
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < SCHEDTAB_CHANNELS && len < size; i++) {
+        if (mask & (1u << i)) {
+            len += snprintf(buf + len, size - len, "%s%s", len ? "+" : "", names[i]);
+        }
+    }
+    if (len == 0) {
+        snprintf(buf, size, "-");
+    }
+}
+
+uint32_t schedtab_next_due(int channel, uint32_t after)
+{
+    if (channel < 0 || channel >= SCHEDTAB_CHANNELS || table[channel].period_sec == 0) {
+        return 0;
+    }
+    uint32_t period = table[channel].period_sec;
+    uint32_t phase = table[channel].phase_sec;
+    uint32_t midnight = after - after % SECONDS_PER_DAY;
+    uint32_t offset = after % SECONDS_PER_DAY;
+
+    if (offset < phase) {
+        return midnight + phase;
+    }
+    uint32_t next = phase + ((offset - phase) / period + 1) * period;
+    if (next < SECONDS_PER_DAY) {
+        return midnight + next;
+    }
+    // Siatka zaczyna się od nowa o północy (faza < okres <= doba)
+    return midnight + SECONDS_PER_DAY + phase;
+}
+
+uint32_t schedtab_plan(const uint32_t due[SCHEDTAB_CHANNELS], uint32_t *mask)
+{
+    uint32_t block = 0;
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        if (due[i] && (block == 0 || due[i] < block)) {
+            block = due[i];
+        }
+    }
+
+    *mask = 0;
+    if (block == 0) {
+        return 0;
+    }
+    for (int i = 0; i < SCHEDTAB_CHANNELS; i++) {
+        uint32_t window = table[i].period_sec / SCHEDTAB_MERGE_DIV;
+        if (window > SCHEDTAB_MERGE_MAX_SEC) window = SCHEDTAB_MERGE_MAX_SEC;
+        if (due[i] && due[i] - block <= window) {
+            *mask |= 1u << i;
+        }
+    }
+    return block;
+}
@@ -0,0 +1,99 @@
+#ifndef SCHEDTAB_H
+#define SCHEDTAB_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/*
+ * Tabela harmonogramu: każdy kanał czujników ma własny okres i fazę.
+ *
+ * Terminy kanału leżą na siatce od północy: phase, phase + period, ... aż do
+ * końca doby; następna doba zaczyna siatkę od nowa. Okres, który nie dzieli
+ * doby, daje więc te same godziny każdego dnia (ostatni odstęp jest krótszy).
+ *
+ * Planowanie (schedtab_plan) łączy kanały w bloki: blok startuje w
+ * najwcześniejszym terminie, a kanał o terminie do 1/SCHEDTAB_MERGE_DIV
+ * własnego okresu później (najwyżej SCHEDTAB_MERGE_MAX_SEC) jest czytany od
+ * razu w tym samym bloku - jedno wybudzenie magistral i jeden rekord zamiast
+ * kilku blisko siebie.
+ *
+ * Tabela leży w NVS (namespace "sched") i jest zapisywana przy każdej zmianie;
+ * obok niej (osobny klucz) czas ustalania się pH po przełączeniu pompy.
+ */
+
+#define SCHEDTAB_MIN_PERIOD_SEC  2        // DHT22 wymaga 2 s między odczytami
+#define SCHEDTAB_MAX_PERIOD_SEC  86400    // Raz na dobę
+#define SCHEDTAB_MERGE_DIV       10       // Kanał dołącza do bloku do 1/10 okresu przed terminem...
+#define SCHEDTAB_MERGE_MAX_SEC   300      // ...ale nie więcej niż 5 min
+#define SCHEDTAB_SETTLE_MAX_SEC  3600     // Górna granica czasu ustalania się pH
+
+typedef enum {
+    SCHEDTAB_WATER = 0,       // DS18B20: temperatura wody (sondy)
+    SCHEDTAB_AIR,             // DHT22: temperatura i wilgotność powietrza
+    SCHEDTAB_LIGHT,           // BH1750: natężenie światła
+    SCHEDTAB_PH,              // Próbka pH (seria DMA, kompensacja temperatury wody)
+    SCHEDTAB_LEVEL,           // Poziom wody w rekordzie (bez I/O - stan z przerwania)
+    SCHEDTAB_CHANNELS
+} schedtab_channel_t;
+
+#define SCHEDTAB_ALL  ((1u << SCHEDTAB_CHANNELS) - 1)
+
+typedef struct {
+    uint32_t period_sec;      // 0 = kanał wyłączony
+    uint32_t phase_sec;       // Przesunięcie siatki od północy (< period_sec)
+} schedtab_entry_t;
+
+/**
+ * Wczytuje tabelę z NVS; bez wpisu (lub przy uszkodzonym) każdy kanał
+ * dostaje default_period_sec z fazą 0. Czas ustalania się pH bez wpisu
+ * (lub spoza zakresu) = default_settle_sec.
+ */
+esp_err_t schedtab_init(uint32_t default_period_sec, uint32_t default_settle_sec);
+
+/**
+ * Ustawia okres i fazę kanału i zapisuje tabelę w NVS.
+ * @return ESP_ERR_INVALID_ARG: okres poza 0 / SCHEDTAB_MIN..MAX_PERIOD_SEC
+ *         albo faza >= okres
+ */
+esp_err_t schedtab_set(int channel, uint32_t period_sec, uint32_t phase_sec);
+
+// Ten sam okres dla wszystkich kanałów, faza 0 (SET_FREQ)
+esp_err_t schedtab_set_all(uint32_t period_sec);
+
+schedtab_entry_t schedtab_get(int channel);
+
+/**
+ * Okres kanału PH i czas ustalania się pH po przełączeniu pompy (PH:SCHED),
+ * zapisywane razem w NVS. Faza kanału zostaje, jeśli mieści się w okresie.
+ * @return ESP_ERR_INVALID_ARG: okres jak w schedtab_set, settle poza
+ *         1..SCHEDTAB_SETTLE_MAX_SEC albo settle >= okres (dla okresu > 0)
+ */
+esp_err_t schedtab_set_ph(uint32_t period_sec, uint32_t settle_sec);
+
+// Czas ustalania się pH po przełączeniu pompy [s]
+uint32_t schedtab_ph_settle(void);
+
+// Nazwa kanału w komendach UART (WATER, AIR, LIGHT, PH, LEVEL)
+const char *schedtab_name(int channel);
+
+// Kanał po nazwie (wielkość liter bez znaczenia), -1 = nieznany
+int schedtab_parse(const char *name, size_t len);
+
+// Nazwy kanałów z maski, np. "WATER+PH" ("-" dla pustej)
+void schedtab_mask_str(uint32_t mask, char *buf, size_t size);
+
+/**
+ * Najbliższy termin kanału ściśle po after [s Unix]; 0 = kanał wyłączony.
+ */
+uint32_t schedtab_next_due(int channel, uint32_t after);
+
+/**
+ * Następny blok dla terminów due[] (0 = kanał wyłączony): najwcześniejszy
+ * termin i maska kanałów, które się w nim mieszczą (z oknem łączenia).
+ * @return termin bloku [s Unix], 0 = wszystkie kanały wyłączone
+ */
+uint32_t schedtab_plan(const uint32_t due[SCHEDTAB_CHANNELS], uint32_t *mask);
+
+#endif // SCHEDTAB_H
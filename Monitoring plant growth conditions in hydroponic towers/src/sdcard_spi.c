@@ -1,4 +1,8 @@
 #include "sdcard_spi.h"
+#include "sdlog.h"
+#include "logrec.h"
+#include "logstore.h"
+#include "ds1302.h"
 #include "esp_log.h"
 #include "esp_vfs_fat.h"
 #include "driver/sdspi_host.h"
@@ -8,7 +12,6 @@
 #include <math.h>
 #include "esp_timer.h"
 #include <inttypes.h> // for PRId64
-#include "cJSON.h"    
 #include <unistd.h>
 #include <errno.h>
 #include <sys/stat.h>
@@ -18,6 +21,7 @@
 #include <stdlib.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "cJSON.h"
 
 static const char *TAG = "SENSOR_SD";
 
@@ -25,6 +29,26 @@ static sdmmc_card_t *card;
 static const char mount_point[] = "/sdcard";
 static sdmmc_host_t host = SDSPI_HOST_DEFAULT();
 
+// Trwały uchwyt logu - plik danych nie jest otwierany/zamykany przy każdym zapisie.
+// Otwarty jest plik dzienny, do którego ostatnio pisano.
+static sdlog_t data_log = {0};
+// Liczniki zapisu zamkniętych już plików (sdlog_open zeruje data_log.stats przy
+// rotacji doby i ponownym otwarciu po purge) - STATUS pokazuje sumę od startu
+static sdlog_stats_t data_log_totals = {0};
+// Numer kolejny następnego rekordu binarnego (ciągły między plikami dziennymi)
+static uint32_t binlog_next_seq = 0;
+// Indeks (.IDX) otwartego pliku dziennego
+static char binlog_idx_path[SDLOG_PATH_MAX];
+static FILE *binlog_idx_file = NULL;
+// Wpisy indeksu dla rekordów wciąż w buforze RAM - trafiają do .IDX w tym samym
+// commicie co rekordy (binlog_commit_cb). Bufor sdlog mieści SDLOG_BUF_SIZE /
+// LOGREC_RECORD_SIZE rekordów, więc czeka najwyżej tyle wpisów.
+#define BINLOG_IDX_PENDING_MAX (SDLOG_BUF_SIZE / LOGREC_RECORD_SIZE / LOGSTORE_INDEX_STRIDE + 1)
+static logstore_index_t binlog_idx_pending[BINLOG_IDX_PENDING_MAX];
+static size_t binlog_idx_pending_count = 0;
+// Okno trwałości stosowane przy każdym (ponownym) otwarciu logu
+static sdlog_config_t data_log_cfg = SDLOG_CONFIG_DEFAULT();
+
 // konfiguracja montowania
 static esp_vfs_fat_sdmmc_mount_config_t mount_config = {
     .format_if_mount_failed = false,
@@ -68,10 +92,13 @@ esp_err_t sensor_sdcard_init(void) {
     return ESP_OK;
 }
 
+static void binlog_close(void);
+
 /********************
  * Odmontowanie SD
  ********************/
 esp_err_t sensor_sdcard_unmount(void) {
+    binlog_close();
     esp_err_t ret = esp_vfs_fat_sdcard_unmount(mount_point, card);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "Karta SD odmontowana.");
@@ -81,149 +108,448 @@ esp_err_t sensor_sdcard_unmount(void) {
 }
 
 /********************
- * Dopisywanie danych do JSON
+ * Log binarny (logrec)
  ********************/
-esp_err_t sensor_json_append(const char *path, const char *sensor_id, double value, const char *timestamp) {
-    FILE *f = fopen(path, "r+");
-    cJSON *root = NULL;
-
-    if (f) {
-        // Odczytaj istniejący plik
-        fseek(f, 0, SEEK_END);
-        long size = ftell(f);
-        fseek(f, 0, SEEK_SET);
-
-        char *data = malloc(size + 1);
-        if (!data) { fclose(f); return ESP_FAIL; }
-        fread(data, 1, size, f);
-        data[size] = 0;
-
-        root = cJSON_Parse(data);
-        free(data);
-        fclose(f);
-
-        if (!root) {
-            ESP_LOGW(TAG, "Błąd parsowania JSON, utworzę nową tablicę");
-            root = cJSON_CreateArray();
-        }
-    } else {
-        // Plik nie istnieje – utwórz nowy
-        root = cJSON_CreateArray();
+// Po commicie danych: dopisz wpisy indeksu rekordów, które są już na karcie
+static void binlog_commit_cb(uint64_t durable_off, void *ctx) {
+    size_t n = 0;
+    while (n < binlog_idx_pending_count &&
+           binlog_idx_pending[n].offset + LOGREC_RECORD_SIZE <= durable_off) {
+        n++;
     }
+    if (n == 0) return;
+
+    if (!binlog_idx_file ||
+        logstore_index_write(binlog_idx_file, binlog_idx_pending, n, data_log_cfg.fsync) != ESP_OK) {
+        // Indeks jest tylko przyspieszeniem - brakujące wpisy odbuduje kompakcja
+        ESP_LOGW(TAG, "Nie udało się zapisać indeksu %s", binlog_idx_path);
+    }
+    binlog_idx_pending_count -= n;
+    memmove(&binlog_idx_pending[0], &binlog_idx_pending[n],
+            binlog_idx_pending_count * sizeof(binlog_idx_pending[0]));
+}
 
-    // Dodaj nowy obiekt
-    cJSON *entry = cJSON_CreateObject();
-    cJSON_AddStringToObject(entry, "sensor_id", sensor_id);
-    cJSON_AddNumberToObject(entry, "value", value);
+static void stats_add(sdlog_stats_t *dst, const sdlog_stats_t *src) {
+    dst->flushes += src->flushes;
+    dst->flushes_fill += src->flushes_fill;
+    dst->flushes_records += src->flushes_records;
+    dst->flushes_age += src->flushes_age;
+    dst->flushes_sync += src->flushes_sync;
+    dst->bytes_in += src->bytes_in;
+    dst->bytes_written += src->bytes_written;
+    dst->sectors_written += src->sectors_written;
+}
 
-    if (timestamp) {
-        cJSON_AddStringToObject(entry, "timestamp", timestamp);
-    } else {
-        int64_t t = esp_timer_get_time() / 1000;
-        char buf[32];
-        snprintf(buf, sizeof(buf), "%" PRId64, t);
-        cJSON_AddStringToObject(entry, "timestamp", buf);
+// Zamknięcie logu: ostatni commit dopisuje też oczekujące wpisy indeksu
+static void binlog_close(void) {
+    sdlog_close(&data_log);
+    stats_add(&data_log_totals, &data_log.stats);
+    memset(&data_log.stats, 0, sizeof(data_log.stats));
+    if (binlog_idx_file) {
+        fclose(binlog_idx_file);
+        binlog_idx_file = NULL;
     }
+    binlog_idx_pending_count = 0;
+}
 
-    cJSON_AddItemToArray(root, entry);
+// Indeks doby zostaje otwarty razem z plikiem danych (bez fopen co 16 rekordów)
+static void binlog_idx_open(void) {
+    binlog_idx_file = fopen(binlog_idx_path, "ab");
+    if (!binlog_idx_file) {
+        ESP_LOGW(TAG, "fopen(%s) failed: %s - log bez indeksu", binlog_idx_path, strerror(errno));
+    }
+}
 
-    // Zapisz plik
-    f = fopen(path, "w");
-    if (!f) {
-        ESP_LOGE(TAG, "Nie mogę otworzyć %s do zapisu", path);
-        cJSON_Delete(root);
+static esp_err_t binlog_open(const char *dir, const char *path, uint32_t created) {
+    if (mkdir(dir, 0775) != 0 && errno != EEXIST) {
+        ESP_LOGE(TAG, "mkdir(%s) failed: %s", dir, strerror(errno));
         return ESP_FAIL;
     }
 
-    char *json_str = cJSON_Print(root);
-    fprintf(f, "%s\n", json_str);
+    binlog_close();
+    esp_err_t ret = sdlog_open(&data_log, path);
+    if (ret != ESP_OK) return ret;
+    sdlog_set_config(&data_log, &data_log_cfg);
+    sdlog_set_commit_cb(&data_log, binlog_commit_cb, NULL);
+    logstore_day_path(dir, created, "IDX", binlog_idx_path, sizeof(binlog_idx_path));
+
+    // Nowy plik - nagłówek ze schematem trafia na kartę od razu
+    if (data_log.file_off == 0) {
+        logrec_header_t hdr;
+        logrec_header_init(&hdr, created);
+        ret = sdlog_append(&data_log, &hdr, sizeof(hdr));
+        if (ret == ESP_OK) ret = sdlog_flush(&data_log);
+        if (ret != ESP_OK) {
+            binlog_close();
+            return ret;
+        }
+        // Pozostałość indeksu po usuniętym pliku danych byłaby błędna
+        unlink(binlog_idx_path);
+        binlog_idx_open();
+        ESP_LOGI(TAG, "Utworzono log binarny %s (v%d, seq od %lu)", path, LOGREC_VERSION,
+                 (unsigned long)binlog_next_seq);
+        return ESP_OK;
+    }
+
+    // Istniejący plik - sprawdź nagłówek
+    logrec_header_t hdr;
+    FILE *f = fopen(path, "rb");
+    size_t got = f ? fread(&hdr, 1, sizeof(hdr), f) : 0;
+
+    ret = got == sizeof(hdr) ? logrec_header_check(&hdr) : ESP_ERR_INVALID_SIZE;
+    if (ret == ESP_OK && hdr.record_size != LOGREC_RECORD_SIZE) ret = ESP_ERR_INVALID_VERSION;
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Nieprawidłowy nagłówek %s: %s", path, esp_err_to_name(ret));
+        if (f) fclose(f);
+        binlog_close();
+        return ret;
+    }
+
+    uint64_t body = data_log.file_off - LOGREC_HEADER_SIZE;
+    if (body % LOGREC_RECORD_SIZE) {
+        ESP_LOGW(TAG, "%s: niepełny ostatni rekord (%lu B)", path,
+                 (unsigned long)(body % LOGREC_RECORD_SIZE));
+    }
+
+    // Numeracja kontynuuje od ostatniego pełnego rekordu pliku
+    logrec_t last;
+    uint64_t records = body / LOGREC_RECORD_SIZE;
+    if (records > 0 &&
+        fseek(f, (long)(LOGREC_HEADER_SIZE + (records - 1) * LOGREC_RECORD_SIZE), SEEK_SET) == 0 &&
+        fread(&last, 1, sizeof(last), f) == sizeof(last) && logrec_is_valid(&last) &&
+        last.seq >= binlog_next_seq) {
+        binlog_next_seq = last.seq + 1;
+    }
     fclose(f);
-    cJSON_Delete(root);
-    free(json_str);
+    binlog_idx_open();
+    return ESP_OK;
+}
 
-    ESP_LOGI(TAG, "Zapisano JSON: %s", path);
+esp_err_t sensor_binlog_append(const char *dir, logrec_t *rec, logstore_pos_t *pos) {
+    if (!dir || !rec) return ESP_ERR_INVALID_ARG;
+
+    // Plik doby wynika z timestampu rekordu - zmiana doby zamyka poprzedni plik
+    char path[SDLOG_PATH_MAX];
+    esp_err_t ret = logstore_day_path(dir, rec->timestamp, "DAT", path, sizeof(path));
+    if (ret != ESP_OK) return ret;
+
+    if (!sdlog_is_open_at(&data_log, path)) {
+        ret = binlog_open(dir, path, rec->timestamp);
+        if (ret != ESP_OK) return ret;
+    }
+
+    // Offset rekordu = logiczny koniec pliku (zapisane + bufor RAM)
+    uint64_t offset = data_log.file_off + data_log.fill;
+
+    rec->seq = binlog_next_seq;
+    logrec_seal(rec);
+
+    // Wpis indeksu czeka w RAM na commit rekordu (może nastąpić już w sdlog_append)
+    bool indexed = false;
+    if (offset >= LOGREC_HEADER_SIZE &&
+        ((offset - LOGREC_HEADER_SIZE) / LOGREC_RECORD_SIZE) % LOGSTORE_INDEX_STRIDE == 0) {
+        if (binlog_idx_pending_count < BINLOG_IDX_PENDING_MAX) {
+            binlog_idx_pending[binlog_idx_pending_count++] =
+                (logstore_index_t){ .timestamp = rec->timestamp, .offset = (uint32_t)offset };
+            indexed = true;
+        } else {
+            ESP_LOGW(TAG, "Kolejka indeksu pełna, pomijam wpis dla offsetu %lu", (unsigned long)offset);
+        }
+    }
+
+    ret = sdlog_append(&data_log, rec, sizeof(*rec));
+    if (ret != ESP_OK) {
+        if (indexed) binlog_idx_pending_count--;  // Callback nie był wołany - wpis jest ostatni
+        return ret;
+    }
+    binlog_next_seq++;
+    if (pos) {
+        pos->day = rec->timestamp / LOGSTORE_SECONDS_PER_DAY;
+        pos->offset = (uint32_t)offset;
+    }
     return ESP_OK;
 }
 
 /********************
- * Usuwanie wpisów po polu
+ * Migracja starego pliku JSON do logu binarnego
  ********************/
-esp_err_t sensor_json_remove_by_field(const char *path, const char *field, const char *value) {
-    FILE *f = fopen(path, "r");
-    if (!f) return ESP_FAIL;
-
-    fseek(f, 0, SEEK_END);
-    long size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-
-    char *data = malloc(size + 1);
-    if (!data) { fclose(f); return ESP_FAIL; }
-    fread(data, 1, size, f);
-    data[size] = 0;
-    fclose(f);
+typedef struct {
+    const char *dir;
+    uint32_t floor;               // Rekordy nie nowsze niż to są już w logu
+    sensor_json_migration_t res;
+    esp_err_t err;
+} json_migrate_ctx_t;
 
-    cJSON *root = cJSON_Parse(data);
-    free(data);
-    if (!root) return ESP_FAIL;
+// Timestamp ostatniego poprawnego rekordu najnowszego pliku doby (0 = pusty log)
+static uint32_t binlog_last_timestamp(const char *dir) {
+    char name[16], path[SDLOG_PATH_MAX];
+    uint32_t ts = 0;
+    if (!logstore_find_last_day(dir, NULL, name, sizeof(name))) return 0;
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
 
-    int array_size = cJSON_GetArraySize(root);
-    for (int i = array_size - 1; i >= 0; i--) {
-        cJSON *item = cJSON_GetArrayItem(root, i);
-        cJSON *fobj = cJSON_GetObjectItem(item, field);
-        if (fobj && strcmp(fobj->valuestring, value) == 0) {
-            cJSON_DeleteItemFromArray(root, i);
-        }
+    logstore_reader_t rd;
+    if (logstore_reader_open(&rd, path) != ESP_OK) return 0;
+    uint32_t records = (rd.size - LOGREC_HEADER_SIZE) / rd.record_size;
+    logrec_t rec;
+    bool valid;
+    // Od końca do pierwszego poprawnego rekordu (ogon mógł obciąć zanik zasilania)
+    while (records > 0 && ts == 0 &&
+           logstore_reader_seek(&rd, LOGREC_HEADER_SIZE + (records - 1) * rd.record_size) &&
+           logstore_reader_read(&rd, &rec, 1, &valid) == 1) {
+        if (valid) ts = rec.timestamp;
+        records--;
     }
+    logstore_reader_close(&rd);
+    return ts;
+}
 
-    f = fopen(path, "w");
-    if (!f) { cJSON_Delete(root); return ESP_FAIL; }
+static float json_number(const cJSON *obj, const char *name) {
+    const cJSON *item = cJSON_GetObjectItem(obj, name);
+    return cJSON_IsNumber(item) ? (float)item->valuedouble : NAN;
+}
 
-    char *json_str = cJSON_Print(root);
-    fprintf(f, "%s\n", json_str);
-    fclose(f);
-    cJSON_Delete(root);
-    free(json_str);
+static bool json_migrate_cb(const char *object, void *arg) {
+    json_migrate_ctx_t *m = arg;
+    cJSON *obj = cJSON_Parse(object);
+    const cJSON *ts = obj ? cJSON_GetObjectItem(obj, "timestamp") : NULL;
+
+    // Czas RTC "YYYY-MM-DD HH:MM:SS"; liczbowy (ms od startu, bez RTC) nie da się umieścić w dobie
+    unsigned y, mo, d, h, mi, s;
+    if (!cJSON_IsString(ts) ||
+        sscanf(ts->valuestring, "%4u-%2u-%2u %2u:%2u:%2u", &y, &mo, &d, &h, &mi, &s) != 6 ||
+        mo < 1 || mo > 12 || d < 1 || d > 31 || h > 23 || mi > 59 || s > 59) {
+        cJSON_Delete(obj);
+        m->res.skipped++;
+        return true;
+    }
+    ds1302_time_t t = { .sec = s, .min = mi, .hour = h, .day = d, .month = mo, .year = y };
+
+    logrec_t rec;
+    memset(&rec, 0, sizeof(rec));
+    rec.timestamp = ds1302_time_to_unix(&t);
+    rec.temp_ds18 = logrec_pack_i16(json_number(obj, "temp_ds18"), 100.0f);
+    for (int i = 0; i < LOGREC_PROBES; i++) rec.temp_probe[i] = LOGREC_NA_I16;
+    rec.temp_dht = logrec_pack_i16(json_number(obj, "temp_dht"), 100.0f);
+    rec.humidity = logrec_pack_u16(json_number(obj, "humidity"), 100.0f);
+    rec.ph = logrec_pack_u16(json_number(obj, "ph"), 100.0f);
+    rec.light = logrec_pack_u32(json_number(obj, "light"), 100.0f);
+    cJSON_Delete(obj);
+
+    // Log musi rosnąć w czasie (indeks, seq) - starsze rekordy zostają tylko w pliku .OLD
+    if (rec.timestamp <= m->floor) {
+        m->res.older++;
+        return true;
+    }
+    m->err = sensor_binlog_append(m->dir, &rec, NULL);
+    if (m->err != ESP_OK) return false;
+    m->floor = rec.timestamp;
+    m->res.migrated++;
+    return true;
+}
 
-    ESP_LOGI(TAG, "Zaktualizowano JSON: %s", path);
+esp_err_t sensor_json_migrate(const char *path, const char *dir, sensor_json_migration_t *out) {
+    if (!path || !dir) return ESP_ERR_INVALID_ARG;
+
+    int64_t t0 = esp_timer_get_time();
+    json_migrate_ctx_t m = { .dir = dir, .err = ESP_OK };
+    // Ponowienie przerwanej migracji pomija to, co już trafiło do logu
+    m.floor = binlog_last_timestamp(dir);
+
+    uint32_t too_long = 0;
+    esp_err_t ret = sdlog_json_objects(path, json_migrate_cb, &m, &too_long);
+    if (ret == ESP_ERR_NOT_FOUND) return ret;
+    m.res.skipped += too_long;
+    binlog_close();  // Rekordy na kartę, zanim outbox i odzyskiwanie zajrzą do logu
+    if (m.err != ESP_OK) {
+        ESP_LOGE(TAG, "Migracja %s przerwana: %s", path, esp_err_to_name(m.err));
+        if (out) *out = m.res;
+        return m.err;
+    }
+
+    // Oryginał zostaje jako .OLD (FAT nie nadpisuje pliku przy rename)
+    char old_path[SDLOG_PATH_MAX];
+    const char *slash = strrchr(path, '/');
+    const char *dot = strrchr(path, '.');
+    int base_len = (dot && (!slash || dot > slash)) ? (int)(dot - path) : (int)strlen(path);
+    snprintf(old_path, sizeof(old_path), "%.*s.OLD", base_len, path);
+    unlink(old_path);
+    if (rename(path, old_path) != 0) {
+        ESP_LOGE(TAG, "Nie mogę przenieść %s do %s: %s", path, old_path, strerror(errno));
+        if (out) *out = m.res;
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Zmigrowano %s do %s: %lu rekordów, %lu starszych niż log, %lu pominiętych (%lld ms)",
+             path, dir, (unsigned long)m.res.migrated, (unsigned long)m.res.older,
+             (unsigned long)m.res.skipped, (esp_timer_get_time() - t0) / 1000);
+    if (out) *out = m.res;
     return ESP_OK;
 }
 
 /********************
- * Odczyt JSON
+ * Odzyskiwanie logu binarnego
  ********************/
-esp_err_t sensor_json_read(const char *path) {
-    FILE *f = fopen(path, "r");
-    if (!f) return ESP_FAIL;
+#define BINLOG_RECOVER_MAX_FILES 3  // Najnowszy plik + ewentualne puste/uszkodzone
+
+// Doby przepisane do bieżącej wersji przy ostatnim odzyskiwaniu (offsety rekordów się zmieniły)
+static uint32_t binlog_upgraded_days[BINLOG_RECOVER_MAX_FILES];
+static uint32_t binlog_upgraded_count = 0;
 
-    char line[256];
-    while (fgets(line, sizeof(line), f)) {
-        ESP_LOGI(TAG, "Plik %s: %s", path, line);
+bool sensor_binlog_upgraded(uint32_t day) {
+    for (uint32_t i = 0; i < binlog_upgraded_count; i++) {
+        if (binlog_upgraded_days[i] == day) return true;
     }
-    fclose(f);
-    return ESP_OK;
+    return false;
 }
 
-esp_err_t sensor_ndjson_append(const char *path, const char *json_line) {
-    if (!path || !json_line) return ESP_ERR_INVALID_ARG;
-    
-    // Spróbuj otworzyć w trybie append
-    FILE *f = fopen(path, "a");
-    if (!f) {
-        // Jeśli plik nie istnieje, utwórz nowy
-        f = fopen(path, "w");
-        if (!f) {
-            ESP_LOGE(TAG, "fopen(%s) failed: %s", path, strerror(errno));
-            return ESP_FAIL;
+esp_err_t sensor_binlog_recover(const char *dir, sensor_binlog_recovery_t *out) {
+    if (!dir) return ESP_ERR_INVALID_ARG;
+
+    int64_t t0 = esp_timer_get_time();
+    sensor_binlog_recovery_t r = {0};
+    char name[16];
+    char below[16] = "";
+    esp_err_t ret = ESP_OK;
+
+    binlog_close();
+    binlog_upgraded_count = 0;
+
+    while (r.files < BINLOG_RECOVER_MAX_FILES &&
+           logstore_find_last_day(dir, below[0] ? below : NULL, name, sizeof(name))) {
+        char dat_path[SDLOG_PATH_MAX];
+        char idx_path[SDLOG_PATH_MAX];
+        snprintf(dat_path, sizeof(dat_path), "%s/%s", dir, name);
+        snprintf(idx_path, sizeof(idx_path), "%s/%.8s.IDX", dir, name);
+        strcpy(below, name);
+        r.files++;
+
+        logstore_recovery_t res;
+        ret = logstore_recover_file(dat_path, idx_path, &res);
+        if (ret == ESP_ERR_INVALID_VERSION) {
+            // Plik starszej wersji logrec (sprzed aktualizacji firmware) - przepisz na bieżący format
+            logstore_compact_t upgrade = {0};
+            if (logstore_compact_file(dir, name, &upgrade, NULL) == ESP_OK) {
+                ESP_LOGI(TAG, "%s: przepisano do wersji %d", dat_path, LOGREC_VERSION);
+                binlog_upgraded_days[binlog_upgraded_count++] = logstore_day_from_name(name);
+                ret = logstore_recover_file(dat_path, idx_path, &res);
+                if (ret == ESP_ERR_NOT_FOUND) continue;  // Nie było poprawnych rekordów
+            }
+        }
+        if (ret == ESP_ERR_INVALID_SIZE) {
+            // Nagłówek nie zdążył się zapisać - plik nie zawiera żadnych danych
+            ESP_LOGW(TAG, "%s: niepełny nagłówek, usuwam plik", dat_path);
+            unlink(dat_path);
+            unlink(idx_path);
+            continue;
+        }
+        if (ret != ESP_OK) {
+            // Uszkodzony nagłówek blokowałby zapis całej doby - plik odkładamy jako .BAD
+            char bad_path[SDLOG_PATH_MAX];
+            snprintf(bad_path, sizeof(bad_path), "%s/%.8s.BAD", dir, name);
+            ESP_LOGE(TAG, "%s: odzyskiwanie nieudane (%s), przenoszę do %s",
+                     dat_path, esp_err_to_name(ret), bad_path);
+            unlink(bad_path);
+            rename(dat_path, bad_path);
+            unlink(idx_path);
+            continue;
+        }
+
+        if (r.file[0] == '\0') {
+            strcpy(r.file, name);
+            r.result = res;
+        }
+        if (res.truncated_bytes || res.truncated_index) {
+            ESP_LOGW(TAG, "%s: obcięto %lu B uszkodzonego ogona i %lu wpisów indeksu",
+                     dat_path, (unsigned long)res.truncated_bytes, (unsigned long)res.truncated_index);
+        }
+        if (res.has_record) {
+            r.next_seq = res.last_seq + 1;
+            break;
         }
     }
-    
-    fprintf(f, "%s\n", json_line);
-    fflush(f);
-    fclose(f);
-    
+
+    binlog_next_seq = r.next_seq;
+    r.duration_us = esp_timer_get_time() - t0;
+    ESP_LOGI(TAG, "Odzyskiwanie logu: %s, %lu plików, %lu rekordów sprawdzonych, seq od %lu (%lld ms)",
+             r.file[0] ? r.file : "brak danych", (unsigned long)r.files,
+             (unsigned long)r.result.checked, (unsigned long)r.next_seq, r.duration_us / 1000);
+
+    if (out) *out = r;
     return ESP_OK;
 }
 
+esp_err_t sensor_binlog_retention(const char *dir, uint32_t now, const logstore_retention_t *policy,
+                                  logstore_retention_stats_t *stats) {
+    // Plik bieżącej doby jest otwarty - tego nie wolno przepisywać
+    const char *skip = NULL;
+    size_t dir_len = strlen(dir);
+    if (data_log.f && strncmp(data_log.path, dir, dir_len) == 0 && data_log.path[dir_len] == '/') {
+        skip = data_log.path + dir_len + 1;
+    }
+
+    int64_t t0 = esp_timer_get_time();
+    logstore_retention_stats_t st;
+    esp_err_t ret = logstore_retention(dir, now, policy, skip, &st);
+    if (ret == ESP_OK && (st.files_compacted || st.files_deleted)) {
+        ESP_LOGI(TAG, "Retencja: %lu plików uśrednionych (%lu -> %lu B), %lu usuniętych (%lld ms)",
+                 (unsigned long)st.files_compacted, (unsigned long)st.bytes_before,
+                 (unsigned long)st.bytes_after, (unsigned long)st.files_deleted,
+                 (esp_timer_get_time() - t0) / 1000);
+    }
+    if (stats) *stats = st;
+    return ret;
+}
+
+esp_err_t sensor_binlog_purge(const char *dir, logstore_keep_cb_t keep, void *ctx, uint32_t last_day,
+                              logstore_purge_stats_t *stats) {
+    // Otwartego pliku nie da się przepisać - zamknięcie robi też commit bufora
+    binlog_close();
+
+    int64_t t0 = esp_timer_get_time();
+    logstore_purge_stats_t st;
+    esp_err_t ret = logstore_purge(dir, keep, ctx, last_day, NULL, &st);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Usuwanie: %lu rekordów, %lu plików przepisanych, %lu usuniętych (%lld ms)",
+                 (unsigned long)st.records_deleted, (unsigned long)st.files_rewritten,
+                 (unsigned long)st.files_deleted, (esp_timer_get_time() - t0) / 1000);
+    }
+    if (stats) *stats = st;
+    return ret;
+}
+
+esp_err_t sensor_binlog_read_range(const char *dir, uint32_t t0, uint32_t t1,
+                                   logstore_record_cb_t cb, void *ctx,
+                                   logstore_range_stats_t *stats) {
+    return logstore_read_range(dir, t0, t1, cb, ctx, stats);
+}
+
+/********************
+ * Group commit - okno trwałości i liczniki
+ ********************/
+void sensor_sdcard_set_durability(uint32_t max_records, uint32_t max_age_sec) {
+    data_log_cfg.max_records = max_records;
+    data_log_cfg.max_age_ms = max_age_sec * 1000;
+    if (data_log.f) sdlog_set_config(&data_log, &data_log_cfg);
+    ESP_LOGI(TAG, "Okno trwałości: %lu rekordów / %lu s",
+             (unsigned long)max_records, (unsigned long)max_age_sec);
+}
+
+esp_err_t sensor_sdcard_sync(void) {
+    if (!data_log.f) return ESP_OK;
+    return sdlog_flush(&data_log);
+}
+
+esp_err_t sensor_sdcard_poll(void) {
+    if (!data_log.f) return ESP_OK;
+    return sdlog_poll(&data_log);
+}
+
+void sensor_sdcard_get_stats(sdlog_stats_t *stats) {
+    if (!stats) return;
+    *stats = data_log_totals;
+    stats_add(stats, &data_log.stats);
+}
+
 bool sensor_sdcard_is_mounted(void) {
     return card != NULL;
 }
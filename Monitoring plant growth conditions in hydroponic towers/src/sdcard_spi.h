@@ -2,7 +2,11 @@
 #define SDCARD_SPI_H
 
 #include "esp_err.h"
+#include "sdlog.h"
+#include "logrec.h"
+#include "logstore.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 /**
  * Inicjalizacja karty SD i montowanie w SPI
@@ -11,46 +15,137 @@
 esp_err_t sensor_sdcard_init(void);
 
 /**
- * Odmontowanie karty SD
+ * Odmontowanie karty SD (najpierw zapisuje buforowane rekordy)
  */
 esp_err_t sensor_sdcard_unmount(void);
 
 /**
- * Dopisuje dane czujnika do pliku JSON.
- * Jeśli timestamp==NULL, funkcja dopisuje aktualny czas w ms od startu ESP32.
+ * Dopisuje rekord do binarnego logu pomiarów (format w logrec.h).
+ * Log jest dzielony na pliki dzienne "<dir>/YYYYMMDD.DAT" wg timestampu
+ * rekordu, z rzadkim indeksem czasu w "<dir>/YYYYMMDD.IDX" (logstore.h).
+ * Nowy plik dostaje nagłówek ze schematem; dla istniejącego sprawdzana jest
+ * wersja formatu. Funkcja nadaje rekordowi numer kolejny (seq, ciągły między
+ * plikami) i liczy CRC.
  *
- * @param path Ścieżka do pliku JSON (np. "/sdcard/sensordata.json")
- * @param sensor_id Identyfikator czujnika (np. "temp", "hum")
- * @param value Wartość zmierzonego parametru
- * @param timestamp NULL lub string z timestampem
- * @return ESP_OK jeśli zapis się powiódł
+ * @param dir Katalog logu (np. "/sdcard/LOG"), tworzony w razie potrzeby
+ * @param rec Rekord do zapisu; pola seq i crc są uzupełniane
+ * @param pos [out] Pozycja zapisanego rekordu (może być NULL)
+ * @return ESP_OK, ESP_ERR_INVALID_VERSION gdy plik ma inny format
  */
-esp_err_t sensor_json_append(const char *path, const char *sensor_id, double value, const char *timestamp);
+esp_err_t sensor_binlog_append(const char *dir, logrec_t *rec, logstore_pos_t *pos);
 
 /**
- * Usuwa wszystkie wpisy w pliku JSON, gdzie podane pole ma podaną wartość.
- * Przykład: usunięcie wszystkich wpisów typu "temp"
+ * Wynik migracji starego pliku JSON (sensor_json_migrate).
+ */
+typedef struct {
+    uint32_t migrated;            // Rekordy dopisane do logu binarnego
+    uint32_t older;               // Nie nowsze niż ostatni rekord logu - pominięte
+    uint32_t skipped;             // Bez czasu RTC, uszkodzone lub za długie
+} sensor_json_migration_t;
+
+/**
+ * Jednorazowa migracja pliku danych starego firmware (tablica JSON z
+ * sensor_json_append albo NDJSON) do binarnego logu dziennego w dir.
+ * Plik jest czytany strumieniowo (sdlog_json_objects); obiekt z czasem RTC
+ * "YYYY-MM-DD HH:MM:SS" staje się rekordem logrec (temp_ds18, temp_dht,
+ * humidity, light, ph, jeśli są; reszta NA), dostaje kolejny seq i trafia do
+ * pliku swojej doby. Log ma rosnąć w czasie, więc rekordy nie nowsze niż
+ * ostatni rekord logu są pomijane - to też czyni przerwaną migrację bezpieczną
+ * do powtórzenia. Po sukcesie plik zostaje przemianowany na <nazwa>.OLD.
+ * Wołać po sensor_binlog_recover(), przed outbox_init().
+ *
+ * @param path Stary plik (np. "/sdcard/MEASUR~1.NDJ")
+ * @param dir Katalog logu binarnego
+ * @param out [out] Liczniki (może być NULL)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND gdy pliku nie ma, błąd zapisu lub rename
+ */
+esp_err_t sensor_json_migrate(const char *path, const char *dir, sensor_json_migration_t *out);
+
+/**
+ * Wynik odzyskiwania logu binarnego po starcie.
+ */
+typedef struct {
+    char file[16];                // Odzyskany plik doby ("" gdy log jest pusty)
+    logstore_recovery_t result;   // Szczegóły (logstore_recover_file)
+    uint32_t next_seq;            // seq, od którego będzie kontynuowany zapis
+    uint32_t files;               // Sprawdzone pliki
+    int64_t duration_us;          // Czas odzyskiwania
+} sensor_binlog_recovery_t;
+
+/**
+ * Odzyskiwanie logu binarnego po zaniku zasilania. Wołać po sensor_sdcard_init(),
+ * przed pierwszym zapisem. Dla najnowszego pliku doby obcina uszkodzony ogon
+ * (logstore_recover_file) i ustawia kolejny numer seq; plik tylko z nagłówkiem
+ * (zanik zasilania zaraz po utworzeniu) jest usuwany, a seq brany z poprzedniego.
+ * Czas nie zależy od rozmiaru logu (stała liczba rekordów + indeks).
+ *
+ * @param dir Katalog logu (np. "/sdcard/LOG")
+ * @param out [out] Wynik (może być NULL)
+ */
+esp_err_t sensor_binlog_recover(const char *dir, sensor_binlog_recovery_t *out);
+
+/**
+ * Czy plik doby day został przy ostatnim sensor_binlog_recover() przepisany
+ * ze starszej wersji logrec. Offsety rekordów w takim pliku są inne niż przed
+ * aktualizacją - zapisane wcześniej pozycje (kursor outbox) trzeba odświeżyć.
+ *
+ * @param day Numer doby (timestamp / LOGSTORE_SECONDS_PER_DAY)
+ */
+bool sensor_binlog_upgraded(uint32_t day);
+
+/**
+ * Retencja logu binarnego (logstore_retention): usuwa lub uśrednia pliki dób
+ * starsze niż wskazuje polityka. Plik otwarty do zapisu jest pomijany.
+ * Wołać z zadania zapisu (storage_task) - pracuje strumieniowo na stałym buforze.
  *
- * @param path Ścieżka do pliku JSON
- * @param field Nazwa pola (np. "sensor_id")
- * @param value Wartość pola (np. "temp")
- * @return ESP_OK jeśli operacja się powiodła
+ * @param now Bieżący czas RTC (sekundy)
+ */
+esp_err_t sensor_binlog_retention(const char *dir, uint32_t now, const logstore_retention_t *policy,
+                                  logstore_retention_stats_t *stats);
+
+/**
+ * Usuwa z logu rekordy odrzucone przez predykat keep (logstore_purge) w plikach
+ * dób do last_day włącznie. Bieżący plik jest najpierw zamykany (sync), więc
+ * obejmuje także rekordy dzisiejsze; kolejny zapis otwiera go ponownie.
+ * Wołać z zadania zapisu (storage_purge).
+ */
+esp_err_t sensor_binlog_purge(const char *dir, logstore_keep_cb_t keep, void *ctx, uint32_t last_day,
+                              logstore_purge_stats_t *stats);
+
+/**
+ * Odczytuje rekordy z zakresu czasu [t0, t1) (logstore_read_range).
+ * Otwiera tylko pliki dób z zakresu i skacze przez indeks do pierwszego rekordu.
+ * Widoczne są rekordy zapisane na kartę - rekordy z okna trwałości (RAM)
+ * pojawią się po sync. Spoza zadania zapisu wołać przez storage_read_range.
+ */
+esp_err_t sensor_binlog_read_range(const char *dir, uint32_t t0, uint32_t t1,
+                                   logstore_record_cb_t cb, void *ctx,
+                                   logstore_range_stats_t *stats);
+
+/**
+ * Ustawia okno trwałości (group commit) dla logu danych.
+ * Rekordy są zbierane w RAM i zapisywane całymi sektorami 4 KiB; niepełny
+ * sektor trafia na kartę po max_records rekordach lub gdy najstarszy rekord
+ * czeka dłużej niż max_age_sec. 0 wyłącza dany limit.
+ * Domyślnie: commit po każdym rekordzie.
+ */
+void sensor_sdcard_set_durability(uint32_t max_records, uint32_t max_age_sec);
+
+/**
+ * Jawny sync - zapisuje wszystkie buforowane rekordy na kartę.
  */
-esp_err_t sensor_json_remove_by_field(const char *path, const char *field, const char *value);
+esp_err_t sensor_sdcard_sync(void);
 
 /**
- * Odczytuje i loguje zawartość pliku JSON
- * @param path Ścieżka do pliku JSON
- * @return ESP_OK jeśli odczyt się powiódł
+ * Sprawdza limit wieku okna trwałości. Wołać cyklicznie (np. co sekundę).
  */
-esp_err_t sensor_json_read(const char *path);
+esp_err_t sensor_sdcard_poll(void);
 
 /**
- * Append a single JSON object (line) to a file as NDJSON (newline-delimited JSON).
- * This function opens the file in append mode and writes the provided JSON string
- * followed by a newline. It flushes and syncs to reduce data loss on power loss.
+ * Kopiuje liczniki zapisu (commity, bajty, sektory) logu danych - sumę od startu
+ * ze wszystkich plików dziennych, nie tylko z aktualnie otwartego.
  */
-esp_err_t sensor_ndjson_append(const char *path, const char *json_line);
+void sensor_sdcard_get_stats(sdlog_stats_t *stats);
 
 /**
  * Returns true if SD card is currently mounted.
@@ -0,0 +1,282 @@
+#include "sdlog.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+static const char *TAG = "SDLOG";
+
+typedef enum {
+    COMMIT_FILL,
+    COMMIT_RECORDS,
+    COMMIT_AGE,
+    COMMIT_SYNC,
+} commit_reason_t;
+
+/********************
+ * Otwarcie / zamknięcie
+ ********************/
+esp_err_t sdlog_open(sdlog_t *log, const char *path) {
+    if (!log || !path || strlen(path) >= SDLOG_PATH_MAX) return ESP_ERR_INVALID_ARG;
+
+    if (sdlog_is_open_at(log, path)) return ESP_OK;
+    sdlog_close(log);
+
+    // "a" tworzy plik jeśli nie istnieje i zawsze dopisuje na końcu
+    log->f = fopen(path, "a");
+    if (!log->f) {
+        ESP_LOGE(TAG, "fopen(%s) failed: %s", path, strerror(errno));
+        return ESP_FAIL;
+    }
+    // Buforujemy sami (pełne sektory) - bufor stdio tylko dzieliłby zapisy
+    setvbuf(log->f, NULL, _IONBF, 0);
+
+    fseek(log->f, 0, SEEK_END);
+    long size = ftell(log->f);
+
+    strncpy(log->path, path, sizeof(log->path) - 1);
+    log->path[sizeof(log->path) - 1] = '\0';
+    log->cfg = (sdlog_config_t)SDLOG_CONFIG_DEFAULT();
+    log->records = 0;
+    log->bytes = 0;
+    log->head = 0;
+    log->fill = 0;
+    log->file_off = size > 0 ? (uint64_t)size : 0;
+    log->pending_records = 0;
+    log->pending_since_us = 0;
+    log->on_commit = NULL;
+    log->commit_ctx = NULL;
+    memset(&log->stats, 0, sizeof(log->stats));
+    return ESP_OK;
+}
+
+void sdlog_set_config(sdlog_t *log, const sdlog_config_t *cfg) {
+    if (!log || !cfg) return;
+    log->cfg = *cfg;
+}
+
+void sdlog_set_commit_cb(sdlog_t *log, sdlog_commit_cb_t cb, void *ctx) {
+    if (!log) return;
+    log->on_commit = cb;
+    log->commit_ctx = ctx;
+}
+
+void sdlog_close(sdlog_t *log) {
+    if (!log || !log->f) return;
+    sdlog_flush(log);
+    fclose(log->f);
+    log->f = NULL;
+    log->path[0] = '\0';
+}
+
+bool sdlog_is_open_at(const sdlog_t *log, const char *path) {
+    return log && log->f && path && strcmp(log->path, path) == 0;
+}
+
+/********************
+ * Bufor pierścieniowy
+ ********************/
+static void ring_put(sdlog_t *log, const uint8_t *data, size_t len) {
+    size_t tail = (log->head + log->fill) % SDLOG_BUF_SIZE;
+    size_t first = SDLOG_BUF_SIZE - tail;
+    if (first > len) first = len;
+
+    memcpy(&log->buf[tail], data, first);
+    memcpy(&log->buf[0], data + first, len - first);
+    log->fill += len;
+}
+
+// Zapisuje len bajtów od head do pliku (bez commitu)
+static esp_err_t ring_write_out(sdlog_t *log, size_t len) {
+    size_t first = SDLOG_BUF_SIZE - log->head;
+    if (first > len) first = len;
+
+    if (fwrite(&log->buf[log->head], 1, first, log->f) != first ||
+        (len > first && fwrite(&log->buf[0], 1, len - first, log->f) != len - first)) {
+        ESP_LOGE(TAG, "write(%s) failed: %s", log->path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    // Sektory, których dotyka zakres [file_off, file_off + len)
+    uint64_t first_sector = log->file_off / SDLOG_SECTOR_SIZE;
+    uint64_t last_sector = (log->file_off + len - 1) / SDLOG_SECTOR_SIZE;
+    log->stats.sectors_written += last_sector - first_sector + 1;
+    log->stats.bytes_written += len;
+
+    log->head = (log->head + len) % SDLOG_BUF_SIZE;
+    log->fill -= len;
+    log->file_off += len;
+    if (log->fill == 0) log->pending_records = 0;
+    return ESP_OK;
+}
+
+static esp_err_t commit(sdlog_t *log, commit_reason_t reason) {
+    if (fflush(log->f) != 0) {
+        ESP_LOGE(TAG, "fflush(%s) failed: %s", log->path, strerror(errno));
+        return ESP_FAIL;
+    }
+    if (log->cfg.fsync && fsync(fileno(log->f)) != 0) {
+        ESP_LOGE(TAG, "fsync(%s) failed: %s", log->path, strerror(errno));
+        return ESP_FAIL;
+    }
+
+    log->stats.flushes++;
+    switch (reason) {
+        case COMMIT_FILL:    log->stats.flushes_fill++;    break;
+        case COMMIT_RECORDS: log->stats.flushes_records++; break;
+        case COMMIT_AGE:     log->stats.flushes_age++;     break;
+        default:             log->stats.flushes_sync++;    break;
+    }
+    if (log->on_commit) log->on_commit(log->file_off, log->commit_ctx);
+    return ESP_OK;
+}
+
+// Zapisz wszystko (także niepełny sektor) i zrób commit
+static esp_err_t flush_all(sdlog_t *log, commit_reason_t reason) {
+    if (log->fill == 0) return ESP_OK;
+    esp_err_t ret = ring_write_out(log, log->fill);
+    if (ret != ESP_OK) return ret;
+    return commit(log, reason);
+}
+
+/********************
+ * Dopisywanie
+ ********************/
+esp_err_t sdlog_flush(sdlog_t *log) {
+    if (!log || !log->f) return ESP_ERR_INVALID_STATE;
+    return flush_all(log, COMMIT_SYNC);
+}
+
+esp_err_t sdlog_poll(sdlog_t *log) {
+    if (!log || !log->f) return ESP_ERR_INVALID_STATE;
+    if (log->fill == 0 || log->cfg.max_age_ms == 0) return ESP_OK;
+
+    int64_t age_us = esp_timer_get_time() - log->pending_since_us;
+    if (age_us >= (int64_t)log->cfg.max_age_ms * 1000) {
+        return flush_all(log, COMMIT_AGE);
+    }
+    return ESP_OK;
+}
+
+static esp_err_t stage(sdlog_t *log, const void *data, size_t len) {
+    if (log->fill == 0) log->pending_since_us = esp_timer_get_time();
+    ring_put(log, data, len);
+    log->bytes += len;
+    log->stats.bytes_in += len;
+    return ESP_OK;
+}
+
+// Po dopisaniu rekordu: zapisz pełne sektory, potem sprawdź okno trwałości
+static esp_err_t record_done(sdlog_t *log) {
+    log->records++;
+    log->pending_records++;
+
+    bool wrote = false;
+    size_t sector_used = log->file_off % SDLOG_SECTOR_SIZE;
+    while (sector_used + log->fill >= SDLOG_SECTOR_SIZE) {
+        esp_err_t ret = ring_write_out(log, SDLOG_SECTOR_SIZE - sector_used);
+        if (ret != ESP_OK) return ret;
+        sector_used = 0;
+        wrote = true;
+    }
+    if (wrote) {
+        esp_err_t ret = commit(log, COMMIT_FILL);
+        if (ret != ESP_OK) return ret;
+    }
+
+    if (log->cfg.max_records && log->pending_records >= log->cfg.max_records) {
+        return flush_all(log, COMMIT_RECORDS);
+    }
+    return sdlog_poll(log);
+}
+
+esp_err_t sdlog_append(sdlog_t *log, const void *data, size_t len) {
+    if (!log || !data || len == 0) return ESP_ERR_INVALID_ARG;
+    if (!log->f) return ESP_ERR_INVALID_STATE;
+    if (len > SDLOG_SECTOR_SIZE) return ESP_ERR_INVALID_SIZE;
+    // Po udanym record_done() w buforze zostaje mniej niż sektor, więc rekord
+    // zawsze się mieści; brak miejsca oznacza wcześniejszy błąd zapisu
+    if (log->fill + len > SDLOG_BUF_SIZE) return ESP_ERR_NO_MEM;
+
+    esp_err_t ret = stage(log, data, len);
+    if (ret != ESP_OK) return ret;
+    return record_done(log);
+}
+
+esp_err_t sdlog_append_line(sdlog_t *log, const char *json_line) {
+    if (!log || !json_line) return ESP_ERR_INVALID_ARG;
+    if (!log->f) return ESP_ERR_INVALID_STATE;
+
+    size_t len = strlen(json_line);
+    if (len + 1 > SDLOG_LINE_MAX) return ESP_ERR_INVALID_SIZE;
+    if (log->fill + len + 1 > SDLOG_BUF_SIZE) return ESP_ERR_NO_MEM;
+
+    stage(log, json_line, len);
+    stage(log, "\n", 1);
+    return record_done(log);
+}
+
+float sdlog_write_amplification(const sdlog_stats_t *stats) {
+    if (!stats || stats->bytes_in == 0) return 0.0f;
+    return (float)((double)stats->sectors_written * SDLOG_SECTOR_SIZE / (double)stats->bytes_in);
+}
+
+/********************
+ * Stary format JSON (tablica / NDJSON)
+ ********************/
+esp_err_t sdlog_json_objects(const char *path, sdlog_json_cb_t cb, void *ctx, uint32_t *skipped) {
+    if (!path || !cb) return ESP_ERR_INVALID_ARG;
+    if (skipped) *skipped = 0;
+
+    FILE *f = fopen(path, "r");
+    if (!f) return ESP_ERR_NOT_FOUND;
+
+    // Prosty automat: głębokość obiektów { } i stan wewnątrz stringa. Nawiasy
+    // tablicy i przecinki między elementami leżą poza obiektem i są pomijane.
+    char obj[SDLOG_LINE_MAX];
+    size_t pos = 0;
+    int depth = 0;
+    bool in_string = false;
+    bool escape = false;
+    bool overflow = false;
+    int c;
+
+    while ((c = fgetc(f)) != EOF) {
+        if (in_string) {
+            if (escape) escape = false;
+            else if (c == '\\') escape = true;
+            else if (c == '"') in_string = false;
+        } else if (c == '{') {
+            depth++;
+        } else if (c == '}') {
+            if (depth == 0) continue;
+            depth--;
+        } else if (depth == 0 || c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+            continue;
+        } else if (c == '"') {
+            in_string = true;
+        }
+
+        if (pos < sizeof(obj) - 1) {
+            obj[pos++] = (char)c;
+        } else {
+            overflow = true;
+        }
+
+        // Koniec obiektu najwyższego poziomu
+        if (depth == 0) {
+            obj[pos] = '\0';
+            if (overflow) {
+                if (skipped) (*skipped)++;
+            } else if (!cb(obj, ctx)) {
+                break;
+            }
+            pos = 0;
+            overflow = false;
+        }
+    }
+
+    fclose(f);
+    return ESP_OK;
+}
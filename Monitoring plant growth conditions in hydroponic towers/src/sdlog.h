@@ -0,0 +1,159 @@
+#ifndef SDLOG_H
+#define SDLOG_H
+
+#include "esp_err.h"
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Append-only log writer dla karty SD.
+ *
+ * Plik jest otwierany raz (trwały uchwyt) i każdy rekord jest tylko dopisywany
+ * na końcu, więc koszt zapisu nie zależy od rozmiaru pliku. Moduł używa wyłącznie
+ * stdio/POSIX, dzięki czemu ten sam kod da się skompilować i zmierzyć na PC
+ * (patrz tools/bench_sdlog.c).
+ *
+ * Rekordy trafiają najpierw do bufora pierścieniowego w RAM (2 sektory) i są
+ * zapisywane na kartę całymi sektorami 4 KiB (CONFIG_FATFS_SECTOR_4096), tak aby
+ * FAT nie robił read-modify-write sektora przy każdym rekordzie. Niepełny sektor
+ * jest zapisywany (group commit) dopiero po przekroczeniu okna trwałości
+ * (liczba rekordów lub wiek najstarszego rekordu) albo po jawnym sdlog_flush().
+ */
+
+// Maksymalna długość pojedynczej linii tekstowej (z '\n')
+#define SDLOG_LINE_MAX   512
+#define SDLOG_PATH_MAX   64
+
+// Rozmiar sektora FATFS i bufora pierścieniowego
+#define SDLOG_SECTOR_SIZE  4096
+#define SDLOG_BUF_SIZE     (2 * SDLOG_SECTOR_SIZE)
+
+/**
+ * Okno trwałości: ile danych może czekać w RAM przed wymuszonym zapisem.
+ * Wartość 0 wyłącza dany limit. Pełne sektory są zapisywane zawsze.
+ */
+typedef struct {
+    uint32_t max_records;   // commit po tylu rekordach (1 = po każdym rekordzie)
+    uint32_t max_age_ms;    // commit gdy najstarszy niezapisany rekord jest starszy
+    bool fsync;             // fsync po każdym commit (false tylko do testów na PC)
+} sdlog_config_t;
+
+// Domyślnie: commit po każdym rekordzie (najbezpieczniejsze przy zaniku zasilania)
+#define SDLOG_CONFIG_DEFAULT() { .max_records = 1, .max_age_ms = 0, .fsync = true }
+
+/**
+ * Liczniki zapisu. Współczynnik write amplification to
+ * sectors_written * SDLOG_SECTOR_SIZE / bytes_in (sdlog_write_amplification).
+ */
+typedef struct {
+    uint32_t flushes;         // Liczba commitów (fflush + fsync)
+    uint32_t flushes_fill;    // ... wywołanych zapełnieniem sektora
+    uint32_t flushes_records; // ... wywołanych limitem rekordów
+    uint32_t flushes_age;     // ... wywołanych wiekiem rekordów
+    uint32_t flushes_sync;    // ... jawnych (sdlog_flush / zamknięcie)
+    uint64_t bytes_in;        // Bajty przyjęte od wywołującego
+    uint64_t bytes_written;   // Bajty przekazane do systemu plików
+    uint64_t sectors_written; // Sektory dotknięte zapisem (częściowe liczone osobno)
+} sdlog_stats_t;
+
+/**
+ * Wywoływane po każdym udanym commicie (fflush + fsync). durable_off to offset
+ * końca danych, które są już trwale na karcie.
+ */
+typedef void (*sdlog_commit_cb_t)(uint64_t durable_off, void *ctx);
+
+typedef struct {
+    FILE *f;                      // Trwały uchwyt pliku (NULL = zamknięty)
+    char path[SDLOG_PATH_MAX];    // Ścieżka otwartego pliku
+    sdlog_config_t cfg;           // Okno trwałości
+    uint32_t records;             // Liczba rekordów dopisanych od otwarcia
+    uint64_t bytes;               // Liczba bajtów dopisanych od otwarcia
+
+    // Bufor pierścieniowy
+    uint8_t buf[SDLOG_BUF_SIZE];
+    size_t head;                  // Indeks najstarszego niezapisanego bajtu
+    size_t fill;                  // Liczba niezapisanych bajtów
+    uint64_t file_off;            // Offset w pliku odpowiadający head
+    uint32_t pending_records;     // Rekordy od ostatniego opróżnienia bufora
+    int64_t pending_since_us;     // Czas dopisania najstarszego z nich
+
+    sdlog_commit_cb_t on_commit;  // Opcjonalny callback commitu (NULL = brak)
+    void *commit_ctx;
+
+    sdlog_stats_t stats;
+} sdlog_t;
+
+/**
+ * Otwiera (lub tworzy) plik logu w trybie dopisywania z konfiguracją
+ * SDLOG_CONFIG_DEFAULT(). Liczniki sdlog_stats_t są zerowane.
+ * @return ESP_OK, ESP_ERR_INVALID_ARG lub ESP_FAIL gdy fopen się nie powiódł
+ */
+esp_err_t sdlog_open(sdlog_t *log, const char *path);
+
+/**
+ * Ustawia okno trwałości. Może być wywołane w dowolnym momencie.
+ */
+void sdlog_set_config(sdlog_t *log, const sdlog_config_t *cfg);
+
+/**
+ * Ustawia callback wołany po każdym commicie - pozwala dopisać dane pochodne
+ * (np. indeks) w tym samym commicie co dane, które opisują. sdlog_open go zeruje.
+ */
+void sdlog_set_commit_cb(sdlog_t *log, sdlog_commit_cb_t cb, void *ctx);
+
+/**
+ * Dopisuje rekord binarny (maks. SDLOG_SECTOR_SIZE bajtów).
+ */
+esp_err_t sdlog_append(sdlog_t *log, const void *data, size_t len);
+
+/**
+ * Dopisuje jedną linię tekstu, np. NDJSON (funkcja sama dodaje '\n').
+ * Linia jest trwała na karcie najpóźniej po przekroczeniu okna trwałości.
+ */
+esp_err_t sdlog_append_line(sdlog_t *log, const char *json_line);
+
+/**
+ * Sprawdza wiek buforowanych rekordów i robi commit, jeśli przekroczono
+ * max_age_ms. Należy wołać cyklicznie (np. co sekundę).
+ */
+esp_err_t sdlog_poll(sdlog_t *log);
+
+/**
+ * Jawny sync: zapisuje cały bufor (także niepełny sektor), fflush i fsync.
+ */
+esp_err_t sdlog_flush(sdlog_t *log);
+
+/**
+ * Zamyka uchwyt po sdlog_flush() (bezpieczne dla już zamkniętego logu).
+ */
+void sdlog_close(sdlog_t *log);
+
+/**
+ * Zwraca true, jeśli log jest otwarty na podanej ścieżce.
+ */
+bool sdlog_is_open_at(const sdlog_t *log, const char *path);
+
+/**
+ * Zwraca write amplification (bajty fizycznie zapisanych sektorów / bajty przyjęte).
+ */
+float sdlog_write_amplification(const sdlog_stats_t *stats);
+
+/**
+ * Obiekt JSON ze starego pliku danych (sdlog_json_objects), bez białych znaków
+ * spoza stringów. Zwraca false, aby przerwać przeglądanie.
+ */
+typedef bool (*sdlog_json_cb_t)(const char *object, void *ctx);
+
+/**
+ * Strumieniowo przegląda obiekty JSON najwyższego poziomu w pliku starego
+ * formatu: tablicy ([{...}, {...}], dawny sensor_json_append) albo NDJSON
+ * (obiekt na linię). Pamięć stała - jeden obiekt do SDLOG_LINE_MAX; dłuższy
+ * jest pomijany i liczony w skipped.
+ *
+ * @param skipped [out] Pominięte obiekty (może być NULL)
+ * @return ESP_OK, ESP_ERR_NOT_FOUND gdy pliku nie ma
+ */
+esp_err_t sdlog_json_objects(const char *path, sdlog_json_cb_t cb, void *ctx, uint32_t *skipped);
+
+#endif // SDLOG_H
@@ -0,0 +1,231 @@
+#include "storage.h"
+#include "sdcard_spi.h"
+#include "outbox.h"
+#include "recbuf.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "STORAGE";
+
+typedef struct {
+    logrec_t *rec[STORAGE_BANK_RECORDS];  // Rekordy z puli recbuf (po jednej referencji)
+    uint32_t count;
+} storage_bank_t;
+
+// Dwa banki: do jednego pisze akwizycja, drugi zapisuje zadanie storage_task
+static storage_bank_t banks[2];
+static storage_bank_t *fill_bank = &banks[0];
+
+static portMUX_TYPE bank_mux = portMUX_INITIALIZER_UNLOCKED;
+// Dostęp do karty (log, retencja, outbox): trzyma go storage_task na czas pracy,
+// a inne zadania (storage_read_range) tylko przez niego czytają log
+static SemaphoreHandle_t card_mutex = NULL;
+static TaskHandle_t storage_task_handle = NULL;
+static storage_overflow_t overflow_policy = STORAGE_DROP_NEWEST;
+static volatile bool sync_requested = false;
+static char log_dir[SDLOG_PATH_MAX];
+static storage_stats_t stats = {0};
+static logstore_retention_t retention = {0};
+static volatile bool retention_set = false;
+static uint32_t retention_day = UINT32_MAX;  // Doba ostatniego przebiegu retencji
+
+/********************
+ * Zadanie zapisu
+ ********************/
+static void write_bank(storage_bank_t *bank) {
+    int64_t t0 = esp_timer_get_time();
+    uint32_t ok = 0, errors = 0;
+
+    for (uint32_t i = 0; i < bank->count; i++) {
+        logstore_pos_t pos;
+        // Zapis nadaje seq i CRC w rekordzie współdzielonym z outboxem
+        esp_err_t ret = sensor_binlog_append(log_dir, bank->rec[i], &pos);
+        if (ret == ESP_OK) {
+            ok++;
+            outbox_record_written(bank->rec[i], &pos);
+        } else {
+            errors++;
+            ESP_LOGW(TAG, "SD write failed: %s", esp_err_to_name(ret));
+        }
+        recbuf_unref(bank->rec[i]);
+        bank->rec[i] = NULL;
+    }
+    bank->count = 0;
+
+    int64_t dt = esp_timer_get_time() - t0;
+    portENTER_CRITICAL(&bank_mux);
+    stats.written += ok;
+    stats.write_errors += errors;
+    stats.last_write_us = dt;
+    if (dt > stats.max_write_us) stats.max_write_us = dt;
+    portEXIT_CRITICAL(&bank_mux);
+
+    ESP_LOGI(TAG, "Wrote %lu records to SD in %lld us", (unsigned long)ok, dt);
+}
+
+// Retencja raz na dobę - przy pierwszym zapisie nowej doby (czas z rekordu)
+static void run_retention(uint32_t now) {
+    uint32_t day = now / LOGSTORE_SECONDS_PER_DAY;
+    if (!retention_set || day == retention_day) return;
+    retention_day = day;
+
+    logstore_retention_t policy = retention;
+    logstore_retention_stats_t st;
+    if (sensor_binlog_retention(log_dir, now, &policy, &st) == ESP_OK && st.first_day != UINT32_MAX) {
+        outbox_realign(st.first_day);
+    }
+}
+
+// Zamiana banków: akwizycja dostaje pusty bank, my zapisujemy pełny (pod card_mutex)
+static void drain_bank(void) {
+    storage_bank_t *to_write = NULL;
+    portENTER_CRITICAL(&bank_mux);
+    if (fill_bank->count > 0) {
+        to_write = fill_bank;
+        fill_bank = (fill_bank == &banks[0]) ? &banks[1] : &banks[0];
+        stats.swaps++;
+    }
+    portEXIT_CRITICAL(&bank_mux);
+
+    if (to_write) {
+        uint32_t now = to_write->rec[to_write->count - 1]->timestamp;
+        write_bank(to_write);
+        run_retention(now);
+    }
+}
+
+static void storage_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(STORAGE_POLL_MS));
+        xSemaphoreTake(card_mutex, portMAX_DELAY);
+
+        drain_bank();
+
+        if (sync_requested) {
+            sync_requested = false;
+            sensor_sdcard_sync();
+        } else {
+            // Group commit: niepełny sektor trafia na kartę po upływie okna trwałości
+            sensor_sdcard_poll();
+        }
+
+        // Wysyłka MQTT zza kursora outboxa (PUBACK i zmiany połączenia budzą zadanie)
+        outbox_pump();
+        xSemaphoreGive(card_mutex);
+    }
+}
+
+/********************
+ * API
+ ********************/
+esp_err_t storage_start(const char *dir, storage_overflow_t policy) {
+    if (!dir || strlen(dir) >= sizeof(log_dir)) return ESP_ERR_INVALID_ARG;
+    if (storage_task_handle) return ESP_ERR_INVALID_STATE;
+
+    strncpy(log_dir, dir, sizeof(log_dir) - 1);
+    overflow_policy = policy;
+
+    if (!card_mutex) card_mutex = xSemaphoreCreateMutex();
+    if (!card_mutex) return ESP_ERR_NO_MEM;
+
+    if (xTaskCreate(storage_task, "storage_task", STORAGE_TASK_STACK, NULL,
+                    STORAGE_TASK_PRIO, &storage_task_handle) != pdPASS) {
+        storage_task_handle = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    ESP_LOGI(TAG, "Storage task started (%s, bank %d records, overflow: %s)", log_dir,
+             STORAGE_BANK_RECORDS, policy == STORAGE_DROP_OLDEST ? "drop oldest" : "drop newest");
+    return ESP_OK;
+}
+
+esp_err_t storage_submit(logrec_t *rec) {
+    if (!rec) return ESP_ERR_INVALID_ARG;
+    if (!storage_task_handle) return ESP_ERR_INVALID_STATE;
+
+    int64_t t0 = esp_timer_get_time();
+    esp_err_t ret = ESP_OK;
+    logrec_t *dropped = NULL;
+
+    portENTER_CRITICAL(&bank_mux);
+    storage_bank_t *bank = fill_bank;
+    if (bank->count < STORAGE_BANK_RECORDS) {
+        bank->rec[bank->count++] = rec;
+    } else if (overflow_policy == STORAGE_DROP_OLDEST) {
+        dropped = bank->rec[0];
+        memmove(&bank->rec[0], &bank->rec[1], (STORAGE_BANK_RECORDS - 1) * sizeof(bank->rec[0]));
+        bank->rec[STORAGE_BANK_RECORDS - 1] = rec;
+        stats.dropped++;
+    } else {
+        stats.dropped++;
+        ret = ESP_ERR_NO_MEM;
+    }
+    if (ret == ESP_OK) stats.submitted++;
+    if (bank->count > stats.max_pending) stats.max_pending = bank->count;
+
+    int64_t dt = esp_timer_get_time() - t0;
+    stats.last_submit_us = dt;
+    if (dt > stats.max_submit_us) stats.max_submit_us = dt;
+    portEXIT_CRITICAL(&bank_mux);
+
+    recbuf_unref(dropped);
+    xTaskNotifyGive(storage_task_handle);
+    return ret;
+}
+
+void storage_set_retention(const logstore_retention_t *policy) {
+    if (!policy) return;
+    retention = *policy;
+    retention_set = true;
+    retention_day = UINT32_MAX;
+}
+
+void storage_request_sync(void) {
+    sync_requested = true;
+    if (storage_task_handle) xTaskNotifyGive(storage_task_handle);
+}
+
+void storage_wake(void) {
+    if (storage_task_handle) xTaskNotifyGive(storage_task_handle);
+}
+
+esp_err_t storage_read_range(uint32_t t0, uint32_t t1, logstore_record_cb_t cb, void *ctx,
+                             logstore_range_stats_t *range_stats) {
+    if (!cb) return ESP_ERR_INVALID_ARG;
+    if (!storage_task_handle) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(card_mutex, portMAX_DELAY);
+    // Odczyt widzi wszystko, co przyjęto: bank i bufor sektora idą najpierw na kartę
+    drain_bank();
+    sensor_sdcard_sync();
+    esp_err_t ret = sensor_binlog_read_range(log_dir, t0, t1, cb, ctx, range_stats);
+    xSemaphoreGive(card_mutex);
+    return ret;
+}
+
+esp_err_t storage_purge(logstore_keep_cb_t keep, void *ctx, uint32_t last_day,
+                        logstore_purge_stats_t *purge_stats) {
+    if (!keep) return ESP_ERR_INVALID_ARG;
+    if (!storage_task_handle) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(card_mutex, portMAX_DELAY);
+    drain_bank();
+    logstore_purge_stats_t st;
+    esp_err_t ret = sensor_binlog_purge(log_dir, keep, ctx, last_day, &st);
+    // Przepisane doby mają nowe offsety - outbox nie może iść starymi pozycjami
+    if (ret == ESP_OK && st.first_day != UINT32_MAX) outbox_realign(st.first_day);
+    xSemaphoreGive(card_mutex);
+    if (purge_stats) *purge_stats = st;
+    return ret;
+}
+
+void storage_get_stats(storage_stats_t *out) {
+    if (!out) return;
+    portENTER_CRITICAL(&bank_mux);
+    *out = stats;
+    portEXIT_CRITICAL(&bank_mux);
+}
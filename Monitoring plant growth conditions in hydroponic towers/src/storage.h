@@ -0,0 +1,103 @@
+#ifndef STORAGE_H
+#define STORAGE_H
+
+#include "esp_err.h"
+#include "logrec.h"
+#include "logstore.h"
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Zadanie zapisu na kartę SD z podwójnym buforem.
+ *
+ * Akwizycja (scheduler_task) tylko wstawia wskaźnik rekordu z puli (recbuf.h)
+ * do aktywnego banku (storage_submit, sekcja krytyczna rzędu mikrosekund).
+ * Osobne zadanie "storage_task" zamienia banki i zapisuje pełny bank na kartę,
+ * więc wolna karta (timeout FATFS 10 s) nie zatrzymuje pętli pomiarowej.
+ */
+
+#define STORAGE_BANK_RECORDS   8       // Rekordów w jednym banku
+#define STORAGE_TASK_STACK     6144    // Zapis + kompakcja (ścieżki, nagłówki na stosie)
+#define STORAGE_TASK_PRIO      4       // Niżej niż scheduler_task (8)
+#define STORAGE_POLL_MS        1000    // Okres sprawdzania okna trwałości (group commit)
+
+/**
+ * Co zrobić, gdy aktywny bank jest pełny, a zadanie zapisu wciąż pisze drugi.
+ */
+typedef enum {
+    STORAGE_DROP_NEWEST = 0,  // Odrzuć nowy rekord
+    STORAGE_DROP_OLDEST,      // Nadpisz najstarszy rekord w banku
+} storage_overflow_t;
+
+typedef struct {
+    uint32_t submitted;       // Rekordy przyjęte przez storage_submit
+    uint32_t written;         // Rekordy zapisane na kartę
+    uint32_t dropped;         // Rekordy utracone przez przepełnienie
+    uint32_t write_errors;    // Błędy zapisu na kartę
+    uint32_t swaps;           // Zamiany banków
+    uint32_t max_pending;     // Największe zapełnienie aktywnego banku
+    int64_t last_submit_us;   // Czas ostatniego storage_submit
+    int64_t max_submit_us;    // Najdłuższy storage_submit
+    int64_t last_write_us;    // Czas zapisu ostatniego banku na kartę
+    int64_t max_write_us;     // Najdłuższy zapis banku na kartę
+} storage_stats_t;
+
+/**
+ * Uruchamia zadanie zapisu.
+ * @param dir Katalog binarnego logu dziennego (przekazywany do sensor_binlog_append)
+ * @param policy Zachowanie przy przepełnieniu
+ */
+esp_err_t storage_start(const char *dir, storage_overflow_t policy);
+
+/**
+ * Wstawia rekord z puli recbuf do aktywnego banku i budzi zadanie zapisu.
+ * Nigdy nie czeka na kartę. Przy ESP_OK referencja wywołującego przechodzi na
+ * zadanie zapisu (zwalnia ją po zapisie i przekazaniu do outboxa); przy błędzie
+ * zostaje u wywołującego.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE (zadanie nie działa),
+ *         ESP_ERR_NO_MEM (przepełnienie przy STORAGE_DROP_NEWEST)
+ */
+esp_err_t storage_submit(logrec_t *rec);
+
+/**
+ * Ustawia politykę retencji logu. Zadanie zapisu stosuje ją przy pierwszym
+ * zapisie po starcie i po każdej zmianie doby (czas z rekordu).
+ */
+void storage_set_retention(const logstore_retention_t *policy);
+
+/**
+ * Prosi zadanie zapisu o jawny sync (zapis banków i bufora sektora na kartę).
+ * Nie czeka na wykonanie.
+ */
+void storage_request_sync(void);
+
+/**
+ * Budzi zadanie zapisu bez żądania synchronizacji (np. PUBACK dla outboxa).
+ */
+void storage_wake(void);
+
+/**
+ * Odczytuje rekordy z zakresu [t0, t1) w kontekście wywołującego, ale pod
+ * blokadą karty zadania zapisu: najpierw zapisuje oczekujący bank i bufor
+ * sektora (sync), więc widoczne są wszystkie przyjęte rekordy. Na czas odczytu
+ * zapis czeka - rekordy zbiera w tym czasie bank (STORAGE_BANK_RECORDS).
+ * @return ESP_OK, ESP_ERR_INVALID_STATE (zadanie nie działa) lub błąd odczytu
+ */
+esp_err_t storage_read_range(uint32_t t0, uint32_t t1, logstore_record_cb_t cb, void *ctx,
+                             logstore_range_stats_t *stats);
+
+/**
+ * Usuwa z logu rekordy odrzucone przez predykat keep w dobach do last_day
+ * włącznie (sensor_binlog_purge), pod blokadą karty jak storage_read_range.
+ * Przepisuje całe pliki - przy długim logu trwa odpowiednio długo.
+ * @return ESP_OK, ESP_ERR_INVALID_STATE (zadanie nie działa) lub błąd
+ */
+esp_err_t storage_purge(logstore_keep_cb_t keep, void *ctx, uint32_t last_day,
+                        logstore_purge_stats_t *stats);
+
+/**
+ * Kopiuje liczniki i czasy zadania zapisu.
+ */
+void storage_get_stats(storage_stats_t *stats);
+
+#endif // STORAGE_H
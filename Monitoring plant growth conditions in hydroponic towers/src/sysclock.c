@@ -0,0 +1,114 @@
+#include "sysclock.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <sys/time.h>
+#include <time.h>
+
+static const char *TAG = "SYSCLOCK";
+
+static esp_timer_handle_t discipline_timer = NULL;
+static sysclock_stats_t stats = {0};
+
+// Odczyt burst RTC -> sekundy Unix
+static uint32_t rtc_read_unix(void)
+{
+    ds1302_time_t t;
+    ds1302_get_time(&t);
+    return ds1302_time_to_unix(&t);
+}
+
+// Porównanie z RTC (rozdzielczość 1 s: odchyłka 0 / ±1 s to szum odczytu)
+static void discipline(bool slew)
+{
+    struct timeval now;
+    uint32_t rtc = rtc_read_unix();
+    gettimeofday(&now, NULL);
+
+    int32_t offset = (int32_t)(rtc - (uint32_t)now.tv_sec);
+    stats.disciplines++;
+    stats.last_offset_sec = offset;
+    if (offset >= -1 && offset <= 1) {
+        return;
+    }
+
+    if (slew && offset >= -SYSCLOCK_SLEW_MAX_SEC && offset <= SYSCLOCK_SLEW_MAX_SEC) {
+        struct timeval delta = { .tv_sec = offset, .tv_usec = 0 };
+        adjtime(&delta, NULL);
+        stats.slews++;
+        ESP_LOGI(TAG, "System clock off by %ld s from RTC - slewing", (long)offset);
+    } else {
+        struct timeval tv = { .tv_sec = rtc, .tv_usec = 0 };
+        settimeofday(&tv, NULL);
+        stats.steps++;
+        ESP_LOGW(TAG, "System clock off by %ld s from RTC - stepped", (long)offset);
+    }
+}
+
+static void discipline_cb(void *arg)
+{
+    discipline(true);
+}
+
+esp_err_t sysclock_init(void)
+{
+    struct timeval tv = { .tv_sec = rtc_read_unix(), .tv_usec = 0 };
+    if (settimeofday(&tv, NULL) != 0) {
+        return ESP_FAIL;
+    }
+
+    if (!discipline_timer) {
+        esp_timer_create_args_t args = {
+            .callback = discipline_cb,
+            .name = "sysclock",
+        };
+        esp_err_t err = esp_timer_create(&args, &discipline_timer);
+        if (err == ESP_OK) {
+            err = esp_timer_start_periodic(discipline_timer, (uint64_t)SYSCLOCK_DISCIPLINE_SEC * 1000000);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGW(TAG, "RTC discipline timer: %s", esp_err_to_name(err));
+            return err;
+        }
+    }
+    ESP_LOGI(TAG, "System clock set from RTC: %lu, RTC re-read every %d s",
+             (unsigned long)tv.tv_sec, SYSCLOCK_DISCIPLINE_SEC);
+    return ESP_OK;
+}
+
+esp_err_t sysclock_resume(void)
+{
+    // Krótkie wybudzenie: adjtime nie zdąży skorygować, więc tylko skok
+    discipline(false);
+    return ESP_OK;
+}
+
+int64_t sysclock_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+uint32_t sysclock_now_unix(void)
+{
+    return (uint32_t)time(NULL);
+}
+
+void sysclock_get_time(ds1302_time_t *t)
+{
+    time_t now = time(NULL);
+    struct tm tm;
+    gmtime_r(&now, &tm);
+    t->sec = tm.tm_sec;
+    t->min = tm.tm_min;
+    t->hour = tm.tm_hour;
+    t->day = tm.tm_mday;
+    t->month = tm.tm_mon + 1;
+    t->year = tm.tm_year + 1900;
+    t->dow = tm.tm_wday == 0 ? 7 : tm.tm_wday;
+}
+
+void sysclock_get_stats(sysclock_stats_t *out)
+{
+    *out = stats;
+}
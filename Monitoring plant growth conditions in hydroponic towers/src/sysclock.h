@@ -0,0 +1,50 @@
+#ifndef SYSCLOCK_H
+#define SYSCLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "ds1302.h"
+
+/*
+ * Czas systemowy (newlib, licznik sprzętowy) jako pamięć podręczna zegara
+ * DS1302. sysclock_init() czyta RTC jednym odczytem burst i ustawia zegar
+ * systemowy (settimeofday); później RTC jest czytany tylko co
+ * SYSCLOCK_DISCIPLINE_SEC (esp_timer), a odchyłka ponad 1 s jest korygowana
+ * płynnie (adjtime) lub skokiem, gdy przekracza SYSCLOCK_SLEW_MAX_SEC.
+ *
+ * Pozostałe moduły biorą czas stąd: odczyt z pamięci zamiast ~0.5 ms
+ * bit-bangingu DS1302. Pola ds1302_time_t traktujemy jak UTC (bez strefy),
+ * tak jak ds1302_time_to_unix().
+ */
+
+#define SYSCLOCK_DISCIPLINE_SEC  3600  // Odczyt RTC raz na godzinę
+#define SYSCLOCK_SLEW_MAX_SEC    60    // Większa odchyłka = skok zegara
+
+typedef struct {
+    uint32_t disciplines;       // Odczyty RTC po starcie
+    uint32_t slews;             // Korekty płynne (adjtime)
+    uint32_t steps;             // Korekty skokowe (settimeofday)
+    int32_t last_offset_sec;    // RTC - czas systemowy przy ostatnim odczycie
+} sysclock_stats_t;
+
+// Ustawia zegar systemowy z DS1302 (po ds1302_init) i uruchamia korekty
+esp_err_t sysclock_init(void);
+
+// Po wybudzeniu z deep sleep: czas systemowy biegł na timerze RTC (oscylator
+// RC, dryf rzędu %), więc jedno porównanie z DS1302 i skok przy odchyłce > 1 s
+esp_err_t sysclock_resume(void);
+
+// Czas Unix w nanosekundach (CLOCK_REALTIME)
+int64_t sysclock_now_ns(void);
+
+// Czas Unix w sekundach
+uint32_t sysclock_now_unix(void);
+
+// Czas w polach ds1302_time_t (dow: 1 = poniedziałek)
+void sysclock_get_time(ds1302_time_t *t);
+
+// Liczniki korekt (STATUS)
+void sysclock_get_stats(sysclock_stats_t *out);
+
+#endif // SYSCLOCK_H
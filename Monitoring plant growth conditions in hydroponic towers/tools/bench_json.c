@@ -0,0 +1,286 @@
+/*
+ * Mikrobenchmark formatowania rekordu NDJSON na PC: snprintf vs jsonw.
+ *
+ * Porównuje:
+ *   - snprintf : poprzednia wersja logrec_format_ndjson (snprintf z %.*f
+ *                i %lld, gmtime_r) - skopiowana tutaj jako punkt odniesienia
+ *   - jsonw    : bieżąca logrec_format_ndjson (src/jsonw.c, arytmetyka
+ *                całkowita, bez printf i sterty)
+ * Dla obu liczy czas i cykle TSC na rekord (x86) oraz maksymalne użycie stosu:
+ * formatowanie jest uruchamiane na osobnym, wypełnionym wzorcem stosie
+ * (ucontext) i liczone są bajty, które zostały nadpisane.
+ * Przed pomiarem sprawdza, że oba warianty dają identyczny tekst.
+ *
+ * Ten sam pomiar na ESP32 (także w QEMU: idf.py qemu monitor) wykonuje
+ * komenda UART BENCH:JSON (src/payload_bench.c).
+ *
+ * Kompilacja (z katalogu tools/):
+ *   gcc -O2 -Ihost -I../src -o bench_json bench_json.c ../src/logrec.c ../src/cborenc.c ../src/jsonw.c
+ *
+ * Użycie:
+ *   ./bench_json [-n ITERATIONS]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <ucontext.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define HAVE_TSC 1
+#endif
+
+#include "logrec.h"
+
+#define RECORDS      64
+#define STACK_SIZE   (64 * 1024)
+#define STACK_FILL   0xA5
+
+/********************
+ * Poprzednia implementacja (snprintf)
+ ********************/
+static bool ref_element(const uint8_t *r, const logrec_field_t *fd, int e, int64_t *raw, bool *na)
+{
+    switch (fd->type) {
+        case LOGREC_TYPE_U8:  { uint8_t v;  memcpy(&v, r + fd->offset + e, 1); *raw = v; *na = false; return true; }
+        case LOGREC_TYPE_I16: { int16_t v;  memcpy(&v, r + fd->offset + 2 * e, 2); *raw = v; *na = v == LOGREC_NA_I16; return true; }
+        case LOGREC_TYPE_U16: { uint16_t v; memcpy(&v, r + fd->offset + 2 * e, 2); *raw = v; *na = v == LOGREC_NA_U16; return true; }
+        case LOGREC_TYPE_U32: { uint32_t v; memcpy(&v, r + fd->offset + 4 * e, 4); *raw = v; *na = v == LOGREC_NA_U32; return true; }
+        default: return false;
+    }
+}
+
+static bool ref_field(const logrec_header_t *hdr, const uint8_t *r, const logrec_field_t *fd,
+                      int64_t *raw, bool *na)
+{
+    (void)hdr;
+    return ref_element(r, fd, 0, raw, na);
+}
+
+#define APPEND(...) do { \
+        int n_ = snprintf(buf + pos, len - pos, __VA_ARGS__); \
+        if (n_ < 0 || (size_t)n_ >= len - pos) return -1; \
+        pos += (size_t)n_; \
+    } while (0)
+
+static int ref_value(char *buf, size_t len, int64_t raw, bool na, int scale)
+{
+    if (na) return snprintf(buf, len, "null");
+    if (scale >= 0) {
+        int64_t v = raw;
+        for (int s = 0; s < scale; s++) v *= 10;
+        return snprintf(buf, len, "%lld", (long long)v);
+    }
+    double div = 1.0;
+    for (int s = 0; s < -scale; s++) div *= 10.0;
+    return snprintf(buf, len, "%.*f", -scale, (double)raw / div);
+}
+
+static bool ref_get(const logrec_header_t *hdr, const uint8_t *r, const char *name, int64_t *raw, bool *na)
+{
+    for (int i = 0; i < hdr->field_count; i++) {
+        if (strncmp(hdr->fields[i].name, name, LOGREC_NAME_LEN) == 0) {
+            return ref_field(hdr, r, &hdr->fields[i], raw, na);
+        }
+    }
+    return false;
+}
+
+static int ref_format_ndjson(const logrec_header_t *hdr, const void *rec, char *buf, size_t len)
+{
+    const uint8_t *r = rec;
+    size_t pos = 0;
+    int64_t raw;
+    bool na;
+
+    APPEND("{");
+    if (ref_get(hdr, r, "timestamp", &raw, &na)) {
+        time_t t = (time_t)raw;
+        struct tm tm;
+        gmtime_r(&t, &tm);
+        APPEND("\"timestamp\": \"%04d-%02d-%02d %02d:%02d:%02d\"",
+               tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec);
+    }
+    for (int i = 0; i < hdr->field_count; i++) {
+        const logrec_field_t *fd = &hdr->fields[i];
+        char name[LOGREC_NAME_LEN + 1];
+        memcpy(name, fd->name, LOGREC_NAME_LEN);
+        name[LOGREC_NAME_LEN] = '\0';
+        if (strcmp(name, "timestamp") == 0 || strcmp(name, "flags") == 0 ||
+            strncmp(name, "relay", 5) == 0) {
+            continue;
+        }
+        if (!ref_field(hdr, r, fd, &raw, &na)) continue;
+        char value[32];
+        if (fd->count > 1) {
+            // Tablica bez końcowych braków odczytu
+            int used = fd->count;
+            while (used > 0 && ref_element(r, fd, used - 1, &raw, &na) && na) used--;
+            APPEND(", \"%s\": [", name);
+            for (int e = 0; e < used; e++) {
+                ref_element(r, fd, e, &raw, &na);
+                ref_value(value, sizeof(value), raw, na, fd->scale);
+                APPEND("%s%s", e ? ", " : "", value);
+            }
+            APPEND("]");
+        } else {
+            ref_value(value, sizeof(value), raw, na, fd->scale);
+            APPEND(", \"%s\": %s", name, value);
+        }
+    }
+    if (ref_get(hdr, r, "flags", &raw, &na)) {
+        uint8_t flags = (uint8_t)raw;
+        if (flags & LOGREC_FLAG_LEVEL_VALID) {
+            APPEND(", \"level\": %d", (flags & LOGREC_FLAG_LEVEL) ? 1 : 0);
+        }
+        if (flags & LOGREC_FLAG_PH_FRESH_VALID) {
+            APPEND(", \"ph_fresh\": %s", (flags & LOGREC_FLAG_PH_FRESH) ? "true" : "false");
+        }
+        int64_t on_ms = 0, off_ms = 0;
+        bool na_on, na_off;
+        ref_get(hdr, r, "relay1_on_ms", &on_ms, &na_on);
+        ref_get(hdr, r, "relay1_off_ms", &off_ms, &na_off);
+        APPEND(", \"relay_1\": {\"active\": %s", (flags & LOGREC_FLAG_RELAY1) ? "true" : "false");
+        if ((flags & LOGREC_FLAG_RELAY1_CYCLE) && on_ms > 0 && off_ms > 0) {
+            APPEND(", \"%lld\": %lld", (long long)on_ms, (long long)off_ms);
+        }
+        APPEND("}, \"relay_2\": {\"active\": %s}", (flags & LOGREC_FLAG_RELAY2) ? "true" : "false");
+    }
+    APPEND("}");
+    return (int)pos;
+}
+
+/********************
+ * Pomiar
+ ********************/
+typedef int (*format_fn_t)(const logrec_header_t *hdr, const void *rec, char *buf, size_t len);
+
+static logrec_header_t hdr;
+static logrec_t recs[RECORDS];
+static char out[512];
+static format_fn_t stack_fn;
+static ucontext_t main_ctx, bench_ctx;
+static uint8_t bench_stack[STACK_SIZE];
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void make_records(void)
+{
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        logrec_t *r = &recs[i];
+        memset(r, 0, sizeof(*r));
+        r->seq = 1000 + i;
+        r->timestamp = 1760486400u + i * 600;
+        r->temp_ds18 = logrec_pack_i16(19.5f + i * 0.07f, 100.0f);
+        for (int p = 0; p < LOGREC_PROBES; p++) {
+            r->temp_probe[p] = p < (int)(i % 4) ? logrec_pack_i16(18.0f + p - i * 0.05f, 100.0f) : LOGREC_NA_I16;
+        }
+        if (i % 8 == 3) r->temp_probe[1] = LOGREC_NA_I16;
+        r->temp_dht = i % 16 == 0 ? LOGREC_NA_I16 : logrec_pack_i16(-2.0f + i * 0.5f, 100.0f);
+        r->humidity = logrec_pack_u16(55.0f + i * 0.3f, 100.0f);
+        r->ph = logrec_pack_u16(5.5f + (i % 10) * 0.05f, 100.0f);
+        r->light = logrec_pack_u32(i * 37.25f, 100.0f);
+        r->flags = (uint8_t)(i & 0xFF);
+        r->relay1_on_ms = 900000;
+        r->relay1_off_ms = 1500000;
+        logrec_seal(r);
+    }
+}
+
+static void stack_entry(void)
+{
+    for (uint32_t i = 0; i < RECORDS; i++) stack_fn(&hdr, &recs[i], out, sizeof(out));
+}
+
+// Maksymalne użycie stosu przez fn (bajty nadpisane na wypełnionym stosie)
+static size_t measure_stack(format_fn_t fn)
+{
+    memset(bench_stack, STACK_FILL, sizeof(bench_stack));
+    stack_fn = fn;
+    getcontext(&bench_ctx);
+    bench_ctx.uc_stack.ss_sp = bench_stack;
+    bench_ctx.uc_stack.ss_size = sizeof(bench_stack);
+    bench_ctx.uc_link = &main_ctx;
+    makecontext(&bench_ctx, stack_entry, 0);
+    swapcontext(&main_ctx, &bench_ctx);
+
+    size_t untouched = 0;
+    while (untouched < sizeof(bench_stack) && bench_stack[untouched] == STACK_FILL) untouched++;
+    return sizeof(bench_stack) - untouched;
+}
+
+static void run(const char *name, format_fn_t fn, uint32_t iterations, size_t baseline_stack)
+{
+    volatile int sink = 0;
+    uint64_t bytes = 0;
+    double t0 = now_ns();
+#ifdef HAVE_TSC
+    uint64_t c0 = __rdtsc();
+#endif
+    for (uint32_t i = 0; i < iterations; i++) {
+        int n = fn(&hdr, &recs[i % RECORDS], out, sizeof(out));
+        bytes += n;
+        sink += out[0];
+    }
+#ifdef HAVE_TSC
+    double cycles = (double)(__rdtsc() - c0) / iterations;
+#else
+    double cycles = 0;
+#endif
+    double ns = (now_ns() - t0) / iterations;
+    (void)sink;
+
+    printf("  %-10s %10.1f %12.0f %10.1f %12zu\n", name, ns, cycles, (double)bytes / iterations,
+           measure_stack(fn) - baseline_stack);
+}
+
+static int format_nothing(const logrec_header_t *h, const void *rec, char *buf, size_t len)
+{
+    (void)h; (void)rec; (void)len;
+    buf[0] = '{';
+    return 1;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 200000;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        switch (opt) {
+            case 'n': iterations = strtoul(optarg, NULL, 10); break;
+            default:
+                fprintf(stderr, "usage: %s [-n ITERATIONS]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (iterations == 0) return 1;
+
+    logrec_header_init(&hdr, 0);
+    make_records();
+
+    char a[512], b[512];
+    for (uint32_t i = 0; i < RECORDS; i++) {
+        int na = ref_format_ndjson(&hdr, &recs[i], a, sizeof(a));
+        int nb = logrec_format_ndjson(&hdr, &recs[i], b, sizeof(b));
+        if (na != nb || strcmp(a, b) != 0) {
+            fprintf(stderr, "output mismatch for record %u:\n  %s\n  %s\n", i, a, b);
+            return 1;
+        }
+    }
+
+    // Stos samego wywołania (ramka stack_entry) odejmowany od wyników
+    size_t baseline = measure_stack(format_nothing);
+
+    printf("bench_json: %u records per case, output identical\n\n", iterations);
+    printf("  %-10s %10s %12s %10s %12s\n", "writer", "ns/rec", "cycles/rec", "bytes/rec", "stack [B]");
+    run("snprintf", ref_format_ndjson, iterations, baseline);
+    run("jsonw", logrec_format_ndjson, iterations, baseline);
+    return 0;
+}
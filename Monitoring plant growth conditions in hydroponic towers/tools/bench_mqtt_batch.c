@@ -0,0 +1,201 @@
+/*
+ * Benchmark paczkowania publikacji MQTT (src/outbox.c) na PC.
+ *
+ * Dla paczek 1, 8 i 64 rekordów (lub podanych -b) buduje payloady tym samym
+ * kodem co firmware (logrec_format_ndjson / logrec_format_batch) i liczy:
+ *   - bajty payloadu i bajty "w eterze" na rekord: PUBLISH QoS 1 + PUBACK,
+ *     segmenty TCP/IPv4 (MSS lwIP 1440), ramki 802.11 z WPA2 (CCMP) i ACK TCP,
+ *   - liczbę ramek radiowych na rekord,
+ *   - czas pracy radia na rekord: czas nadawania/odbioru ramek (preambuła,
+ *     SIFS + ACK 802.11, DIFS, średni backoff) plus oczekiwanie na PUBACK (RTT),
+ *     przez które radio nie może wrócić do uśpienia,
+ *   - czas CPU formatowania payloadu na rekord.
+ *
+ * Model radia jest uproszczony (jedna szybkość PHY, brak retransmisji), więc
+ * wynik służy do porównania wielkości paczek, nie jako pomiar bezwzględny.
+ *
+ * Kompilacja (z katalogu tools/):
+ *   gcc -O2 -Ihost -I../src -o bench_mqtt_batch bench_mqtt_batch.c ../src/logrec.c ../src/cborenc.c ../src/jsonw.c
+ *
+ * Użycie:
+ *   ./bench_mqtt_batch [-n RECORDS] [-b N,N,...] [-p PHY_MBPS] [-t RTT_MS]
+ *     -n  liczba rekordów (domyślnie 4096)
+ *     -b  wielkości paczek (domyślnie 1,8,64; najwyżej 64 jak OUTBOX_BATCH_MAX)
+ *     -p  szybkość PHY w Mb/s (domyślnie 24)
+ *     -t  czas od wysłania PUBLISH do PUBACK w ms (domyślnie 10)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logrec.h"
+
+#define MAX_BATCH       64
+#define MAX_SIZES       8
+#define PAYLOAD_MAX     (MAX_BATCH * 320 + 64)
+#define TOPIC           "das_tower/measurements"
+
+// Narzuty protokołów [B]
+#define TCP_MSS         1440    // CONFIG_LWIP_TCP_MSS
+#define IP_TCP_HDR      40      // IPv4 + TCP bez opcji
+#define WIFI_DATA_HDR   54      // MAC QoS 26 + LLC/SNAP 8 + CCMP 16 + FCS 4
+#define MQTT_PUBACK     4
+
+// Czasy 802.11 (OFDM, 2.4 GHz) [us]
+#define PHY_PREAMBLE_US 20
+#define SIFS_US         10
+#define DIFS_US         28
+#define BACKOFF_US      67.5    // CWmin 15 * 9 us / 2
+#define WIFI_ACK_US     28      // Ramka ACK 802.11 z preambułą
+
+typedef struct {
+    uint32_t batch;
+    uint64_t messages;
+    uint64_t payload_bytes;
+    uint64_t wire_bytes;
+    uint64_t frames;
+    double airtime_us;
+    double radio_on_us;
+    double format_us;
+} batch_result_t;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Rekordy jak z firmware: pomiar co 10 min, wartości z typowych zakresów
+static void make_record(logrec_t *rec, uint32_t i)
+{
+    memset(rec, 0, sizeof(*rec));
+    rec->timestamp = 1760486400u + i * 600;
+    rec->seq = i + 1;
+    rec->temp_ds18 = logrec_pack_i16(20.0f + (i % 50) * 0.03f, 100.0f);
+    for (int p = 0; p < LOGREC_PROBES; p++) rec->temp_probe[p] = p == 0 ? rec->temp_ds18 : LOGREC_NA_I16;
+    rec->temp_dht = logrec_pack_i16(21.5f + (i % 40) * 0.05f, 100.0f);
+    rec->humidity = logrec_pack_u16(60.0f + (i % 30) * 0.2f, 100.0f);
+    rec->ph = logrec_pack_u16(5.8f + (i % 10) * 0.01f, 100.0f);
+    rec->light = logrec_pack_u32((i % 144) < 72 ? 450.0f + i % 100 : 0.0f, 100.0f);
+    rec->flags = (i % 6 == 0) ? LOGREC_FLAG_RELAY1 : 0;
+    logrec_seal(rec);
+}
+
+static uint32_t mqtt_publish_size(uint32_t payload)
+{
+    uint32_t remaining = 2 + (uint32_t)strlen(TOPIC) + 2 + payload;  // topic + packet id
+    uint32_t len_bytes = remaining < 128 ? 1 : remaining < 16384 ? 2 : 3;
+    return 1 + len_bytes + remaining;
+}
+
+// Jedna ramka danych 802.11 niosąca segment TCP z bytes bajtami danych
+static double frame_airtime_us(uint32_t bytes, double phy_mbps)
+{
+    uint32_t frame = WIFI_DATA_HDR + IP_TCP_HDR + bytes;
+    return DIFS_US + BACKOFF_US + PHY_PREAMBLE_US + frame * 8 / phy_mbps + SIFS_US + WIFI_ACK_US;
+}
+
+static void account_message(batch_result_t *r, uint32_t payload, double phy_mbps, double rtt_us)
+{
+    uint32_t mqtt = mqtt_publish_size(payload);
+    uint32_t segments = (mqtt + TCP_MSS - 1) / TCP_MSS;
+    double air = 0;
+
+    // PUBLISH: segmenty TCP nadawane przez ESP32
+    for (uint32_t s = 0; s < segments; s++) {
+        uint32_t bytes = (s + 1 < segments) ? TCP_MSS : mqtt - s * TCP_MSS;
+        air += frame_airtime_us(bytes, phy_mbps);
+    }
+    // Odbiór: PUBACK (niesie ACK TCP ostatniego segmentu) + ACK TCP co 2 pełne segmenty
+    uint32_t rx_acks = (segments - 1) / 2;
+    air += frame_airtime_us(MQTT_PUBACK, phy_mbps) + rx_acks * frame_airtime_us(0, phy_mbps);
+    // Nadanie ACK TCP dla PUBACK
+    air += frame_airtime_us(0, phy_mbps);
+
+    uint32_t frames = segments + 1 + rx_acks + 1;
+    r->messages++;
+    r->payload_bytes += payload;
+    r->wire_bytes += mqtt + MQTT_PUBACK + (uint64_t)frames * (WIFI_DATA_HDR + IP_TCP_HDR);
+    r->frames += frames;
+    r->airtime_us += air;
+    r->radio_on_us += air + rtt_us;
+}
+
+static int run_batch(uint32_t batch, uint32_t n, double phy_mbps, double rtt_us,
+                     const logrec_header_t *hdr, batch_result_t *r)
+{
+    static logrec_t recs[MAX_BATCH];
+    static char payload[PAYLOAD_MAX];
+
+    memset(r, 0, sizeof(*r));
+    r->batch = batch;
+
+    for (uint32_t i = 0; i < n; i += batch) {
+        uint32_t count = (n - i < batch) ? n - i : batch;
+        for (uint32_t k = 0; k < count; k++) make_record(&recs[k], i + k);
+
+        double t0 = now_us();
+        int len = batch > 1 ? logrec_format_batch(hdr, recs, count, payload, sizeof(payload))
+                            : logrec_format_ndjson(hdr, &recs[0], payload, sizeof(payload));
+        r->format_us += now_us() - t0;
+        if (len < 0) {
+            fprintf(stderr, "payload buffer too small for batch %u\n", batch);
+            return 1;
+        }
+        account_message(r, (uint32_t)len, phy_mbps, rtt_us);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = 4096;
+    uint32_t sizes[MAX_SIZES] = {1, 8, 64};
+    uint32_t size_count = 3;
+    double phy_mbps = 24.0, rtt_ms = 10.0;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:b:p:t:")) != -1) {
+        switch (opt) {
+            case 'n': n = strtoul(optarg, NULL, 10); break;
+            case 'p': phy_mbps = atof(optarg); break;
+            case 't': rtt_ms = atof(optarg); break;
+            case 'b': {
+                size_count = 0;
+                for (char *tok = strtok(optarg, ","); tok && size_count < MAX_SIZES; tok = strtok(NULL, ",")) {
+                    sizes[size_count++] = strtoul(tok, NULL, 10);
+                }
+                break;
+            }
+            default:
+                fprintf(stderr, "usage: %s [-n RECORDS] [-b N,N,...] [-p PHY_MBPS] [-t RTT_MS]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (n == 0 || phy_mbps <= 0) return 1;
+
+    logrec_header_t hdr;
+    logrec_header_init(&hdr, 0);
+
+    printf("bench_mqtt_batch: %u records, PHY %.1f Mb/s, PUBACK RTT %.1f ms\n\n", n, phy_mbps, rtt_ms);
+    printf("  %6s %9s %13s %13s %11s %14s %15s %13s\n", "batch", "messages", "payload B/rec",
+           "wire B/rec", "frames/rec", "airtime us/rec", "radio-on us/rec", "format us/rec");
+
+    for (uint32_t s = 0; s < size_count; s++) {
+        if (sizes[s] < 1 || sizes[s] > MAX_BATCH) {
+            fprintf(stderr, "batch size must be 1..%d\n", MAX_BATCH);
+            return 1;
+        }
+        batch_result_t r;
+        if (run_batch(sizes[s], n, phy_mbps, rtt_ms * 1000.0, &hdr, &r) != 0) return 1;
+        printf("  %6u %9llu %13.1f %13.1f %11.3f %14.1f %15.1f %13.2f\n", r.batch,
+               (unsigned long long)r.messages, (double)r.payload_bytes / n,
+               (double)r.wire_bytes / n, (double)r.frames / n, r.airtime_us / n,
+               r.radio_on_us / n, r.format_us / n);
+    }
+    return 0;
+}
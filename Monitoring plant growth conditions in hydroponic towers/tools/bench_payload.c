@@ -0,0 +1,183 @@
+/*
+ * Benchmark kodowania payloadu MQTT na PC: JSON vs CBOR.
+ *
+ * Porównuje czas kodowania i rozmiar payloadu jednego pomiaru:
+ *   - legacy : snprintf z %.2f jak dawne publish_to_mqtt() (src/main.c)
+ *   - ndjson : logrec_format_ndjson (outbox, FORMAT:JSON)
+ *   - cbor   : logrec_format_cbor (outbox, FORMAT:CBOR, temat .../cbor)
+ * oraz paczki 8 i 64 rekordów (logrec_format_batch / logrec_format_cbor).
+ *
+ * Na ESP32 printf liczb zmiennoprzecinkowych jest programowy, więc różnica
+ * w firmware jest większa niż na PC; wynik pokazuje proporcje.
+ *
+ * -w zapisuje payload CBOR paczki 8 rekordów do pliku, do sprawdzenia dekodera:
+ *   ./bench_payload -w /tmp/batch.cbor
+ *   python "../../Broker + Python app/das_tower_cbor.py" < /tmp/batch.cbor
+ *
+ * Kompilacja (z katalogu tools/):
+ *   gcc -O2 -Ihost -I../src -o bench_payload bench_payload.c ../src/logrec.c ../src/cborenc.c ../src/jsonw.c
+ *
+ * Użycie:
+ *   ./bench_payload [-n ITERATIONS] [-w FILE]
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "logrec.h"
+
+#define BATCH_MAX    64
+#define PAYLOAD_MAX  (BATCH_MAX * 320 + 64)
+
+typedef struct {
+    float temperature_ds18;
+    float temperature_dht;
+    float humidity;
+    float light;
+    float ph;
+    char rtc_string[20];
+} measurement_t;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+static void make_measurement(measurement_t *m, logrec_t *rec, uint32_t i)
+{
+    m->temperature_ds18 = 20.0f + (i % 50) * 0.03f;
+    m->temperature_dht = 21.5f + (i % 40) * 0.05f;
+    m->humidity = 60.0f + (i % 30) * 0.2f;
+    m->light = 450.0f + i % 100;
+    m->ph = 5.8f + (i % 10) * 0.01f;
+    snprintf(m->rtc_string, sizeof(m->rtc_string), "2026-10-15 %02u:%02u:00", (i / 60) % 24, i % 60);
+
+    memset(rec, 0, sizeof(*rec));
+    rec->seq = i + 1;
+    rec->timestamp = 1760486400u + i * 600;
+    rec->temp_ds18 = logrec_pack_i16(m->temperature_ds18, 100.0f);
+    for (int p = 0; p < LOGREC_PROBES; p++) rec->temp_probe[p] = p == 0 ? rec->temp_ds18 : LOGREC_NA_I16;
+    rec->temp_dht = logrec_pack_i16(m->temperature_dht, 100.0f);
+    rec->humidity = logrec_pack_u16(m->humidity, 100.0f);
+    rec->ph = logrec_pack_u16(m->ph, 100.0f);
+    rec->light = logrec_pack_u32(m->light, 100.0f);
+    rec->flags = (i % 6 == 0) ? LOGREC_FLAG_RELAY1 : 0;
+    logrec_seal(rec);
+}
+
+// Wzorzec dawnego publish_to_mqtt()
+static int format_legacy(const measurement_t *m, char *buf, size_t len)
+{
+    return snprintf(buf, len,
+        "{\"timestamp\":\"%s\",\"temp_ds18\":%.2f,\"temp_dht\":%.2f,\"humidity\":%.2f,\"light\":%.2f,\"ph\":%.2f,"
+        "\"relay1\":%s,\"relay1_mode\":\"%s\",\"relay1_on_ms\":%lu,\"relay1_off_ms\":%lu,"
+        "\"relay2\":%s,\"relay2_mode\":\"%s\"}",
+        m->rtc_string, m->temperature_ds18, m->temperature_dht, m->humidity, m->light, m->ph,
+        "false", "manual", 0UL, 0UL, "false", "manual");
+}
+
+typedef struct {
+    const char *name;
+    uint32_t batch;
+    double us;
+    uint64_t bytes;
+    uint64_t records;
+} result_t;
+
+static void print_result(const result_t *r)
+{
+    printf("  %-8s %6u %14.3f %14.1f\n", r->name, r->batch, r->us / r->records,
+           (double)r->bytes / r->records);
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t iterations = 20000;
+    const char *dump_path = NULL;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:w:")) != -1) {
+        switch (opt) {
+            case 'n': iterations = strtoul(optarg, NULL, 10); break;
+            case 'w': dump_path = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n ITERATIONS] [-w FILE]\n", argv[0]);
+                return 1;
+        }
+    }
+    if (iterations < BATCH_MAX) iterations = BATCH_MAX;
+
+    static measurement_t meas[BATCH_MAX];
+    static logrec_t recs[BATCH_MAX];
+    static char buf[PAYLOAD_MAX];
+    logrec_header_t hdr;
+    logrec_header_init(&hdr, 0);
+    for (uint32_t i = 0; i < BATCH_MAX; i++) make_measurement(&meas[i], &recs[i], i);
+
+    printf("bench_payload: %u records per case\n\n", iterations);
+    printf("  %-8s %6s %14s %14s\n", "codec", "batch", "encode us/rec", "bytes/rec");
+
+    result_t r;
+    volatile int sink = 0;
+
+    r = (result_t){ .name = "legacy", .batch = 1 };
+    for (uint32_t i = 0; i < iterations; i++) {
+        double t0 = now_us();
+        int len = format_legacy(&meas[i % BATCH_MAX], buf, sizeof(buf));
+        r.us += now_us() - t0;
+        r.bytes += len;
+        r.records++;
+        sink += buf[0];
+    }
+    print_result(&r);
+
+    static const uint32_t batches[] = {1, 8, 64};
+    for (size_t b = 0; b < sizeof(batches) / sizeof(batches[0]); b++) {
+        uint32_t n = batches[b];
+
+        r = (result_t){ .name = "ndjson", .batch = n };
+        for (uint32_t i = 0; i + n <= iterations; i += n) {
+            double t0 = now_us();
+            int len = n == 1 ? logrec_format_ndjson(&hdr, &recs[i % BATCH_MAX], buf, sizeof(buf))
+                             : logrec_format_batch(&hdr, recs, n, buf, sizeof(buf));
+            r.us += now_us() - t0;
+            if (len < 0) return 1;
+            r.bytes += len;
+            r.records += n;
+        }
+        print_result(&r);
+
+        r = (result_t){ .name = "cbor", .batch = n };
+        for (uint32_t i = 0; i + n <= iterations; i += n) {
+            const logrec_t *first = n == 1 ? &recs[i % BATCH_MAX] : recs;
+            double t0 = now_us();
+            int len = logrec_format_cbor(first, n, (uint8_t *)buf, sizeof(buf));
+            r.us += now_us() - t0;
+            if (len < 0) return 1;
+            r.bytes += len;
+            r.records += n;
+        }
+        print_result(&r);
+    }
+    (void)sink;
+
+    if (dump_path) {
+        int len = logrec_format_cbor(recs, 8, (uint8_t *)buf, sizeof(buf));
+        FILE *f = fopen(dump_path, "wb");
+        if (!f || len < 0 || fwrite(buf, 1, len, f) != (size_t)len) {
+            perror(dump_path);
+            return 1;
+        }
+        fclose(f);
+        for (uint32_t i = 0; i < 8; i++) {
+            logrec_format_ndjson(&hdr, &recs[i], buf, sizeof(buf));
+            fprintf(stderr, "%s\n", buf);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+/*
+ * Benchmark zapisu logu pomiarów na PC.
+ *
+ * Porównuje koszt jednego dopisania rekordu:
+ *   - sdlog   : append-only z trwałym uchwytem (src/sdlog.c, ten sam kod co w firmware)
+ *   - legacy  : wzorzec starego sensor_json_append (odczyt całego pliku + zapis całego pliku)
+ *
+ * Wynik to średnia i maksymalna latencja dopisania w dekadach liczby rekordów
+ * (1, 2-10, 11-100, ...). Dla sdlog latencja powinna być płaska aż do 1 000 000.
+ * Dla sdlog wypisywane są też liczniki commitów i write amplification
+ * (bajty dotkniętych sektorów 4 KiB / bajty rekordów).
+ *
+ * Kompilacja (z katalogu tools/):
+ *   gcc -O2 -Ihost -I../src -o bench_sdlog bench_sdlog.c ../src/sdlog.c
+ *
+ * Użycie:
+ *   ./bench_sdlog [-n RECORDS] [-l LEGACY_RECORDS] [-g GROUP] [-s] [-d DIR]
+ *     -n  liczba rekordów dla sdlog (domyślnie 1000000)
+ *     -l  liczba rekordów dla legacy (domyślnie 2000, koszt rośnie kwadratowo)
+ *     -g  okno trwałości sdlog w rekordach (domyślnie 1 = commit po każdym,
+ *         0 = tylko pełne sektory)
+ *     -s  fsync przy każdym commit (jak w firmware; wolne na dysku PC).
+ *         Bez -s commit kończy się na przekazaniu danych do systemu plików.
+ *     -d  katalog na pliki tymczasowe (domyślnie /tmp)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sdlog.h"
+
+#define MAX_DECADES 8
+
+typedef struct {
+    double sum_us[MAX_DECADES];
+    double max_us[MAX_DECADES];
+    uint32_t count[MAX_DECADES];
+} decade_stats_t;
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Dekada rekordu: 1 -> 0, 2..10 -> 1, 11..100 -> 2, ...
+static int decade_of(uint32_t n)
+{
+    int d = 0;
+    uint32_t limit = 1;
+    while (n > limit && d < MAX_DECADES - 1) {
+        limit *= 10;
+        d++;
+    }
+    return d;
+}
+
+static void stats_add(decade_stats_t *st, uint32_t n, double us)
+{
+    int d = decade_of(n);
+    st->sum_us[d] += us;
+    if (us > st->max_us[d]) st->max_us[d] = us;
+    st->count[d]++;
+}
+
+static void stats_print(const char *name, const decade_stats_t *st)
+{
+    printf("\n%s\n", name);
+    printf("  %-20s %12s %12s %10s\n", "records", "avg [us]", "max [us]", "samples");
+    uint32_t lo = 1, hi = 1;
+    for (int d = 0; d < MAX_DECADES; d++) {
+        if (st->count[d]) {
+            char range[32];
+            if (lo == hi) snprintf(range, sizeof(range), "%u", lo);
+            else snprintf(range, sizeof(range), "%u-%u", lo, hi);
+            printf("  %-20s %12.2f %12.2f %10u\n", range,
+                   st->sum_us[d] / st->count[d], st->max_us[d], st->count[d]);
+        }
+        lo = hi + 1;
+        hi *= 10;
+    }
+}
+
+static void make_record(char *buf, size_t len, uint32_t i)
+{
+    snprintf(buf, len,
+             "{\"timestamp\":\"2025-10-%02u %02u:%02u:%02u\",\"temp_ds18\":%.2f,\"temp_dht\":%.2f,"
+             "\"humidity\":%.2f,\"light\":%.2f,\"ph\":%.2f}",
+             1 + (i / 86400) % 28, (i / 3600) % 24, (i / 60) % 60, i % 60,
+             20.0 + (i % 50) / 10.0, 21.0 + (i % 40) / 10.0, 60.0 + (i % 30) / 10.0,
+             400.0 + (i % 200), 5.5 + (i % 10) / 10.0);
+}
+
+static int bench_sdlog(const char *path, uint32_t n, uint32_t group, int sync_each)
+{
+    decade_stats_t st = {0};
+    static sdlog_t log;
+    char rec[SDLOG_LINE_MAX];
+
+    unlink(path);
+    if (sdlog_open(&log, path) != ESP_OK) return 1;
+    sdlog_config_t cfg = { .max_records = group, .max_age_ms = 0, .fsync = sync_each };
+    sdlog_set_config(&log, &cfg);
+
+    double t_total = now_us();
+    for (uint32_t i = 1; i <= n; i++) {
+        make_record(rec, sizeof(rec), i);
+        double t0 = now_us();
+        if (sdlog_append_line(&log, rec) != ESP_OK) {
+            fprintf(stderr, "append failed at %u\n", i);
+            sdlog_close(&log);
+            return 1;
+        }
+        stats_add(&st, i, now_us() - t0);
+    }
+    t_total = now_us() - t_total;
+    uint64_t bytes = log.bytes;
+    sdlog_close(&log);
+    const sdlog_stats_t *ls = &log.stats;
+
+    char name[96];
+    snprintf(name, sizeof(name), "sdlog (append-only, persistent handle, group commit %u)", group);
+    stats_print(name, &st);
+    printf("  total: %u records, %.1f MiB, %.2f s\n", n, bytes / 1048576.0, t_total / 1e6);
+    printf("  commits: %u (fill %u, records %u, age %u, sync %u)\n",
+           ls->flushes, ls->flushes_fill, ls->flushes_records, ls->flushes_age, ls->flushes_sync);
+    printf("  sectors written: %llu, write amplification: %.2f\n",
+           (unsigned long long)ls->sectors_written, sdlog_write_amplification(ls));
+    unlink(path);
+    return 0;
+}
+
+// Wzorzec starego sensor_json_append: wczytaj cały plik, dołóż rekord, zapisz całość
+static int bench_legacy(const char *path, uint32_t n, int sync_each)
+{
+    decade_stats_t st = {0};
+    char rec[SDLOG_LINE_MAX];
+
+    unlink(path);
+    for (uint32_t i = 1; i <= n; i++) {
+        make_record(rec, sizeof(rec), i);
+        double t0 = now_us();
+
+        char *data = NULL;
+        long size = 0;
+        FILE *f = fopen(path, "r");
+        if (f) {
+            fseek(f, 0, SEEK_END);
+            size = ftell(f);
+            fseek(f, 0, SEEK_SET);
+            data = malloc(size + 1);
+            if (!data || fread(data, 1, size, f) != (size_t)size) {
+                fclose(f);
+                free(data);
+                return 1;
+            }
+            fclose(f);
+            size -= 2;  // zdejmij "]\n"
+        }
+
+        f = fopen(path, "w");
+        if (!f) {
+            free(data);
+            return 1;
+        }
+        if (data) {
+            fwrite(data, 1, size, f);
+            fprintf(f, ",\n\t%s]\n", rec);
+        } else {
+            fprintf(f, "[\n\t%s]\n", rec);
+        }
+        fflush(f);
+        if (sync_each) fsync(fileno(f));
+        fclose(f);
+        free(data);
+
+        stats_add(&st, i, now_us() - t0);
+    }
+
+    stats_print("legacy (read + rewrite whole file)", &st);
+    unlink(path);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    uint32_t n = 1000000;
+    uint32_t legacy_n = 2000;
+    uint32_t group = 1;
+    int sync_each = 0;
+    const char *dir = "/tmp";
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:l:g:sd:")) != -1) {
+        switch (opt) {
+            case 'n': n = strtoul(optarg, NULL, 10); break;
+            case 'l': legacy_n = strtoul(optarg, NULL, 10); break;
+            case 'g': group = strtoul(optarg, NULL, 10); break;
+            case 's': sync_each = 1; break;
+            case 'd': dir = optarg; break;
+            default:
+                fprintf(stderr, "usage: %s [-n RECORDS] [-l LEGACY_RECORDS] [-g GROUP] [-s] [-d DIR]\n", argv[0]);
+                return 2;
+        }
+    }
+
+    char path[SDLOG_PATH_MAX];
+    snprintf(path, sizeof(path), "%s/BENCH.LOG", dir);
+
+    printf("bench_sdlog: %u records (legacy: %u), fsync per commit: %s\n",
+           n, legacy_n, sync_each ? "yes" : "no");
+
+    if (n && bench_sdlog(path, n, group, sync_each) != 0) return 1;
+    if (legacy_n && bench_legacy(path, legacy_n, sync_each) != 0) return 1;
+    return 0;
+}
@@ -0,0 +1,201 @@
+/*
+ * Dekoder binarnego logu pomiarów (src/logrec.h) do NDJSON.
+ *
+ * Wynik ma format pliku das_tower_data.json czytanego przez das_tower_viewer.py,
+ * więc karty z terenu można przeglądać bez zmian w przeglądarce:
+ *
+ *   ./dasdecode /media/sd/LOG/2026*.DAT > das_tower_data.json
+ *
+ * Pola są dekodowane wyłącznie na podstawie schematu z nagłówka pliku.
+ * Rekordy z błędnym CRC są pomijane i liczone.
+ *
+ * Zakres czasu z katalogu logu dziennego (przez indeks .IDX, src/logstore.h):
+ *
+ *   ./dasdecode -r 1760486400:1761091200 /media/sd/LOG > tydzien.json
+ *
+ * Kompilacja (z katalogu tools/):
+ *   gcc -O2 -Ihost -I../src -o dasdecode dasdecode.c ../src/logrec.c ../src/logstore.c ../src/cborenc.c ../src/jsonw.c
+ *
+ * Użycie:
+ *   ./dasdecode [-o OUT] [-s] FILE...
+ *   ./dasdecode [-o OUT] [-s] -r T0:T1 DIR
+ *     -o  plik wyjściowy (domyślnie stdout)
+ *     -s  statystyki na stderr
+ *     -r  rekordy z zakresu [T0, T1) (sekundy czasu RTC) z katalogu DIR
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+
+#include "logrec.h"
+#include "logstore.h"
+
+#define READ_CHUNK_RECORDS 128
+
+typedef struct {
+    uint64_t records;
+    uint64_t bad_crc;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+} decode_stats_t;
+
+static int decode_file(const char *path, FILE *out, decode_stats_t *st)
+{
+    FILE *in = fopen(path, "rb");
+    if (!in) {
+        perror(path);
+        return 1;
+    }
+
+    logrec_header_t hdr;
+    if (fread(&hdr, 1, sizeof(hdr), in) != sizeof(hdr)) {
+        fprintf(stderr, "%s: file too short for header\n", path);
+        fclose(in);
+        return 1;
+    }
+    esp_err_t err = logrec_header_check(&hdr);
+    if (err != ESP_OK) {
+        fprintf(stderr, "%s: invalid header (%s)\n", path, esp_err_to_name(err));
+        fclose(in);
+        return 1;
+    }
+    st->bytes_in += sizeof(hdr);
+
+    size_t rec_size = hdr.record_size;
+    uint8_t *chunk = malloc(rec_size * READ_CHUNK_RECORDS);
+    if (!chunk) {
+        fclose(in);
+        return 1;
+    }
+
+    char line[1024];
+    size_t got;
+    while ((got = fread(chunk, 1, rec_size * READ_CHUNK_RECORDS, in)) > 0) {
+        st->bytes_in += got;
+        size_t n = got / rec_size;
+
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t *rec = chunk + i * rec_size;
+            // CRC zawsze w ostatnich 2 bajtach rekordu
+            uint16_t crc;
+            memcpy(&crc, rec + rec_size - 2, sizeof(crc));
+            if (crc != logrec_crc16(rec, rec_size - 2)) {
+                st->bad_crc++;
+                continue;
+            }
+
+            int len = logrec_format_ndjson(&hdr, rec, line, sizeof(line));
+            if (len < 0) {
+                st->bad_crc++;
+                continue;
+            }
+            fputs(line, out);
+            fputc('\n', out);
+            st->records++;
+            st->bytes_out += (uint64_t)len + 1;
+        }
+
+        if (got % rec_size) {
+            fprintf(stderr, "%s: ignoring %zu trailing bytes (torn record)\n", path, got % rec_size);
+        }
+    }
+
+    free(chunk);
+    fclose(in);
+    return 0;
+}
+
+typedef struct {
+    FILE *out;
+    logrec_header_t hdr;
+    decode_stats_t *st;
+} range_ctx_t;
+
+static bool range_cb(const logrec_t *rec, void *arg)
+{
+    range_ctx_t *ctx = arg;
+    char line[1024];
+    int len = logrec_format_ndjson(&ctx->hdr, rec, line, sizeof(line));
+    if (len < 0) return true;
+    fputs(line, ctx->out);
+    fputc('\n', ctx->out);
+    ctx->st->records++;
+    ctx->st->bytes_in += sizeof(*rec);
+    ctx->st->bytes_out += (uint64_t)len + 1;
+    return true;
+}
+
+static int decode_range(const char *dir, uint32_t t0, uint32_t t1, FILE *out, decode_stats_t *st)
+{
+    range_ctx_t ctx = { .out = out, .st = st };
+    logrec_header_init(&ctx.hdr, 0);
+
+    logstore_range_stats_t rs;
+    if (logstore_read_range(dir, t0, t1, range_cb, &ctx, &rs) != ESP_OK) {
+        fprintf(stderr, "invalid range %u:%u\n", (unsigned)t0, (unsigned)t1);
+        return 1;
+    }
+    st->bad_crc += rs.bad_crc;
+    fprintf(stderr, "range: %u files opened, %u records read, %u matched\n",
+            (unsigned)rs.files, (unsigned)rs.records_read, (unsigned)rs.records_matched);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = NULL;
+    int show_stats = 0;
+    int range = 0;
+    unsigned long t0 = 0, t1 = 0;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "o:sr:")) != -1) {
+        switch (opt) {
+            case 'o': out_path = optarg; break;
+            case 's': show_stats = 1; break;
+            case 'r':
+                if (sscanf(optarg, "%lu:%lu", &t0, &t1) != 2) goto usage;
+                range = 1;
+                break;
+            default:
+                goto usage;
+        }
+    }
+    if (optind >= argc || (range && optind + 1 != argc)) goto usage;
+
+    FILE *out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+    }
+
+    decode_stats_t st = {0};
+    int ret = 0;
+    if (range) {
+        ret = decode_range(argv[optind], (uint32_t)t0, (uint32_t)t1, out, &st);
+    } else {
+        for (int i = optind; i < argc; i++) {
+            ret |= decode_file(argv[i], out, &st);
+        }
+    }
+
+    if (out != stdout) fclose(out);
+
+    if (show_stats) {
+        fprintf(stderr, "records: %llu, bad CRC: %llu, binary: %llu B, NDJSON: %llu B (%.1fx)\n",
+                (unsigned long long)st.records, (unsigned long long)st.bad_crc,
+                (unsigned long long)st.bytes_in, (unsigned long long)st.bytes_out,
+                st.bytes_in ? (double)st.bytes_out / st.bytes_in : 0.0);
+    }
+    return ret;
+
+usage:
+    fprintf(stderr, "usage: %s [-o OUT] [-s] FILE...\n"
+                    "       %s [-o OUT] [-s] -r T0:T1 DIR\n", argv[0], argv[0]);
+    return 2;
+}
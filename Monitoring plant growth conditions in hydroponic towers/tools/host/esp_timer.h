@@ -0,0 +1,18 @@
+/*
+ * Minimalny zamiennik esp_timer.h do kompilacji modułów firmware na PC.
+ * esp_timer_get_time() zwraca czas monotoniczny w mikrosekundach.
+ */
+#ifndef HOST_ESP_TIMER_H
+#define HOST_ESP_TIMER_H
+
+#include <stdint.h>
+#include <time.h>
+
+static inline int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+#endif // HOST_ESP_TIMER_H
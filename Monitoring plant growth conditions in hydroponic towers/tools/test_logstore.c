@@ -0,0 +1,415 @@
+/*
+ * Test logstore na PC: usuwanie rekordów (logstore_purge), retencja, odczyt
+ * plików starszej wersji (v1, rekord 32 B) i wysyłka zaległości po usuwaniu
+ * (kursor outboxa po outbox_realign).
+ *
+ * Tworzy w katalogu tymczasowym pliki dób w tym samym formacie co firmware
+ * (nagłówek + rekordy logrec_t), wykonuje na nich operacje i sprawdza przez
+ * logstore_read_range, które rekordy zostały, a które zniknęły. Kod logstore
+ * jest ten sam co w firmware (komendy UART PURGE:BEFORE / PURGE:FIELD).
+ *
+ * Kompilacja (z katalogu tools/):
+ *   gcc -O2 -Ihost -I../src -o test_logstore test_logstore.c ../src/logrec.c ../src/logstore.c ../src/cborenc.c ../src/jsonw.c
+ *
+ * Użycie:
+ *   ./test_logstore        (kod wyjścia 0 = wszystkie testy OK)
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "logrec.h"
+#include "logstore.h"
+
+#define DAY             LOGSTORE_SECONDS_PER_DAY
+#define BASE_DAY        20376u              // 2025-10-15
+#define RECORDS_PER_DAY 48                  // Co 30 min
+#define PH_A            700
+#define PH_B            650
+
+static int failures = 0;
+
+#define CHECK(cond, ...) do {                                   \
+        if (!(cond)) {                                          \
+            fprintf(stderr, "FAIL %s:%d: ", __FILE__, __LINE__); \
+            fprintf(stderr, __VA_ARGS__);                       \
+            fputc('\n', stderr);                                \
+            failures++;                                         \
+        }                                                       \
+    } while (0)
+
+/********************
+ * Przygotowanie katalogu
+ ********************/
+static void clear_dir(const char *dir)
+{
+    DIR *d = opendir(dir);
+    if (!d) return;
+    struct dirent *de;
+    char path[512];
+    while ((de = readdir(d)) != NULL) {
+        if (de->d_name[0] == '.') continue;
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        unlink(path);
+    }
+    closedir(d);
+}
+
+// Plik doby: rekordy co 30 min, pH na przemian PH_A / PH_B, seq ciągły między dobami
+static void write_day(const char *dir, uint32_t day)
+{
+    char path[LOGSTORE_PATH_MAX];
+    logstore_day_path(dir, day * DAY, "DAT", path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+
+    logrec_header_t hdr;
+    logrec_header_init(&hdr, day * DAY);
+    fwrite(&hdr, 1, sizeof(hdr), f);
+    for (uint32_t i = 0; i < RECORDS_PER_DAY; i++) {
+        logrec_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.seq = (day - BASE_DAY) * RECORDS_PER_DAY + i;
+        rec.timestamp = day * DAY + i * (DAY / RECORDS_PER_DAY);
+        rec.ph = (i % 2) ? PH_B : PH_A;
+        rec.temp_ds18 = 2000 + (int16_t)i;
+        logrec_seal(&rec);
+        fwrite(&rec, 1, sizeof(rec), f);
+    }
+    fclose(f);
+
+    char idx[LOGSTORE_PATH_MAX];
+    logstore_day_path(dir, day * DAY, "IDX", idx, sizeof(idx));
+    logstore_index_rebuild(path, idx);
+}
+
+// Plik doby w formacie v1: rekord 32 B = pola do flags/reserved + CRC, bez sond
+#define V1_RECORD_SIZE  32
+
+static void write_day_v1(const char *dir, uint32_t day)
+{
+    logrec_header_t hdr;
+    logrec_header_init(&hdr, day * DAY);
+    logrec_header_t v1 = hdr;
+    memset(v1.fields, 0, sizeof(v1.fields));
+    v1.field_count = 0;
+    for (int i = 0; i < hdr.field_count; i++) {
+        if (hdr.fields[i].offset < V1_RECORD_SIZE - 2) v1.fields[v1.field_count++] = hdr.fields[i];
+    }
+    v1.version = 1;
+    v1.record_size = V1_RECORD_SIZE;
+    v1.crc = logrec_crc16(&v1, offsetof(logrec_header_t, crc));
+
+    char path[LOGSTORE_PATH_MAX];
+    logstore_day_path(dir, day * DAY, "DAT", path, sizeof(path));
+    FILE *f = fopen(path, "wb");
+    if (!f) {
+        perror(path);
+        exit(1);
+    }
+    fwrite(&v1, 1, sizeof(v1), f);
+    for (uint32_t i = 0; i < RECORDS_PER_DAY; i++) {
+        logrec_t rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.seq = (day - BASE_DAY) * RECORDS_PER_DAY + i;
+        rec.timestamp = day * DAY + i * (DAY / RECORDS_PER_DAY);
+        rec.ph = (i % 2) ? PH_B : PH_A;
+
+        uint8_t raw[V1_RECORD_SIZE];
+        memcpy(raw, &rec, V1_RECORD_SIZE - 2);
+        uint16_t crc = logrec_crc16(raw, V1_RECORD_SIZE - 2);
+        memcpy(raw + V1_RECORD_SIZE - 2, &crc, sizeof(crc));
+        fwrite(raw, 1, sizeof(raw), f);
+    }
+    fclose(f);
+}
+
+static bool day_exists(const char *dir, uint32_t day)
+{
+    char path[LOGSTORE_PATH_MAX];
+    struct stat st;
+    logstore_day_path(dir, day * DAY, "DAT", path, sizeof(path));
+    return stat(path, &st) == 0;
+}
+
+/********************
+ * Sprawdzanie zawartości
+ ********************/
+typedef struct {
+    uint32_t count;
+    uint32_t ph_a;
+    uint32_t before;              // Rekordy z timestamp < limit
+    uint32_t limit;
+    uint32_t last_seq;
+    bool ordered;
+} scan_t;
+
+static bool scan_cb(const logrec_t *rec, void *arg)
+{
+    scan_t *s = arg;
+    if (s->count && rec->seq <= s->last_seq) s->ordered = false;
+    s->last_seq = rec->seq;
+    s->count++;
+    if (rec->ph == PH_A) s->ph_a++;
+    if (rec->timestamp < s->limit) s->before++;
+    return true;
+}
+
+static scan_t scan(const char *dir, uint32_t limit)
+{
+    scan_t s = { .limit = limit, .ordered = true };
+    logstore_range_stats_t rs;
+    logstore_read_range(dir, 0, UINT32_MAX, scan_cb, &s, &rs);
+    CHECK(rs.bad_crc == 0, "bad CRC after rewrite: %u", rs.bad_crc);
+    return s;
+}
+
+/********************
+ * Testy
+ ********************/
+static void test_purge_field(const char *dir)
+{
+    clear_dir(dir);
+    for (uint32_t d = 0; d < 3; d++) write_day(dir, BASE_DAY + d);
+
+    logstore_field_match_t m = { .field = "ph", .raw = PH_A };
+    logstore_purge_stats_t ps;
+    CHECK(logstore_purge(dir, logstore_keep_unless_field, &m, UINT32_MAX, NULL, &ps) == ESP_OK,
+          "purge field");
+    CHECK(ps.records_deleted == 3 * RECORDS_PER_DAY / 2, "deleted %u", ps.records_deleted);
+    CHECK(ps.files_rewritten == 3 && ps.files_deleted == 0, "rewritten %u deleted %u",
+          ps.files_rewritten, ps.files_deleted);
+
+    scan_t s = scan(dir, 0);
+    CHECK(s.count == 3 * RECORDS_PER_DAY / 2, "kept %u", s.count);
+    CHECK(s.ph_a == 0, "records with ph=%d left: %u", PH_A, s.ph_a);
+    CHECK(s.ordered, "seq order broken");
+
+    // Drugi przebieg nie ma czego usuwać - pliki zostają bez zmian
+    CHECK(logstore_purge(dir, logstore_keep_unless_field, &m, UINT32_MAX, NULL, &ps) == ESP_OK,
+          "purge field again");
+    CHECK(ps.records_deleted == 0 && ps.files_rewritten == 0 && ps.files_checked == 3,
+          "second pass: deleted %u rewritten %u checked %u",
+          ps.records_deleted, ps.files_rewritten, ps.files_checked);
+}
+
+static void test_purge_before(const char *dir)
+{
+    clear_dir(dir);
+    for (uint32_t d = 0; d < 3; d++) write_day(dir, BASE_DAY + d);
+
+    // Granica w połowie drugiej doby: pierwsza doba znika, druga traci połowę
+    uint32_t before = (BASE_DAY + 1) * DAY + DAY / 2;
+    logstore_purge_stats_t ps;
+    CHECK(logstore_purge(dir, logstore_keep_newer_than, &before, before / DAY, NULL, &ps) == ESP_OK,
+          "purge before");
+    CHECK(ps.records_deleted == RECORDS_PER_DAY + RECORDS_PER_DAY / 2, "deleted %u", ps.records_deleted);
+    CHECK(ps.files_deleted == 1 && ps.files_rewritten == 1 && ps.files_checked == 2,
+          "deleted %u rewritten %u checked %u", ps.files_deleted, ps.files_rewritten, ps.files_checked);
+    CHECK(!day_exists(dir, BASE_DAY), "first day still present");
+    CHECK(day_exists(dir, BASE_DAY + 2), "last day removed");
+
+    scan_t s = scan(dir, before);
+    CHECK(s.before == 0, "records older than limit left: %u", s.before);
+    CHECK(s.count == RECORDS_PER_DAY + RECORDS_PER_DAY / 2, "kept %u", s.count);
+
+    // Pominięty plik (otwarty log) nie jest ruszany
+    char path[LOGSTORE_PATH_MAX];
+    logstore_day_path(dir, (BASE_DAY + 2) * DAY, "DAT", path, sizeof(path));
+    const char *skip = strrchr(path, '/') + 1;
+    uint32_t all = UINT32_MAX;
+    CHECK(logstore_purge(dir, logstore_keep_newer_than, &all, UINT32_MAX, skip, &ps) == ESP_OK,
+          "purge all but skip");
+    CHECK(day_exists(dir, BASE_DAY + 2) && !day_exists(dir, BASE_DAY + 1), "skip not honoured");
+}
+
+// Odczyt jak w outboxie (file_read): od kursora (day, offset) przez kolejne doby,
+// rekordy z seq <= acked_seq są pomijane. Zwraca liczbę rekordów do wysłania.
+static uint32_t unsent_from(const char *dir, uint32_t day, uint32_t offset, uint32_t acked_seq,
+                            uint32_t last_day, uint32_t *first_seq)
+{
+    uint32_t count = 0;
+    for (; day <= last_day; day++, offset = LOGREC_HEADER_SIZE) {
+        char path[LOGSTORE_PATH_MAX];
+        logstore_day_path(dir, day * DAY, "DAT", path, sizeof(path));
+        logstore_reader_t rd;
+        if (logstore_reader_open(&rd, path) != ESP_OK) continue;
+        if (logstore_reader_seek(&rd, offset)) {
+            logrec_t recs[8];
+            bool valid[8];
+            size_t n;
+            while ((n = logstore_reader_read(&rd, recs, 8, valid)) > 0) {
+                for (size_t i = 0; i < n; i++) {
+                    if (!valid[i] || recs[i].seq <= acked_seq) continue;
+                    if (count++ == 0) *first_seq = recs[i].seq;
+                }
+            }
+        }
+        logstore_reader_close(&rd);
+    }
+    return count;
+}
+
+static void test_purge_unsent(const char *dir)
+{
+    clear_dir(dir);
+    for (uint32_t d = 0; d < 3; d++) write_day(dir, BASE_DAY + d);
+
+    // Kursor outboxa: potwierdzone 20 pierwszych rekordów drugiej doby, reszta czeka
+    uint32_t cursor_day = BASE_DAY + 1;
+    uint32_t acked = RECORDS_PER_DAY + 19;
+    uint32_t cursor_off = LOGREC_HEADER_SIZE + 20 * LOGREC_RECORD_SIZE;
+    uint32_t first = 0;
+    CHECK(unsent_from(dir, cursor_day, cursor_off, acked, BASE_DAY + 2, &first) == 2 * RECORDS_PER_DAY - 20,
+          "unsent before purge");
+
+    logstore_field_match_t m = { .field = "ph", .raw = PH_A };
+    logstore_purge_stats_t ps;
+    CHECK(logstore_purge(dir, logstore_keep_unless_field, &m, UINT32_MAX, NULL, &ps) == ESP_OK,
+          "purge field");
+    CHECK(ps.first_day == BASE_DAY, "first changed day %u", ps.first_day);
+
+    // Niepotwierdzone rekordy, które przetrwały usuwanie (pH = PH_B, nieparzyste)
+    uint32_t expected = (2 * RECORDS_PER_DAY - 20) / 2;
+
+    // Stary offset wskazuje teraz dalej niż pierwszy niepotwierdzony rekord
+    uint32_t stale = unsent_from(dir, cursor_day, cursor_off, acked, BASE_DAY + 2, &first);
+    CHECK(stale < expected, "stale cursor offset should skip records (%u of %u)", stale, expected);
+
+    // outbox_realign: kursor w przepisanej dobie wraca na jej początek, seq odsiewa potwierdzone
+    uint32_t off = cursor_day >= ps.first_day ? LOGREC_HEADER_SIZE : cursor_off;
+    uint32_t n = unsent_from(dir, cursor_day, off, acked, BASE_DAY + 2, &first);
+    CHECK(n == expected, "unsent after realign: %u, expected %u", n, expected);
+    CHECK(first == acked + 2, "first unsent seq %u, expected %u", first, acked + 2);
+}
+
+static void test_retention(const char *dir)
+{
+    clear_dir(dir);
+    // Luki w dobach: retencja ma przejść tylko po istniejących plikach
+    write_day(dir, BASE_DAY);
+    write_day(dir, BASE_DAY + 40);
+    write_day(dir, BASE_DAY + 95);
+    write_day(dir, BASE_DAY + 99);
+    write_day(dir, BASE_DAY + 100);
+
+    uint32_t now = (BASE_DAY + 100) * DAY + 3600;
+    logstore_retention_t policy = {
+        .downsample_age_sec = 2 * DAY,
+        .bucket_sec = 3 * 3600,
+        .delete_age_sec = 30 * DAY,
+    };
+    logstore_retention_stats_t rs;
+    CHECK(logstore_retention(dir, now, &policy, NULL, &rs) == ESP_OK, "retention");
+    CHECK(rs.files_deleted == 2 && rs.files_compacted == 1 && rs.files_checked == 3,
+          "deleted %u compacted %u checked %u", rs.files_deleted, rs.files_compacted, rs.files_checked);
+    CHECK(!day_exists(dir, BASE_DAY) && !day_exists(dir, BASE_DAY + 40), "old days kept");
+    CHECK(day_exists(dir, BASE_DAY + 95) && day_exists(dir, BASE_DAY + 99) &&
+          day_exists(dir, BASE_DAY + 100), "young days removed");
+
+    // Doba 95 uśredniona do 8 przedziałów, 99 i 100 bez zmian
+    scan_t s = scan(dir, (BASE_DAY + 96) * DAY);
+    CHECK(s.before == 24 / 3, "averaged records: %u", s.before);
+    CHECK(s.count == 24 / 3 + 2 * RECORDS_PER_DAY, "total %u", s.count);
+}
+
+static void test_range_sparse(const char *dir)
+{
+    clear_dir(dir);
+    write_day(dir, BASE_DAY);
+    write_day(dir, BASE_DAY + 1000);
+
+    // Pełny zakres (READ:0:4294967295) otwiera tylko istniejące pliki
+    scan_t s = { .ordered = true };
+    logstore_range_stats_t rs;
+    CHECK(logstore_read_range(dir, 0, UINT32_MAX, scan_cb, &s, &rs) == ESP_OK, "full range");
+    CHECK(rs.files == 2 && s.count == 2 * RECORDS_PER_DAY, "files %u records %u", rs.files, s.count);
+
+    // Zakres od połowy pierwszej doby do początku drugiego pliku
+    s = (scan_t){ .ordered = true };
+    CHECK(logstore_read_range(dir, BASE_DAY * DAY + DAY / 2, (BASE_DAY + 1000) * DAY + 1, scan_cb, &s, &rs) == ESP_OK,
+          "partial range");
+    CHECK(rs.files == 2 && s.count == RECORDS_PER_DAY / 2 + 1, "files %u records %u", rs.files, s.count);
+}
+
+static void test_read_v1(const char *dir)
+{
+    clear_dir(dir);
+    write_day_v1(dir, BASE_DAY);
+
+    char path[LOGSTORE_PATH_MAX];
+    logstore_day_path(dir, BASE_DAY * DAY, "DAT", path, sizeof(path));
+
+    // Czytnik dekoduje rekordy wg nagłówka; offset niewyrównany idzie w dół do rekordu
+    logstore_reader_t rd;
+    CHECK(logstore_reader_open(&rd, path) == ESP_OK, "open v1");
+    CHECK(rd.upgrade && rd.record_size == V1_RECORD_SIZE, "upgrade %d record_size %u",
+          rd.upgrade, rd.record_size);
+    CHECK(logstore_reader_seek(&rd, LOGREC_HEADER_SIZE + 5 * V1_RECORD_SIZE + 7), "seek");
+    CHECK(rd.offset == LOGREC_HEADER_SIZE + 5 * V1_RECORD_SIZE, "aligned offset %u", rd.offset);
+
+    logrec_t recs[4];
+    bool valid[4];
+    size_t n = logstore_reader_read(&rd, recs, 4, valid);
+    CHECK(n == 4, "read %zu", n);
+    for (size_t i = 0; i < n; i++) {
+        CHECK(valid[i] && recs[i].seq == 5 + i, "record %zu: valid %d seq %u", i, valid[i], recs[i].seq);
+        CHECK(recs[i].ph == ((5 + i) % 2 ? PH_B : PH_A), "record %zu: ph %u", i, recs[i].ph);
+        CHECK(recs[i].temp_probe[0] == LOGREC_NA_I16, "record %zu: probe not NA", i);
+        CHECK(logrec_is_valid(&recs[i]), "record %zu: not resealed", i);
+    }
+    CHECK(rd.offset == LOGREC_HEADER_SIZE + 9 * V1_RECORD_SIZE, "offset after read %u", rd.offset);
+    logstore_reader_close(&rd);
+
+    scan_t s = scan(dir, 0);
+    CHECK(s.count == RECORDS_PER_DAY && s.ph_a == RECORDS_PER_DAY / 2 && s.ordered,
+          "v1 range: count %u ph_a %u", s.count, s.ph_a);
+
+    // Przepisanie do bieżącej wersji: te same rekordy, rozmiar logrec_t
+    logstore_compact_t upgrade = {0};
+    char name[16];
+    strcpy(name, strrchr(path, '/') + 1);
+    CHECK(logstore_compact_file(dir, name, &upgrade, NULL) == ESP_OK, "upgrade v1");
+    CHECK(logstore_reader_open(&rd, path) == ESP_OK, "open upgraded");
+    CHECK(!rd.upgrade && rd.record_size == LOGREC_RECORD_SIZE &&
+          rd.size == LOGREC_HEADER_SIZE + RECORDS_PER_DAY * LOGREC_RECORD_SIZE,
+          "upgraded: record_size %u size %u", rd.record_size, rd.size);
+    logstore_reader_close(&rd);
+
+    s = scan(dir, 0);
+    CHECK(s.count == RECORDS_PER_DAY && s.ph_a == RECORDS_PER_DAY / 2, "upgraded range: count %u", s.count);
+}
+
+int main(void)
+{
+    char dir[] = "/tmp/logstoreXXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+
+    test_purge_field(dir);
+    test_purge_before(dir);
+    test_purge_unsent(dir);
+    test_retention(dir);
+    test_range_sparse(dir);
+    test_read_v1(dir);
+
+    clear_dir(dir);
+    rmdir(dir);
+
+    if (failures) {
+        fprintf(stderr, "%d check(s) failed\n", failures);
+        return 1;
+    }
+    printf("test_logstore: OK\n");
+    return 0;
+}